@@ -0,0 +1,91 @@
+/**
+ * @file AccelFifo.h
+ * @brief KX134 sample-buffer frame decoding and timestamp reconstruction
+ *
+ * In buffered mode the KX134 collects samples on chip and the MCU drains them in one SPI
+ * burst, so individual samples have no MCU timestamp. FifoSampleClock rebuilds them from the
+ * ODR period and the time of each burst read: the newest sample of a burst that empties the
+ * buffer was produced at most one period before the read. Successive bursts continue the
+ * previous timeline at exactly one period per sample, and are pulled back inside that window
+ * whenever the sensor's clock drifts from nominal or samples were discarded.
+ *
+ * Pure logic, no Arduino dependency, so it is covered by host tests.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** Bytes per sample in the buffer at 16-bit resolution (X, Y, Z little-endian). */
+static constexpr size_t KX134_BUFFER_SAMPLE_BYTES = 6;
+/** Buffer capacity in samples at 16-bit resolution. */
+static constexpr size_t KX134_BUFFER_MAX_SAMPLES = 86;
+
+/**
+ * @brief Sample period for a KX134 ODR code (OSA bits, 0.781 Hz * 2^code)
+ * @param odrCode 0..15, e.g. 6 = 50 Hz, 9 = 400 Hz, 11 = 1600 Hz
+ * @return Period in microseconds (exact down to code 11)
+ */
+constexpr uint32_t kx134OdrPeriodUs(uint8_t odrCode) { return 1280000UL >> (odrCode & 0x0F); }
+
+/** @brief Decode one 6-byte buffer frame into X/Y/Z counts */
+inline void kx134DecodeBufferSample(const uint8_t* bytes, int16_t raw[3]) {
+    for (int axis = 0; axis < 3; ++axis) {
+        raw[axis] = static_cast<int16_t>(static_cast<uint16_t>(bytes[2 * axis]) |
+                                         (static_cast<uint16_t>(bytes[2 * axis + 1]) << 8));
+    }
+}
+
+/**
+ * @class FifoSampleClock
+ * @brief Timestamps for samples read back from the KX134 buffer in bursts
+ */
+class FifoSampleClock {
+public:
+    FifoSampleClock() : _periodUs(0), _lastUs(0), _started(false) {}
+
+    /** Start a new timeline (after an ODR change or buffer clear). */
+    void reset(uint32_t periodUs) {
+        _periodUs = periodUs;
+        _lastUs = 0;
+        _started = false;
+    }
+
+    uint32_t periodUs() const { return _periodUs; }
+
+    /**
+     * @brief Timestamp n samples of one burst that drained the buffer at readUs
+     * @param readUs micros() taken when the burst read started
+     * @param n Samples in the burst, oldest first
+     * @param out n timestamps (us); out[n - 1] is the newest sample
+     */
+    void stamp(uint32_t readUs, size_t n, uint32_t* out) {
+        if (n == 0) {
+            return;
+        }
+        // The newest sample was produced in (readUs - period, readUs].
+        const uint32_t earliest = readUs - _periodUs;
+        uint32_t newest;
+        if (!_started) {
+            newest = readUs - _periodUs / 2;
+            _started = true;
+        } else {
+            newest = _lastUs + static_cast<uint32_t>(n) * _periodUs;
+            if (static_cast<int32_t>(newest - readUs) > 0) {
+                newest = readUs;
+            } else if (static_cast<int32_t>(earliest - newest) > 0) {
+                newest = earliest;
+            }
+        }
+        for (size_t i = 0; i < n; ++i) {
+            out[i] = newest - static_cast<uint32_t>(n - 1 - i) * _periodUs;
+        }
+        _lastUs = newest;
+    }
+
+private:
+    uint32_t _periodUs;
+    uint32_t _lastUs;  ///< timestamp given to the newest sample of the previous burst
+    bool _started;
+};
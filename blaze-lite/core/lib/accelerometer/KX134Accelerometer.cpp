@@ -8,7 +8,7 @@
 // Define the SPI settings (declared as extern in header)
 SPISettings kx134Settings(1000000, MSBFIRST, SPI_MODE0);
 
-KX134Accelerometer::KX134Accelerometer() : _initialized(false) {
+KX134Accelerometer::KX134Accelerometer() : _initialized(false), _range(SFE_KX134_RANGE8G), _odr(6) {
 }
 
 KX134Accelerometer::~KX134Accelerometer() {
@@ -46,7 +46,11 @@ bool KX134Accelerometer::setRange(uint8_t range) {
     if (!_initialized) {
         return false;
     }
-    return _kx134.setRange(range);
+    if (!_kx134.setRange(range)) {
+        return false;
+    }
+    _range = range;
+    return true;
 }
 
 bool KX134Accelerometer::enableDataEngine(bool enable) {
@@ -56,11 +60,71 @@ bool KX134Accelerometer::enableDataEngine(bool enable) {
     return _kx134.enableDataEngine(enable);
 }
 
+bool KX134Accelerometer::enableDataReadyInterrupt() {
+    if (!_initialized) {
+        return false;
+    }
+    // BUF_CNTL2: 16-bit samples, stream mode, no buffer interrupt; INC4 bit 4 (DRDYI1) on INT1.
+    return _kx134.setBufferResolution(true) && _kx134.setBufferOperationMode(0x01) && _kx134.enableBufferInt(false) &&
+           _kx134.enableSampleBuffer(true) && _kx134.clearBuffer() && _kx134.setPinMode(true) &&
+           _kx134.setLatchControl(false) && _kx134.routeHardwareInterrupt(0x10) && _kx134.enablePhysInterrupt();
+}
+
+bool KX134Accelerometer::enableSampleBuffer(uint8_t watermark) {
+    if (!_initialized || watermark == 0 || watermark > KX134_BUFFER_MAX_SAMPLES) {
+        return false;
+    }
+    // BUF_CNTL2: 16-bit samples, stream mode, watermark interrupt; INC4 bit 5 (WMI1) on INT1.
+    return _kx134.setBufferResolution(true) && _kx134.setBufferOperationMode(0x01) &&
+           _kx134.setBufferThreshold(watermark) && _kx134.enableBufferInt(true) && _kx134.enableSampleBuffer(true) &&
+           _kx134.clearBuffer() && _kx134.setPinMode(true) && _kx134.setLatchControl(false) &&
+           _kx134.routeHardwareInterrupt(0x20) && _kx134.enablePhysInterrupt();
+}
+
+bool KX134Accelerometer::disableSampleBuffer() {
+    if (!_initialized) {
+        return false;
+    }
+    return _kx134.enableBufferInt(false) && _kx134.enableSampleBuffer(false) && _kx134.clearBuffer();
+}
+
+int KX134Accelerometer::bufferedSampleCount() {
+    if (!_initialized) {
+        return -1;
+    }
+    // BUF_STATUS SMP_LEV counts bytes.
+    return static_cast<int>(_kx134.getSampleLevel() / KX134_BUFFER_SAMPLE_BYTES);
+}
+
+int KX134Accelerometer::readBufferedSamples(uint8_t* frames, size_t maxSamples, int* level) {
+    if (!_initialized || frames == nullptr) {
+        return -1;
+    }
+    const int buffered = bufferedSampleCount();
+    if (level != nullptr) {
+        *level = buffered;
+    }
+    if (buffered <= 0) {
+        return buffered;
+    }
+    const size_t n = static_cast<size_t>(buffered) < maxSamples ? static_cast<size_t>(buffered) : maxSamples;
+    // BUF_READ pops one frame per 6 bytes; reading them all in one transaction keeps CS and
+    // command overhead to a single burst.
+    if (_kx134.readRegisterRegion(SFE_KX13X_BUF_READ, frames, static_cast<uint16_t>(n * KX134_BUFFER_SAMPLE_BYTES)) != 0) {
+        return -1;
+    }
+    return static_cast<int>(n);
+}
+
 bool KX134Accelerometer::setOutputDataRate(uint8_t odr) {
     if (!_initialized) {
         return false;
     }
-    return _kx134.setOutputDataRate(odr);
+    if (!_kx134.setOutputDataRate(odr)) {
+        return false;
+    }
+    _odr = odr;
+    return true;
 }
 
 float KX134Accelerometer::getOutputDataRate() {
@@ -91,6 +155,14 @@ bool KX134Accelerometer::getRawAccelData(rawOutputData *data) {
     return _kx134.getRawAccelData(data);
 }
 
+uint8_t KX134Accelerometer::getRange() const {
+    return _range;
+}
+
+uint8_t KX134Accelerometer::getOutputDataRateCode() const {
+    return _odr;
+}
+
 uint8_t KX134Accelerometer::getUniqueID() {
     if (!_initialized) {
         return 0;
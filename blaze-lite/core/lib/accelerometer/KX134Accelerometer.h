@@ -12,7 +12,20 @@
 #include <SPI.h>
 #include <SparkFun_KX13X.h>
 
+#include "AccelFifo.h"
+
 #define KX134_CS_PIN PB2
+// KX134 INT1 (data ready) -> MCU pin (placeholder, adjust to the board wiring)
+#ifndef KX134_INT1_PIN
+#define KX134_INT1_PIN PB1
+#endif
+// KX134 axis along the rocket body (0=X, 1=Y, 2=Z) and its sign when pointing nose-up
+#ifndef KX134_AXIAL_AXIS
+#define KX134_AXIAL_AXIS 2
+#endif
+#ifndef KX134_AXIAL_SIGN
+#define KX134_AXIAL_SIGN 1
+#endif
 extern SPISettings kx134Settings;
 
 /**
@@ -72,6 +85,49 @@ public:
      */
     bool enableDataEngine(bool enable = true);
 
+    /**
+     * @brief Route data-ready to INT1 as an active-high pulse per sample
+     *
+     * Pulse mode needs no interrupt release, so a sample that is never read does not stop
+     * later edges. Samples also go to the on-chip buffer (stream mode, no buffer interrupt), so
+     * one not read at its edge is still there later; read them with readBufferedSamples().
+     * Call while the accelerometer is disabled (enable(false)).
+     * @return true if operation successful, false otherwise
+     */
+    bool enableDataReadyInterrupt();
+
+    /**
+     * @brief Collect samples in the on-chip buffer and pulse INT1 at the watermark
+     *
+     * Stream mode (oldest sample dropped when full), 16-bit resolution, so the buffer holds up
+     * to KX134_BUFFER_MAX_SAMPLES. Replaces the data-ready routing on INT1. Call while the
+     * accelerometer is disabled (enable(false)).
+     * @param watermark Samples that trigger the interrupt (1..KX134_BUFFER_MAX_SAMPLES)
+     * @return true if operation successful, false otherwise
+     */
+    bool enableSampleBuffer(uint8_t watermark);
+
+    /**
+     * @brief Stop buffering and clear the buffer (call while disabled)
+     * @return true if operation successful, false otherwise
+     */
+    bool disableSampleBuffer();
+
+    /**
+     * @brief Samples waiting in the on-chip buffer
+     * @return Sample count, or -1 on error
+     */
+    int bufferedSampleCount();
+
+    /**
+     * @brief Read up to maxSamples buffered samples in a single SPI burst
+     * @param frames Receives KX134_BUFFER_SAMPLE_BYTES per sample (see kx134DecodeBufferSample())
+     * @param maxSamples Capacity of frames in samples
+     * @param level If not null, receives the samples that were buffered before the read
+     * @return Samples read (oldest first), or -1 on error
+     */
+    int readBufferedSamples(uint8_t* frames, size_t maxSamples, int* level = nullptr);
+
     /**
      * @brief Set the output data rate (ODR)
      * @param odr Output data rate setting (see SparkFun_KX13X_regs.h for values)
@@ -85,6 +141,11 @@ public:
      */
     float getOutputDataRate();
 
+    /**
+     * @brief ODR code last applied with setOutputDataRate() (power-on default 6 = 50 Hz)
+     */
+    uint8_t getOutputDataRateCode() const;
+
     /**
      * @brief Check if new data is ready
      * @return true if data ready, false otherwise
@@ -105,6 +166,12 @@ public:
      */
     bool getRawAccelData(rawOutputData *data);
 
+    /**
+     * @brief Range code last applied with setRange()
+     * @return SFE_KX134_RANGE8G .. SFE_KX134_RANGE64G
+     */
+    uint8_t getRange() const;
+
     /**
      * @brief Get the unique ID of the device
      * @return Unique ID byte
@@ -120,5 +187,7 @@ public:
 private:
     SparkFun_KX134_SPI _kx134;  ///< Underlying SparkFun KX134 SPI object
     bool _initialized;          ///< Initialization status flag
+    uint8_t _range;             ///< Range code applied with setRange()
+    uint8_t _odr;               ///< ODR code applied with setOutputDataRate()
 };
 
@@ -0,0 +1,206 @@
+/**
+ * @file KX134Sampler.cpp
+ * @brief Implementation of KX134Sampler
+ */
+
+#include "KX134Sampler.h"
+
+KX134Sampler::KX134Sampler(KX134Accelerometer& accel)
+    : _accel(accel),
+      _watermark(0),
+      _lockDepth(0),
+      _samples(0),
+      _deferred(0),
+      _lost(0),
+      _readErrors(0),
+      _bursts(0),
+      _maxBurst(0) {
+}
+
+bool KX134Sampler::configure(uint8_t odrCode, uint8_t watermark) {
+    if (!_accel.isReady() || watermark > KX134_BUFFER_MAX_SAMPLES) {
+        return false;
+    }
+    // Hold the bus so the ISR cannot read mid-reconfiguration. Queued edges belong to samples
+    // the reconfiguration clears from the buffer, so they are dropped once no new ones come.
+    lockBus();
+    bool ok = _accel.enable(false) && _accel.setOutputDataRate(odrCode);
+    if (ok) {
+        ok = watermark > 0 ? _accel.enableSampleBuffer(watermark)
+                           : _accel.disableSampleBuffer() && _accel.enableDataReadyInterrupt();
+    }
+    _edges.popBatch(_edgeUs, KX134_EDGE_RING);
+    if (ok) {
+        _clock.reset(kx134OdrPeriodUs(odrCode));
+        _watermark = watermark;
+        ok = _accel.enable(true);
+    }
+    unlockBus();
+    return ok;
+}
+
+uint8_t KX134Sampler::watermark() const {
+    return _watermark;
+}
+
+uint8_t KX134Sampler::watermarkFor(uint8_t odrCode, uint32_t burstMs) {
+    const uint32_t samples = burstMs * 1000 / kx134OdrPeriodUs(odrCode);
+    const uint32_t cap = KX134_BUFFER_MAX_SAMPLES / 2;
+    return static_cast<uint8_t>(samples < 1 ? 1 : (samples > cap ? cap : samples));
+}
+
+bool KX134Sampler::begin(uint8_t intPin, void (*isr)()) {
+    if (!_accel.isReady() || isr == nullptr || digitalPinToInterrupt(intPin) == NOT_AN_INTERRUPT) {
+        return false;
+    }
+    pinMode(intPin, INPUT);
+    attachInterrupt(digitalPinToInterrupt(intPin), isr, RISING);
+    return true;
+}
+
+void KX134Sampler::onDataReady() {
+    const uint32_t now = micros();
+    // A burst (up to KX134_BUFFER_MAX_SAMPLES frames, milliseconds of SPI) is too long for
+    // interrupt context. Behind earlier queued edges a sample must wait its turn too, or the
+    // ring goes out of order.
+    if (_watermark > 0 || _lockDepth > 0 || !_edges.empty()) {
+        _edges.push(now);
+        return;
+    }
+    capture(now);
+}
+
+void KX134Sampler::service() {
+    if (_lockDepth > 0 || _edges.empty()) {
+        return;
+    }
+    // Hold the bus so the ISR only queues edges while the buffer is read.
+    lockBus();
+    const size_t edges = _edges.popBatch(_edgeUs, KX134_EDGE_RING);
+    _deferred += static_cast<uint32_t>(edges);
+    if (_watermark > 0) {
+        captureBurst();
+    } else {
+        captureQueued(_edgeUs, edges);
+    }
+    unlockBus();
+}
+
+void KX134Sampler::poll() {
+    if (_lockDepth > 0) {
+        return;
+    }
+    if (_watermark > 0) {
+        if (_accel.bufferedSampleCount() >= _watermark) {
+            captureBurst();
+        }
+    } else {
+        const uint32_t now = micros();
+        captureQueued(&now, 1);
+    }
+}
+
+void KX134Sampler::lockBus() {
+    ++_lockDepth;  // the ISR only reads it
+}
+
+void KX134Sampler::unlockBus() {
+    // Samples of edges queued meanwhile are read by service(), with interrupts on.
+    if (_lockDepth > 0) {
+        --_lockDepth;
+    }
+}
+
+void KX134Sampler::capture(uint32_t timestampUs) {
+    // Normally the buffer holds just this edge's sample. If it holds more (edges were missed),
+    // the read took the oldest; the rest stay buffered for service(), behind this edge.
+    int level = 0;
+    const int n = _accel.readBufferedSamples(_frames, 1, &level);
+    if (n < 0) {
+        ++_readErrors;
+        return;
+    }
+    if (n == 0) {
+        return;
+    }
+    _stamps[0] = timestampUs - static_cast<uint32_t>(level - 1) * _clock.periodUs();
+    pushFrames(1);
+    if (level > 1) {
+        _edges.push(timestampUs);
+    }
+}
+
+void KX134Sampler::captureQueued(const uint32_t* edgeUs, size_t edges) {
+    const int n = _accel.readBufferedSamples(_frames, KX134_BUFFER_MAX_SAMPLES);
+    if (n < 0) {
+        ++_readErrors;
+        return;
+    }
+    if (n == 0) {
+        return;
+    }
+    if (static_cast<size_t>(n) == KX134_BUFFER_MAX_SAMPLES) {
+        ++_lost;  // buffer was full: stream mode has dropped an unknown number of older samples
+    }
+    // The newest samples belong to the newest edges; older ones whose edge was not queued
+    // (edge ring full) are placed one ODR period apart before them.
+    const size_t count = static_cast<size_t>(n);
+    const size_t paired = edges < count ? edges : count;
+    const size_t unpaired = count - paired;
+    const uint32_t* newest = edgeUs + (edges - paired);
+    const uint32_t anchor = paired > 0 ? newest[0] : micros();
+    for (size_t i = 0; i < count; ++i) {
+        _stamps[i] = i < unpaired ? anchor - static_cast<uint32_t>(unpaired - i) * _clock.periodUs()
+                                  : newest[i - unpaired];
+    }
+    pushFrames(n);
+}
+
+void KX134Sampler::captureBurst() {
+    // Stamp the read, not the edge: the clock needs the time the buffer was drained.
+    const uint32_t readUs = micros();
+    const int n = _accel.readBufferedSamples(_frames, KX134_BUFFER_MAX_SAMPLES);
+    if (n < 0) {
+        ++_readErrors;
+        return;
+    }
+    if (n == 0) {
+        return;
+    }
+    if (static_cast<size_t>(n) == KX134_BUFFER_MAX_SAMPLES) {
+        ++_lost;  // buffer was full: stream mode has dropped an unknown number of older samples
+    }
+    ++_bursts;
+    if (static_cast<uint32_t>(n) > _maxBurst) {
+        _maxBurst = static_cast<uint32_t>(n);
+    }
+    _clock.stamp(readUs, static_cast<size_t>(n), _stamps);
+    pushFrames(n);
+}
+
+void KX134Sampler::pushFrames(int n) {
+    for (int i = 0; i < n; ++i) {
+        AccelSample sample;
+        sample.timestampUs = _stamps[i];
+        kx134DecodeBufferSample(_frames + i * KX134_BUFFER_SAMPLE_BYTES, sample.raw);
+        if (_ring.push(sample)) {
+            ++_samples;
+        }
+    }
+}
+
+size_t KX134Sampler::consume(AccelSample* out, size_t maxSamples) {
+    return _ring.popBatch(out, maxSamples);
+}
+
+KX134SamplerStats KX134Sampler::stats() const {
+    KX134SamplerStats st;
+    st.samples = _samples;
+    st.deferred = _deferred;
+    st.lost = _lost;
+    st.readErrors = _readErrors;
+    st.ringOverflows = _ring.overflows();
+    st.bursts = _bursts;
+    st.maxBurst = _maxBurst;
+    return st;
+}
@@ -0,0 +1,155 @@
+/**
+ * @file KX134Sampler.h
+ * @brief Interrupt-driven KX134 acquisition into a lock-free sample ring
+ *
+ * The KX134 data-ready pulse (INT1) runs onDataReady() in interrupt context: it stamps the
+ * edge with micros(), reads the raw X/Y/Z counts and pushes both into an SpscRing that the
+ * main loop drains in batches with consume(). Blocking work in loop() (radio, SD flush, flash
+ * erase) then delays when samples are processed, not when they are taken.
+ *
+ * The accelerometer shares the SPI bus with SD, SPI flash, radio and barometer. Code that
+ * talks to those holds a BusLock for the transfer itself. An edge that arrives meanwhile only
+ * queues its timestamp; the sensor keeps the sample in its on-chip buffer, and service() in
+ * the main loop reads every queued sample and pairs it with its edge once the bus is free.
+ * Nothing is lost unless the loop falls KX134_BUFFER_MAX_SAMPLES samples behind.
+ *
+ * With a watermark set in configure() INT1 fires once per watermark instead. The interrupt
+ * only queues the edge: service() drains the buffer in one SPI burst from the main loop, with
+ * interrupts on, and timestamps the samples with FifoSampleClock. That allows ODRs well above
+ * the loop rate, and a slow loop pass loses nothing until the on-chip buffer fills.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#include "KX134Accelerometer.h"
+#include "SpscRing.h"
+
+// Samples buffered between ISR and main loop (power of two). 256 = 640 ms at 400 Hz.
+#ifndef KX134_SAMPLE_RING
+#define KX134_SAMPLE_RING 256
+#endif
+
+// Edge timestamps queued while the bus is held (power of two, at least the on-chip buffer).
+#ifndef KX134_EDGE_RING
+#define KX134_EDGE_RING 128
+#endif
+
+// ODR codes while disarmed and from ARMED to LANDED (6 = 50 Hz, 9 = 400 Hz, 10 = 800 Hz,
+// 11 = 1600 Hz), and the target time between buffered bursts at the flight rate.
+#ifndef KX134_GROUND_ODR
+#define KX134_GROUND_ODR 6
+#endif
+#ifndef KX134_FLIGHT_ODR
+#define KX134_FLIGHT_ODR 9
+#endif
+#ifndef KX134_BURST_MS
+#define KX134_BURST_MS 20
+#endif
+
+/** One accelerometer sample as taken at the data-ready edge. */
+struct AccelSample {
+    uint32_t timestampUs;  ///< micros() at the data-ready edge (wraps every 71.6 min)
+    int16_t raw[3];        ///< X/Y/Z output (counts)
+};
+
+/** Acquisition counters since begin(). */
+struct KX134SamplerStats {
+    uint32_t samples;       ///< samples pushed into the ring
+    uint32_t deferred;      ///< edges read by service(): under a BusLock, and every watermark edge
+    uint32_t lost;          ///< samples the on-chip buffer dropped before they could be read
+    uint32_t readErrors;    ///< failed SPI reads
+    uint32_t ringOverflows; ///< samples dropped because the main loop fell a whole ring behind
+    uint32_t bursts;        ///< buffered mode: burst reads
+    uint32_t maxBurst;      ///< buffered mode: most samples in one burst
+};
+
+class KX134Sampler {
+public:
+    typedef SpscRing<AccelSample, KX134_SAMPLE_RING> Ring;
+
+    /** Holds the SPI bus for the enclosing scope; nestable. */
+    class BusLock {
+    public:
+        explicit BusLock(KX134Sampler& sampler) : _sampler(sampler) { _sampler.lockBus(); }
+        ~BusLock() { _sampler.unlockBus(); }
+        BusLock(const BusLock&) = delete;
+        BusLock& operator=(const BusLock&) = delete;
+
+    private:
+        KX134Sampler& _sampler;
+    };
+
+    explicit KX134Sampler(KX134Accelerometer& accel);
+
+    /**
+     * @brief Set the ODR and acquisition mode; the accelerometer is enabled afterwards
+     * @param odrCode KX134 ODR code (6 = 50 Hz, 9 = 400 Hz, 11 = 1600 Hz)
+     * @param watermark 0: one data-ready interrupt per sample. Otherwise samples per burst
+     *                  from the on-chip buffer (1..KX134_BUFFER_MAX_SAMPLES).
+     * @return false if a register write failed (the accelerometer may be left disabled)
+     */
+    bool configure(uint8_t odrCode, uint8_t watermark);
+
+    /** Watermark in use (0 = data-ready mode). */
+    uint8_t watermark() const;
+
+    /**
+     * @brief Watermark that gives one burst per burstMs at odrCode
+     *
+     * Capped at half the on-chip buffer so a burst the main loop reads late still has room.
+     */
+    static uint8_t watermarkFor(uint8_t odrCode, uint32_t burstMs);
+
+    /**
+     * @brief Attach isr (which must call onDataReady()) to the INT1 pin, rising edge
+     * @return false if the accelerometer is not initialised or the pin has no interrupt
+     */
+    bool begin(uint8_t intPin, void (*isr)());
+
+    /**
+     * Interrupt context: stamp the edge and read its one sample, or queue the edge while the bus
+     * is held. Watermark edges are always queued, so no burst read runs in the ISR.
+     */
+    void onDataReady();
+
+    /** Main loop, outside any BusLock: read the samples of queued edges (buffered mode: the burst). */
+    void service();
+
+    /** Without the interrupt wired: poll the sensor and push like the ISR would (thread context). */
+    void poll();
+
+    void lockBus();
+    void unlockBus();
+
+    /** Main loop: take up to maxSamples of the oldest samples. */
+    size_t consume(AccelSample* out, size_t maxSamples);
+
+    KX134SamplerStats stats() const;
+
+private:
+    typedef SpscRing<uint32_t, KX134_EDGE_RING> EdgeRing;
+    static_assert(KX134_EDGE_RING >= KX134_BUFFER_MAX_SAMPLES, "edge ring smaller than the on-chip buffer");
+
+    void capture(uint32_t timestampUs);
+    void captureQueued(const uint32_t* edgeUs, size_t edges);
+    void captureBurst();
+    void pushFrames(int n);
+
+    KX134Accelerometer& _accel;
+    Ring _ring;
+    EdgeRing _edges;  ///< ISR pushes, service() pops
+    FifoSampleClock _clock;
+    uint8_t _frames[KX134_BUFFER_MAX_SAMPLES * KX134_BUFFER_SAMPLE_BYTES];
+    uint32_t _stamps[KX134_BUFFER_MAX_SAMPLES];
+    uint32_t _edgeUs[KX134_EDGE_RING];
+    volatile uint8_t _watermark;
+    volatile uint8_t _lockDepth;
+    volatile uint32_t _samples;
+    volatile uint32_t _deferred;
+    volatile uint32_t _lost;
+    volatile uint32_t _readErrors;
+    volatile uint32_t _bursts;
+    volatile uint32_t _maxBurst;
+};
@@ -0,0 +1,192 @@
+/**
+ * @file AltitudeFilter.h
+ * @brief Baro/accelerometer fusion: altitude, vertical velocity and acceleration estimates
+ *
+ * Three-state Kalman filter [altitude, velocity, acceleration] with a constant-acceleration
+ * model driven by white jerk. Every accelerometer sample predicts to its own timestamp and
+ * updates the acceleration state; every barometer sample updates altitude. Velocity is never
+ * measured directly, so it no longer comes from differencing two noisy altitudes.
+ *
+ * The axial accelerometer only measures vertical acceleration while the rocket points up. From
+ * apogee on (turning over, tumbling, hanging under a parachute) the caller switches acceleration
+ * fusion off with setAccelerationFused(false) and the barometer alone drives the estimate.
+ *
+ * Barometer samples whose innovation exceeds BARO_GATE_SIGMA standard deviations (transonic
+ * pressure spikes, ejection-charge pressure) are skipped. After BARO_GATE_MAX_REJECTS in a row
+ * the estimate is treated as lost rather than the barometer: altitude and velocity variances are
+ * opened up to the size of the residual and the sample is accepted, so a genuine step (or a
+ * manoeuvre the model missed) cannot lock the filter out.
+ */
+
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+
+#include "LinearKalman.h"
+
+// Noise defaults: baro altitude (m), acceleration (m/s^2), jerk spectral density (m^2/s^5).
+#ifndef ALT_FILTER_BARO_SIGMA_M
+#define ALT_FILTER_BARO_SIGMA_M 1.0f
+#endif
+#ifndef ALT_FILTER_ACCEL_SIGMA_MS2
+#define ALT_FILTER_ACCEL_SIGMA_MS2 0.5f
+#endif
+#ifndef ALT_FILTER_JERK_PSD
+#define ALT_FILTER_JERK_PSD 100.0f
+#endif
+#ifndef ALT_FILTER_BARO_GATE_SIGMA
+#define ALT_FILTER_BARO_GATE_SIGMA 5.0f
+#endif
+#ifndef ALT_FILTER_BARO_GATE_MAX_REJECTS
+#define ALT_FILTER_BARO_GATE_MAX_REJECTS 20
+#endif
+
+/** Standard gravity (m/s^2), for converting accelerometer g to m/s^2. */
+static constexpr float ALT_FILTER_G0 = 9.80665f;
+
+/** Tunables of AltitudeFilter. */
+struct AltitudeFilterConfig {
+    float baroSigmaM;
+    float accelSigmaMs2;
+    float jerkPsd;
+    float baroGateSigma;      ///< 0 disables gating
+    uint16_t baroGateMaxRejects;
+
+    static AltitudeFilterConfig defaults() {
+        return AltitudeFilterConfig{ALT_FILTER_BARO_SIGMA_M, ALT_FILTER_ACCEL_SIGMA_MS2, ALT_FILTER_JERK_PSD,
+                                    ALT_FILTER_BARO_GATE_SIGMA, ALT_FILTER_BARO_GATE_MAX_REJECTS};
+    }
+};
+
+/**
+ * @class AltitudeFilter
+ * @brief Altitude/velocity/acceleration estimator fed at the sensor sample rate
+ */
+class AltitudeFilter {
+public:
+    enum State { ALTITUDE = 0, VELOCITY = 1, ACCELERATION = 2 };
+
+    explicit AltitudeFilter(const AltitudeFilterConfig& config = AltitudeFilterConfig::defaults())
+        : _config(config) {
+        reset(0.0f);
+    }
+
+    /** Restart at rest at altitudeM (e.g. on the pad). */
+    void reset(float altitudeM) {
+        const LinearKalman<3>::Vector x0 = {altitudeM, 0.0f, 0.0f};
+        _kf.reset(x0, 1.0f);
+        _started = false;
+        _lastUs = 0;
+        _baroRejects = 0;
+        _baroRejectsTotal = 0;
+        _firstRejectUs = 0;
+        _accelFused = true;
+    }
+
+    void setConfig(const AltitudeFilterConfig& config) { _config = config; }
+
+    /**
+     * @brief Advance the model to timestampUs (first call only sets the time base)
+     * @param timestampUs Sample time (micros(), wrap-safe)
+     */
+    void predictTo(uint32_t timestampUs) {
+        if (!_started) {
+            _started = true;
+            _lastUs = timestampUs;
+            return;
+        }
+        const int32_t deltaUs = static_cast<int32_t>(timestampUs - _lastUs);
+        if (deltaUs <= 0) {
+            return;  // same or older sample: keep the current prediction
+        }
+        _lastUs = timestampUs;
+        const float dt = deltaUs * 1e-6f;
+        const float dt2 = dt * dt;
+        const float dt3 = dt2 * dt;
+        const float q = _config.jerkPsd;
+        const LinearKalman<3>::Matrix f = {{1.0f, dt, 0.5f * dt2}, {0.0f, 1.0f, dt}, {0.0f, 0.0f, 1.0f}};
+        const LinearKalman<3>::Matrix qm = {
+            {q * dt3 * dt2 / 20.0f, q * dt2 * dt2 / 8.0f, q * dt3 / 6.0f},
+            {q * dt2 * dt2 / 8.0f, q * dt3 / 3.0f, q * dt2 / 2.0f},
+            {q * dt3 / 6.0f, q * dt2 / 2.0f, q * dt}};
+        _kf.predict(f, qm);
+    }
+
+    /**
+     * @brief Whether updateAcceleration() measures the acceleration state (true after reset())
+     *
+     * Off, accelerometer samples only advance the model to their time.
+     */
+    void setAccelerationFused(bool fused) { _accelFused = fused; }
+    bool accelerationFused() const { return _accelFused; }
+
+    /**
+     * @brief Vertical acceleration measurement, gravity removed (m/s^2)
+     * @param timestampUs Sample time; the model is predicted to it first
+     */
+    void updateAcceleration(uint32_t timestampUs, float accelMs2) {
+        predictTo(timestampUs);
+        if (!_accelFused) {
+            return;
+        }
+        static const LinearKalman<3>::Vector h = {0.0f, 0.0f, 1.0f};
+        _kf.update(h, _config.accelSigmaMs2 * _config.accelSigmaMs2, accelMs2);
+    }
+
+    /**
+     * @brief Barometric altitude measurement (m)
+     * @param timestampUs Sample time; the model is predicted to it first
+     * @return false if the sample was rejected by the innovation gate
+     */
+    bool updateAltitude(uint32_t timestampUs, float altitudeM) {
+        predictTo(timestampUs);
+        static const LinearKalman<3>::Vector h = {1.0f, 0.0f, 0.0f};
+        const float r = _config.baroSigmaM * _config.baroSigmaM;
+        if (_config.baroGateSigma > 0.0f) {
+            float residual;
+            float s;
+            _kf.innovation(h, r, altitudeM, &residual, &s);
+            const float gate = _config.baroGateSigma * _config.baroGateSigma;
+            if (residual * residual > gate * s) {
+                if (_baroRejects < _config.baroGateMaxRejects) {
+                    if (_baroRejects == 0) {
+                        _firstRejectUs = timestampUs;
+                    }
+                    ++_baroRejects;
+                    ++_baroRejectsTotal;
+                    return false;
+                }
+                // Persistent disagreement: a residual that built up over the reject window
+                // implies a velocity error of about residual / window.
+                const float windowS = static_cast<int32_t>(timestampUs - _firstRejectUs) * 1e-6f;
+                const float dv = windowS > 0.0f ? residual / windowS : residual;
+                _kf.addVariance(ALTITUDE, residual * residual);
+                _kf.addVariance(VELOCITY, dv * dv);
+            }
+        }
+        _baroRejects = 0;
+        _kf.update(h, r, altitudeM);
+        return true;
+    }
+
+    float altitude() const { return _kf.state(ALTITUDE); }
+    float velocity() const { return _kf.state(VELOCITY); }
+    float acceleration() const { return _kf.state(ACCELERATION); }
+
+    /** Standard deviation of the velocity estimate (m/s). */
+    float velocitySigma() const { return sqrtf(_kf.covariance(VELOCITY, VELOCITY)); }
+
+    /** Barometer samples skipped by the gate since reset(). */
+    uint32_t baroRejects() const { return _baroRejectsTotal; }
+
+private:
+    AltitudeFilterConfig _config;
+    LinearKalman<3> _kf;
+    bool _started;
+    uint32_t _lastUs;
+    uint16_t _baroRejects;
+    uint32_t _baroRejectsTotal;
+    uint32_t _firstRejectUs;
+    bool _accelFused;
+};
@@ -0,0 +1,144 @@
+/**
+ * @file LinearKalman.h
+ * @brief Fixed-size linear Kalman filter with scalar measurement updates
+ *
+ * The state dimension is a template parameter, so every matrix is a plain array sized at
+ * compile time: no allocation, no run-time dimension checks, and the loops unroll. Measurements
+ * are applied one scalar at a time (sequential updates), which replaces the matrix inverse of
+ * the textbook update by one division.
+ *
+ * Pure logic, no Arduino dependency, so it is covered by host tests.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * @class LinearKalman
+ * @brief Kalman filter over kStates states (float)
+ */
+template <int kStates>
+class LinearKalman {
+public:
+    static_assert(kStates > 0, "LinearKalman needs at least one state");
+    static constexpr int kN = kStates;
+    typedef float Matrix[kStates][kStates];
+    typedef float Vector[kStates];
+
+    LinearKalman() { reset(nullptr, 0.0f); }
+
+    /**
+     * @brief Set the state and a diagonal covariance
+     * @param x0 Initial state (nullptr = zeros)
+     * @param variance Initial variance of every state
+     */
+    void reset(const Vector x0, float variance) {
+        for (int i = 0; i < kStates; ++i) {
+            _x[i] = x0 != nullptr ? x0[i] : 0.0f;
+            for (int j = 0; j < kStates; ++j) {
+                _p[i][j] = i == j ? variance : 0.0f;
+            }
+        }
+    }
+
+    /** @brief x = F x, P = F P F' + Q */
+    void predict(const Matrix f, const Matrix q) {
+        Vector x;
+        Matrix fp;
+        for (int i = 0; i < kStates; ++i) {
+            x[i] = 0.0f;
+            for (int k = 0; k < kStates; ++k) {
+                x[i] += f[i][k] * _x[k];
+            }
+            for (int j = 0; j < kStates; ++j) {
+                float sum = 0.0f;
+                for (int k = 0; k < kStates; ++k) {
+                    sum += f[i][k] * _p[k][j];
+                }
+                fp[i][j] = sum;
+            }
+        }
+        for (int i = 0; i < kStates; ++i) {
+            _x[i] = x[i];
+            for (int j = 0; j < kStates; ++j) {
+                float sum = q[i][j];
+                for (int k = 0; k < kStates; ++k) {
+                    sum += fp[i][k] * f[j][k];
+                }
+                _p[i][j] = sum;
+            }
+        }
+    }
+
+    /**
+     * @brief Innovation z - H x and its variance H P H' + r, without updating
+     */
+    void innovation(const Vector h, float r, float z, float* residual, float* variance) const {
+        float hx = 0.0f;
+        float s = r;
+        for (int i = 0; i < kStates; ++i) {
+            hx += h[i] * _x[i];
+            float ph = 0.0f;
+            for (int j = 0; j < kStates; ++j) {
+                ph += _p[i][j] * h[j];
+            }
+            s += h[i] * ph;
+        }
+        *residual = z - hx;
+        *variance = s;
+    }
+
+    /**
+     * @brief Apply one scalar measurement z = H x + v, var(v) = r
+     * @return false if the innovation variance is not positive (nothing applied)
+     */
+    bool update(const Vector h, float r, float z) {
+        float residual;
+        float s;
+        innovation(h, r, z, &residual, &s);
+        if (!(s > 0.0f)) {
+            return false;
+        }
+        Vector k;
+        for (int i = 0; i < kStates; ++i) {
+            float ph = 0.0f;
+            for (int j = 0; j < kStates; ++j) {
+                ph += _p[i][j] * h[j];
+            }
+            k[i] = ph / s;
+        }
+        Vector hp;
+        for (int j = 0; j < kStates; ++j) {
+            hp[j] = 0.0f;
+            for (int i = 0; i < kStates; ++i) {
+                hp[j] += h[i] * _p[i][j];
+            }
+        }
+        for (int i = 0; i < kStates; ++i) {
+            _x[i] += k[i] * residual;
+            for (int j = 0; j < kStates; ++j) {
+                _p[i][j] -= k[i] * hp[j];
+            }
+        }
+        // Keep P symmetric against float round-off.
+        for (int i = 0; i < kStates; ++i) {
+            for (int j = i + 1; j < kStates; ++j) {
+                const float m = 0.5f * (_p[i][j] + _p[j][i]);
+                _p[i][j] = m;
+                _p[j][i] = m;
+            }
+        }
+        return true;
+    }
+
+    /** @brief Add variance to state i, e.g. to let the filter re-acquire after a disturbance */
+    void addVariance(int i, float variance) { _p[i][i] += variance; }
+
+    float state(int i) const { return _x[i]; }
+    float covariance(int i, int j) const { return _p[i][j]; }
+
+private:
+    Vector _x;
+    Matrix _p;
+};
@@ -0,0 +1,157 @@
+/**
+ * @file ApogeePredictor.h
+ * @brief Time-to-apogee and apogee altitude from a drag-aware ballistic coast model
+ *
+ * After burnout the vehicle decelerates as dv/dt = -g - k v^2, where k = rho Cd A / (2 m) is drag
+ * per unit mass. Upward from velocity v this coasts for
+ *
+ *     t = atan(v sqrt(k/g)) / sqrt(k g)        and rises        ln(1 + k v^2 / g) / (2 k)
+ *
+ * k is fitted on line from the estimated acceleration: drag = -(a + g) = k v^2, least squares
+ * through the origin weighted by v^2, so the noisy low-speed samples near apogee say little.
+ * Each update is a handful of flops plus one atanf, log1pf and sqrtf: fixed cost at any rate.
+ *
+ * The velocity the model runs from is not the filter velocity as given. From the first update
+ * (launch, when the filter is still clean) the predictor integrates the acceleration estimate,
+ * which the accelerometer drives, and follows the filter velocity at no more than
+ * APOGEE_PREDICT_MAX_SLEW_MS2. A barometer transient (transonic shock, ejection pressure) that
+ * drags the fused velocity hundreds of m/s for a few hundred ms then moves the prediction by a
+ * few m/s, while accelerometer bias and saturation are still corrected over the flight.
+ *
+ * Coast starts when the acceleration estimate first falls below -APOGEE_PREDICT_COAST_ACCEL_G g
+ * (thrust no longer holding the vehicle up); only then is there a prediction. Without an
+ * acceleration estimate there is none. Vertical flight is assumed; on a tilted trajectory k
+ * absorbs part of the error.
+ */
+
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+
+// Coast detection: acceleration estimate below -this * g0 (m/s^2, gravity included).
+#ifndef APOGEE_PREDICT_COAST_ACCEL_G
+#define APOGEE_PREDICT_COAST_ACCEL_G 0.8f
+#endif
+// Drag fit only above this speed (m/s); below it v^2 is too small to separate drag from noise.
+#ifndef APOGEE_PREDICT_MIN_FIT_VELOCITY
+#define APOGEE_PREDICT_MIN_FIT_VELOCITY 10.0f
+#endif
+// Fastest the coast velocity is pulled toward the filter velocity (m/s^2).
+#ifndef APOGEE_PREDICT_MAX_SLEW_MS2
+#define APOGEE_PREDICT_MAX_SLEW_MS2 10.0f
+#endif
+
+/**
+ * @class ApogeePredictor
+ * @brief Ballistic coast model fed with altitude/velocity/acceleration estimates
+ */
+class ApogeePredictor {
+public:
+    static constexpr float G0 = 9.80665f;
+
+    ApogeePredictor() { reset(); }
+
+    /** Forget the coast and the drag fit (back on the pad). */
+    void reset() {
+        _tracking = false;
+        _coasting = false;
+        _lastUs = 0;
+        _velocity = 0.0f;
+        _sumDragV2 = 0.0f;
+        _sumV4 = 0.0f;
+        _dragPerMass = 0.0f;
+        _timeToApogeeS = 0.0f;
+        _apogeeM = 0.0f;
+    }
+
+    /**
+     * @brief Advance with the latest estimate
+     * @param timestampUs Sample time (us, wrap-safe)
+     * @param altitude Altitude (m)
+     * @param velocity Vertical velocity (m/s, up positive)
+     * @param acceleration Vertical acceleration (m/s^2, -g in free fall); NAN if unknown
+     * @return true if coasting and the prediction was refreshed
+     */
+    bool update(uint32_t timestampUs, float altitude, float velocity, float acceleration) {
+        if (isnan(acceleration)) {
+            return false;  // nothing to detect the coast or fit drag with; keep the last prediction
+        }
+        if (!_tracking) {
+            _tracking = true;
+            _velocity = velocity;
+        } else {
+            const int32_t deltaUs = static_cast<int32_t>(timestampUs - _lastUs);
+            const float dt = deltaUs > 0 ? deltaUs * 1e-6f : 0.0f;
+            const float maxStep = APOGEE_PREDICT_MAX_SLEW_MS2 * dt;
+            const float pull = velocity - (_velocity + acceleration * dt);
+            _velocity += acceleration * dt + (pull > maxStep ? maxStep : (pull < -maxStep ? -maxStep : pull));
+        }
+        _lastUs = timestampUs;
+        bool first = false;
+        if (!_coasting) {
+            if (acceleration > -APOGEE_PREDICT_COAST_ACCEL_G * G0) {
+                return false;
+            }
+            _coasting = true;
+            first = true;
+        }
+        if (_velocity > APOGEE_PREDICT_MIN_FIT_VELOCITY) {
+            const float v2 = _velocity * _velocity;
+            _sumDragV2 += -(acceleration + G0) * v2;
+            _sumV4 += v2 * v2;
+            _dragPerMass = _sumDragV2 > 0.0f ? _sumDragV2 / _sumV4 : 0.0f;
+        }
+        float rise;
+        _timeToApogeeS = coastToApogee(_velocity, _dragPerMass, &rise);
+        if (_velocity > 0.0f || first) {
+            _apogeeM = altitude + rise;  // past apogee: keep the last prediction made on the way up
+        }
+        return true;
+    }
+
+    /** Coast detected since reset(). */
+    bool coasting() const { return _coasting; }
+
+    /** Predicted time from the last update to apogee (s); 0 once descending. */
+    float timeToApogeeS() const { return _timeToApogeeS; }
+
+    /** Predicted apogee altitude (m); held once the velocity reaches zero. */
+    float apogeeAltitudeM() const { return _apogeeM; }
+
+    /** Velocity the prediction runs from (m/s), tracked from the first update. */
+    float velocity() const { return _velocity; }
+
+    /** Fitted drag per unit mass k (1/m); 0 until the fit has data. */
+    float dragPerMass() const { return _dragPerMass; }
+
+    /**
+     * @brief Coast from velocity under gravity and quadratic drag k (closed form)
+     * @param riseM Height gained until v = 0 (m)
+     * @return Time until v = 0 (s); 0 if velocity <= 0
+     */
+    static float coastToApogee(float velocity, float dragPerMass, float* riseM) {
+        if (velocity <= 0.0f) {
+            *riseM = 0.0f;
+            return 0.0f;
+        }
+        const float x = dragPerMass * velocity * velocity / G0;
+        if (x < 1e-4f) {  // drag-free limit; avoids 0/0 below
+            *riseM = velocity * velocity / (2.0f * G0);
+            return velocity / G0;
+        }
+        *riseM = log1pf(x) / (2.0f * dragPerMass);
+        return atanf(sqrtf(x)) / sqrtf(dragPerMass * G0);
+    }
+
+private:
+    bool _tracking;
+    bool _coasting;
+    uint32_t _lastUs;
+    float _velocity;    ///< Integrated acceleration, slew-limited toward the input velocity
+    float _sumDragV2;   ///< sum of drag * v^2 (fit numerator)
+    float _sumV4;       ///< sum of v^4 (fit denominator)
+    float _dragPerMass;
+    float _timeToApogeeS;
+    float _apogeeM;
+};
@@ -5,7 +5,51 @@
 
 #include "Baro.h"
 
-Baro::Baro(uint8_t CS) : cs_pin(CS), baro(CS), _initialized(false) {
+// MS5611 commands (datasheet): convert D1/D2 at OSR 256, +2 per OSR step.
+static constexpr uint8_t MS5611_CONVERT_D1 = 0x40;
+static constexpr uint8_t MS5611_CONVERT_D2 = 0x50;
+
+void Ms5611Device::startConversion(Ms5611Sequencer::Channel channel) {
+  const uint8_t base = channel == Ms5611Sequencer::D1 ? MS5611_CONVERT_D1 : MS5611_CONVERT_D2;
+  command(base + (getOversampling() - 8) * 2);
+}
+
+uint32_t Ms5611Device::readConversion() {
+  return readADC();
+}
+
+void Ms5611Device::compute(uint32_t d1, uint32_t d2) {
+  // TEMP & PRESS MATH - datasheet page 7/20, as in MS5611_SPI::read() (C[] holds the PROM
+  // values already multiplied by their scale factors).
+  float dT = d2 - C[5];
+  _temperature = 2000 + dT * C[6];
+  float offset = C[2] + dT * C[4];
+  float sens = C[1] + dT * C[3];
+
+  if (_compensation && _temperature < 2000) {
+    // SECOND ORDER COMPENSATION - PAGE 8/20
+    float T2 = dT * dT * 4.6566128731E-10;
+    float t = (_temperature - 2000) * (_temperature - 2000);
+    float offset2 = 2.5 * t;
+    float sens2 = 1.25 * t;
+    if (_temperature < -1500) {
+      t = (_temperature + 1500) * (_temperature + 1500);
+      offset2 += 7 * t;
+      sens2 += 5.5 * t;
+    }
+    _temperature -= T2;
+    offset -= offset2;
+    sens -= sens2;
+  }
+
+  _pressure = (d1 * sens * 4.76837158205E-7 - offset) * 3.051757813E-5;
+  _lastRead = millis();
+  _result = MS5611_READ_OK;
+}
+
+Baro::Baro(uint8_t CS)
+  : baro(CS), cs_pin(CS), _initialized(false), _temperatureEvery(BARO_TEMPERATURE_EVERY),
+    _d1(0), _d2(0), _d1Us(0), _adcErrors(0), _padCalibrating(true) {
 }
 
 bool Baro::init() {
@@ -14,6 +58,7 @@ bool Baro::init() {
 
     // Reset the sensor
     baro.reset();
+    restartSequencer();
 
     return true;
   }
@@ -27,7 +72,64 @@ bool Baro::isReady() const {
 
 int Baro::read() {
   if (!_initialized) return -1;
-  return baro.read();
+  const int result = baro.read();
+  // The blocking read issued its own conversions; anything tick() started is gone.
+  restartSequencer();
+  return result;
+}
+
+bool Baro::tick() {
+  if (!_initialized) return false;
+
+  const Ms5611Sequencer::Step step = _sequencer.tick(micros());
+  if (step.read != Ms5611Sequencer::NONE) {
+    const uint32_t adc = baro.readConversion();
+    if (adc == 0) {
+      ++_adcErrors;
+      restartSequencer();
+      return false;
+    }
+    if (step.read == Ms5611Sequencer::D1) {
+      _d1 = adc;
+      _d1Us = step.readyUs;
+    } else {
+      _d2 = adc;
+    }
+  }
+  if (step.start != Ms5611Sequencer::NONE) {
+    baro.startConversion(step.start);
+  }
+  if (step.sampleReady) {
+    baro.compute(_d1, _d2);
+    if (_padCalibrating) {
+      _pad.addPadSample(baro.getPressure());
+    }
+    return true;
+  }
+  return false;
+}
+
+void Baro::setOversampling(osr_t osr) {
+  baro.setOversampling(osr);
+  restartSequencer();
+}
+
+void Baro::setTemperatureEvery(uint8_t every) {
+  _temperatureEvery = every;
+  restartSequencer();
+}
+
+uint32_t Baro::getSampleUs() const {
+  return _d1Us;
+}
+
+uint32_t Baro::getAdcErrors() const {
+  return _adcErrors;
+}
+
+void Baro::restartSequencer() {
+  // Drop the conversion in flight; the next tick() starts over with a temperature conversion.
+  _sequencer.configure(ms5611ConversionUs(baro.getOversampling()), _temperatureEvery);
 }
 
 float Baro::getPressure() {
@@ -49,3 +151,16 @@ float Baro::getAltitude() {
   if (!_initialized) return 0.0f;
   return baro.getAltitude();
 }
+
+void Baro::setPadCalibration(bool enable) {
+  _padCalibrating = enable;
+}
+
+float Baro::getAltitudeAgl() {
+  if (!_initialized) return 0.0f;
+  return _pad.agl(baro.getPressure());
+}
+
+float Baro::getPadPressure() const {
+  return _pad.hasReference() ? _pad.referenceHpa() : 0.0f;
+}
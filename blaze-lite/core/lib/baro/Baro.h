@@ -4,12 +4,45 @@
  * 
  * This class provides a simplified interface for interacting with the MS5611
  * barometric pressure sensor using SPI communication.
+ *
+ * read() is the driver's blocking D1 + D2 read (two full conversion times). tick() is the
+ * non-blocking alternative: it starts a conversion and returns, reads the ADC on a later call
+ * once the conversion time has elapsed (Ms5611Sequencer), and never waits.
+ *
+ * getAltitudeAgl() is height above the pad from a lookup table (BaroAltitude.h), referenced to
+ * pressure averaged by tick() while pad calibration is on.
  */
 
 #pragma once
 #include <Arduino.h>
 #include <MS5611_SPI.h>
 
+#include "BaroAltitude.h"
+#include "Ms5611Sequencer.h"
+
+// Pressure conversions per temperature conversion in tick() mode (temperature is reused between).
+#ifndef BARO_TEMPERATURE_EVERY
+#define BARO_TEMPERATURE_EVERY 4
+#endif
+
+/**
+ * @class Ms5611Device
+ * @brief MS5611_SPI with its conversion steps exposed separately for non-blocking use
+ */
+class Ms5611Device : public MS5611_SPI {
+public:
+  explicit Ms5611Device(uint8_t cs) : MS5611_SPI(cs) {}
+
+  /** Send the convert command for D1 (pressure) or D2 (temperature) at the current OSR. */
+  void startConversion(Ms5611Sequencer::Channel channel);
+
+  /** Read the 24-bit result of the last conversion (0 if it was not complete). */
+  uint32_t readConversion();
+
+  /** Same compensation as MS5611_SPI::read(), from raw D1/D2; updates pressure/temperature. */
+  void compute(uint32_t d1, uint32_t d2);
+};
+
 /**
  * @class Baro
  * @brief Wrapper class for MS5611 barometer SPI communication
@@ -35,11 +68,40 @@ public:
   bool isReady() const;
 
   /**
-   * @brief Triggers a read operation from the sensor
+   * @brief Triggers a read operation from the sensor (blocks for both conversions)
    * @return Status of the read operation
    */
   int read();
 
+  /**
+   * @brief Advance the non-blocking conversion cycle; call every loop
+   * @return true when a new pressure/temperature pair was computed on this call
+   */
+  bool tick();
+
+  /**
+   * @brief When the pressure conversion of the last tick() sample finished
+   * @return micros() timestamp; later than the conversion itself by at most one conversion time
+   */
+  uint32_t getSampleUs() const;
+
+  /**
+   * @brief Set the oversampling ratio used by read() and tick()
+   * @param osr OSR_ULTRA_LOW (0.6 ms per conversion) .. OSR_ULTRA_HIGH (9.1 ms)
+   */
+  void setOversampling(osr_t osr);
+
+  /**
+   * @brief Pressure conversions per temperature conversion in tick() mode
+   * @param every 1 = alternate; larger values reuse the last temperature
+   */
+  void setTemperatureEvery(uint8_t every);
+
+  /**
+   * @brief tick() ADC reads that returned 0 (conversion not complete); each restarts the cycle
+   */
+  uint32_t getAdcErrors() const;
+
   /**
    * @brief Retrieves the last read pressure value
    * @return Pressure in millibars (mbar) / hPa
@@ -53,11 +115,29 @@ public:
   float getTemperature();
 
   /**
-   * @brief Retrieves the altitude
+   * @brief Retrieves the altitude (standard atmosphere from 1013.25 hPa, uses powf)
    * @return Altitude in meters
    */
   float getAltitude();
 
+  /**
+   * @brief Average tick() samples into the pad reference while on (UNARMED/ARMED)
+   * @param enable true on the pad, false from launch on (freezes the reference)
+   */
+  void setPadCalibration(bool enable);
+
+  /**
+   * @brief Height above the pad for the last sample (no powf)
+   * @return Altitude above ground level in meters; 0 before the first pad sample
+   */
+  float getAltitudeAgl();
+
+  /**
+   * @brief Pad reference pressure
+   * @return Pressure in hPa; 0 before the first pad sample
+   */
+  float getPadPressure() const;
+
   /**
    * @brief Retrieves the device ID of the barometer
    * @return Device ID byte
@@ -65,7 +145,17 @@ public:
   uint8_t getDeviceID();
 
 private:
-  MS5611_SPI baro;   ///< Underlying MS5611 driver object
+  void restartSequencer();
+
+  Ms5611Device baro;  ///< Underlying MS5611 driver object
   uint8_t cs_pin;    ///< Chip Select pin number
   bool _initialized; ///< Initialization status flag
+  Ms5611Sequencer _sequencer;  ///< tick() conversion schedule
+  uint8_t _temperatureEvery;   ///< see setTemperatureEvery()
+  uint32_t _d1;                ///< last raw pressure conversion
+  uint32_t _d2;                ///< last raw temperature conversion
+  uint32_t _d1Us;              ///< when the conversion behind _d1 finished
+  uint32_t _adcErrors;
+  PadAltitude _pad;            ///< pad reference and pressure->altitude table
+  bool _padCalibrating;        ///< feed tick() samples into _pad
 };
@@ -0,0 +1,147 @@
+/**
+ * @file BaroAltitude.h
+ * @brief Pad-referenced barometric altitude without powf on the sample path
+ *
+ * Height above the pad is the difference of two standard-atmosphere altitudes, one for the
+ * current pressure and one for the averaged pad pressure, so the 1013.25 hPa sea-level
+ * assumption cancels out. The standard-atmosphere curve comes from a table of altitude and
+ * slope every BARO_ALT_TABLE_STEP_HPA, evaluated by cubic Hermite interpolation (error well
+ * under 0.01 m over 0-12 km); the table is filled once at construction.
+ *
+ * Pure logic, no Arduino dependency, so it is covered by host tests.
+ */
+
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+
+// Table span and spacing (hPa). 150 hPa is ~13.6 km in the standard atmosphere.
+#ifndef BARO_ALT_TABLE_MIN_HPA
+#define BARO_ALT_TABLE_MIN_HPA 150
+#endif
+#ifndef BARO_ALT_TABLE_MAX_HPA
+#define BARO_ALT_TABLE_MAX_HPA 1100
+#endif
+#ifndef BARO_ALT_TABLE_STEP_HPA
+#define BARO_ALT_TABLE_STEP_HPA 10
+#endif
+// Pressure samples averaged into each pad reference update.
+#ifndef BARO_PAD_SAMPLES
+#define BARO_PAD_SAMPLES 64
+#endif
+
+/**
+ * @brief Standard-atmosphere altitude, same formula as the MS5611 driver's getAltitude()
+ * @param pressureHpa Pressure (hPa)
+ * @param seaLevelHpa Reference pressure (hPa)
+ */
+inline float baroStdAltitude(float pressureHpa, float seaLevelHpa = 1013.25f) {
+    return 44307.694f * (1.0f - powf(pressureHpa / seaLevelHpa, 0.190284f));
+}
+
+/**
+ * @brief Inverse of baroStdAltitude(): pressure at a standard-atmosphere altitude
+ * @param altitudeM Altitude (m) relative to seaLevelHpa
+ * @param seaLevelHpa Reference pressure (hPa)
+ */
+inline float baroStdPressure(float altitudeM, float seaLevelHpa = 1013.25f) {
+    return seaLevelHpa * powf(1.0f - altitudeM / 44307.694f, 1.0f / 0.190284f);
+}
+
+/**
+ * @class BaroAltitudeTable
+ * @brief Standard-atmosphere altitude (relative to 1013.25 hPa) by Hermite table lookup
+ */
+class BaroAltitudeTable {
+public:
+    static constexpr int kKnots = (BARO_ALT_TABLE_MAX_HPA - BARO_ALT_TABLE_MIN_HPA) / BARO_ALT_TABLE_STEP_HPA + 1;
+
+    BaroAltitudeTable() {
+        for (int i = 0; i < kKnots; ++i) {
+            const double p = BARO_ALT_TABLE_MIN_HPA + static_cast<double>(i) * BARO_ALT_TABLE_STEP_HPA;
+            const double ratio = pow(p / 1013.25, 0.190284);
+            _altitude[i] = static_cast<float>(44307.694 * (1.0 - ratio));
+            // dh/dp, scaled to one table step so evaluation needs no extra multiply
+            _slope[i] = static_cast<float>(-44307.694 * 0.190284 * ratio / p * BARO_ALT_TABLE_STEP_HPA);
+        }
+    }
+
+    /** Altitude (m) for pressureHpa; falls back to baroStdAltitude() outside the table. */
+    float altitude(float pressureHpa) const {
+        const float x = (pressureHpa - BARO_ALT_TABLE_MIN_HPA) * (1.0f / BARO_ALT_TABLE_STEP_HPA);
+        if (!(x >= 0.0f) || x >= static_cast<float>(kKnots - 1)) {
+            return baroStdAltitude(pressureHpa);
+        }
+        const int i = static_cast<int>(x);
+        const float t = x - static_cast<float>(i);
+        const float t2 = t * t;
+        const float t3 = t2 * t;
+        const float h00 = 2.0f * t3 - 3.0f * t2 + 1.0f;
+        const float h10 = t3 - 2.0f * t2 + t;
+        const float h01 = -2.0f * t3 + 3.0f * t2;
+        const float h11 = t3 - t2;
+        return h00 * _altitude[i] + h10 * _slope[i] + h01 * _altitude[i + 1] + h11 * _slope[i + 1];
+    }
+
+private:
+    float _altitude[kKnots];
+    float _slope[kKnots];
+};
+
+/**
+ * @class PadAltitude
+ * @brief Height above the pad from pressure, with the pad pressure averaged on the ground
+ *
+ * While calibrating, every BARO_PAD_SAMPLES pressure samples are averaged into a new pad
+ * reference, so slow weather drift on the pad is followed until calibration stops (launch).
+ * Before the first average completes the first sample serves as the reference.
+ */
+class PadAltitude {
+public:
+    PadAltitude() { reset(); }
+
+    /** Forget the pad reference. */
+    void reset() {
+        _sum = 0.0;
+        _count = 0;
+        _haveReference = false;
+        _referenceHpa = 0.0f;
+        _referenceAltitude = 0.0f;
+    }
+
+    /** Feed one ground sample (call only while on the pad). */
+    void addPadSample(float pressureHpa) {
+        if (!_haveReference) {
+            setReference(pressureHpa);
+        }
+        _sum += pressureHpa;
+        if (++_count >= BARO_PAD_SAMPLES) {
+            setReference(static_cast<float>(_sum / _count));
+            _sum = 0.0;
+            _count = 0;
+        }
+    }
+
+    /** Height above the pad reference (m); 0 until the first pad sample. */
+    float agl(float pressureHpa) const {
+        return _haveReference ? _table.altitude(pressureHpa) - _referenceAltitude : 0.0f;
+    }
+
+    bool hasReference() const { return _haveReference; }
+    float referenceHpa() const { return _referenceHpa; }
+
+private:
+    void setReference(float pressureHpa) {
+        _referenceHpa = pressureHpa;
+        _referenceAltitude = _table.altitude(pressureHpa);
+        _haveReference = true;
+    }
+
+    BaroAltitudeTable _table;
+    double _sum;
+    uint32_t _count;
+    bool _haveReference;
+    float _referenceHpa;
+    float _referenceAltitude;
+};
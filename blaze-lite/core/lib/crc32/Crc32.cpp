@@ -0,0 +1,35 @@
+/**
+ * @file Crc32.cpp
+ * @brief Table-driven CRC-32; the 1 KiB table is built at compile time and lives in flash
+ */
+
+#include "Crc32.h"
+
+namespace {
+
+struct Crc32Table {
+    uint32_t entries[256];
+
+    constexpr Crc32Table() : entries() {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1u) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+            }
+            entries[i] = c;
+        }
+    }
+};
+
+constexpr Crc32Table kCrc32Table;
+
+}  // namespace
+
+uint32_t crc32Update(uint32_t crc, const void* data, size_t len) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    uint32_t c = crc ^ 0xFFFFFFFFu;
+    while (len-- > 0) {
+        c = kCrc32Table.entries[(c ^ *p++) & 0xFFu] ^ (c >> 8);
+    }
+    return c ^ 0xFFFFFFFFu;
+}
@@ -0,0 +1,23 @@
+/**
+ * @file Crc32.h
+ * @brief CRC-32 (IEEE 802.3 / zlib polynomial) for flash pages and exported files
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Extend a CRC-32 with more data
+ * @param crc CRC of the preceding data (0 to start)
+ * @param data Bytes to add
+ * @param len Number of bytes
+ * @return CRC of the preceding data followed by data; matches zlib's crc32()
+ */
+uint32_t crc32Update(uint32_t crc, const void* data, size_t len);
+
+/**
+ * @brief CRC-32 of a single buffer
+ */
+inline uint32_t crc32(const void* data, size_t len) { return crc32Update(0, data, len); }
@@ -0,0 +1,228 @@
+/**
+ * @file EraseAhead.h
+ * @brief Background pre-erase of the blocks LittleFS will allocate next
+ *
+ * A sector erase on SPI NOR takes 45-400 ms, and LittleFS erases a block synchronously the
+ * moment it allocates it. EraseAhead walks the free blocks in the LittleFS lookahead window
+ * (the allocator hands them out in that order), checks or erases them one small step at a time
+ * while the system is idle, and remembers which blocks are known blank. The erase callback then
+ * skips blocks that are already blank; any program into a block clears its blank bit.
+ *
+ * Each step does at most one status poll, one chunk read or one erase command, so it never
+ * waits for the chip. The blank bitmap lives in RAM only; after a reset blocks are re-verified
+ * by reading before they are erased again.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+extern "C" {
+#include "lfs.h"
+}
+
+/**
+ * @struct EraseAheadDevice
+ * @brief Non-blocking flash primitives used by EraseAhead
+ */
+struct EraseAheadDevice {
+    void* user;
+    bool (*busy)(void* user);                          ///< True while an erase/program is in progress
+    bool (*startErase)(void* user, uint32_t block);    ///< Issue a block erase without waiting for it
+    bool (*read)(void* user, uint32_t block, uint32_t off, uint8_t* buf, uint32_t len);
+};
+
+/**
+ * @struct EraseAheadStats
+ * @brief Counters since begin()
+ */
+struct EraseAheadStats {
+    uint32_t erased;        ///< Blocks erased in the background
+    uint32_t foundBlank;    ///< Blocks verified blank by reading (no erase needed)
+    uint32_t hits;          ///< LittleFS erases skipped because the block was known blank
+    uint32_t misses;        ///< LittleFS erases that had to run synchronously
+};
+
+/**
+ * @class EraseAhead
+ * @brief Blank-block tracker and pre-erase state machine for up to kMaxBlocks blocks
+ */
+template <uint32_t kMaxBlocks>
+class EraseAhead {
+public:
+    static constexpr uint32_t kNone = 0xFFFFFFFFu;
+    static constexpr uint32_t kVerifyChunk = 256;
+
+    EraseAhead() : _dev{}, _blockCount(0), _blockSize(0), _depth(0) { reset(); }
+
+    /**
+     * @brief Attach to a device and forget everything known about it
+     * @param dev Flash primitives
+     * @param blockCount LittleFS block count
+     * @param blockSize LittleFS block size (multiple of kVerifyChunk)
+     * @param depth Free blocks to keep blank ahead of the allocator (0 disables pre-erase)
+     */
+    void begin(const EraseAheadDevice& dev, uint32_t blockCount, uint32_t blockSize, uint32_t depth) {
+        _dev = dev;
+        _blockCount = blockCount < kMaxBlocks ? blockCount : kMaxBlocks;
+        _blockSize = blockSize;
+        _depth = depth;
+        reset();
+    }
+
+    /**
+     * @brief Run one non-blocking step
+     * @param lfs Mounted filesystem whose lookahead window names the next allocations
+     * @return true if the step touched the flash
+     */
+    bool step(const lfs_t* lfs) {
+        if (_depth == 0 || _dev.busy == nullptr || _dev.busy(_dev.user)) {
+            return false;
+        }
+        if (_erasing != kNone) {
+            setBlank(_erasing, true);
+            _erasing = kNone;
+            ++_stats.erased;
+        }
+
+        const uint32_t target = nextTarget(lfs);
+        if (target == kNone) {
+            return false;
+        }
+        if (_verifying != target) {
+            _verifying = target;
+            _verifyOff = 0;
+        }
+
+        uint8_t chunk[kVerifyChunk];
+        if (!_dev.read(_dev.user, target, _verifyOff, chunk, kVerifyChunk)) {
+            return true;
+        }
+        for (uint32_t i = 0; i < kVerifyChunk; ++i) {
+            if (chunk[i] != 0xFF) {
+                _verifying = kNone;
+                if (_dev.startErase(_dev.user, target)) {
+                    _erasing = target;
+                }
+                return true;
+            }
+        }
+        _verifyOff += kVerifyChunk;
+        if (_verifyOff >= _blockSize) {
+            _verifying = kNone;
+            setBlank(target, true);
+            ++_stats.foundBlank;
+        }
+        return true;
+    }
+
+    /** @brief Wait for a background erase to finish; call before any synchronous erase */
+    void settle() {
+        if (_erasing == kNone) {
+            return;
+        }
+        while (_dev.busy(_dev.user)) {
+        }
+        setBlank(_erasing, true);
+        _erasing = kNone;
+        ++_stats.erased;
+    }
+
+    /**
+     * @brief LittleFS erase hook: consume the blank bit of a block
+     * @return true if the block is known blank and the erase can be skipped
+     */
+    bool takeBlank(uint32_t block) {
+        settle();
+        forget(block);
+        if (isBlank(block)) {
+            setBlank(block, false);
+            ++_stats.hits;
+            return true;
+        }
+        ++_stats.misses;
+        return false;
+    }
+
+    /** @brief LittleFS program hook: the block is no longer blank */
+    void noteProgram(uint32_t block) {
+        forget(block);
+        setBlank(block, false);
+    }
+
+    bool isBlank(uint32_t block) const {
+        return block < _blockCount && (_blank[block / 8] & (1u << (block % 8))) != 0;
+    }
+
+    /** @brief Blocks currently known blank */
+    uint32_t blankCount() const {
+        uint32_t n = 0;
+        for (uint32_t b = 0; b < _blockCount; ++b) {
+            n += isBlank(b) ? 1 : 0;
+        }
+        return n;
+    }
+
+    const EraseAheadStats& stats() const { return _stats; }
+
+    void resetStats() { memset(&_stats, 0, sizeof(_stats)); }
+
+private:
+    void reset() {
+        memset(_blank, 0, sizeof(_blank));
+        memset(&_stats, 0, sizeof(_stats));
+        _erasing = kNone;
+        _verifying = kNone;
+        _verifyOff = 0;
+    }
+
+    void setBlank(uint32_t block, bool blank) {
+        if (block >= _blockCount) {
+            return;
+        }
+        if (blank) {
+            _blank[block / 8] |= static_cast<uint8_t>(1u << (block % 8));
+        } else {
+            _blank[block / 8] &= static_cast<uint8_t>(~(1u << (block % 8)));
+        }
+    }
+
+    // A partial read-back of a block LittleFS just touched is stale.
+    void forget(uint32_t block) {
+        if (_verifying == block) {
+            _verifying = kNone;
+        }
+    }
+
+    // First of the next _depth free lookahead blocks that is not known blank.
+    uint32_t nextTarget(const lfs_t* lfs) const {
+        const lfs_block_t count = lfs->block_count;
+        if (count == 0 || lfs->lookahead.buffer == nullptr) {
+            return kNone;
+        }
+        uint32_t seen = 0;
+        for (lfs_block_t i = lfs->lookahead.next; i < lfs->lookahead.size && seen < _depth; ++i) {
+            if (lfs->lookahead.buffer[i / 8] & (1u << (i % 8))) {
+                continue;  // in use at the last scan
+            }
+            ++seen;
+            const uint32_t block = (lfs->lookahead.start + i) % count;
+            if (block < _blockCount && !isBlank(block)) {
+                return block;
+            }
+        }
+        return kNone;
+    }
+
+    EraseAheadDevice _dev;
+    uint32_t _blockCount;
+    uint32_t _blockSize;
+    uint32_t _depth;
+    uint32_t _erasing;
+    uint32_t _verifying;
+    uint32_t _verifyOff;
+    EraseAheadStats _stats;
+    uint8_t _blank[(kMaxBlocks + 7) / 8];
+};
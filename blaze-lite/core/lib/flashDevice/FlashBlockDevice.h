@@ -0,0 +1,60 @@
+/**
+ * @file FlashBlockDevice.h
+ * @brief The SPI NOR command set spiFlash needs, so the same storage code runs on the board and on a host
+ *
+ * Program and erase only issue the command and return; busy() reports the chip's WIP bit and
+ * waitReady() blocks until it clears. Every command waits for the previous program/erase first.
+ * Implementations: AdafruitFlashDevice (board) and EmulatedNorFlash (host tests and benchmarks).
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @class FlashBlockDevice
+ * @brief Abstract SPI NOR flash (256-byte pages, 4 KiB erase sectors)
+ */
+class FlashBlockDevice {
+public:
+    static constexpr uint32_t kPageSize = 256;
+    static constexpr uint32_t kSectorSize = 4096;
+
+    virtual ~FlashBlockDevice() {}
+
+    /** @brief Bring up the chip; false if it does not answer */
+    virtual bool begin() = 0;
+
+    /** @brief Capacity in bytes */
+    virtual uint32_t size() const = 0;
+
+    virtual uint32_t jedecId() = 0;
+
+    /** @brief Read any range (waits for a running program/erase first) */
+    virtual bool read(uint32_t address, uint8_t* buffer, uint32_t len) = 0;
+
+    /**
+     * @brief Issue a page program without waiting for it to complete
+     * @param len Bytes to program; must not cross a 256-byte page boundary
+     */
+    virtual bool startProgram(uint32_t address, const uint8_t* data, uint32_t len) = 0;
+
+    /** @brief Issue a 4 KiB sector erase without waiting for it to complete */
+    virtual bool startErase(uint32_t address) = 0;
+
+    /** @brief True while a program or erase is in progress */
+    virtual bool busy() = 0;
+
+    /** @brief Block until the chip is idle */
+    virtual void waitReady() = 0;
+
+    /** @brief Erase one sector and wait for it */
+    bool eraseSector(uint32_t sector) {
+        if (!startErase(sector * kSectorSize)) {
+            return false;
+        }
+        waitReady();
+        return true;
+    }
+};
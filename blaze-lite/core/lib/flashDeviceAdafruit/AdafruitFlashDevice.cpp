@@ -0,0 +1,115 @@
+/**
+ * @file AdafruitFlashDevice.cpp
+ * @brief Implementation of AdafruitFlashDevice
+ */
+
+#include "AdafruitFlashDevice.h"
+
+#include <flash_devices.h>
+
+namespace {
+
+// GD25Q128 (16 MiB): same ID pattern as GD25Q64 but capacity 0x18 — not in Adafruit's default table.
+static const SPIFlash_Device_t kGd25q128 = {
+    .total_size = (1UL << 24),
+    .start_up_time_us = 5000,
+    .manufacturer_id = 0xc8,
+    .memory_type = 0x40,
+    .capacity = 0x18,
+    .max_clock_speed_mhz = 104,
+    .quad_enable_bit_mask = 0x02,
+    .has_sector_protection = false,
+    .supports_fast_read = true,
+    .supports_qspi = true,
+    .supports_qspi_writes = true,
+    .write_status_register_split = true,
+    .single_status_byte = false,
+    .is_fram = false,
+};
+
+// Order: try exact parts used on Blaze / common alternates before library defaults.
+static const SPIFlash_Device_t kBlazeFlashCandidates[] = {
+    W25Q128JV_SQ,
+    W25Q128JV_PM,
+    MX25L12833F,
+    kGd25q128,
+};
+
+void logRawJedec(uint8_t csPin) {
+    pinMode(csPin, OUTPUT);
+    digitalWrite(csPin, HIGH);
+    delayMicroseconds(50);
+    SPI.beginTransaction(SPISettings(250000, MSBFIRST, SPI_MODE0));
+    digitalWrite(csPin, LOW);
+    delayMicroseconds(2);
+    SPI.transfer(0x9F);
+    uint8_t m = SPI.transfer(0xFF);
+    uint8_t t = SPI.transfer(0xFF);
+    uint8_t c = SPI.transfer(0xFF);
+    digitalWrite(csPin, HIGH);
+    SPI.endTransaction();
+    Serial.print("SPI flash raw JEDEC (manuf, type, cap): 0x");
+    if (m < 16) {
+        Serial.print('0');
+    }
+    Serial.print(m, HEX);
+    Serial.print(" 0x");
+    if (t < 16) {
+        Serial.print('0');
+    }
+    Serial.print(t, HEX);
+    Serial.print(" 0x");
+    if (c < 16) {
+        Serial.print('0');
+    }
+    Serial.print(c, HEX);
+    Serial.println(" (if FF FF FF check wiring / CS pin / power)");
+}
+
+}  // namespace
+
+AdafruitFlashDevice::AdafruitFlashDevice(uint8_t csPin, SPIClass& spi)
+    : _csPin(csPin), _transport(csPin, spi), _flash(&_transport) {}
+
+bool AdafruitFlashDevice::begin() {
+    // Pass explicit candidates: W25Q128JV-PM/IM (EF 70 18) is omitted from Adafruit's built-in list,
+    // which only includes W25Q128JV-SQ (EF 40 18).
+    Serial.println("Before SPI flash initialization:");
+    if (!_flash.begin(kBlazeFlashCandidates, sizeof(kBlazeFlashCandidates) / sizeof(kBlazeFlashCandidates[0]))) {
+        Serial.println("Error, failed to initialize flash chip!");
+        logRawJedec(_csPin);
+        return false;
+    }
+    Serial.print("Flash chip JEDEC ID: 0x");
+    Serial.println(_flash.getJEDECID(), HEX);
+    return true;
+}
+
+uint32_t AdafruitFlashDevice::size() const { return _flash.size(); }
+
+uint32_t AdafruitFlashDevice::jedecId() { return _flash.getJEDECID(); }
+
+bool AdafruitFlashDevice::read(uint32_t address, uint8_t* buffer, uint32_t len) {
+    return _flash.readBuffer(address, buffer, len) == len;
+}
+
+bool AdafruitFlashDevice::startProgram(uint32_t address, const uint8_t* data, uint32_t len) {
+    // writeBuffer() would wait for WIP after the program; issue WREN + PAGE PROGRAM ourselves.
+    _flash.waitUntilReady();
+    if (!_flash.writeEnable()) {
+        return false;
+    }
+    return _transport.writeMemory(address, data, len);
+}
+
+bool AdafruitFlashDevice::startErase(uint32_t address) {
+    _flash.waitUntilReady();
+    if (!_flash.writeEnable()) {
+        return false;
+    }
+    return _transport.eraseCommand(SFLASH_CMD_ERASE_SECTOR, address);
+}
+
+bool AdafruitFlashDevice::busy() { return (_flash.readStatus() & 0x01) != 0; }
+
+void AdafruitFlashDevice::waitReady() { _flash.waitUntilReady(); }
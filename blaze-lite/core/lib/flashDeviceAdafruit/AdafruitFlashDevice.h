@@ -0,0 +1,43 @@
+/**
+ * @file AdafruitFlashDevice.h
+ * @brief FlashBlockDevice on the Blaze W25Q128-class SPI NOR chip via Adafruit_SPIFlash
+ */
+
+#pragma once
+
+#include <SPI.h>
+
+#include <Adafruit_SPIFlash.h>
+
+#include "FlashBlockDevice.h"
+
+/**
+ * @class AdafruitFlashDevice
+ * @brief Adafruit_SPIFlash for detection/reads, raw transport commands for non-blocking program and erase
+ */
+class AdafruitFlashDevice : public FlashBlockDevice {
+public:
+    /**
+     * @param csPin Flash chip select
+     * @param spi SPI bus shared with the other peripherals
+     */
+    explicit AdafruitFlashDevice(uint8_t csPin, SPIClass& spi = SPI);
+
+    /** @brief Detect the chip against the Blaze candidate list; logs the raw JEDEC ID on failure */
+    bool begin() override;
+
+    uint32_t size() const override;
+    uint32_t jedecId() override;
+    bool read(uint32_t address, uint8_t* buffer, uint32_t len) override;
+    bool startProgram(uint32_t address, const uint8_t* data, uint32_t len) override;
+    bool startErase(uint32_t address) override;
+    bool busy() override;
+    void waitReady() override;
+
+    uint8_t getCS_PIN() const { return _csPin; }
+
+private:
+    uint8_t _csPin;
+    Adafruit_FlashTransport_SPI _transport;
+    mutable Adafruit_SPIFlash _flash;
+};
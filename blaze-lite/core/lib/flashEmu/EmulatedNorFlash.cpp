@@ -0,0 +1,266 @@
+/**
+ * @file EmulatedNorFlash.cpp
+ * @brief Implementation of EmulatedNorFlash
+ */
+
+#include "EmulatedNorFlash.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "HostClock.h"
+
+namespace {
+constexpr uint64_t kNever = ~0ULL;
+constexpr uint32_t kCommandBytes = 4;  // opcode + 24-bit address
+}  // namespace
+
+EmulatedNorFlash::EmulatedNorFlash(uint32_t sizeBytes, const NorTimings& timings, uint32_t seed)
+    : _t(timings),
+      _mem(sizeBytes, 0xFF),
+      _sectorErases(sizeBytes / kSectorSize, 0),
+      _badSectors(sizeBytes / kSectorSize, false),
+      _stats{},
+      _path(nullptr),
+      _powered(true),
+      _cutAtUs(kNever),
+      _cutAfterOps(0),
+      _rng(seed != 0 ? seed : 1),
+      _op(Op::None),
+      _opStartUs(0),
+      _opDoneUs(0),
+      _opAddress(0),
+      _opLen(0),
+      _opData{} {}
+
+bool EmulatedNorFlash::begin() {
+    if (!checkPower()) {
+        return false;
+    }
+    hostClockAdvanceUs(5000);  // tPUW-style start-up delay
+    return true;
+}
+
+bool EmulatedNorFlash::read(uint32_t address, uint8_t* buffer, uint32_t len) {
+    if (!checkPower() || buffer == nullptr || address + len > _mem.size()) {
+        return false;
+    }
+    waitReady();
+    if (!_powered) {
+        return false;
+    }
+    transfer(kCommandBytes + len);
+    memcpy(buffer, &_mem[address], len);
+    ++_stats.reads;
+    _stats.readBytes += len;
+    return true;
+}
+
+bool EmulatedNorFlash::startProgram(uint32_t address, const uint8_t* data, uint32_t len) {
+    if (!checkPower() || data == nullptr || len == 0 || len > kPageSize || address >= _mem.size()) {
+        return false;
+    }
+    waitReady();
+    if (!_powered) {
+        return false;
+    }
+    transfer(1);  // WREN
+    transfer(kCommandBytes + len);
+
+    _op = Op::Program;
+    _opAddress = address;
+    _opLen = len;
+    memcpy(_opData, data, len);
+    _opStartUs = hostClockUs();
+    _opDoneUs = _opStartUs + duration(_t.pageProgramUs, _t.pageProgramMaxUs);
+    _stats.busyUs += _opDoneUs - _opStartUs;
+    ++_stats.programs;
+    _stats.programBytes += len;
+
+    if (_cutAfterOps > 0 && --_cutAfterOps == 0) {
+        _cutAtUs = _opStartUs + (_opDoneUs - _opStartUs) / 2;
+    }
+    return true;
+}
+
+bool EmulatedNorFlash::startErase(uint32_t address) {
+    if (!checkPower() || address >= _mem.size()) {
+        return false;
+    }
+    waitReady();
+    if (!_powered) {
+        return false;
+    }
+    transfer(1);  // WREN
+    transfer(kCommandBytes);
+
+    _op = Op::Erase;
+    _opAddress = address - (address % kSectorSize);
+    _opLen = kSectorSize;
+    _opStartUs = hostClockUs();
+    _opDoneUs = _opStartUs + duration(_t.sectorEraseUs, _t.sectorEraseMaxUs);
+    _stats.busyUs += _opDoneUs - _opStartUs;
+    ++_stats.erases;
+    ++_sectorErases[_opAddress / kSectorSize];
+
+    if (_cutAfterOps > 0 && --_cutAfterOps == 0) {
+        _cutAtUs = _opStartUs + (_opDoneUs - _opStartUs) / 2;
+    }
+    return true;
+}
+
+bool EmulatedNorFlash::busy() {
+    if (!checkPower()) {
+        return false;
+    }
+    transfer(2);  // RDSR + status byte
+    ++_stats.statusPolls;
+    settle();
+    return _op != Op::None;
+}
+
+void EmulatedNorFlash::waitReady() {
+    if (!checkPower() || _op == Op::None) {
+        return;
+    }
+    const uint64_t now = hostClockUs();
+    if (_opDoneUs > now) {
+        // Power may fail while we wait.
+        const uint64_t until = _cutAtUs < _opDoneUs ? _cutAtUs : _opDoneUs;
+        _stats.waitUs += until - now;
+        hostClockAdvanceTo(until);
+        if (!checkPower()) {
+            return;
+        }
+    }
+    settle();
+}
+
+bool EmulatedNorFlash::open(const char* path) {
+    _path = path;
+    FILE* f = fopen(path, "rb");
+    if (f == nullptr) {
+        memset(_mem.data(), 0xFF, _mem.size());
+        return true;
+    }
+    const size_t n = fread(_mem.data(), 1, _mem.size(), f);
+    fclose(f);
+    return n == _mem.size();
+}
+
+bool EmulatedNorFlash::save() const {
+    if (_path == nullptr) {
+        return false;
+    }
+    FILE* f = fopen(_path, "wb");
+    if (f == nullptr) {
+        return false;
+    }
+    const size_t n = fwrite(_mem.data(), 1, _mem.size(), f);
+    fclose(f);
+    return n == _mem.size();
+}
+
+void EmulatedNorFlash::cutPowerAtUs(uint64_t t) { _cutAtUs = t; }
+
+void EmulatedNorFlash::cutPowerAfterOps(uint32_t n) { _cutAfterOps = n; }
+
+void EmulatedNorFlash::setBadSector(uint32_t sector, bool bad) {
+    if (sector < _badSectors.size()) {
+        _badSectors[sector] = bad;
+    }
+}
+
+void EmulatedNorFlash::powerOn() {
+    _powered = true;
+    _cutAtUs = kNever;
+    _cutAfterOps = 0;
+    _op = Op::None;
+}
+
+void EmulatedNorFlash::resetStats() {
+    memset(&_stats, 0, sizeof(_stats));
+    for (uint32_t& e : _sectorErases) {
+        e = 0;
+    }
+}
+
+bool EmulatedNorFlash::checkPower() {
+    if (!_powered) {
+        return false;
+    }
+    if (hostClockUs() < _cutAtUs) {
+        return true;
+    }
+    // Power fails at _cutAtUs: an operation still running then is only partly done.
+    if (_op != Op::None) {
+        if (_opDoneUs <= _cutAtUs) {
+            applyPending(_opLen, false);
+        } else {
+            const uint64_t total = _opDoneUs - _opStartUs;
+            const uint64_t done = _cutAtUs > _opStartUs ? _cutAtUs - _opStartUs : 0;
+            applyPending(static_cast<uint32_t>(_opLen * done / (total != 0 ? total : 1)), true);
+        }
+    }
+    _op = Op::None;
+    _powered = false;
+    return false;
+}
+
+void EmulatedNorFlash::settle() {
+    if (_op != Op::None && hostClockUs() >= _opDoneUs) {
+        applyPending(_opLen, false);
+        _op = Op::None;
+    }
+}
+
+void EmulatedNorFlash::applyPending(uint32_t bytesToApply, bool torn) {
+    if (_op == Op::Program) {
+        if (_badSectors[_opAddress / kSectorSize]) {
+            ++_stats.failedPrograms;
+            return;
+        }
+        const uint32_t pageBase = _opAddress - (_opAddress % kPageSize);
+        for (uint32_t i = 0; i < _opLen; ++i) {
+            const uint32_t at = pageBase + ((_opAddress - pageBase + i) % kPageSize);
+            uint8_t value = _opData[i];
+            if (i >= bytesToApply) {
+                // Cells not reached yet: an interrupted program leaves random partial results.
+                value = torn ? static_cast<uint8_t>(_opData[i] | random()) : 0xFF;
+            }
+            if ((_mem[at] & value) != value && value == _opData[i]) {
+                ++_stats.norViolations;
+            }
+            _mem[at] &= value;
+        }
+    } else if (_op == Op::Erase) {
+        for (uint32_t i = 0; i < kSectorSize; ++i) {
+            if (i < bytesToApply) {
+                _mem[_opAddress + i] = 0xFF;
+            } else if (torn) {
+                _mem[_opAddress + i] |= static_cast<uint8_t>(random());
+            }
+        }
+    }
+}
+
+void EmulatedNorFlash::transfer(uint32_t bytes) {
+    const uint64_t bits = static_cast<uint64_t>(bytes) * 8;
+    hostClockAdvanceUs(_t.commandOverheadUs + (bits * 1000000ULL + _t.spiClockHz - 1) / _t.spiClockHz);
+}
+
+uint32_t EmulatedNorFlash::duration(uint32_t typ, uint32_t max) {
+    if (_t.jitter <= 0.0f || max <= typ) {
+        return typ;
+    }
+    const float u = static_cast<float>(random() % 10000) / 10000.0f;
+    return typ + static_cast<uint32_t>((max - typ) * _t.jitter * u);
+}
+
+uint32_t EmulatedNorFlash::random() {
+    // xorshift32: deterministic for a given seed.
+    _rng ^= _rng << 13;
+    _rng ^= _rng >> 17;
+    _rng ^= _rng << 5;
+    return _rng;
+}
@@ -0,0 +1,134 @@
+/**
+ * @file EmulatedNorFlash.h
+ * @brief Host stand-in for the W25Q128 behind FlashBlockDevice
+ *
+ * RAM-backed (optionally loaded from / saved to an image file) with NOR semantics: programs
+ * only clear bits, erases set a whole 4 KiB sector to 0xFF, and a page program wraps inside
+ * its 256-byte page. Commands take virtual time on the host clock (SPI transfer at the
+ * configured clock plus tPP / tSE from the datasheet), so code calling millis()/micros()
+ * sees realistic latency. A power cut can be scheduled; the operation in flight is then
+ * only partly applied and every later command fails until powerOn(). Sectors can be marked
+ * bad: programs into them complete without changing the cells, as worn-out cells do.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "FlashBlockDevice.h"
+
+/**
+ * @struct NorTimings
+ * @brief Operation timings (us) and bus speed; defaults are W25Q128JV datasheet typical values
+ */
+struct NorTimings {
+    uint32_t pageProgramUs = 700;
+    uint32_t pageProgramMaxUs = 3000;
+    uint32_t sectorEraseUs = 45000;
+    uint32_t sectorEraseMaxUs = 400000;
+    uint32_t spiClockHz = 24000000;
+    uint32_t commandOverheadUs = 1;  ///< CS toggle and driver overhead per command
+    float jitter = 0.0f;             ///< 0 = always typical, 1 = uniform between typical and max
+
+    /** @brief Every program and erase takes its datasheet maximum */
+    static NorTimings worstCase() {
+        NorTimings t;
+        t.pageProgramUs = t.pageProgramMaxUs;
+        t.sectorEraseUs = t.sectorEraseMaxUs;
+        return t;
+    }
+};
+
+/**
+ * @struct NorStats
+ * @brief Operation counters since construction or resetStats()
+ */
+struct NorStats {
+    uint64_t reads;
+    uint64_t readBytes;
+    uint64_t programs;
+    uint64_t programBytes;
+    uint64_t erases;
+    uint64_t statusPolls;
+    uint64_t waitUs;          ///< Virtual time spent blocked waiting for WIP to clear
+    uint64_t busyUs;          ///< Total program/erase time
+    uint64_t norViolations;   ///< Programs that tried to turn a 0 bit back into 1
+    uint64_t failedPrograms;  ///< Programs into a bad sector
+};
+
+/**
+ * @class EmulatedNorFlash
+ * @brief FlashBlockDevice backed by host RAM with virtual-time latency and power-cut injection
+ */
+class EmulatedNorFlash : public FlashBlockDevice {
+public:
+    static constexpr uint32_t kW25Q128Size = 1UL << 24;
+    static constexpr uint32_t kW25Q128Jedec = 0xEF4018;
+
+    explicit EmulatedNorFlash(uint32_t sizeBytes = kW25Q128Size, const NorTimings& timings = NorTimings(),
+                              uint32_t seed = 1);
+
+    bool begin() override;
+    uint32_t size() const override { return static_cast<uint32_t>(_mem.size()); }
+    uint32_t jedecId() override { return kW25Q128Jedec; }
+    bool read(uint32_t address, uint8_t* buffer, uint32_t len) override;
+    bool startProgram(uint32_t address, const uint8_t* data, uint32_t len) override;
+    bool startErase(uint32_t address) override;
+    bool busy() override;
+    void waitReady() override;
+
+    /** @brief Load an image file (missing file = blank chip); later save() writes it back */
+    bool open(const char* path);
+    bool save() const;
+
+    /** @brief Cut power at an absolute virtual time (us); the operation running then is torn */
+    void cutPowerAtUs(uint64_t t);
+    /** @brief Cut power during the n-th program/erase command from now (1 = the next one) */
+    void cutPowerAfterOps(uint32_t n);
+    /** @brief Restore power; pending cuts are cleared */
+    void powerOn();
+    bool powered() const { return _powered; }
+
+    /** @brief Make programs into a 4 KiB sector fail silently (or work again) */
+    void setBadSector(uint32_t sector, bool bad = true);
+
+    void setTimings(const NorTimings& timings) { _t = timings; }
+    const NorStats& stats() const { return _stats; }
+    void resetStats();
+
+    /** @brief Erase count per 4 KiB sector */
+    const std::vector<uint32_t>& sectorErases() const { return _sectorErases; }
+
+    /** @brief Direct access to the cell array (for tests) */
+    std::vector<uint8_t>& image() { return _mem; }
+
+private:
+    enum class Op : uint8_t { None, Program, Erase };
+
+    bool checkPower();
+    void settle();
+    void applyPending(uint32_t bytesToApply, bool tornErase);
+    void transfer(uint32_t bytes);
+    uint32_t duration(uint32_t typ, uint32_t max);
+    uint32_t random();
+
+    NorTimings _t;
+    std::vector<uint8_t> _mem;
+    std::vector<uint32_t> _sectorErases;
+    std::vector<bool> _badSectors;
+    NorStats _stats;
+    const char* _path;
+    bool _powered;
+    uint64_t _cutAtUs;
+    uint32_t _cutAfterOps;
+    uint32_t _rng;
+
+    Op _op;
+    uint64_t _opStartUs;
+    uint64_t _opDoneUs;
+    uint32_t _opAddress;
+    uint32_t _opLen;
+    uint8_t _opData[kPageSize];
+};
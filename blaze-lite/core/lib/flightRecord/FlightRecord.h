@@ -0,0 +1,133 @@
+/**
+ * @file FlightRecord.h
+ * @brief Packed binary flight-data record written to SD and SPI flash
+ *
+ * One 24-byte record per sensor sample, replacing the ASCII CSV line. Values are stored
+ * raw (KX134 counts, MS5611 pressure/temperature) so nothing is formatted on board;
+ * tools/flight_decode turns DATA###.bin back into the legacy CSV columns.
+ *
+ * Layout is little-endian (Cortex-M4 and x86 hosts). Bump FLIGHT_RECORD_VERSION whenever
+ * a field changes meaning; decoders reject versions they do not know. Each record carries a
+ * CRC-8 so a decoder can resynchronise on the magic byte without accepting torn records.
+ */
+
+#pragma once
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "RawAccel.h"
+
+static constexpr uint8_t FLIGHT_RECORD_MAGIC = 0xB7;
+static constexpr uint8_t FLIGHT_RECORD_VERSION = 1;
+
+/** Bits of FlightRecord::flags */
+static constexpr uint8_t FLIGHT_RECORD_ACCEL_VALID = 0x01;
+static constexpr uint8_t FLIGHT_RECORD_BARO_VALID = 0x02;
+static constexpr uint8_t FLIGHT_RECORD_RANGE_SHIFT = 4;  ///< KX134 range code (0=8g .. 3=64g) in bits 4..5
+static constexpr uint8_t FLIGHT_RECORD_RANGE_MASK = 0x30;
+
+/**
+ * @struct FlightRecord
+ * @brief One sensor sample as stored on the logging media
+ */
+struct __attribute__((packed)) FlightRecord {
+    uint8_t magic;              ///< FLIGHT_RECORD_MAGIC, used to resynchronise after corruption
+    uint8_t versionPhase;       ///< FLIGHT_RECORD_VERSION in bits 4..7, FlightPhase in bits 0..3
+    uint8_t flags;              ///< Validity bits and accelerometer range code
+    uint8_t crc;                ///< CRC-8 (poly 0x07) of the record with this byte set to 0
+    uint32_t timestampMs;       ///< System timestamp (ms)
+    uint32_t sequence;          ///< Sample sequence number
+    int16_t accelRaw[3];        ///< KX134 X/Y/Z output in counts
+    int16_t temperatureCentiC;  ///< MS5611 temperature (0.01 C)
+    int32_t pressureDeciPa;     ///< MS5611 pressure (0.1 Pa)
+};
+
+static_assert(sizeof(FlightRecord) == 24, "FlightRecord layout changed; bump FLIGHT_RECORD_VERSION");
+
+/**
+ * @brief g per count for a KX134 range code, the inverse of rawAccelCountsPerG()
+ * @param rangeCode 0=8g, 1=16g, 2=32g, 3=64g
+ */
+inline float flightRecordAccelScale(uint8_t rangeCode) {
+    return 1.0f / static_cast<float>(rawAccelCountsPerG(rangeCode));
+}
+
+/** @brief Record version stored in versionPhase */
+inline uint8_t flightRecordVersion(const FlightRecord& rec) { return rec.versionPhase >> 4; }
+
+/** @brief FlightPhase value stored in versionPhase */
+inline uint8_t flightRecordPhase(const FlightRecord& rec) { return rec.versionPhase & 0x0F; }
+
+/**
+ * @brief CRC-8 (poly 0x07, init 0) over the record, treating the crc byte as 0
+ */
+inline uint8_t flightRecordCrc(const FlightRecord& rec) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&rec);
+    uint8_t crc = 0;
+    for (size_t i = 0; i < sizeof(FlightRecord); ++i) {
+        crc ^= (i == offsetof(FlightRecord, crc)) ? 0 : bytes[i];
+        for (uint8_t bit = 0; bit < 8; ++bit) {
+            crc = (crc & 0x80) ? static_cast<uint8_t>((crc << 1) ^ 0x07) : static_cast<uint8_t>(crc << 1);
+        }
+    }
+    return crc;
+}
+
+/**
+ * @brief Fill magic, version/phase and CRC; call after every other field is set
+ */
+inline void flightRecordSeal(FlightRecord& rec, uint8_t phase) {
+    rec.magic = FLIGHT_RECORD_MAGIC;
+    rec.versionPhase = static_cast<uint8_t>((FLIGHT_RECORD_VERSION << 4) | (phase & 0x0F));
+    rec.crc = flightRecordCrc(rec);
+}
+
+/**
+ * @brief Check magic, version and CRC of a record
+ */
+inline bool flightRecordIsValid(const FlightRecord& rec) {
+    return rec.magic == FLIGHT_RECORD_MAGIC && flightRecordVersion(rec) == FLIGHT_RECORD_VERSION &&
+           rec.crc == flightRecordCrc(rec);
+}
+
+/**
+ * @brief Standard-atmosphere altitude for a pressure, matching Baro::getAltitude()
+ * @param pressureHpa Pressure (hPa)
+ * @param seaLevelHpa Reference pressure (hPa)
+ */
+inline float flightRecordAltitude(float pressureHpa, float seaLevelHpa = 1013.25f) {
+    return 44307.694f * (1.0f - powf(pressureHpa / seaLevelHpa, 0.190284f));
+}
+
+/**
+ * @brief Format a record as the legacy CSV line
+ *
+ * Columns: timestamp, sequence, ax, ay, az, |a| (g, 3 decimals), altitude (m, 2 decimals), phase.
+ * Intended for host-side tooling; the flight firmware never formats records.
+ * @return Characters written (excluding NUL), or a negative value on error
+ */
+inline int flightRecordToCsv(const FlightRecord& rec, char* out, size_t outSize, float seaLevelHpa = 1013.25f) {
+    float ax = 0.0f;
+    float ay = 0.0f;
+    float az = 0.0f;
+    float mag = 0.0f;
+    if (rec.flags & FLIGHT_RECORD_ACCEL_VALID) {
+        const float scale = flightRecordAccelScale((rec.flags & FLIGHT_RECORD_RANGE_MASK) >> FLIGHT_RECORD_RANGE_SHIFT);
+        ax = rec.accelRaw[0] * scale;
+        ay = rec.accelRaw[1] * scale;
+        az = rec.accelRaw[2] * scale;
+        mag = sqrtf(ax * ax + ay * ay + az * az);
+    }
+    float altitude = 0.0f;
+    if (rec.flags & FLIGHT_RECORD_BARO_VALID) {
+        altitude = flightRecordAltitude(rec.pressureDeciPa / 1000.0f, seaLevelHpa);
+    }
+    return snprintf(out, outSize, "%lu,%lu,%.3f,%.3f,%.3f,%.3f,%.2f,%u\r\n",
+                    static_cast<unsigned long>(rec.timestampMs),
+                    static_cast<unsigned long>(rec.sequence),
+                    ax, ay, az, mag, altitude,
+                    static_cast<unsigned>(flightRecordPhase(rec)));
+}
@@ -0,0 +1,293 @@
+/**
+ * @file FlightReplay.h
+ * @brief Host-side replay of logged or simulated sensor streams through the flight pipeline
+ *
+ * FlightReplayer runs samples through the same chain as the firmware: PadAltitude (pressure to
+ * height above the pad) -> AltitudeFilter -> FlightStateMachine on sample time, the way recordSensorSample(),
+ * pollBarometer() and updateStateMachine() do in main.cpp. It records when each phase is first
+ * entered; scoreFlightEvents() compares that with a reference (the logged phase column or
+ * annotated ground truth).
+ *
+ * Also parses the legacy DATA###.txt CSV line (timestamp, sequence, ax, ay, az, |a|, altitude,
+ * phase), as written by the firmware before FlightRecord and by tools/flight_decode.
+ *
+ * Used by tools/flight_replay and the native tests; not part of the board build.
+ */
+
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "AltitudeFilter.h"
+#include "BaroAltitude.h"
+#include "FlightState.h"
+#include "RawAccel.h"
+
+/** Number of FlightPhase values (UNARMED .. ERROR). */
+static constexpr int FLIGHT_PHASE_COUNT = 7;
+
+/** @brief Upper-case name of a phase ("LAUNCH"), or "?" */
+inline const char* flightPhaseName(FlightPhase phase) {
+    static const char* const kNames[FLIGHT_PHASE_COUNT] = {"UNARMED", "ARMED", "LAUNCH", "APOGEE",
+                                                           "DESCENT", "LANDED", "ERROR"};
+    const uint8_t i = static_cast<uint8_t>(phase);
+    return i < FLIGHT_PHASE_COUNT ? kNames[i] : "?";
+}
+
+/**
+ * @brief Phase for a name as printed by flightPhaseName() (case-sensitive)
+ * @return false if name is not a phase
+ */
+inline bool flightPhaseFromName(const char* name, FlightPhase* out) {
+    for (int i = 0; i < FLIGHT_PHASE_COUNT; ++i) {
+        const FlightPhase phase = static_cast<FlightPhase>(i);
+        const char* candidate = flightPhaseName(phase);
+        const char* a = name;
+        const char* b = candidate;
+        while (*a != '\0' && *a == *b) {
+            ++a;
+            ++b;
+        }
+        if (*a == '\0' && *b == '\0') {
+            *out = phase;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @struct ReplaySample
+ * @brief One sensor sample as the pipeline sees it
+ */
+struct ReplaySample {
+    uint32_t timestampUs;  ///< Sample time
+    int16_t accelRaw[3];   ///< KX134 X/Y/Z counts
+    uint8_t accelRange;    ///< KX134 range code of accelRaw
+    bool accelValid;
+    float pressureHpa;     ///< Barometer pressure (hPa)
+    bool baroFresh;        ///< pressureHpa is a new barometer sample (false: repeated from an earlier one)
+};
+
+/**
+ * @struct DataCsvRow
+ * @brief One parsed DATA###.txt line
+ */
+struct DataCsvRow {
+    uint32_t timestampMs;
+    uint32_t sequence;
+    float accelG[3];
+    float magnitudeG;
+    float altitudeM;
+    uint8_t phase;
+};
+
+/**
+ * @brief Parse "timestamp,seq,ax,ay,az,|a|,alt,phase" (trailing CR/LF ignored)
+ * @return false for headers, blank or malformed lines
+ */
+inline bool parseDataCsvLine(const char* line, DataCsvRow* out) {
+    char* end = nullptr;
+    const char* p = line;
+    double v[8];
+    for (int i = 0; i < 8; ++i) {
+        v[i] = strtod(p, &end);
+        if (end == p) {
+            return false;
+        }
+        p = end;
+        if (i < 7) {
+            if (*p != ',') {
+                return false;
+            }
+            ++p;
+        }
+    }
+    while (*p == ' ' || *p == '\r' || *p == '\n') {
+        ++p;
+    }
+    if (*p != '\0' || v[0] < 0.0 || v[7] < 0.0 || v[7] >= FLIGHT_PHASE_COUNT) {
+        return false;
+    }
+    out->timestampMs = static_cast<uint32_t>(v[0]);
+    out->sequence = static_cast<uint32_t>(v[1]);
+    out->accelG[0] = static_cast<float>(v[2]);
+    out->accelG[1] = static_cast<float>(v[3]);
+    out->accelG[2] = static_cast<float>(v[4]);
+    out->magnitudeG = static_cast<float>(v[5]);
+    out->altitudeM = static_cast<float>(v[6]);
+    out->phase = static_cast<uint8_t>(v[7]);
+    return true;
+}
+
+/**
+ * @brief KX134 counts for an acceleration in g at a range code, saturating like the sensor
+ */
+inline int16_t rawAccelFromG(float g, uint8_t rangeCode) {
+    const float counts = roundf(g * static_cast<float>(rawAccelCountsPerG(rangeCode)));
+    if (counts > 32767.0f) {
+        return 32767;
+    }
+    if (counts < -32768.0f) {
+        return -32768;
+    }
+    return static_cast<int16_t>(counts);
+}
+
+/**
+ * @struct FlightEvents
+ * @brief Sample time at which each phase was first entered
+ */
+struct FlightEvents {
+    uint32_t timeUs[FLIGHT_PHASE_COUNT];
+    bool seen[FLIGHT_PHASE_COUNT];
+
+    void clear() {
+        for (int i = 0; i < FLIGHT_PHASE_COUNT; ++i) {
+            timeUs[i] = 0;
+            seen[i] = false;
+        }
+    }
+
+    void mark(FlightPhase phase, uint32_t us) {
+        const uint8_t i = static_cast<uint8_t>(phase);
+        if (i < FLIGHT_PHASE_COUNT && !seen[i]) {
+            seen[i] = true;
+            timeUs[i] = us;
+        }
+    }
+};
+
+/**
+ * @class FlightReplayer
+ * @brief Feeds samples through pad reference, AltitudeFilter and FlightStateMachine
+ */
+class FlightReplayer {
+public:
+    /**
+     * @param useFilter true: state machine gets AltitudeFilter altitude/velocity (firmware
+     *                  behaviour); false: raw pad-referenced altitude, velocity by differencing
+     * @param axialAxis KX134 axis along the body (KX134_AXIAL_AXIS)
+     * @param axialSign +1 or -1 (KX134_AXIAL_SIGN)
+     */
+    explicit FlightReplayer(bool useFilter = true, uint8_t axialAxis = 2, int8_t axialSign = 1)
+        : _useFilter(useFilter), _axialAxis(axialAxis), _axialSign(axialSign) {
+        reset();
+    }
+
+    void reset() {
+        _fsm.init();
+        _filter.reset(0.0f);
+        _events.clear();
+        _pad.reset();
+        _agl = 0.0f;
+        _haveBaro = false;
+        _samples = 0;
+    }
+
+    /** Detection thresholds for the state machine (kept across reset()). */
+    void setDetectorConfig(const FlightDetectorConfig& config) { _fsm.setDetectorConfig(config); }
+
+    /** Arm at sample time us, as the "sm" ARM radio command does. */
+    void arm(uint32_t us) {
+        _fsm.setPhase(FlightPhase::ARMED);
+        _events.mark(FlightPhase::ARMED, us);
+    }
+
+    /**
+     * @brief Run one sample through the pipeline
+     * @return true if the flight phase changed on this sample
+     */
+    bool feed(const ReplaySample& s) {
+        ++_samples;
+        const FlightPhase phase = _fsm.getPhase();
+        // As applySensorPhase() in main.cpp: no acceleration fusion from apogee on.
+        _filter.setAccelerationFused(phase != FlightPhase::APOGEE && phase != FlightPhase::DESCENT &&
+                                     phase != FlightPhase::LANDED);
+        if (s.accelValid) {
+            const float axialG = _axialSign * rawAccelToG(s.accelRaw[_axialAxis], s.accelRange);
+            _filter.updateAcceleration(s.timestampUs, (axialG - 1.0f) * ALT_FILTER_G0);
+        } else {
+            _filter.predictTo(s.timestampUs);
+        }
+        if (s.baroFresh) {
+            // Pad reference averaged while UNARMED/ARMED and held from LAUNCH on, as Baro::tick().
+            if (phase == FlightPhase::UNARMED || phase == FlightPhase::ARMED) {
+                _pad.addPadSample(s.pressureHpa);
+            }
+            _agl = _pad.agl(s.pressureHpa);
+            _filter.updateAltitude(s.timestampUs, _agl);
+            _haveBaro = true;
+        }
+        const float agl = _agl;
+        const bool fused = _useFilter && _haveBaro;
+        const uint32_t magSq = s.accelValid ? rawAccelMagnitudeSq(s.accelRaw) : 0;
+        const bool changed = _fsm.update(s.timestampUs, fused ? _filter.altitude() : agl, magSq, s.accelRange,
+                                         fused ? _filter.velocity() : NAN, fused ? _filter.acceleration() : NAN);
+        if (changed) {
+            _events.mark(_fsm.getPhase(), s.timestampUs);
+        }
+        return changed;
+    }
+
+    FlightPhase phase() const { return _fsm.getPhase(); }
+    const FlightState& state() const { return _fsm.getState(); }
+    const FlightEvents& events() const { return _events; }
+    const AltitudeFilter& filter() const { return _filter; }
+    uint32_t samples() const { return _samples; }
+
+private:
+    FlightStateMachine _fsm;
+    AltitudeFilter _filter;
+    FlightEvents _events;
+    bool _useFilter;
+    uint8_t _axialAxis;
+    int8_t _axialSign;
+    PadAltitude _pad;
+    float _agl;
+    bool _haveBaro;
+    uint32_t _samples;
+};
+
+/**
+ * @struct FlightEventScore
+ * @brief Detected vs reference time of one phase
+ */
+struct FlightEventScore {
+    bool expected;       ///< The reference has this phase
+    bool detected;       ///< The replay entered this phase
+    int32_t latencyMs;   ///< detected - reference (negative: early); valid if both
+    bool falsePositive;  ///< Detected without a reference, or earlier than allowed
+    bool missed;         ///< Expected but never detected
+};
+
+/**
+ * @brief Score LAUNCH, APOGEE, DESCENT and LANDED (index = FlightPhase value)
+ * @param earlyToleranceMs Detection this much before the reference still counts as correct
+ *                         (an onboard phase column is itself late)
+ * @return Number of false positives plus misses
+ */
+inline int scoreFlightEvents(const FlightEvents& reference, const FlightEvents& detected, uint32_t earlyToleranceMs,
+                             FlightEventScore out[FLIGHT_PHASE_COUNT]) {
+    int failures = 0;
+    for (int i = 0; i < FLIGHT_PHASE_COUNT; ++i) {
+        FlightEventScore& score = out[i];
+        score = FlightEventScore{reference.seen[i], detected.seen[i], 0, false, false};
+        const FlightPhase phase = static_cast<FlightPhase>(i);
+        if (phase != FlightPhase::LAUNCH && phase != FlightPhase::APOGEE && phase != FlightPhase::DESCENT &&
+            phase != FlightPhase::LANDED) {
+            continue;
+        }
+        if (score.expected && score.detected) {
+            score.latencyMs = static_cast<int32_t>(detected.timeUs[i] - reference.timeUs[i]) / 1000;
+            score.falsePositive = score.latencyMs < -static_cast<int32_t>(earlyToleranceMs);
+        } else {
+            score.falsePositive = score.detected;
+            score.missed = score.expected;
+        }
+        failures += (score.falsePositive ? 1 : 0) + (score.missed ? 1 : 0);
+    }
+    return failures;
+}
@@ -0,0 +1,342 @@
+/**
+ * @file FlightSim.h
+ * @brief 1-DOF rocket trajectory with synthetic KX134 / MS5611 streams, for Monte Carlo runs
+ *
+ * simulateFlight() integrates a vertical flight (thrust curve, mass flow, ISA drag, vertical
+ * gusts, parachute deployed a fixed delay after the *detected* apogee) and samples it the way the
+ * board does: KX134 specific force along the body axis at the accelerometer rate, quantised to
+ * counts and saturating at the range limit (+-64 g), and MS5611 pressure with noise plus a
+ * static-pressure excursion while the vehicle is transonic. The samples run through
+ * FlightReplayer, so the detectors see what they would in flight, closed loop. A motor ejection
+ * charge (backupDeployS after true apogee) opens the parachute if detection never does.
+ *
+ * Every dispersion is drawn from the seed, so one seed is one reproducible flight and two
+ * detector configurations can be compared on identical flights.
+ *
+ * Host only (tools/flight_sim and native tests); not part of the board build.
+ */
+
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+
+#include <random>
+
+#include "BaroAltitude.h"
+#include "FlightReplay.h"
+
+/**
+ * @struct ThrustCurve
+ * @brief Piecewise-linear thrust (N) over burn time (s), starting at t = 0
+ */
+struct ThrustCurve {
+    static constexpr int kMaxPoints = 64;
+    float timeS[kMaxPoints];
+    float thrustN[kMaxPoints];
+    int count = 0;
+
+    /** @return false if the curve is full or time does not increase */
+    bool add(float t, float n) {
+        if (count >= kMaxPoints || (count > 0 && t <= timeS[count - 1])) {
+            return false;
+        }
+        timeS[count] = t;
+        thrustN[count] = n;
+        ++count;
+        return true;
+    }
+
+    float at(float t) const {
+        if (count == 0 || t < 0.0f || t >= timeS[count - 1]) {
+            return 0.0f;
+        }
+        float prevT = 0.0f;
+        float prevN = 0.0f;
+        for (int i = 0; i < count; ++i) {
+            if (t < timeS[i]) {
+                return prevN + (thrustN[i] - prevN) * (t - prevT) / (timeS[i] - prevT);
+            }
+            prevT = timeS[i];
+            prevN = thrustN[i];
+        }
+        return 0.0f;
+    }
+
+    float burnTimeS() const { return count > 0 ? timeS[count - 1] : 0.0f; }
+
+    float impulseNs() const {
+        float total = 0.0f;
+        float prevT = 0.0f;
+        float prevN = 0.0f;
+        for (int i = 0; i < count; ++i) {
+            total += 0.5f * (prevN + thrustN[i]) * (timeS[i] - prevT);
+            prevT = timeS[i];
+            prevN = thrustN[i];
+        }
+        return total;
+    }
+
+    /** A mid-power I-class motor: ~330 N.s over 1.6 s. */
+    static ThrustCurve defaultMotor() {
+        ThrustCurve c;
+        c.add(0.05f, 320.0f);
+        c.add(0.20f, 260.0f);
+        c.add(1.20f, 200.0f);
+        c.add(1.45f, 120.0f);
+        c.add(1.60f, 0.0f);
+        return c;
+    }
+};
+
+/**
+ * @struct SimConfig
+ * @brief Vehicle, environment, sensor and dispersion parameters (SI units, 1-sigma dispersions)
+ */
+struct SimConfig {
+    // Vehicle
+    ThrustCurve motor = ThrustCurve::defaultMotor();
+    float dryMassKg = 1.6f;
+    float propellantKg = 0.18f;
+    float cdA = 0.0045f;          ///< Body Cd * reference area (m^2)
+    float parachuteCdA = 0.35f;   ///< Drogue Cd * area (m^2)
+    float deployDelayS = 0.0f;    ///< Parachute opens this long after detected APOGEE
+    float backupDeployS = 4.0f;   ///< Motor ejection: opens this long after true apogee regardless
+
+    // Environment
+    float padAltitudeM = 300.0f;  ///< Above sea level
+    float gustSigmaMs = 2.0f;     ///< Vertical gust (Ornstein-Uhlenbeck) standard deviation
+    float gustTauS = 1.5f;        ///< Gust correlation time
+
+    // Sensors
+    uint32_t accelRateHz = 400;
+    uint8_t accelRange = 3;       ///< KX134 range code (3 = +-64 g)
+    float accelNoiseG = 0.02f;
+    float boostVibrationG = 0.5f; ///< Extra accelerometer noise while the motor burns
+    uint32_t baroEvery = 4;       ///< One MS5611 sample per this many accelerometer samples
+    float baroNoisePa = 2.5f;
+    float transonicSpikePa = 600.0f;  ///< Peak static-pressure error near Mach 1 (0 disables)
+
+    // Run
+    float padTimeS = 3.0f;        ///< ARMED on the pad before ignition
+    float maxTimeS = 400.0f;
+    float substepS = 0.0005f;     ///< Integration step
+
+    // Dispersions (relative 1-sigma unless noted)
+    float thrustDispersion = 0.05f;
+    float dragDispersion = 0.10f;
+    float massDispersion = 0.03f;
+    float ignitionJitterS = 0.0f;
+};
+
+/**
+ * @struct SimFlightResult
+ * @brief Truth and detections for one simulated flight (times from the start of the run, s)
+ */
+struct SimFlightResult {
+    float ignitionS;
+    float trueApogeeS;
+    float trueApogeeM;            ///< Above the pad
+    float maxMach;
+    float deployS;                ///< Parachute opening (detected or backup)
+    float altitudeLostM;          ///< trueApogeeM - altitude at deploy (still to climb, if deployed early)
+    float landingS;               ///< Touchdown, -1 if the run ended first
+    bool launchDetected;
+    bool apogeeDetected;
+    bool landedDetected;
+    bool earlyApogee;             ///< APOGEE detected while still climbing
+    float launchDetectS;
+    float apogeeDetectS;
+    float landedDetectS;
+    bool apogeePredicted;         ///< Predicted-apogee event fired
+    float predictedEventS;        ///< ... at this time
+    float coastStartS;            ///< First apogee prediction (motor out), -1 if none
+    float coastPredictedApogeeM;  ///< Apogee predicted SIM_COAST_SCORE_S into the coast
+    float coastPredictedApogeeS;  ///< Apogee time predicted SIM_COAST_SCORE_S into the coast
+    uint32_t baroRejects;
+    uint32_t samples;
+};
+
+/** The apogee prediction is scored this long (s) after the coast starts (drag fit has data). */
+static constexpr float SIM_COAST_SCORE_S = 1.0f;
+
+/** ISA pressure (Pa) at a geometric altitude above sea level (troposphere). */
+inline double simIsaPressurePa(double altitudeM) { return 101325.0 * pow(1.0 - 2.25577e-5 * altitudeM, 5.25588); }
+
+/** ISA density (kg/m^3) at a geometric altitude above sea level (troposphere). */
+inline double simIsaDensity(double altitudeM) { return 1.225 * pow(1.0 - 2.25577e-5 * altitudeM, 4.25588); }
+
+/** ISA speed of sound (m/s). */
+inline double simIsaSpeedOfSound(double altitudeM) { return sqrt(1.4 * 287.05 * (288.15 - 0.0065 * altitudeM)); }
+
+/**
+ * @brief Fly one seeded flight through the detection pipeline
+ * @param detector Thresholds under test
+ */
+inline SimFlightResult simulateFlight(const SimConfig& cfg, const FlightDetectorConfig& detector, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::normal_distribution<double> unit(0.0, 1.0);
+    const double g0 = 9.80665;
+
+    const double thrustScale = 1.0 + cfg.thrustDispersion * unit(rng);
+    const double dragScale = 1.0 + cfg.dragDispersion * unit(rng);
+    const double massScale = 1.0 + cfg.massDispersion * unit(rng);
+    const double spikeScale = fabs(1.0 + 0.3 * unit(rng));
+    const double ignitionS = cfg.padTimeS + fabs(cfg.ignitionJitterS * unit(rng));
+    const double dryMass = cfg.dryMassKg * massScale;
+    const double impulse = cfg.motor.impulseNs();
+    const double cdA = cfg.cdA * dragScale;
+
+    FlightReplayer replay;
+    replay.setDetectorConfig(detector);
+
+    SimFlightResult r{};
+    r.ignitionS = static_cast<float>(ignitionS);
+    r.deployS = -1.0f;
+    r.landingS = -1.0f;
+    r.launchDetectS = -1.0f;
+    r.apogeeDetectS = -1.0f;
+    r.landedDetectS = -1.0f;
+    r.predictedEventS = -1.0f;
+    r.coastStartS = -1.0f;
+
+    const double samplePeriod = 1.0 / cfg.accelRateHz;
+    const int substeps = static_cast<int>(ceil(samplePeriod / cfg.substepS));
+    const double dt = samplePeriod / substeps;
+    const double gustDecay = exp(-samplePeriod / cfg.gustTauS);
+    const double gustKick = cfg.gustSigmaMs * sqrt(1.0 - gustDecay * gustDecay);
+
+    double h = 0.0;   // above the pad
+    double v = 0.0;
+    double gust = cfg.gustSigmaMs * unit(rng);
+    double burned = 0.0;  // impulse delivered so far
+    bool offPad = false;
+    bool deployed = false;
+    double deployAltitude = 0.0;
+    bool landed = false;
+    bool pastApogee = false;
+    bool coastScored = false;
+    double specificForce = g0;  // along the body axis, what the accelerometer senses
+    double baroPa = simIsaPressurePa(cfg.padAltitudeM);
+    ReplaySample sample{};
+    sample.accelRange = cfg.accelRange;
+    sample.accelValid = true;
+    replay.arm(0);
+
+    for (uint32_t n = 0;; ++n) {
+        const double t = n * samplePeriod;
+        if (t > cfg.maxTimeS || (r.landedDetected && t > r.landedDetectS + 1.0)) {
+            break;
+        }
+
+        // Physics up to this sample. Gust, density and speed of sound change slowly: once per sample.
+        gust = gust * gustDecay + gustKick * unit(rng);
+        const double density = simIsaDensity(cfg.padAltitudeM + h);
+        const double speedOfSound = simIsaSpeedOfSound(cfg.padAltitudeM + h);
+        for (int k = 0; k < substeps && !landed; ++k) {
+            const double tk = t - samplePeriod + (k + 1) * dt;
+            const double burnT = tk - ignitionS;
+            const double thrust = thrustScale * cfg.motor.at(static_cast<float>(burnT));
+            burned += thrust * dt;
+            const double mass = dryMass + cfg.propellantKg * (1.0 - fmin(1.0, burned / (thrustScale * impulse)));
+            const double vRel = v - gust;
+            const double area = cdA + (deployed ? cfg.parachuteCdA : 0.0);
+            const double drag = -0.5 * density * fabs(vRel) * vRel * area;
+            double accel = (thrust + drag) / mass - g0;
+            if (!offPad) {
+                if (thrust <= mass * g0) {
+                    specificForce = g0;  // resting on the pad
+                    continue;
+                }
+                offPad = true;
+            }
+            v += accel * dt;
+            h += v * dt;
+            specificForce = (thrust + drag) / mass;
+            const double mach = fabs(v) / speedOfSound;
+            if (mach > r.maxMach) {
+                r.maxMach = static_cast<float>(mach);
+            }
+            if (!pastApogee && offPad && v <= 0.0 && burnT > cfg.motor.burnTimeS()) {
+                pastApogee = true;
+                r.trueApogeeS = static_cast<float>(tk);
+                r.trueApogeeM = static_cast<float>(h);
+            }
+            if (!deployed && pastApogee && tk >= r.trueApogeeS + cfg.backupDeployS) {
+                deployed = true;
+                r.deployS = static_cast<float>(tk);
+                deployAltitude = h;
+            }
+            if (offPad && h <= 0.0 && v < 0.0) {
+                h = 0.0;
+                v = 0.0;
+                landed = true;
+                r.landingS = static_cast<float>(tk);
+            }
+        }
+
+        // KX134: specific force on the body axis; on the ground after landing it lies on its side.
+        const double noise = cfg.accelNoiseG + (t > ignitionS && t < ignitionS + cfg.motor.burnTimeS() ? cfg.boostVibrationG : 0.0);
+        const double axialG = landed ? 0.0 : specificForce / g0;
+        sample.timestampUs = static_cast<uint32_t>(t * 1e6);
+        sample.accelRaw[0] = rawAccelFromG(static_cast<float>((landed ? 1.0 : 0.0) + cfg.accelNoiseG * unit(rng)), cfg.accelRange);
+        sample.accelRaw[1] = rawAccelFromG(static_cast<float>(cfg.accelNoiseG * unit(rng)), cfg.accelRange);
+        sample.accelRaw[2] = rawAccelFromG(static_cast<float>(axialG + noise * unit(rng)), cfg.accelRange);
+
+        // MS5611 with a static-pressure excursion across Mach 0.85..1.15 (reads low, so high altitude).
+        sample.baroFresh = n % cfg.baroEvery == 0;
+        if (sample.baroFresh) {
+            const double altitude = cfg.padAltitudeM + h;
+            baroPa = simIsaPressurePa(altitude) + cfg.baroNoisePa * unit(rng);
+            const double mach = fabs(v) / simIsaSpeedOfSound(altitude);
+            if (cfg.transonicSpikePa > 0.0f && mach > 0.85 && mach < 1.15) {
+                baroPa -= spikeScale * cfg.transonicSpikePa * (1.0 - fabs(mach - 1.0) / 0.15);
+            }
+            sample.pressureHpa = static_cast<float>(baroPa / 100.0);
+        }
+
+        if (replay.feed(sample)) {
+            const FlightPhase phase = replay.phase();
+            if (phase == FlightPhase::LAUNCH && !r.launchDetected) {
+                r.launchDetected = true;
+                r.launchDetectS = static_cast<float>(t);
+            } else if (phase == FlightPhase::APOGEE && !r.apogeeDetected) {
+                r.apogeeDetected = true;
+                r.apogeeDetectS = static_cast<float>(t);
+                r.earlyApogee = !pastApogee;
+            } else if (phase == FlightPhase::LANDED && !r.landedDetected) {
+                r.landedDetected = true;
+                r.landedDetectS = static_cast<float>(t);
+            }
+        }
+        const FlightState& state = replay.state();
+        if (r.coastStartS < 0.0f && state.apogeePredictionValid) {
+            r.coastStartS = static_cast<float>(t);
+        }
+        if (r.coastStartS >= 0.0f && !coastScored && t >= r.coastStartS + SIM_COAST_SCORE_S &&
+            state.phase == FlightPhase::LAUNCH) {
+            coastScored = true;
+            r.coastPredictedApogeeM = state.predictedApogee;
+            r.coastPredictedApogeeS = static_cast<float>(t + state.timeToApogee);
+        }
+        if (!r.apogeePredicted && state.apogeePredicted) {
+            r.apogeePredicted = true;
+            r.predictedEventS = static_cast<float>(t);
+        }
+        if (!deployed && r.apogeeDetected && t >= r.apogeeDetectS + cfg.deployDelayS) {
+            deployed = true;
+            r.deployS = static_cast<float>(t);
+            deployAltitude = h;
+        }
+    }
+    // Scored once the true apogee is known, so an early deploy is charged the height still to climb.
+    if (deployed && pastApogee) {
+        r.altitudeLostM = static_cast<float>(r.trueApogeeM - deployAltitude);
+    }
+    if (!coastScored) {
+        r.coastStartS = -1.0f;
+    }
+    r.baroRejects = replay.filter().baroRejects();
+    r.samples = replay.samples();
+    return r;
+}
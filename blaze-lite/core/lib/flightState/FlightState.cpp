@@ -6,12 +6,11 @@
 #include "FlightState.h"
 
 FlightStateMachine::FlightStateMachine() 
-    : _state{}, _launchDetectionStart(0), _apogeeDetectionStart(0), 
-      _landedDetectionStart(0), _previousAltitude(0.0f), _previousVelocity(0.0f),
-      _lastUpdateTime(0)
+    : _state{}, _previousAltitude(0.0f), _previousVelocity(0.0f)
 {
     _state.phase = FlightPhase::UNARMED;
     _state.altitude = 0.0f;
+    _state.velocity = 0.0f;
     _state.maxAltitude = 0.0f;
     _state.timestamp = 0;
     _state.radioFlag = false;
@@ -21,6 +20,39 @@ FlightStateMachine::FlightStateMachine()
     _state.landedTime = 0;
     _state.errorFlag = false;
     memset(_state.errorMessage, 0, sizeof(_state.errorMessage));
+    _state.apogeePredictionValid = false;
+    _state.predictedApogee = 0.0f;
+    _state.timeToApogee = 0.0f;
+    _state.apogeePredicted = false;
+    _state.apogeePredictedTime = 0;
+    _debounce.clear();
+    _predictDebounce.clear();
+    setDetectorConfig(defaultDetectorConfig());
+}
+
+FlightDetectorConfig FlightStateMachine::defaultDetectorConfig() {
+    FlightDetectorConfig config;
+    config.launchAccelG = LAUNCH_ACCEL_THRESHOLD;
+    config.launchDetectionMs = LAUNCH_DETECTION_TIME;
+    config.apogeeVelocity = APOGEE_VELOCITY_THRESHOLD;
+    config.apogeeDetectionMs = APOGEE_DETECTION_TIME;
+    config.descentVelocity = DESCENT_VELOCITY_THRESHOLD;
+    config.landedAccelG = LANDED_ACCEL_THRESHOLD;
+    config.landedAltitudeM = LANDED_ALTITUDE_THRESHOLD;
+    config.landedDetectionMs = LANDED_DETECTION_TIME;
+    config.apogeeLeadMs = APOGEE_LEAD_TIME;
+    config.apogeePredictMs = APOGEE_PREDICT_TIME;
+    config.apogeeOnPrediction = APOGEE_ON_PREDICTION;
+    return config;
+}
+
+void FlightStateMachine::setDetectorConfig(const FlightDetectorConfig& config) {
+    _config = config;
+    for (uint8_t range = 0; range < 4; ++range) {
+        _launchAccelSq[range] = rawAccelThresholdSq(config.launchAccelG, range);
+        _landedAccelLowSq[range] = rawAccelThresholdSq(1.0f - config.landedAccelG, range);
+        _landedAccelHighSq[range] = rawAccelThresholdSq(1.0f + config.landedAccelG, range);
+    }
 }
 
 void FlightStateMachine::init() {
@@ -30,8 +62,9 @@ void FlightStateMachine::init() {
 void FlightStateMachine::reset() {
     _state.phase = FlightPhase::UNARMED;
     _state.altitude = 0.0f;
+    _state.velocity = 0.0f;
     _state.maxAltitude = 0.0f;
-    _state.timestamp = millis();
+    _state.timestamp = _clock.ms();
     _state.radioFlag = false;
     _state.loggingEnabled = false;
     _state.launchTime = 0;
@@ -39,22 +72,29 @@ void FlightStateMachine::reset() {
     _state.landedTime = 0;
     _state.errorFlag = false;
     memset(_state.errorMessage, 0, sizeof(_state.errorMessage));
+    _state.apogeePredictionValid = false;
+    _state.predictedApogee = 0.0f;
+    _state.timeToApogee = 0.0f;
+    _state.apogeePredicted = false;
+    _state.apogeePredictedTime = 0;
     
-    _launchDetectionStart = 0;
-    _apogeeDetectionStart = 0;
-    _landedDetectionStart = 0;
+    _debounce.clear();
+    _predictDebounce.clear();
+    _predictor.reset();
     _previousAltitude = 0.0f;
     _previousVelocity = 0.0f;
-    _lastUpdateTime = millis();
+    _clock.reset();
 }
 
-bool FlightStateMachine::update(float altitude, float acceleration, float velocity) {
-    uint32_t currentTime = millis();
-    uint32_t deltaTime = currentTime - _lastUpdateTime;
-    _lastUpdateTime = currentTime;
+bool FlightStateMachine::update(uint32_t timestampUs, float altitude, uint32_t accelMagnitudeSq, uint8_t accelRange,
+                                float velocity, float acceleration) {
+    const bool hasLastUpdate = _clock.started();
+    const uint64_t previousUs = _clock.us();
+    const uint64_t nowUs = _clock.update(timestampUs);
+    const uint32_t deltaUs = hasLastUpdate ? static_cast<uint32_t>(nowUs - previousUs) : 0;
     
     // Update state timestamp
-    _state.timestamp = currentTime;
+    _state.timestamp = _clock.ms();
     _state.altitude = altitude;
     
     // Update max altitude
@@ -63,61 +103,17 @@ bool FlightStateMachine::update(float altitude, float acceleration, float veloci
     }
     
     // Calculate velocity if not provided
-    if (velocity == 0.0f && deltaTime > 0) {
-        velocity = calculateVelocity(altitude, deltaTime);
+    if (isnan(velocity)) {
+        velocity = calculateVelocity(altitude, deltaUs);
     }
+    _state.velocity = velocity;
     
-    bool stateChanged = false;
-    
-    // State machine transitions
-    switch (_state.phase) {
-        case FlightPhase::UNARMED:
-            
-            
-        case FlightPhase::ARMED:
-            // Check for launch detection
-            if (checkLaunchConditions(acceleration)) {
-                _state.phase = FlightPhase::LAUNCH;
-                _state.launchTime = currentTime;
-                // Logging and radio already enabled when ARMED, keep them enabled
-                stateChanged = true;
-            }
-            break;
-            
-        case FlightPhase::LAUNCH:
-            // Check for apogee detection
-            if (checkApogeeConditions(velocity)) {
-                _state.phase = FlightPhase::APOGEE;
-                _state.apogeeTime = currentTime;
-                stateChanged = true;
-            }
-            break;
-            
-        case FlightPhase::APOGEE:
-            // Transition to descent when velocity becomes positive (falling)
-            if (velocity < -1.0f) {  // Falling down
-                _state.phase = FlightPhase::DESCENT;
-                stateChanged = true;
-            }
-            break;
-            
-        case FlightPhase::DESCENT:
-            // Check for landing detection
-            if (checkLandedConditions(altitude, acceleration)) {
-                _state.phase = FlightPhase::LANDED;
-                _state.landedTime = currentTime;
-                stateChanged = true;
-            }
-            break;
-            
-        case FlightPhase::LANDED:
-            // Stay in LANDED state
-            break;
-            
-        case FlightPhase::ERROR:
-            // Stay in ERROR state until reset
-            break;
+    // Transitions out of the current phase (table rows); the predicted-apogee event is one input
+    Inputs in = {timestampUs, altitude, velocity, accelMagnitudeSq, accelRange, false};
+    if (_state.phase == FlightPhase::LAUNCH) {
+        in.apogeePredicted = checkApogeePrediction(altitude, velocity, acceleration, timestampUs);
     }
+    const bool stateChanged = Transitions::step(_state.phase, *this, in, _debounce);
     
     // Update previous values for next iteration
     _previousAltitude = altitude;
@@ -128,7 +124,8 @@ bool FlightStateMachine::update(float altitude, float acceleration, float veloci
 
 void FlightStateMachine::setPhase(FlightPhase phase) {
     _state.phase = phase;
-    _state.timestamp = millis();
+    _state.timestamp = _clock.ms();
+    _debounce.clear();
     
     // Update logging and radio state based on phase
     if (phase == FlightPhase::ARMED) {
@@ -153,66 +150,35 @@ void FlightStateMachine::setError(const char* message) {
     _state.errorFlag = true;
     strncpy(_state.errorMessage, message, sizeof(_state.errorMessage) - 1);
     _state.errorMessage[sizeof(_state.errorMessage) - 1] = '\0';
-    _state.timestamp = millis();
+    _state.timestamp = _clock.ms();
 }
 
-float FlightStateMachine::calculateVelocity(float currentAltitude, uint32_t deltaTime) {
-    if (deltaTime == 0) {
+float FlightStateMachine::calculateVelocity(float currentAltitude, uint32_t deltaUs) {
+    if (deltaUs == 0) {
         return _previousVelocity;
     }
     
     float altitudeChange = currentAltitude - _previousAltitude;
-    float timeSeconds = deltaTime / 1000.0f;
+    float timeSeconds = deltaUs / 1000000.0f;
     
-    if (timeSeconds > 0) {
-        return altitudeChange / timeSeconds;
-    }
-    
-    return _previousVelocity;
+    return altitudeChange / timeSeconds;
 }
 
-bool FlightStateMachine::checkLaunchConditions(float acceleration) {
-    if (acceleration > LAUNCH_ACCEL_THRESHOLD) {
-        if (_launchDetectionStart == 0) {
-            _launchDetectionStart = millis();
-        } else if (millis() - _launchDetectionStart >= LAUNCH_DETECTION_TIME) {
-            _launchDetectionStart = 0;
-            return true;
-        }
-    } else {
-        _launchDetectionStart = 0;
+bool FlightStateMachine::checkApogeePrediction(float altitude, float velocity, float acceleration, uint32_t nowUs) {
+    if (!_predictor.update(nowUs, altitude, velocity, acceleration)) {
+        return false;
     }
-    return false;
-}
-
-bool FlightStateMachine::checkApogeeConditions(float velocity) {
-    if (velocity < APOGEE_VELOCITY_THRESHOLD) {
-        if (_apogeeDetectionStart == 0) {
-            _apogeeDetectionStart = millis();
-        } else if (millis() - _apogeeDetectionStart >= APOGEE_DETECTION_TIME) {
-            _apogeeDetectionStart = 0;
-            return true;
-        }
-    } else {
-        _apogeeDetectionStart = 0;
+    _state.apogeePredictionValid = true;
+    _state.predictedApogee = _predictor.apogeeAltitudeM();
+    _state.timeToApogee = _predictor.timeToApogeeS();
+    if (_state.apogeePredicted) {
+        return false;
     }
-    return false;
-}
-
-bool FlightStateMachine::checkLandedConditions(float altitude, float acceleration) {
-    bool altitudeOk = altitude < LANDED_ALTITUDE_THRESHOLD;
-    float accelDiff = (acceleration > 1.0f) ? (acceleration - 1.0f) : (1.0f - acceleration);
-    bool accelOk = accelDiff < LANDED_ACCEL_THRESHOLD;  // ~1g when landed
-    
-    if (altitudeOk && accelOk) {
-        if (_landedDetectionStart == 0) {
-            _landedDetectionStart = millis();
-        } else if (millis() - _landedDetectionStart >= LANDED_DETECTION_TIME) {
-            _landedDetectionStart = 0;
-            return true;
-        }
-    } else {
-        _landedDetectionStart = 0;
+    const bool due = _state.timeToApogee * 1000.0f <= static_cast<float>(_config.apogeeLeadMs);
+    if (!_predictDebounce.update(due, nowUs, _config.apogeePredictMs)) {
+        return false;
     }
-    return false;
+    _state.apogeePredicted = true;
+    _state.apogeePredictedTime = _clock.ms();
+    return true;
 }
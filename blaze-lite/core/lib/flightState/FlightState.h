@@ -3,11 +3,30 @@
  * @brief Flight state machine for avionics system
  * 
  * Manages flight phases: UNARMED -> ARMED -> LAUNCH -> APOGEE -> DESCENT -> LANDED
+ *
+ * The automatic transitions are rows of FlightStateMachine::Transitions (TransitionTable.h):
+ * from-phase, guard, debounce window from FlightDetectorConfig, action. Adding a phase is a
+ * FlightPhase value plus its rows.
+ *
+ * During LAUNCH an ApogeePredictor runs on the altitude/velocity/acceleration estimates once the
+ * motor is out; its time-to-apogee raises a predicted-apogee event (FlightState::apogeePredicted)
+ * ahead of the velocity-sign detector, and optionally enters APOGEE on it.
+ *
+ * Never reads the system clock: every detection window runs on the sample timestamps passed
+ * to update(), so recorded or simulated flights replay faster than real time on a host. The
+ * millisecond fields of FlightState come from a SampleClock over those timestamps, so they keep
+ * counting up across the 71.6 min micros() wrap.
  */
 
 #pragma once
 
 #include <Arduino.h>
+#include <math.h>
+
+#include "ApogeePredictor.h"
+#include "RawAccel.h"
+#include "SampleClock.h"
+#include "TransitionTable.h"
 
 /**
  * @enum FlightPhase
@@ -30,8 +49,9 @@ enum class FlightPhase : uint8_t {
 struct FlightState {
     FlightPhase phase;           ///< Current flight phase
     float altitude;              ///< Current altitude (m)
+    float velocity;              ///< Vertical velocity used for the last update (m/s)
     float maxAltitude;           ///< Maximum altitude reached (m)
-    uint32_t timestamp;          ///< Timestamp of last state update (ms)
+    uint32_t timestamp;          ///< Sample time of last state update (ms)
     bool radioFlag;              ///< Radio transmission flag
     bool loggingEnabled;         ///< Logging enabled flag
     uint32_t launchTime;         ///< Time when launch was detected (ms)
@@ -39,6 +59,29 @@ struct FlightState {
     uint32_t landedTime;         ///< Time when landing was detected (ms)
     bool errorFlag;              ///< Error flag
     char errorMessage[32];       ///< Error message if errorFlag is true
+    bool apogeePredictionValid;  ///< Coasting; predictedApogee/timeToApogee are current
+    float predictedApogee;       ///< Predicted apogee altitude (m), last value kept after LAUNCH
+    float timeToApogee;          ///< Predicted time to apogee at the last update (s)
+    bool apogeePredicted;        ///< Predicted-apogee event has fired
+    uint32_t apogeePredictedTime;  ///< Time of the predicted-apogee event (ms)
+};
+
+/**
+ * @struct FlightDetectorConfig
+ * @brief Detection thresholds and debounce windows (defaults: FlightStateMachine::defaultDetectorConfig())
+ */
+struct FlightDetectorConfig {
+    float launchAccelG;          ///< |a| above this (g) ...
+    uint32_t launchDetectionMs;  ///< ... for this long detects LAUNCH
+    float apogeeVelocity;        ///< Velocity below this (m/s) ...
+    uint32_t apogeeDetectionMs;  ///< ... for this long detects APOGEE
+    float descentVelocity;       ///< Velocity below this (m/s) moves APOGEE to DESCENT
+    float landedAccelG;          ///< |a| within 1g +- this ...
+    float landedAltitudeM;       ///< ... below this altitude ...
+    uint32_t landedDetectionMs;  ///< ... for this long detects LANDED
+    uint32_t apogeeLeadMs;       ///< Predicted time to apogee at most this ...
+    uint32_t apogeePredictMs;    ///< ... for this long fires the predicted-apogee event
+    bool apogeeOnPrediction;     ///< The predicted-apogee event also enters APOGEE
 };
 
 /**
@@ -59,12 +102,19 @@ public:
 
     /**
      * @brief Update the state machine based on sensor data
+     * @param timestampUs Sample time (us, e.g. the KX134 data-ready micros()); wrap-safe
      * @param altitude Current altitude (m)
-     * @param acceleration Current acceleration magnitude (g)
-     * @param velocity Current vertical velocity (m/s) - optional, can be calculated
+     * @param accelMagnitudeSq Squared acceleration magnitude in KX134 counts^2
+     *                         (rawAccelMagnitudeSq(); 0 if no valid sample)
+     * @param accelRange KX134 range code the counts were taken at
+     * @param velocity Current vertical velocity (m/s), e.g. from AltitudeFilter; NAN (default)
+     *                 derives it by differencing successive altitudes
+     * @param acceleration Vertical acceleration estimate (m/s^2, -g in free fall) for the apogee
+     *                     predictor; NAN (default) disables prediction
      * @return true if state changed, false otherwise
      */
-    bool update(float altitude, float acceleration, float velocity = 0.0f);
+    bool update(uint32_t timestampUs, float altitude, uint32_t accelMagnitudeSq, uint8_t accelRange,
+                float velocity = NAN, float acceleration = NAN);
 
     /**
      * @brief Get current flight state
@@ -79,7 +129,7 @@ public:
     FlightPhase getPhase() const { return _state.phase; }
 
     /**
-     * @brief Manually set flight phase (for testing/override)
+     * @brief Manually set flight phase (for testing/override); stamped with the last sample time
      * @param phase New flight phase
      */
     void setPhase(FlightPhase phase);
@@ -97,7 +147,7 @@ public:
     void setRadioFlag(bool enable);
 
     /**
-     * @brief Reset state machine to UNARMED
+     * @brief Reset state machine to UNARMED; the next update() starts a new sample timeline
      */
     void reset();
 
@@ -107,55 +157,139 @@ public:
      */
     void setError(const char* message);
 
+    /**
+     * @brief Replace the detection thresholds (tuning, simulation); takes effect on the next update
+     */
+    void setDetectorConfig(const FlightDetectorConfig& config);
+    const FlightDetectorConfig& detectorConfig() const { return _config; }
+
+    /**
+     * @brief Flight defaults: the LAUNCH_ / APOGEE_ / LANDED_ constants below
+     */
+    static FlightDetectorConfig defaultDetectorConfig();
+
+    /**
+     * @struct Inputs
+     * @brief One sample as the transition guards see it
+     */
+    struct Inputs {
+        uint32_t nowUs;              ///< Sample time (us)
+        float altitude;              ///< m
+        float velocity;              ///< m/s, given or differenced
+        uint32_t accelMagnitudeSq;   ///< counts^2
+        uint8_t accelRange;          ///< KX134 range code
+        bool apogeePredicted;        ///< The predicted-apogee event fired on this sample
+    };
+
+private:
+    // Guards and actions of the rows in Transitions; nested so they can read the thresholds.
+    struct LaunchAccel {
+        static constexpr const char* kName = "launch accel";
+        static bool test(const FlightStateMachine& m, const Inputs& in) {
+            return in.accelMagnitudeSq > m._launchAccelSq[in.accelRange & 0x03];
+        }
+    };
+    struct PredictedApogee {
+        static constexpr const char* kName = "predicted apogee";
+        static bool test(const FlightStateMachine& m, const Inputs& in) {
+            return in.apogeePredicted && m._config.apogeeOnPrediction;
+        }
+    };
+    struct Descending {
+        static constexpr const char* kName = "descending";
+        static bool test(const FlightStateMachine& m, const Inputs& in) { return in.velocity < m._config.apogeeVelocity; }
+    };
+    struct Falling {
+        static constexpr const char* kName = "falling";
+        static bool test(const FlightStateMachine& m, const Inputs& in) { return in.velocity < m._config.descentVelocity; }
+    };
+    struct AtRest {
+        static constexpr const char* kName = "at rest";
+        static bool test(const FlightStateMachine& m, const Inputs& in) {
+            const uint8_t range = in.accelRange & 0x03;
+            return in.altitude < m._config.landedAltitudeM && in.accelMagnitudeSq > m._landedAccelLowSq[range] &&
+                   in.accelMagnitudeSq < m._landedAccelHighSq[range];  // ~1g when landed
+        }
+    };
+    struct StampLaunch {
+        static void apply(FlightStateMachine& m, const Inputs&) { m._state.launchTime = m._clock.ms(); }
+    };
+    struct StampApogee {
+        static void apply(FlightStateMachine& m, const Inputs&) { m._state.apogeeTime = m._clock.ms(); }
+    };
+    struct StampLanded {
+        static void apply(FlightStateMachine& m, const Inputs&) { m._state.landedTime = m._clock.ms(); }
+    };
+
+    template <FlightPhase From, FlightPhase To, class Guard, class Window, class Action>
+    using Row = Transition<FlightPhase, From, To, Guard, Window, Action>;
+    template <uint32_t FlightDetectorConfig::*Window>
+    using WindowMs = DebounceMs<FlightDetectorConfig, Window>;
+
+public:
+    /**
+     * Phase transitions in evaluation order. UNARMED, LANDED and ERROR have no rows: ARMED and
+     * UNARMED are entered by setPhase() (arm/disarm command), ERROR by setError().
+     */
+    using Transitions = TransitionTable<
+        FlightPhase,
+        Row<FlightPhase::ARMED, FlightPhase::LAUNCH, LaunchAccel, WindowMs<&FlightDetectorConfig::launchDetectionMs>,
+            StampLaunch>,
+        Row<FlightPhase::LAUNCH, FlightPhase::APOGEE, PredictedApogee, NoDebounce, StampApogee>,
+        Row<FlightPhase::LAUNCH, FlightPhase::APOGEE, Descending, WindowMs<&FlightDetectorConfig::apogeeDetectionMs>,
+            StampApogee>,
+        Row<FlightPhase::APOGEE, FlightPhase::DESCENT, Falling, NoDebounce, NoAction>,
+        Row<FlightPhase::DESCENT, FlightPhase::LANDED, AtRest, WindowMs<&FlightDetectorConfig::landedDetectionMs>,
+            StampLanded>>;
+
 private:
     FlightState _state;
+    FlightDetectorConfig _config;
     
-    // State transition thresholds
+    // Default state transition thresholds
     static constexpr float LAUNCH_ACCEL_THRESHOLD = 2.0f;  // g - acceleration threshold for launch detection
     static constexpr float APOGEE_VELOCITY_THRESHOLD = -0.5f;  // m/s - negative velocity threshold for apogee
     static constexpr float LANDED_ACCEL_THRESHOLD = 0.5f;  // g - low acceleration threshold for landing
     static constexpr float LANDED_ALTITUDE_THRESHOLD = 5.0f;  // m - altitude threshold for landing detection
+    static constexpr float DESCENT_VELOCITY_THRESHOLD = -1.0f;  // m/s - falling after apogee
+    static constexpr bool APOGEE_ON_PREDICTION = false;  // predicted apogee is reported, deploy stays on detection
+
+    // Acceleration thresholds squared into counts^2 per KX134 range code (from _config), compared
+    // against the squared magnitude so no sample needs sqrtf.
+    uint32_t _launchAccelSq[4];
+    uint32_t _landedAccelLowSq[4];
+    uint32_t _landedAccelHighSq[4];
     
-    // Timing constants
+    // Timing constants (sample time)
     static constexpr uint32_t LAUNCH_DETECTION_TIME = 100;  // ms - time acceleration must be above threshold
     static constexpr uint32_t APOGEE_DETECTION_TIME = 500;   // ms - time velocity must be negative
     static constexpr uint32_t LANDED_DETECTION_TIME = 2000;  // ms - time conditions must be met for landing
+    static constexpr uint32_t APOGEE_LEAD_TIME = 50;  // ms - predicted time to apogee that fires the event ...
+    static constexpr uint32_t APOGEE_PREDICT_TIME = 50;  // ms - ... once it has held this long
     
     // State tracking
-    uint32_t _launchDetectionStart;
-    uint32_t _apogeeDetectionStart;
-    uint32_t _landedDetectionStart;
+    Transitions::Debounce _debounce;     ///< One window per Transitions row
+    TransitionDebounce _predictDebounce;
+    ApogeePredictor _predictor;
     float _previousAltitude;
     float _previousVelocity;
-    uint32_t _lastUpdateTime;
+    SampleClock _clock;  ///< Sample time of the last update(); reset() starts a new timeline
     
     /**
      * @brief Calculate vertical velocity from altitude change
      * @param currentAltitude Current altitude
-     * @param deltaTime Time since last update (ms)
+     * @param deltaUs Sample time since last update (us)
      * @return Vertical velocity (m/s)
      */
-    float calculateVelocity(float currentAltitude, uint32_t deltaTime);
-    
-    /**
-     * @brief Check if launch conditions are met
-     * @param acceleration Current acceleration
-     * @return true if launch detected
-     */
-    bool checkLaunchConditions(float acceleration);
-    
-    /**
-     * @brief Check if apogee conditions are met
-     * @param velocity Current vertical velocity
-     * @return true if apogee detected
-     */
-    bool checkApogeeConditions(float velocity);
-    
+    float calculateVelocity(float currentAltitude, uint32_t deltaUs);
+
     /**
-     * @brief Check if landing conditions are met
+     * @brief Run the apogee predictor and publish its estimate in _state
      * @param altitude Current altitude
-     * @param acceleration Current acceleration
-     * @return true if landing detected
+     * @param velocity Current vertical velocity
+     * @param acceleration Vertical acceleration estimate (NAN: no prediction)
+     * @param nowUs Sample time (us)
+     * @return true on the sample the predicted-apogee event fires
      */
-    bool checkLandedConditions(float altitude, float acceleration);
+    bool checkApogeePrediction(float altitude, float velocity, float acceleration, uint32_t nowUs);
 };
@@ -0,0 +1,171 @@
+/**
+ * @file TransitionTable.h
+ * @brief Compile-time state transition table: (from, to, guard, debounce window, action) rows
+ *
+ * A table is a type: TransitionTable<Phase, Transition<...>, ...>. step() is unrolled by the
+ * compiler into one compare-and-guard per row, in row order, with every guard and action
+ * inlined, so the generated code is the hand-written switch it replaces. Rows for the same
+ * from-phase are tried in order and the first that fires wins; a phase with no rows is
+ * terminal. Each row owns one TransitionDebounce slot; all are cleared on every transition so a
+ * window never carries over from an earlier phase.
+ *
+ * Row parts are stateless types:
+ *   Guard   static bool test(const Context&, const Inputs&); static constexpr const char* kName
+ *   Window  NoDebounce, or DebounceMs<Config, &Config::field> (Context::detectorConfig().*field)
+ *   Action  static void apply(Context&, const Inputs&), or NoAction
+ * Inputs must carry the sample time as uint32_t nowUs (micros(), wrap-safe).
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @struct TransitionDebounce
+ * @brief Debounce state of one row: how long its guard has held, in sample time
+ */
+struct TransitionDebounce {
+    bool active;
+    uint32_t startUs;
+
+    void clear() {
+        active = false;
+        startUs = 0;
+    }
+
+    /**
+     * @brief Feed this sample's condition
+     * @return true once the condition has held for windowMs (the window then restarts)
+     */
+    bool update(bool condition, uint32_t nowUs, uint32_t windowMs) {
+        if (!condition) {
+            active = false;
+            return false;
+        }
+        if (!active) {
+            active = true;
+            startUs = nowUs;
+            return false;
+        }
+        if (nowUs - startUs >= windowMs * 1000u) {
+            active = false;
+            return true;
+        }
+        return false;
+    }
+};
+
+/** Window policy: the row fires on the first sample its guard holds. */
+struct NoDebounce {
+    static constexpr bool kDebounced = false;
+
+    template <class Context>
+    static bool fire(bool condition, const Context&, uint32_t, TransitionDebounce&) {
+        return condition;
+    }
+};
+
+/** Window policy: the guard must hold for Context::detectorConfig().*Window ms of sample time. */
+template <class Config, uint32_t Config::*Window>
+struct DebounceMs {
+    static constexpr bool kDebounced = true;
+
+    template <class Context>
+    static bool fire(bool condition, const Context& ctx, uint32_t nowUs, TransitionDebounce& state) {
+        return state.update(condition, nowUs, ctx.detectorConfig().*Window);
+    }
+};
+
+/** Action policy: nothing beyond the phase change. */
+struct NoAction {
+    template <class Context, class Inputs>
+    static void apply(Context&, const Inputs&) {}
+};
+
+/**
+ * @struct TransitionInfo
+ * @brief One row as data, for listing and tests
+ */
+template <class Phase>
+struct TransitionInfo {
+    Phase from;
+    Phase to;
+    bool debounced;
+    const char* guard;
+};
+
+/** One table row. */
+template <class Phase, Phase From, Phase To, class Guard, class Window, class Action>
+struct Transition {
+    static constexpr Phase kFrom = From;
+    static constexpr Phase kTo = To;
+    using GuardType = Guard;
+    using WindowType = Window;
+    using ActionType = Action;
+
+    static constexpr TransitionInfo<Phase> info() { return TransitionInfo<Phase>{From, To, Window::kDebounced, Guard::kName}; }
+};
+
+/** Rows I.. of a table; recursion ends in the empty specialisation. */
+template <size_t I, class... Rows>
+struct TransitionRows {
+    template <class Phase, class Context, class Inputs>
+    static bool step(Phase&, Context&, const Inputs&, TransitionDebounce*) {
+        return false;
+    }
+};
+
+template <size_t I, class Row, class... Rest>
+struct TransitionRows<I, Row, Rest...> {
+    template <class Phase, class Context, class Inputs>
+    static bool step(Phase& phase, Context& ctx, const Inputs& in, TransitionDebounce* debounce) {
+        if (phase == Row::kFrom &&
+            Row::WindowType::fire(Row::GuardType::test(ctx, in), ctx, in.nowUs, debounce[I])) {
+            phase = Row::kTo;
+            Row::ActionType::apply(ctx, in);
+            return true;
+        }
+        return TransitionRows<I + 1, Rest...>::step(phase, ctx, in, debounce);
+    }
+};
+
+/**
+ * @class TransitionTable
+ * @brief The rows, their debounce slots and the engine that evaluates them
+ */
+template <class Phase, class... Rows>
+struct TransitionTable {
+    static constexpr size_t kRows = sizeof...(Rows);
+
+    /** The rows in evaluation order. */
+    static constexpr TransitionInfo<Phase> kInfo[kRows] = {Rows::info()...};
+
+    /** Per-row debounce state, owned by the state machine using the table. */
+    struct Debounce {
+        TransitionDebounce rows[kRows];
+
+        void clear() {
+            for (size_t i = 0; i < kRows; ++i) {
+                rows[i].clear();
+            }
+        }
+    };
+
+    /**
+     * @brief Evaluate the rows of the current phase against one sample
+     * @param phase Current phase; replaced by the target if a row fires
+     * @return true if a row fired (its action has run and the debounce state is cleared)
+     */
+    template <class Context, class Inputs>
+    static bool step(Phase& phase, Context& ctx, const Inputs& in, Debounce& debounce) {
+        if (!TransitionRows<0, Rows...>::step(phase, ctx, in, debounce.rows)) {
+            return false;
+        }
+        debounce.clear();
+        return true;
+    }
+};
+
+template <class Phase, class... Rows>
+constexpr TransitionInfo<Phase> TransitionTable<Phase, Rows...>::kInfo[];
@@ -0,0 +1,81 @@
+/**
+ * @file Arduino.h
+ * @brief Minimal Arduino core for host builds (native env): Serial, timing, pins and a few helpers
+ *
+ * Only what the storage libraries use. Time is virtual (see HostClock.h): it only advances
+ * when an emulated device or delay() moves it, so benchmarks are deterministic.
+ * Never linked into the board build (lib_ignore in the blaze_f411ce env).
+ */
+
+#pragma once
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include <string>
+
+#include "HostClock.h"
+
+#define HEX 16
+#define DEC 10
+
+#define LOW 0
+#define HIGH 1
+#define INPUT 0
+#define OUTPUT 1
+
+/** Arduino String, as far as the libraries use it (construct, assign, c_str). */
+class String : public std::string {
+public:
+    String() {}
+    String(const char* s) : std::string(s != nullptr ? s : "") {}
+    String(const std::string& s) : std::string(s) {}
+};
+
+class HostSerial {
+public:
+    void begin(unsigned long /*baud*/) {}
+    explicit operator bool() const { return true; }
+    int available() { return 0; }
+    int read() { return -1; }
+
+    size_t print(const char* s);
+    size_t print(char c);
+    size_t print(int v, int base = DEC) { return print(static_cast<long long>(v), base); }
+    size_t print(unsigned v, int base = DEC) { return print(static_cast<unsigned long long>(v), base); }
+    size_t print(long v, int base = DEC) { return print(static_cast<long long>(v), base); }
+    size_t print(unsigned long v, int base = DEC) { return print(static_cast<unsigned long long>(v), base); }
+    size_t print(long long v, int base = DEC);
+    size_t print(unsigned long long v, int base = DEC);
+    size_t print(double v, int digits = 2);
+
+    size_t println() { return print("\r\n"); }
+    template <typename T>
+    size_t println(T v) {
+        const size_t n = print(v);
+        return n + println();
+    }
+    template <typename T>
+    size_t println(T v, int format) {
+        const size_t n = print(v, format);
+        return n + println();
+    }
+
+    size_t write(const uint8_t* data, size_t len);
+    size_t write(uint8_t b) { return write(&b, 1); }
+};
+
+extern HostSerial Serial;
+
+inline uint32_t micros() { return static_cast<uint32_t>(hostClockUs()); }
+inline uint32_t millis() { return static_cast<uint32_t>(hostClockUs() / 1000); }
+inline void delayMicroseconds(uint32_t us) { hostClockAdvanceUs(us); }
+inline void delay(uint32_t ms) { hostClockAdvanceUs(static_cast<uint64_t>(ms) * 1000); }
+inline void yield() {}
+// Pins are not modelled; the emulated devices need no chip select.
+inline void pinMode(uint32_t /*pin*/, uint32_t /*mode*/) {}
+inline void digitalWrite(uint32_t /*pin*/, uint32_t /*value*/) {}
@@ -0,0 +1,60 @@
+/**
+ * @file HostArduino.cpp
+ * @brief Host implementation of the Arduino shim and the virtual clock
+ */
+
+#include "Arduino.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+
+HostSerial Serial;
+
+namespace {
+uint64_t nowUs = 0;
+bool serialEnabled = true;
+}  // namespace
+
+uint64_t hostClockUs() { return nowUs; }
+
+void hostClockAdvanceUs(uint64_t us) { nowUs += us; }
+
+void hostClockAdvanceTo(uint64_t t) {
+    if (t > nowUs) {
+        nowUs = t;
+    }
+}
+
+void hostClockReset() { nowUs = 0; }
+
+void hostSerialSetEnabled(bool enabled) { serialEnabled = enabled; }
+
+size_t HostSerial::write(const uint8_t* data, size_t len) {
+    if (serialEnabled) {
+        fwrite(data, 1, len, stdout);
+    }
+    return len;
+}
+
+size_t HostSerial::print(const char* s) { return write(reinterpret_cast<const uint8_t*>(s), strlen(s)); }
+
+size_t HostSerial::print(char c) { return write(static_cast<uint8_t>(c)); }
+
+size_t HostSerial::print(long long v, int base) {
+    if (v < 0 && base == DEC) {
+        return print('-') + print(static_cast<unsigned long long>(-v), base);
+    }
+    return print(static_cast<unsigned long long>(v), base);
+}
+
+size_t HostSerial::print(unsigned long long v, int base) {
+    char buf[24];
+    snprintf(buf, sizeof(buf), base == HEX ? "%" PRIX64 : "%" PRIu64, static_cast<uint64_t>(v));
+    return print(buf);
+}
+
+size_t HostSerial::print(double v, int digits) {
+    char buf[48];
+    snprintf(buf, sizeof(buf), "%.*f", digits, v);
+    return print(buf);
+}
@@ -0,0 +1,23 @@
+/**
+ * @file HostClock.h
+ * @brief Virtual time base for host builds; millis()/micros() read it and emulated devices advance it
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+/** @brief Current virtual time (us since reset) */
+uint64_t hostClockUs();
+
+/** @brief Move virtual time forward */
+void hostClockAdvanceUs(uint64_t us);
+
+/** @brief Move virtual time forward to at least t (no-op if already past it) */
+void hostClockAdvanceTo(uint64_t t);
+
+/** @brief Restart virtual time at zero */
+void hostClockReset();
+
+/** @brief Send Serial output to stdout (default) or discard it */
+void hostSerialSetEnabled(bool enabled);
@@ -0,0 +1,195 @@
+/**
+ * @file IoQueue.h
+ * @brief Fixed-capacity, allocation-free priority write queue
+ *
+ * Keeps one byte ring per priority class (class 0 is drained first). Each record is
+ * stored as a 16-bit length followed by its payload, always contiguous in the ring, so
+ * the consumer can hand it straight to the writer and pop it afterwards without a copy.
+ * All storage lives inside the object; nothing is allocated at run time.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * @class IoPriorityQueue
+ * @brief Byte-ring priority queue with kClasses classes of kClassBytes each
+ */
+template <uint8_t kClasses, size_t kClassBytes>
+class IoPriorityQueue {
+public:
+    static_assert(kClasses > 0, "IoPriorityQueue needs at least one priority class");
+    static_assert(kClassBytes >= 16 && kClassBytes <= 0xFFFF, "class ring must be 16..65535 bytes");
+
+    static constexpr size_t kHeaderBytes = sizeof(uint16_t);
+    static constexpr size_t kMaxRecordBytes = kClassBytes - kHeaderBytes;
+
+    IoPriorityQueue() { clear(); }
+
+    /**
+     * @brief Copy a record into the ring of its priority class
+     * @param cls Priority class (0 = highest)
+     * @param data Payload
+     * @param bytes Payload length (0 is accepted and ignored)
+     * @return false if the class is invalid or its ring is full (back-pressure)
+     */
+    bool push(uint8_t cls, const void* data, size_t bytes) {
+        if (bytes == 0) {
+            return true;
+        }
+        if (cls >= kClasses || data == nullptr || bytes > kMaxRecordBytes) {
+            ++_dropped;
+            return false;
+        }
+
+        Ring& r = _rings[cls];
+        const size_t need = kHeaderBytes + bytes;
+
+        if (r.used == 0) {
+            r.head = 0;
+            r.tail = 0;
+        }
+
+        if (r.tail >= r.head && !(r.used > 0 && r.tail == r.head)) {
+            if (kClassBytes - r.tail < need) {
+                // Not enough room before the end of the ring: skip to the start if it fits there.
+                if (r.head < need) {
+                    ++_dropped;
+                    return false;
+                }
+                const size_t waste = kClassBytes - r.tail;
+                if (waste >= kHeaderBytes) {
+                    writeLength(r, r.tail, kWrapMarker);
+                }
+                r.used += waste;
+                r.tail = 0;
+            }
+        } else if (r.head - r.tail < need) {
+            ++_dropped;
+            return false;
+        }
+
+        writeLength(r, r.tail, static_cast<uint16_t>(bytes));
+        memcpy(r.bytes + r.tail + kHeaderBytes, data, bytes);
+        r.tail += need;
+        if (r.tail == kClassBytes) {
+            r.tail = 0;
+        }
+        r.used += need;
+        if (r.used > r.highWater) {
+            r.highWater = r.used;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Look at the oldest record of the highest non-empty priority class
+     * @param cls Receives the class of the record
+     * @param data Receives a pointer into the ring (valid until pop)
+     * @param bytes Receives the payload length
+     * @return false if the queue is empty
+     */
+    bool peek(uint8_t* cls, const char** data, size_t* bytes) const {
+        for (uint8_t c = 0; c < kClasses; ++c) {
+            const Ring& r = _rings[c];
+            if (r.used == 0) {
+                continue;
+            }
+            if (cls != nullptr) {
+                *cls = c;
+            }
+            if (data != nullptr) {
+                *data = reinterpret_cast<const char*>(r.bytes + r.head + kHeaderBytes);
+            }
+            if (bytes != nullptr) {
+                *bytes = readLength(r, r.head);
+            }
+            return true;
+        }
+        return false;
+    }
+
+    /**
+     * @brief Drop the oldest record of a class (the one returned by peek)
+     * @param cls Priority class
+     */
+    void pop(uint8_t cls) {
+        if (cls >= kClasses) {
+            return;
+        }
+        Ring& r = _rings[cls];
+        if (r.used == 0) {
+            return;
+        }
+
+        const size_t consumed = kHeaderBytes + readLength(r, r.head);
+        r.head += consumed;
+        r.used -= consumed;
+        if (r.used == 0) {
+            r.head = 0;
+            r.tail = 0;
+            return;
+        }
+        if (r.head == kClassBytes) {
+            r.head = 0;
+        } else if (kClassBytes - r.head < kHeaderBytes || readLength(r, r.head) == kWrapMarker) {
+            r.used -= kClassBytes - r.head;
+            r.head = 0;
+        }
+    }
+
+    /** @brief True if every class is empty */
+    bool empty() const {
+        for (uint8_t c = 0; c < kClasses; ++c) {
+            if (_rings[c].used != 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /** @brief Bytes in use (records, headers and wrap padding) for one class */
+    size_t usedBytes(uint8_t cls) const { return cls < kClasses ? _rings[cls].used : 0; }
+
+    /** @brief Highest usedBytes() seen for one class since the last clear() */
+    size_t highWater(uint8_t cls) const { return cls < kClasses ? _rings[cls].highWater : 0; }
+
+    /** @brief Number of records rejected since the last clear() */
+    uint32_t droppedCount() const { return _dropped; }
+
+    /** @brief Discard every queued record and reset statistics */
+    void clear() {
+        for (uint8_t c = 0; c < kClasses; ++c) {
+            _rings[c].head = 0;
+            _rings[c].tail = 0;
+            _rings[c].used = 0;
+            _rings[c].highWater = 0;
+        }
+        _dropped = 0;
+    }
+
+private:
+    static constexpr uint16_t kWrapMarker = 0xFFFF;
+
+    struct Ring {
+        size_t head;
+        size_t tail;
+        size_t used;
+        size_t highWater;
+        uint8_t bytes[kClassBytes];
+    };
+
+    static void writeLength(Ring& r, size_t at, uint16_t len) { memcpy(r.bytes + at, &len, sizeof(len)); }
+
+    static uint16_t readLength(const Ring& r, size_t at) {
+        uint16_t len;
+        memcpy(&len, r.bytes + at, sizeof(len));
+        return len;
+    }
+
+    Ring _rings[kClasses];
+    uint32_t _dropped;
+};
@@ -0,0 +1,120 @@
+/**
+ * @file LatencyHistogram.h
+ * @brief Fixed-size log2 latency histogram for storage calls
+ *
+ * Bucket 0 counts calls under 2 us and bucket i (i >= 1) counts [2^i, 2^(i+1)) us; the last
+ * bucket is open-ended (>= ~8.4 s). Recording is a count-leading-zeros and three adds, with no
+ * allocation, so it can wrap every write on the flight path.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * @class LatencyHistogram
+ * @brief Call count, mean, max and log2 buckets of durations in microseconds
+ */
+class LatencyHistogram {
+public:
+    static constexpr uint8_t kBuckets = 24;
+
+    /**
+     * @class Scope
+     * @brief Records the lifetime of the enclosing block, e.g. `LatencyHistogram::Scope t(hist, micros);`
+     */
+    class Scope {
+    public:
+        Scope(LatencyHistogram& hist, uint32_t (*now)()) : _hist(hist), _now(now), _start(now()) {}
+        ~Scope() { _hist.record(_now() - _start); }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        LatencyHistogram& _hist;
+        uint32_t (*_now)();
+        uint32_t _start;
+    };
+
+    LatencyHistogram() { reset(); }
+
+    void reset() {
+        memset(_buckets, 0, sizeof(_buckets));
+        _count = 0;
+        _maxUs = 0;
+        _totalUs = 0;
+    }
+
+    void record(uint32_t us) {
+        ++_buckets[bucketFor(us)];
+        ++_count;
+        _totalUs += us;
+        if (us > _maxUs) {
+            _maxUs = us;
+        }
+    }
+
+    uint32_t count() const { return _count; }
+    uint32_t maxUs() const { return _maxUs; }
+    uint32_t meanUs() const { return _count ? static_cast<uint32_t>(_totalUs / _count) : 0; }
+    uint32_t bucket(uint8_t i) const { return i < kBuckets ? _buckets[i] : 0; }
+
+    /** @brief Smallest duration counted in bucket i */
+    static uint32_t bucketLowUs(uint8_t i) { return i == 0 ? 0 : (1UL << i); }
+
+    static uint8_t bucketFor(uint32_t us) {
+        if (us < 2) {
+            return 0;
+        }
+        const uint8_t log2 = static_cast<uint8_t>(31 - __builtin_clz(us));
+        return log2 < kBuckets ? log2 : kBuckets - 1;
+    }
+
+    /**
+     * @brief Upper bound of the bucket holding the pct-th percentile call (never above maxUs())
+     * @param pct 1..100
+     */
+    uint32_t percentileUs(uint8_t pct) const {
+        if (_count == 0) {
+            return 0;
+        }
+        const uint64_t rank = (static_cast<uint64_t>(_count) * pct + 99) / 100;
+        uint64_t seen = 0;
+        for (uint8_t i = 0; i < kBuckets; ++i) {
+            seen += _buckets[i];
+            if (seen >= rank) {
+                const uint32_t upper = i + 1 < kBuckets ? (1UL << (i + 1)) - 1 : _maxUs;
+                return upper < _maxUs ? upper : _maxUs;
+            }
+        }
+        return _maxUs;
+    }
+
+    /**
+     * @brief One line: "name n=.. mean=.. p50<=.. p99<=.. max=.. us | low:count ..." (non-empty buckets)
+     * @return snprintf-style length
+     */
+    int format(char* out, size_t size, const char* name) const {
+        int n = snprintf(out, size, "%s n=%lu mean=%lu p50<=%lu p99<=%lu max=%lu us |", name,
+                         static_cast<unsigned long>(_count), static_cast<unsigned long>(meanUs()),
+                         static_cast<unsigned long>(percentileUs(50)), static_cast<unsigned long>(percentileUs(99)),
+                         static_cast<unsigned long>(_maxUs));
+        for (uint8_t i = 0; i < kBuckets && n >= 0 && static_cast<size_t>(n) < size; ++i) {
+            if (_buckets[i] != 0) {
+                n += snprintf(out + n, size - n, " %lu:%lu", static_cast<unsigned long>(bucketLowUs(i)),
+                              static_cast<unsigned long>(_buckets[i]));
+            }
+        }
+        return n;
+    }
+
+private:
+    uint32_t _buckets[kBuckets];
+    uint32_t _count;
+    uint32_t _maxUs;
+    uint64_t _totalUs;
+};
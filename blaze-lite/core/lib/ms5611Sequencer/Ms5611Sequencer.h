@@ -0,0 +1,96 @@
+/**
+ * @file Ms5611Sequencer.h
+ * @brief Non-blocking MS5611 conversion schedule (which ADC to start/read, and when)
+ *
+ * The MS5611 converts one channel at a time: D1 (pressure) or D2 (temperature), each taking up
+ * to the datasheet conversion time for the OSR. Instead of waiting, the caller starts a
+ * conversion, returns, and calls tick() on later loop iterations; once the conversion time has
+ * elapsed tick() says to read the ADC and which conversion to start next. Temperature is
+ * refreshed every temperatureEvery pressure conversions and reused in between. Each read also
+ * reports when its conversion finished, which is the time to stamp the sample with: the loop may
+ * get to it much later.
+ *
+ * Pure logic, no Arduino dependency, so it is covered by host tests.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+/** @brief Max conversion time (us) for an OSR given as ADC bits 8..12 (datasheet, rounded up) */
+constexpr uint32_t ms5611ConversionUs(uint8_t osrBits) {
+    return osrBits <= 8 ? 600 : osrBits == 9 ? 1200 : osrBits == 10 ? 2300 : osrBits == 11 ? 4600 : 9100;
+}
+
+/**
+ * @class Ms5611Sequencer
+ * @brief Alternates D2/D1 conversions on a timer without blocking
+ */
+class Ms5611Sequencer {
+public:
+    enum Channel : uint8_t { NONE = 0, D1 = 1, D2 = 2 };
+
+    /** What the caller must do on this tick, in order: read the ADC, then start a conversion. */
+    struct Step {
+        Channel read;      ///< conversion whose result is ready to read (NONE: nothing yet)
+        Channel start;     ///< conversion to start after reading (NONE: keep waiting)
+        bool sampleReady;  ///< read == D1 and a temperature (D2) is available: compute a sample
+        uint32_t readyUs;  ///< when the conversion being read finished (start + conversion time)
+    };
+
+    Ms5611Sequencer() { configure(ms5611ConversionUs(12), 1); }
+
+    /**
+     * @brief Set conversion time and temperature refresh rate; restarts the schedule
+     * @param conversionUs Time to wait after starting a conversion
+     * @param temperatureEvery Pressure conversions per temperature conversion (>= 1)
+     */
+    void configure(uint32_t conversionUs, uint8_t temperatureEvery) {
+        _conversionUs = conversionUs;
+        _temperatureEvery = temperatureEvery > 0 ? temperatureEvery : 1;
+        restart();
+    }
+
+    /** Forget the conversion in flight (e.g. after a sensor reset or a bad ADC read). */
+    void restart() {
+        _converting = NONE;
+        _haveTemperature = false;
+        _pressureSinceTemperature = 0;
+    }
+
+    /** Call from the loop as often as convenient. */
+    Step tick(uint32_t nowUs) {
+        Step step = {NONE, NONE, false, 0};
+        if (_converting != NONE) {
+            if (nowUs - _startUs < _conversionUs) {
+                return step;
+            }
+            step.read = _converting;
+            step.readyUs = _startUs + _conversionUs;
+            if (_converting == D2) {
+                _haveTemperature = true;
+                _pressureSinceTemperature = 0;
+            } else {
+                ++_pressureSinceTemperature;
+                step.sampleReady = _haveTemperature;
+            }
+        }
+        step.start = (!_haveTemperature || _pressureSinceTemperature >= _temperatureEvery) ? D2 : D1;
+        _converting = step.start;
+        _startUs = nowUs;
+        return step;
+    }
+
+    /** Conversion currently running (NONE before the first tick). */
+    Channel converting() const { return _converting; }
+
+    uint32_t conversionUs() const { return _conversionUs; }
+
+private:
+    uint32_t _conversionUs;
+    uint32_t _startUs = 0;
+    uint8_t _temperatureEvery;
+    uint8_t _pressureSinceTemperature = 0;
+    Channel _converting = NONE;
+    bool _haveTemperature = false;
+};
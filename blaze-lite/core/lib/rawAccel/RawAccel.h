@@ -0,0 +1,51 @@
+/**
+ * @file RawAccel.h
+ * @brief Integer-only KX134 acceleration math on raw counts
+ *
+ * Samples stay as int16 counts plus the range code they were taken at. Threshold checks use the
+ * squared magnitude in counts^2 against thresholds squared once per range, so the per-sample
+ * path has no float conversion and no sqrtf. Floats are produced only for human-readable output.
+ *
+ * Counts per g are exact powers of two (16-bit output over +-8/16/32/64 g), so scaling is a shift.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+/** @brief Counts per g for a KX134 range code (0=8g .. 3=64g), 16-bit resolution */
+constexpr int32_t rawAccelCountsPerG(uint8_t rangeCode) { return 4096 >> (rangeCode & 0x03); }
+
+/**
+ * @brief Squared magnitude of a raw sample in counts^2
+ *
+ * At most 3 * 32768^2, which fits in 32 bits unsigned.
+ */
+inline uint32_t rawAccelMagnitudeSq(const int16_t raw[3]) {
+    uint32_t sum = 0;
+    for (int axis = 0; axis < 3; ++axis) {
+        const int32_t v = raw[axis];
+        sum += static_cast<uint32_t>(v * v);
+    }
+    return sum;
+}
+
+/**
+ * @brief A magnitude threshold in g squared into counts^2 for a range (saturates)
+ */
+constexpr uint32_t rawAccelThresholdSq(float g, uint8_t rangeCode) {
+    return g <= 0.0f ? 0u
+           : g * rawAccelCountsPerG(rangeCode) >= 65535.0f
+               ? 0xFFFFFFFFu
+               : static_cast<uint32_t>(g * rawAccelCountsPerG(rangeCode) * g * rawAccelCountsPerG(rangeCode) + 0.5f);
+}
+
+/** @brief One axis in milli-g, truncated toward zero (telemetry) */
+inline int32_t rawAccelMilliG(int16_t raw, uint8_t rangeCode) {
+    return static_cast<int32_t>(raw) * 1000 / rawAccelCountsPerG(rangeCode);
+}
+
+/** @brief One axis in g, for display only */
+inline float rawAccelToG(int16_t raw, uint8_t rangeCode) {
+    return static_cast<float>(raw) / static_cast<float>(rawAccelCountsPerG(rangeCode));
+}
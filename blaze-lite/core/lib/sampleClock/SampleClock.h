@@ -0,0 +1,61 @@
+/**
+ * @file SampleClock.h
+ * @brief 64-bit sample time from wrapping 32-bit micros() timestamps
+ *
+ * Sensor samples carry micros() of their data-ready edge, which wraps every 71.6 minutes;
+ * dividing it to milliseconds would jump back to 0 at the wrap. SampleClock sums the wrap-safe
+ * difference between successive timestamps instead, so sample time keeps counting across any
+ * number of wraps as long as consecutive timestamps are less than 71.6 minutes apart.
+ *
+ * Pure logic, no Arduino dependency, so it is covered by host tests.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * @class SampleClock
+ * @brief Extends in-order 32-bit microsecond timestamps to 64 bits
+ */
+class SampleClock {
+public:
+    SampleClock() : _us(0), _lastUs(0), _started(false) {}
+
+    /** Forget the timeline; the next update() starts it again at that timestamp. */
+    void reset() {
+        _us = 0;
+        _lastUs = 0;
+        _started = false;
+    }
+
+    /**
+     * @brief Advance to the next timestamp
+     * @param nowUs micros()-style timestamp, not older than the previous one
+     * @return Sample time in microseconds; the first call returns nowUs itself, so before the
+     *         first wrap the result equals micros() and its milliseconds equal millis()
+     */
+    uint64_t update(uint32_t nowUs) {
+        if (!_started) {
+            _us = nowUs;
+            _started = true;
+        } else {
+            _us += static_cast<uint32_t>(nowUs - _lastUs);
+        }
+        _lastUs = nowUs;
+        return _us;
+    }
+
+    bool started() const { return _started; }
+
+    /** Sample time of the last update() in microseconds. */
+    uint64_t us() const { return _us; }
+
+    /** Sample time of the last update() in milliseconds; wraps like millis(), after 49.7 days. */
+    uint32_t ms() const { return static_cast<uint32_t>(_us / 1000); }
+
+private:
+    uint64_t _us;
+    uint32_t _lastUs;
+    bool _started;
+};
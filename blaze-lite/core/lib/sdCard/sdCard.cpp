@@ -6,81 +6,185 @@
 
 #include "sdCard.h"
 
+#include "Crc32.h"
+#include "SessionIndex.h"
 #include "spiFlash.h"
 
 #include <stdio.h>
 #include <string.h>
 
-File dataFile; // global data file object
-File logFile;  // global log file object
+SdFat32 sd;       // FAT16/FAT32 volume on the SD card
+File32 dataFile;  // global data file object
+File32 logFile;   // global log file object
 
 namespace {
-void makeDataFileName(char* buffer, size_t bufferSize) {
-    uint16_t fileIndex = 0;
-    do {
-        snprintf(buffer, bufferSize, "DATA%03u.txt", fileIndex++);
-    } while (SD.exists(buffer) && fileIndex < 1000);
-}
-void makeLogFileName(char* buffer, size_t bufferSize) {
-    uint16_t fileIndex = 0;
-    do {
-        snprintf(buffer, bufferSize, "LOG%03u.txt", fileIndex++);
-    } while (SD.exists(buffer) && fileIndex < 1000);
+// One pass over the root directory picks both session names (one past the highest index in use).
+bool makeSessionFileNames(char* dataName, char* logName, size_t bufferSize) {
+    SessionIndex data("DATA", ".bin");
+    SessionIndex log("LOG", ".txt");
+
+    File32 root = sd.open("/");
+    if (!root) {
+        return false;
+    }
+    File32 entry;
+    char name[64];
+    while (entry.openNext(&root, O_RDONLY)) {
+        if (!entry.isDir() && entry.getName(name, sizeof(name)) > 0) {
+            data.observe(name);
+            log.observe(name);
+        }
+        entry.close();
+    }
+    root.close();
+
+    return data.format(dataName, bufferSize) && log.format(logName, bufferSize);
 }
 
-struct SdExportState {
+// Flash-side and card-side chunks. Copies stream through the first; the resume check and the
+// post-copy verify read the card into the second so both sides can be compared chunk by chunk.
+uint8_t exportChunks[2][SD_CARD_EXPORT_CHUNK_BYTES] __attribute__((aligned(4)));
+
+struct SdExportJob {
+    spiFlash* flash;
     const char* folder;
-    File out;
-    bool open;
+    SdExportReport report;
 };
 
-static bool sdExportBegin(void* user, const char* filename) {
-    auto* st = static_cast<SdExportState*>(user);
-    char path[96];
-    if (st->folder != nullptr && st->folder[0] != '\0') {
-        if (snprintf(path, sizeof(path), "%s/%s", st->folder, filename) >= static_cast<int>(sizeof(path))) {
+bool exportPath(char* path, size_t size, const char* folder, const char* filename) {
+    const int n = (folder != nullptr && folder[0] != '\0') ? snprintf(path, size, "%s/%s", folder, filename)
+                                                          : snprintf(path, size, "%s", filename);
+    return n > 0 && n < static_cast<int>(size);
+}
+
+// CRC32 of a whole card file, read in chunks through exportChunks[1].
+bool sdFileCrc(File32& file, uint32_t* crc) {
+    *crc = 0;
+    if (!file.seekSet(0)) {
+        return false;
+    }
+    while (true) {
+        const int n = file.read(exportChunks[1], SD_CARD_EXPORT_CHUNK_BYTES);
+        if (n < 0) {
             return false;
         }
-    } else {
-        if (snprintf(path, sizeof(path), "%s", filename) >= static_cast<int>(sizeof(path))) {
-            return false;
+        if (n == 0) {
+            return true;
         }
+        *crc = crc32Update(*crc, exportChunks[1], static_cast<size_t>(n));
     }
-    if (st->open) {
-        st->out.close();
-        st->open = false;
+}
+
+// Resume check: the card already holds this file if sizes match and both sides have the same
+// CRC32. Reads both in lockstep and stops at the first differing chunk.
+bool sameOnCard(spiFlash& flash, const char* name, uint32_t size, const char* path) {
+    if (!sd.exists(path)) {
+        return false;
     }
-    if (SD.exists(path)) {
-        SD.remove(path);
+    File32 existing = sd.open(path, O_RDONLY);
+    if (!existing || existing.fileSize() != size || !flash.openReader(name)) {
+        existing.close();
+        return false;
+    }
+    uint32_t flashCrc = 0;
+    uint32_t cardCrc = 0;
+    bool same = true;
+    while (same) {
+        const ssize_t n = flash.readReader(exportChunks[0], SD_CARD_EXPORT_CHUNK_BYTES);
+        const int m = existing.read(exportChunks[1], SD_CARD_EXPORT_CHUNK_BYTES);
+        if (n < 0 || m < 0 || n != m) {
+            same = false;
+            break;
+        }
+        if (n == 0) {
+            break;
+        }
+        flashCrc = crc32Update(flashCrc, exportChunks[0], static_cast<size_t>(n));
+        cardCrc = crc32Update(cardCrc, exportChunks[1], static_cast<size_t>(m));
+        same = memcmp(exportChunks[0], exportChunks[1], static_cast<size_t>(n)) == 0;
     }
-    st->out = SD.open(path, FILE_WRITE);
-    st->open = static_cast<bool>(st->out);
-    return st->open;
+    flash.closeReader();
+    existing.close();
+    return same && flashCrc == cardCrc;
 }
 
-static bool sdExportWrite(void* user, const uint8_t* data, size_t len) {
-    auto* st = static_cast<SdExportState*>(user);
-    if (!st->open) {
+// Copy one flash file in SD_CARD_EXPORT_CHUNK_BYTES chunks (whole flash pages, whole SD
+// sectors), CRC the flash side on the way, then read the card copy back and compare CRCs.
+// A file that cannot be read or does not verify is counted and the export moves on; only a card
+// that stops taking writes (full, removed) returns false and ends the walk.
+bool exportOneFile(void* user, const char* name, uint32_t size) {
+    auto* job = static_cast<SdExportJob*>(user);
+    char path[96];
+    if (!exportPath(path, sizeof(path), job->folder, name)) {
+        ++job->report.failed;
+        return true;
+    }
+    if (sameOnCard(*job->flash, name, size, path)) {
+        ++job->report.skipped;
+        return true;
+    }
+
+    File32 out = sd.open(path, O_RDWR | O_CREAT | O_TRUNC);
+    if (!out) {
+        Serial.print("Export stopped, card refused ");
+        Serial.println(path);
+        ++job->report.failed;
         return false;
     }
-    return st->out.write(data, len) == len;
-}
+    if (!job->flash->openReader(name)) {
+        out.close();
+        ++job->report.failed;
+        return true;
+    }
+    uint32_t flashCrc = 0;
+    uint32_t copied = 0;
+    bool ok = true;
+    bool cardOk = true;
+    while (true) {
+        const ssize_t n = job->flash->readReader(exportChunks[0], SD_CARD_EXPORT_CHUNK_BYTES);
+        if (n <= 0) {
+            ok = n == 0;
+            break;
+        }
+        flashCrc = crc32Update(flashCrc, exportChunks[0], static_cast<size_t>(n));
+        if (out.write(exportChunks[0], static_cast<size_t>(n)) != static_cast<size_t>(n)) {
+            cardOk = false;
+            break;
+        }
+        copied += static_cast<uint32_t>(n);
+    }
+    job->flash->closeReader();
 
-static bool sdExportEnd(void* user) {
-    auto* st = static_cast<SdExportState*>(user);
-    if (st->open) {
-        st->out.close();
-        st->open = false;
+    uint32_t cardCrc = 0;
+    cardOk = cardOk && out.sync() && sdFileCrc(out, &cardCrc);
+    ok = ok && cardOk && copied == size && cardCrc == flashCrc;
+    out.close();
+    if (!ok) {
+        Serial.print(cardOk ? "Export did not verify: " : "Export stopped, card write failed: ");
+        Serial.println(name);
+        ++job->report.failed;
+        return cardOk;
     }
+    ++job->report.files;
+    job->report.bytes += copied;
     return true;
 }
 }
 
-sdCard::sdCard(const uint8_t csPin) {
+sdCard::sdCard(const uint8_t csPin)
+    : _dataPolicy(SyncPolicyConfig{SD_CARD_FLUSH_EVERY_BYTES, SD_CARD_FLUSH_EVERY_MS, true}),
+      _logPolicy(SyncPolicyConfig{SD_CARD_LOG_FLUSH_EVERY_BYTES, SD_CARD_LOG_FLUSH_EVERY_MS, true}),
+      _stats{},
+      _streaming(false),
+      _streamSectors(0) {
     this->CS_PIN = csPin;
 }
 
 sdCard::~sdCard() {
+    if (_streaming) {
+        endStream();
+    }
+    flush();
     dataFile.close();
     logFile.close();
 }
@@ -94,23 +198,37 @@ void sdCard::startUp() {
     digitalWrite(this->CS_PIN, HIGH);
     delay(2000); // Allow SD card to power up
     
-    if (!SD.begin(this->CS_PIN)) {
+    if (!sd.begin(SdSpiConfig(this->CS_PIN, SHARED_SPI, SD_SCK_MHZ(SD_CARD_SPI_MHZ)))) {
         Serial.println("SD card failed to connect. Reason: failed to connect to SD breakout board, check CS pin");
         return;
     }
     Serial.println("SD Card initialized.");
 
-    //create data file that has a unique name with a integer, if file already excist, integer +1
+    //create data and log files numbered one past the highest existing index
     char dataFileName[16];
     char logFileName[16];
 
-    makeDataFileName(dataFileName, sizeof(dataFileName));
-    delay(500);
-    makeLogFileName(logFileName, sizeof(logFileName));
-    delay(500);
+    const uint32_t scanStart = micros();
+    if (!makeSessionFileNames(dataFileName, logFileName, sizeof(dataFileName))) {
+        Serial.println("Failed to allocate SD session file names");
+        return;
+    }
+    const uint32_t scanUs = micros() - scanStart;
 
-    dataFile = SD.open(dataFileName, FILE_WRITE);
-    logFile = SD.open(logFileName, FILE_WRITE);
+    // No O_AT_END: while streaming, the partial last sector is rewritten in place.
+    dataFile = sd.open(dataFileName, O_RDWR | O_CREAT);
+    if (dataFile) {
+        dataFile.seekEnd();
+    }
+    logFile = sd.open(logFileName, FILE_WRITE);
+    // Buffers track file offsets so their writes end on 512-byte sector boundaries.
+    _dataBuffer.reset(dataFile ? dataFile.fileSize() : 0);
+    _logBuffer.reset(logFile ? logFile.fileSize() : 0);
+#if SD_CARD_BUFFERED && SD_CARD_PREALLOCATE_BYTES > 0
+    if (dataFile) {
+        beginStream();
+    }
+#endif
     if (!dataFile) {
         Serial.println("Failed to create data file on SD card");
     } else {
@@ -123,6 +241,10 @@ void sdCard::startUp() {
         Serial.print("Log file created: ");
         Serial.println(logFileName);
     }
+
+    Serial.print("SD session name scan: ");
+    Serial.print(scanUs);
+    Serial.println(" us");
 }
 
 uint8_t sdCard::getCS_PIN() {
@@ -134,19 +256,32 @@ void sdCard::setCS_PIN(uint8_t pin) {
 }
 
 ssize_t sdCard::writeData(const size_t bytes, const char* data) {
-    if (dataFile) {
-        size_t written = dataFile.write((const uint8_t*)data, bytes);
-        dataFile.flush();
-        return written;
-    } else {
+    LatencyHistogram::Scope timer(_latency.writeData, micros);
+    if (!dataFile) {
         return -1; // error
     }
+    const uint32_t start = micros();
+#if SD_CARD_BUFFERED
+    const ssize_t written = _streaming ? streamWrite(data, bytes)
+                                       : bufferedWrite(dataFile, _dataBuffer, _dataPolicy, data, bytes);
+#else
+    const ssize_t written = dataFile.write((const uint8_t*)data, bytes);
+    dataFile.flush();
+#endif
+    _stats.lastUs = micros() - start;
+    if (_stats.lastUs > _stats.maxUs) {
+        _stats.maxUs = _stats.lastUs;
+    }
+    ++_stats.calls;
+    return written;
 }
 
 ssize_t sdCard::readData(const size_t bytes, char* buffer) {
-    if (dataFile) {
-        dataFile.seek(0); // go to the beginning
-        size_t readBytes = dataFile.readBytes(buffer, bytes);
+    if (dataFile && !_streaming) {
+        flushFile(dataFile, _dataBuffer, _dataPolicy);
+        dataFile.seekSet(0); // go to the beginning
+        const int readBytes = dataFile.read(buffer, bytes);
+        dataFile.seekEnd(); // appends continue at the end
         return readBytes;
     } else {
         return -1; // error
@@ -154,47 +289,279 @@ ssize_t sdCard::readData(const size_t bytes, char* buffer) {
 }
 
 ssize_t sdCard::writeLog(const char* logEntry, const size_t length) {
-    if (logFile) {
-        size_t written = logFile.write((const uint8_t*)logEntry, length);
-        logFile.flush();
-        return written;
-    } else {
+    LatencyHistogram::Scope timer(_latency.writeLog, micros);
+    if (!logFile) {
         return -1; // error
     }
+#if SD_CARD_BUFFERED
+    return bufferedWrite(logFile, _logBuffer, _logPolicy, logEntry, length);
+#else
+    size_t written = logFile.write((const uint8_t*)logEntry, length);
+    logFile.flush();
+    return written;
+#endif
 }
 
 ssize_t sdCard::readLog(char* buffer, const size_t maxLength) {
     if (logFile) {
-        logFile.seek(0); // go to the beginning
-        size_t readBytes = logFile.readBytes(buffer, maxLength);
+        flushFile(logFile, _logBuffer, _logPolicy);
+        logFile.seekSet(0); // go to the beginning
+        const int readBytes = logFile.read(buffer, maxLength);
+        logFile.seekEnd(); // appends continue at the end
         return readBytes;
     } else {
         return -1; // error
     }
 }
 
-bool sdCard::exportSpiFlashRootTo(spiFlash& flash, const char* destFolder) {
-    // Requires SD.begin (e.g. sdCard::startUp) already succeeded; do not call SD.begin here
+int sdCard::flush() {
+    int err = 0;
+    if (_streaming) {
+        if (streamSectors(true) < 0) {
+            err = -1;
+        }
+        _dataPolicy.markSynced();
+    } else if (dataFile && flushFile(dataFile, _dataBuffer, _dataPolicy) < 0) {
+        err = -1;
+    }
+    if (logFile && flushFile(logFile, _logBuffer, _logPolicy) < 0) {
+        err = -1;
+    }
+    return err;
+}
+
+int sdCard::onPhaseChange(bool landed) {
+    int err = 0;
+    if (_streaming && landed) {
+        err = endStream();
+    } else if (_streaming) {
+        if (_dataPolicy.dueOnPhaseChange(landed)) {
+            err = streamSectors(true);
+            _dataPolicy.markSynced();
+        }
+    } else if (dataFile && _dataPolicy.dueOnPhaseChange(landed) &&
+               flushFile(dataFile, _dataBuffer, _dataPolicy) < 0) {
+        err = -1;
+    }
+    if (logFile && _logPolicy.dueOnPhaseChange(landed) && flushFile(logFile, _logBuffer, _logPolicy) < 0) {
+        err = -1;
+    }
+    return err;
+}
+
+void sdCard::setFlushPolicy(const SyncPolicyConfig& data, const SyncPolicyConfig& log) {
+    _dataPolicy.configure(data);
+    _logPolicy.configure(log);
+}
+
+bool sdCard::isStreaming() const { return _streaming; }
+
+const SdCardWriteStats& sdCard::writeStats() const { return _stats; }
+
+void sdCard::resetWriteStats() { _stats = SdCardWriteStats{}; }
+
+const SdCardLatency& sdCard::latency() const { return _latency; }
+
+void sdCard::resetLatency() {
+    _latency.writeData.reset();
+    _latency.writeLog.reset();
+}
+
+ssize_t sdCard::bufferedWrite(File32& file, Buffer& buffer, SyncPolicy& policy, const char* data, size_t bytes) {
+    if (data == nullptr) {
+        return -1;
+    }
+    size_t done = 0;
+    while (done < bytes) {
+        done += buffer.append(data + done, bytes - done);
+        // Whole sectors go out as soon as they are complete; a full buffer of odd size drains too.
+        if (drain(file, buffer, buffer.full()) < 0) {
+            return -1;
+        }
+    }
+    policy.noteWritten(bytes, millis());
+    if (policy.due(millis()) && flushFile(file, buffer, policy) < 0) {
+        return -1;
+    }
+    return static_cast<ssize_t>(bytes);
+}
+
+int sdCard::drain(File32& file, Buffer& buffer, bool partial) {
+    const size_t n = partial ? buffer.size() : buffer.alignedBytes();
+    if (n == 0) {
+        return 0;
+    }
+    if (file.write(buffer.data(), n) != n) {
+        return -1;
+    }
+    buffer.consume(n);
+    ++_stats.sectorWrites;
+    return 0;
+}
+
+int sdCard::flushFile(File32& file, Buffer& buffer, SyncPolicy& policy) {
+    if (drain(file, buffer, true) < 0) {
+        return -1;
+    }
+    if (!policy.dirty()) {
+        return 0;
+    }
+    const uint32_t start = micros();
+    file.flush();
+    const uint32_t us = micros() - start;
+    if (us > _stats.maxFlushUs) {
+        _stats.maxFlushUs = us;
+    }
+    ++_stats.flushes;
+    policy.markSynced();
+    return 0;
+}
+
+bool sdCard::beginStream() {
+    const uint32_t start = micros();
+    // Needs an empty file and one free contiguous run of clusters.
+    if (!dataFile.preAllocate(SD_CARD_PREALLOCATE_BYTES)) {
+        Serial.println("SD preallocation failed (full or fragmented card); data file uses FAT appends");
+        return false;
+    }
+    uint32_t first = 0;
+    uint32_t last = 0;
+    if (!dataFile.contiguousRange(&first, &last)) {
+        Serial.println("SD data file is not contiguous; data file uses FAT appends");
+        dataFile.truncate(0);
+        return false;
+    }
+    // Erased up front so no stale records of an earlier flight can be read back from the extent.
+    if (!sd.card()->erase(first, last)) {
+        Serial.println("SD preallocated extent could not be erased; data file uses FAT appends");
+        dataFile.truncate(0);
+        return false;
+    }
+    _streamSectors = last - first + 1;
+    _dataBuffer.reset(0);
+    _streaming = true;
+
+    Serial.print("SD data file preallocated: ");
+    Serial.print(SD_CARD_PREALLOCATE_BYTES / 1024);
+    Serial.print(" KiB in ");
+    Serial.print((micros() - start) / 1000);
+    Serial.println(" ms");
+    return true;
+}
+
+ssize_t sdCard::streamWrite(const char* data, size_t bytes) {
+    if (data == nullptr) {
+        return -1;
+    }
+    // Out of preallocated room: close the extent and keep going with FAT appends.
+    if ((_dataBuffer.filePosition() + _dataBuffer.size() + bytes + 511) / 512 > _streamSectors) {
+        if (endStream() < 0) {
+            return -1;
+        }
+        return bufferedWrite(dataFile, _dataBuffer, _dataPolicy, data, bytes);
+    }
+    size_t done = 0;
+    while (done < bytes) {
+        done += _dataBuffer.append(data + done, bytes - done);
+        if (_dataBuffer.full() && streamSectors(false) < 0) {
+            return -1;
+        }
+    }
+    _dataPolicy.noteWritten(bytes, millis());
+    if (_dataPolicy.due(millis())) {
+        if (streamSectors(true) < 0) {
+            return -1;
+        }
+        _dataPolicy.markSynced();
+    }
+    return static_cast<ssize_t>(bytes);
+}
+
+int sdCard::streamSectors(bool withTail) {
+    // The buffer starts on a sector boundary while streaming, so its whole sectors go out as
+    // multi-sector writes into clusters the file already owns; SdFat allocates nothing.
+    if (!dataFile.seekSet(_dataBuffer.filePosition())) {
+        return -1;
+    }
+    const size_t whole = _dataBuffer.alignedBytes();
+    if (whole > 0) {
+        if (dataFile.write(_dataBuffer.data(), whole) != whole) {
+            return -1;
+        }
+        _dataBuffer.consume(whole);
+        _stats.streamedSectors += static_cast<uint32_t>(whole / 512);
+        ++_stats.sectorWrites;
+    }
+    if (withTail) {
+        // The partial last sector stays buffered and is rewritten in place once it has more
+        // data. sync() puts it and the file size in the directory entry on the card, so a reset
+        // mid-flight leaves a file that ends at the last flushed record.
+        const uint32_t start = micros();
+        const size_t tail = _dataBuffer.size();
+        if ((tail > 0 && dataFile.write(_dataBuffer.data(), tail) != tail) || !dataFile.sync()) {
+            return -1;
+        }
+        const uint32_t us = micros() - start;
+        if (us > _stats.maxFlushUs) {
+            _stats.maxFlushUs = us;
+        }
+        ++_stats.flushes;
+    }
+    return 0;
+}
+
+int sdCard::endStream() {
+    if (!_streaming) {
+        return 0;
+    }
+    int err = streamSectors(true);
+    _streaming = false;
+    const uint32_t length = _dataBuffer.filePosition() + static_cast<uint32_t>(_dataBuffer.size());
+    // The file already ends at length; truncating there frees the clusters it did not use.
+    if (err < 0 || !dataFile.truncate(length) || !dataFile.sync() || !dataFile.seekEnd()) {
+        err = -1;
+    }
+    _dataBuffer.reset(length);
+    _dataPolicy.markSynced();
+    return err;
+}
+
+bool sdCard::exportSpiFlashRootTo(spiFlash& flash, const char* destFolder, const char* pattern,
+                                  SdExportReport* report) {
+    // Requires sd.begin (e.g. sdCard::startUp) already succeeded; do not call sd.begin here
     // while dataFile/logFile may be open.
-    if (destFolder != nullptr && destFolder[0] != '\0' && !SD.exists(destFolder)) {
-        if (!SD.mkdir(destFolder)) {
+    if (destFolder != nullptr && destFolder[0] != '\0' && !sd.exists(destFolder)) {
+        if (!sd.mkdir(destFolder)) {
             return false;
         }
     }
 
-    SdExportState st;
-    st.folder = destFolder;
-    st.open = false;
+    SdExportJob job;
+    job.flash = &flash;
+    job.folder = destFolder;
+    job.report = SdExportReport{};
+
+    const uint32_t start = millis();
+    const bool ok = flash.forEachRootFile(pattern, exportOneFile, &job) >= 0 && job.report.failed == 0;
+    job.report.elapsedMs = millis() - start;
 
-    SpiFlashExportCallbacks cb;
-    cb.user = &st;
-    cb.onBeginFile = sdExportBegin;
-    cb.onWrite = sdExportWrite;
-    cb.onEndFile = sdExportEnd;
+    const uint32_t ms = job.report.elapsedMs > 0 ? job.report.elapsedMs : 1;
+    Serial.print("SPI flash export: ");
+    Serial.print(job.report.files);
+    Serial.print(" copied, ");
+    Serial.print(job.report.skipped);
+    Serial.print(" already on card, ");
+    Serial.print(job.report.failed);
+    Serial.print(" failed, ");
+    Serial.print(static_cast<uint32_t>(job.report.bytes / 1024));
+    Serial.print(" KiB in ");
+    Serial.print(job.report.elapsedMs);
+    Serial.print(" ms (");
+    Serial.print(static_cast<float>(job.report.bytes) / (ms * 1000.0f), 3);
+    Serial.println(" MB/s)");
 
-    bool ok = flash.exportRootFiles(&cb);
-    if (st.open) {
-        st.out.close();
+    if (report != nullptr) {
+        *report = job.report;
     }
     return ok;
 }
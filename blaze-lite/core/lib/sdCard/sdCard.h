@@ -1,11 +1,79 @@
 #include <Arduino.h>
 #include <SPI.h>
-#include <SD.h>
+#include <SdFat.h>
 
 #include <string>
 
+#include "LatencyHistogram.h"
+#include "SectorBuffer.h"
+#include "SyncPolicy.h"
+
+// 1: writeData/writeLog collect records in RAM and write whole 512-byte sectors; File::flush()
+// (sector + FAT/dir-entry update) only runs per the flush policy. 0: write and flush every call.
+#ifndef SD_CARD_BUFFERED
+#define SD_CARD_BUFFERED 1
+#endif
+// RAM per file for buffered mode (multiple of 512).
+#ifndef SD_CARD_BUFFER_BYTES
+#define SD_CARD_BUFFER_BYTES 1024
+#endif
+// Default flush policy (see SyncPolicy.h). 0 disables a threshold; phase changes always flush.
+#ifndef SD_CARD_FLUSH_EVERY_BYTES
+#define SD_CARD_FLUSH_EVERY_BYTES 4096
+#endif
+#ifndef SD_CARD_FLUSH_EVERY_MS
+#define SD_CARD_FLUSH_EVERY_MS 1000
+#endif
+#ifndef SD_CARD_LOG_FLUSH_EVERY_BYTES
+#define SD_CARD_LOG_FLUSH_EVERY_BYTES 1024
+#endif
+#ifndef SD_CARD_LOG_FLUSH_EVERY_MS
+#define SD_CARD_LOG_FLUSH_EVERY_MS 1000
+#endif
+// Bytes preallocated as one contiguous extent for the session data file at startUp(); records
+// then go into it as whole-sector writes, so SdFat never allocates a cluster or touches the FAT
+// in flight. Every flush syncs the file size, so after a reset mid-flight the file ends at the
+// last flushed record. LANDED truncates the file to its written length, which frees the unused
+// clusters. 0 disables.
+#ifndef SD_CARD_PREALLOCATE_BYTES
+#define SD_CARD_PREALLOCATE_BYTES (16UL * 1024 * 1024)
+#endif
+// SPI flash export chunk: a multiple of 4096 so it spans whole flash pages and whole SD sectors.
+#ifndef SD_CARD_EXPORT_CHUNK_BYTES
+#define SD_CARD_EXPORT_CHUNK_BYTES 4096
+#endif
+#ifndef SD_CARD_SPI_MHZ
+#define SD_CARD_SPI_MHZ 16
+#endif
+
 class spiFlash;
 
+/** Result of sdCard::exportSpiFlashRootTo(). */
+struct SdExportReport {
+    uint32_t files;       // files copied and verified
+    uint32_t skipped;     // already on the card with the same size and CRC32 (resume)
+    uint32_t failed;      // read, write or verify failures
+    uint64_t bytes;       // bytes copied
+    uint32_t elapsedMs;
+};
+
+/** Call latency since sdCard::resetLatency(). */
+struct SdCardLatency {
+    LatencyHistogram writeData;
+    LatencyHistogram writeLog;
+};
+
+/** writeData() timing since sdCard::resetWriteStats(). */
+struct SdCardWriteStats {
+    uint32_t calls;          // writeData() calls
+    uint32_t lastUs;         // duration of the last writeData()
+    uint32_t maxUs;          // worst writeData()
+    uint32_t sectorWrites;   // File::write() calls from the RAM buffers (whole sectors unless flushing)
+    uint32_t flushes;        // File::flush() calls (data and log)
+    uint32_t maxFlushUs;     // slowest flush
+    uint32_t streamedSectors;  // whole sectors written into the preallocated data file
+};
+
 class sdCard {
     public:
         //Constructors
@@ -20,20 +88,75 @@ class sdCard {
         void setCS_PIN(uint8_t pin);
         //data read/write methods
         ssize_t writeData(const size_t bytes, const char* data);
+        /** Not available (-1) while the data file is streamed into its preallocated extent. */
         ssize_t readData(const size_t bytes, char* buffer);
         //log read/write methods
         ssize_t writeLog(const char* logEntry, const size_t length);
         ssize_t readLog(char* buffer, const size_t maxLength);
 
+        /** Write buffered bytes of both files and flush them. Returns 0 or -1 on error. */
+        int flush();
+
         /**
-         * Copy every regular file from SPI flash FAT root into destFolder on the SD card.
-         * Creates destFolder if needed. Existing SD files with the same relative path are replaced.
-         * Does not delete or alter files on SPI flash.
+         * Call on every flight-phase change; flushes both files. LANDED also ends streaming and
+         * truncates the preallocated data file to its written length. Returns 0 or -1.
          */
-        bool exportSpiFlashRootTo(spiFlash& flash, const char* destFolder);
+        int onPhaseChange(bool landed);
+
+        /** True while data records go to the preallocated extent as whole-sector writes. */
+        bool isStreaming() const;
+
+        /** Replace the data and log flush thresholds (defaults from SD_CARD_*FLUSH_* macros). */
+        void setFlushPolicy(const SyncPolicyConfig& data, const SyncPolicyConfig& log);
+
+        const SdCardWriteStats& writeStats() const;
+        void resetWriteStats();
+
+        const SdCardLatency& latency() const;
+        void resetLatency();
+
+        /**
+         * Copy every regular file (matching pattern, * and ?) from the SPI flash root into destFolder
+         * on the SD card, in SD_CARD_EXPORT_CHUNK_BYTES chunks. Creates destFolder if needed. Files
+         * already on the card with the same size and CRC32 are skipped, so an interrupted export
+         * can be resumed; every copy is read back and its CRC32 checked against the flash side.
+         * A file that fails is counted and the rest are still copied; a card write failure stops
+         * the export. Returns false if anything failed. Prints a summary with MB/s. Does not
+         * delete or alter files on SPI flash.
+         */
+        bool exportSpiFlashRootTo(spiFlash& flash, const char* destFolder, const char* pattern = nullptr,
+                                  SdExportReport* report = nullptr);
 
     private:
+        typedef SectorBuffer<SD_CARD_BUFFER_BYTES> Buffer;
+
+        /** Buffer bytes for file, writing whole sectors as they fill and flushing per policy. */
+        ssize_t bufferedWrite(File32& file, Buffer& buffer, SyncPolicy& policy, const char* data, size_t bytes);
+        /** Write the sector-aligned head of buffer (all of it if partial is set). Returns 0 or -1. */
+        int drain(File32& file, Buffer& buffer, bool partial);
+        /** Drain everything and File::flush(). Returns 0 or -1. */
+        int flushFile(File32& file, Buffer& buffer, SyncPolicy& policy);
+
+        /** Preallocate the data file and switch writeData() to whole-sector writes into it. */
+        bool beginStream();
+        /** Buffer data records and write them into the extent with multi-sector writes. */
+        ssize_t streamWrite(const char* data, size_t bytes);
+        /** Write the whole buffered sectors; withTail also the partial last sector (kept buffered) and sync. */
+        int streamSectors(bool withTail);
+        /** Write everything, truncate the file to the streamed length and go back to FAT appends. */
+        int endStream();
+
         uint8_t CS_PIN;
         String Datafile = "Data.txt";
         String Logfile = "Log.txt";
+
+        Buffer _dataBuffer;
+        Buffer _logBuffer;
+        SyncPolicy _dataPolicy;
+        SyncPolicy _logPolicy;
+        SdCardWriteStats _stats;
+        SdCardLatency _latency;
+
+        bool _streaming;
+        uint32_t _streamSectors;
 };
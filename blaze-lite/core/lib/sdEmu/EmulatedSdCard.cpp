@@ -0,0 +1,330 @@
+/**
+ * @file EmulatedSdCard.cpp
+ * @brief Implementation of EmulatedSdCard and the SdFat stand-in on top of it
+ */
+
+#include "EmulatedSdCard.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+#include "SdFat.h"
+
+namespace {
+// Card paths are kept without a leading '/'; the root is "".
+std::string normalize(const char* path) {
+    std::string p = path != nullptr ? path : "";
+    while (!p.empty() && p[0] == '/') {
+        p.erase(0, 1);
+    }
+    while (!p.empty() && p[p.size() - 1] == '/') {
+        p.erase(p.size() - 1);
+    }
+    return p;
+}
+
+std::string parentOf(const std::string& path) {
+    const size_t slash = path.rfind('/');
+    return slash == std::string::npos ? std::string() : path.substr(0, slash);
+}
+
+std::string baseName(const std::string& path) {
+    const size_t slash = path.rfind('/');
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+bool isDirPath(const EmulatedSdCard& card, const std::string& path) {
+    return path.empty() || card.dirs.count(path) > 0;
+}
+
+// File whose preallocated extent holds sector, or nullptr.
+EmulatedSdFile* extentFile(uint32_t sector, uint32_t* offset) {
+    for (auto& kv : EmulatedSdCard::instance().files) {
+        EmulatedSdFile& f = kv.second;
+        if (f.sectors > 0 && sector >= f.firstSector && sector < f.firstSector + f.sectors) {
+            *offset = (sector - f.firstSector) * EmulatedSdCard::kSectorSize;
+            return &f;
+        }
+    }
+    return nullptr;
+}
+}  // namespace
+
+EmulatedSdCard& EmulatedSdCard::instance() {
+    static EmulatedSdCard card;
+    return card;
+}
+
+void EmulatedSdCard::reset() {
+    files.clear();
+    dirs.clear();
+    _present = true;
+    _failWrites = false;
+    _corruptPath.clear();
+    _nextSector = 8192;  // past the FAT and root directory of a small volume
+}
+
+uint32_t EmulatedSdCard::allocateSectors(uint32_t count) {
+    const uint32_t first = _nextSector;
+    _nextSector += count;
+    return first;
+}
+
+// ---- SdCard (raw sectors) ----
+
+bool SdCard::writeSectors(uint32_t sector, const uint8_t* src, size_t count) {
+    if (EmulatedSdCard::instance().failWrites()) {
+        return false;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t offset = 0;
+        EmulatedSdFile* f = extentFile(sector + static_cast<uint32_t>(i), &offset);
+        if (f == nullptr) {
+            return false;  // would overwrite file system structures
+        }
+        // Past the current file size the bytes only exist in the cluster, as on a real card.
+        for (uint32_t b = 0; b < EmulatedSdCard::kSectorSize && offset + b < f->data.size(); ++b) {
+            f->data[offset + b] = src[i * EmulatedSdCard::kSectorSize + b];
+        }
+    }
+    return true;
+}
+
+bool SdCard::readSectors(uint32_t sector, uint8_t* dst, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t offset = 0;
+        EmulatedSdFile* f = extentFile(sector + static_cast<uint32_t>(i), &offset);
+        uint8_t* out = dst + i * EmulatedSdCard::kSectorSize;
+        memset(out, EmulatedSdCard::kErasedByte, EmulatedSdCard::kSectorSize);
+        if (f != nullptr && offset < f->data.size()) {
+            const size_t n = std::min<size_t>(EmulatedSdCard::kSectorSize, f->data.size() - offset);
+            memcpy(out, &f->data[offset], n);
+        }
+    }
+    return true;
+}
+
+bool SdCard::erase(uint32_t firstSector, uint32_t lastSector) {
+    if (EmulatedSdCard::instance().failWrites() || lastSector < firstSector) {
+        return false;
+    }
+    for (uint32_t s = firstSector; s <= lastSector; ++s) {
+        uint32_t offset = 0;
+        EmulatedSdFile* f = extentFile(s, &offset);
+        for (uint32_t b = 0; f != nullptr && b < EmulatedSdCard::kSectorSize && offset + b < f->data.size(); ++b) {
+            f->data[offset + b] = EmulatedSdCard::kErasedByte;
+        }
+    }
+    return true;
+}
+
+bool SdCard::syncDevice() { return !EmulatedSdCard::instance().failWrites(); }
+
+// ---- File32 ----
+
+bool File32::openNext(File32* dir, int oflag) {
+    close();
+    if (dir == nullptr || !dir->isDir()) {
+        return false;
+    }
+    EmulatedSdCard& card = EmulatedSdCard::instance();
+    std::vector<std::string> children;
+    for (const auto& kv : card.files) {
+        if (parentOf(kv.first) == dir->_path) {
+            children.push_back(kv.first);
+        }
+    }
+    for (const std::string& d : card.dirs) {
+        if (parentOf(d) == dir->_path) {
+            children.push_back(d);
+        }
+    }
+    std::sort(children.begin(), children.end());
+    if (dir->_next >= children.size()) {
+        return false;
+    }
+    _path = children[dir->_next++];
+    _open = true;
+    _dir = isDirPath(card, _path);
+    _flags = oflag;
+    _pos = 0;
+    _next = 0;
+    return true;
+}
+
+size_t File32::getName(char* name, size_t size) const {
+    if (!_open || name == nullptr || size == 0) {
+        return 0;
+    }
+    const std::string base = baseName(_path);
+    if (base.size() + 1 > size) {
+        name[0] = '\0';
+        return 0;
+    }
+    memcpy(name, base.c_str(), base.size() + 1);
+    return base.size();
+}
+
+int File32::read(void* buf, size_t count) {
+    EmulatedSdCard& card = EmulatedSdCard::instance();
+    auto it = card.files.find(_path);
+    if (!_open || _dir || it == card.files.end()) {
+        return -1;
+    }
+    const std::vector<uint8_t>& data = it->second.data;
+    const size_t n = _pos < data.size() ? std::min(count, data.size() - _pos) : 0;
+    if (n > 0) {
+        memcpy(buf, &data[_pos], n);
+    }
+    _pos += static_cast<uint32_t>(n);
+    return static_cast<int>(n);
+}
+
+size_t File32::write(const void* buf, size_t count) {
+    EmulatedSdCard& card = EmulatedSdCard::instance();
+    auto it = card.files.find(_path);
+    if (!_open || _dir || it == card.files.end() || (_flags & (O_WRONLY | O_RDWR)) == 0 || card.failWrites()) {
+        return 0;
+    }
+    std::vector<uint8_t>& data = it->second.data;
+    if ((_flags & O_AT_END) != 0) {
+        _pos = static_cast<uint32_t>(data.size());
+    }
+    if (_pos + count > data.size()) {
+        data.resize(_pos + count);
+    }
+    memcpy(&data[_pos], buf, count);
+    if (count > 0 && _path == card.corruptWrites()) {
+        data[_pos] ^= 0x01;
+    }
+    _pos += static_cast<uint32_t>(count);
+    return count;
+}
+
+bool File32::sync() { return _open && !EmulatedSdCard::instance().failWrites(); }
+
+bool File32::close() {
+    const bool wasOpen = _open;
+    _open = false;
+    _dir = false;
+    _path.clear();
+    _pos = 0;
+    _next = 0;
+    return wasOpen;
+}
+
+bool File32::seekSet(uint32_t pos) {
+    if (!_open || pos > fileSize()) {
+        return false;
+    }
+    _pos = pos;
+    return true;
+}
+
+bool File32::seekEnd(int32_t offset) {
+    const int64_t pos = static_cast<int64_t>(fileSize()) + offset;
+    return pos >= 0 && seekSet(static_cast<uint32_t>(pos));
+}
+
+uint32_t File32::fileSize() const {
+    const EmulatedSdCard& card = EmulatedSdCard::instance();
+    auto it = card.files.find(_path);
+    return (_open && !_dir && it != card.files.end()) ? static_cast<uint32_t>(it->second.data.size()) : 0;
+}
+
+bool File32::preAllocate(uint32_t length) {
+    EmulatedSdCard& card = EmulatedSdCard::instance();
+    auto it = card.files.find(_path);
+    if (!_open || _dir || it == card.files.end() || !it->second.data.empty() || length == 0 || card.failWrites()) {
+        return false;
+    }
+    EmulatedSdFile& f = it->second;
+    f.sectors = (length + EmulatedSdCard::kSectorSize - 1) / EmulatedSdCard::kSectorSize;
+    f.firstSector = card.allocateSectors(f.sectors);
+    return true;  // like SdFat: the clusters are reserved, the file size stays 0
+}
+
+bool File32::contiguousRange(uint32_t* firstSector, uint32_t* lastSector) {
+    const EmulatedSdCard& card = EmulatedSdCard::instance();
+    auto it = card.files.find(_path);
+    if (!_open || _dir || it == card.files.end() || it->second.sectors == 0) {
+        return false;
+    }
+    *firstSector = it->second.firstSector;
+    *lastSector = it->second.firstSector + it->second.sectors - 1;
+    return true;
+}
+
+bool File32::truncate(uint32_t length) {
+    EmulatedSdCard& card = EmulatedSdCard::instance();
+    auto it = card.files.find(_path);
+    if (!_open || _dir || it == card.files.end() || length > it->second.data.size() || card.failWrites()) {
+        return false;
+    }
+    it->second.data.resize(length);
+    if (length == 0) {
+        it->second.sectors = 0;  // clusters go back to the free list
+    }
+    if (_pos > length) {
+        _pos = length;
+    }
+    return true;
+}
+
+// ---- SdFat32 ----
+
+bool SdFat32::begin(const SdSpiConfig& /*config*/) { return EmulatedSdCard::instance().present(); }
+
+File32 SdFat32::open(const char* path, int oflag) {
+    EmulatedSdCard& card = EmulatedSdCard::instance();
+    const std::string p = normalize(path);
+    File32 file;
+    if (isDirPath(card, p)) {
+        file._path = p;
+        file._open = true;
+        file._dir = true;
+        return file;
+    }
+    auto it = card.files.find(p);
+    if (it == card.files.end()) {
+        if ((oflag & O_CREAT) == 0 || card.failWrites() || !isDirPath(card, parentOf(p))) {
+            return file;
+        }
+        it = card.files.emplace(p, EmulatedSdFile{{}, 0, 0}).first;
+    } else if ((oflag & O_TRUNC) != 0) {
+        if (card.failWrites()) {
+            return file;
+        }
+        it->second = EmulatedSdFile{{}, 0, 0};
+    }
+    file._path = p;
+    file._open = true;
+    file._flags = oflag;
+    return file;
+}
+
+bool SdFat32::exists(const char* path) {
+    const EmulatedSdCard& card = EmulatedSdCard::instance();
+    const std::string p = normalize(path);
+    return isDirPath(card, p) || card.files.count(p) > 0;
+}
+
+bool SdFat32::mkdir(const char* path, bool parents) {
+    EmulatedSdCard& card = EmulatedSdCard::instance();
+    const std::string p = normalize(path);
+    if (p.empty() || card.files.count(p) > 0 || card.failWrites()) {
+        return false;
+    }
+    const std::string parent = parentOf(p);
+    if (!isDirPath(card, parent) && (!parents || !mkdir(parent.c_str(), true))) {
+        return false;
+    }
+    card.dirs.insert(p);
+    return true;
+}
+
+bool SdFat32::remove(const char* path) {
+    EmulatedSdCard& card = EmulatedSdCard::instance();
+    return !card.failWrites() && card.files.erase(normalize(path)) > 0;
+}
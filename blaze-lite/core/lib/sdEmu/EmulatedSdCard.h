@@ -0,0 +1,63 @@
+/**
+ * @file EmulatedSdCard.h
+ * @brief Contents and fault injection of the host SD card behind the SdFat stand-in
+ *
+ * One card per process, shared by every SdFat32. Tests inspect files directly and can make the
+ * card refuse writes (full or pulled) or store corrupted data for one path (bad sectors).
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+struct EmulatedSdFile {
+    std::vector<uint8_t> data;
+    uint32_t firstSector;  ///< Extent from preAllocate(); 0 sectors if none
+    uint32_t sectors;
+};
+
+/**
+ * @class EmulatedSdCard
+ * @brief RAM-backed FAT volume
+ */
+class EmulatedSdCard {
+public:
+    static constexpr uint32_t kSectorSize = 512;
+    static constexpr uint8_t kErasedByte = 0xFF;
+
+    static EmulatedSdCard& instance();
+
+    /** @brief Empty card, inserted, no faults */
+    void reset();
+
+    /** @brief begin() fails while the card is absent */
+    void setPresent(bool present) { _present = present; }
+    bool present() const { return _present; }
+
+    /** @brief Every write, sync and file creation fails (card full or pulled) */
+    void setFailWrites(bool fail) { _failWrites = fail; }
+    bool failWrites() const { return _failWrites; }
+
+    /** @brief Each write to path stores its first byte with one bit flipped ("" for none) */
+    void setCorruptWrites(const std::string& path) { _corruptPath = path; }
+    const std::string& corruptWrites() const { return _corruptPath; }
+
+    /** @brief Next free virtual sector for a preallocated extent */
+    uint32_t allocateSectors(uint32_t count);
+
+    std::map<std::string, EmulatedSdFile> files;
+    std::set<std::string> dirs;
+
+private:
+    EmulatedSdCard() { reset(); }
+
+    bool _present;
+    bool _failWrites;
+    std::string _corruptPath;
+    uint32_t _nextSector;
+};
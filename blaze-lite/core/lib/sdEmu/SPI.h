@@ -0,0 +1,6 @@
+/**
+ * @file SPI.h
+ * @brief Empty SPI header for host builds; the emulated SD card (SdFat.h) needs no bus
+ */
+
+#pragma once
@@ -0,0 +1,103 @@
+/**
+ * @file SdFat.h
+ * @brief Host stand-in for the part of SdFat that sdCard uses (FAT volume, File32, raw sectors)
+ *
+ * Files and directories live in RAM (EmulatedSdCard.h). preAllocate() gives a file a contiguous
+ * extent of virtual sectors but, as in SdFat, leaves its size at 0: raw writeSectors()/erase()
+ * only change the bytes below the file size, and truncate() cannot grow a file. Never linked into the board build (lib_ignore in the
+ * blaze_f411ce env), where the real SdFat provides this header.
+ */
+
+#pragma once
+
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+#ifndef O_AT_END
+#define O_AT_END O_APPEND
+#endif
+#define FILE_WRITE (O_RDWR | O_CREAT | O_AT_END)
+
+#define SHARED_SPI 1
+#define SD_SCK_MHZ(mhz) (1000000UL * (mhz))
+
+struct SdSpiConfig {
+    SdSpiConfig(uint8_t cs, uint8_t opt, uint32_t maxSck) : csPin(cs), options(opt), maxSckHz(maxSck) {}
+    uint8_t csPin;
+    uint8_t options;
+    uint32_t maxSckHz;
+};
+
+/**
+ * @class SdCard
+ * @brief Raw sector access; only sectors inside a preallocated extent hold data
+ */
+class SdCard {
+public:
+    bool writeSectors(uint32_t sector, const uint8_t* src, size_t count);
+    bool readSectors(uint32_t sector, uint8_t* dst, size_t count);
+    bool erase(uint32_t firstSector, uint32_t lastSector);
+    bool syncDevice();
+};
+
+/**
+ * @class File32
+ * @brief Open file or directory handle
+ */
+class File32 {
+public:
+    File32() : _open(false), _dir(false), _flags(0), _pos(0), _next(0) {}
+
+    explicit operator bool() const { return _open; }
+    bool isOpen() const { return _open; }
+    bool isDir() const { return _open && _dir; }
+
+    /** @brief Open the next entry of dir (files and subdirectories, in name order) */
+    bool openNext(File32* dir, int oflag = O_RDONLY);
+    size_t getName(char* name, size_t size) const;
+
+    int read(void* buf, size_t count);
+    size_t write(const void* buf, size_t count);
+    /** @brief As in SdFat (Stream::flush), no status; use sync() to learn whether it worked */
+    void flush() { sync(); }
+    bool sync();
+    bool close();
+
+    bool seekSet(uint32_t pos);
+    bool seekEnd(int32_t offset = 0);
+    uint32_t fileSize() const;
+
+    bool preAllocate(uint32_t length);
+    bool contiguousRange(uint32_t* firstSector, uint32_t* lastSector);
+    bool truncate(uint32_t length);
+
+private:
+    friend class SdFat32;
+
+    std::string _path;
+    bool _open;
+    bool _dir;
+    int _flags;
+    uint32_t _pos;
+    size_t _next;  ///< Next entry index for openNext() on a directory
+};
+
+/**
+ * @class SdFat32
+ * @brief The volume: paths are relative to the root, '/' separated
+ */
+class SdFat32 {
+public:
+    bool begin(const SdSpiConfig& config);
+    File32 open(const char* path, int oflag = O_RDONLY);
+    bool exists(const char* path);
+    bool mkdir(const char* path, bool parents = true);
+    bool remove(const char* path);
+    SdCard* card() { return &_card; }
+
+private:
+    SdCard _card;
+};
@@ -0,0 +1,73 @@
+/**
+ * @file SectorBuffer.h
+ * @brief RAM staging buffer that hands out writes ending on file-sector boundaries
+ *
+ * Appending a few dozen bytes to a FAT file and flushing costs a read-modify-write of the
+ * 512-byte sector plus a FAT/directory update. SectorBuffer tracks the file position of its
+ * first byte, so callers can write exactly the bytes that complete whole sectors and keep the
+ * remainder in RAM until the next append or an explicit flush.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * @class SectorBuffer
+ * @brief Append buffer of kCapacity bytes aligned to kSectorBytes file sectors
+ */
+template <size_t kCapacity, size_t kSectorBytes = 512>
+class SectorBuffer {
+    static_assert(kCapacity >= kSectorBytes, "SectorBuffer must hold at least one sector");
+
+public:
+    SectorBuffer() : _size(0), _filePos(0) {}
+
+    /** @brief Drop buffered bytes; filePos is where the next appended byte will land in the file */
+    void reset(uint32_t filePos = 0) {
+        _size = 0;
+        _filePos = filePos;
+    }
+
+    /** @brief Copy as much of data as fits; returns bytes copied */
+    size_t append(const void* data, size_t len) {
+        const size_t n = len < kCapacity - _size ? len : kCapacity - _size;
+        memcpy(_buf + _size, data, n);
+        _size += n;
+        return n;
+    }
+
+    /** @brief Leading bytes that end exactly on a sector boundary of the file (0 if none) */
+    size_t alignedBytes() const {
+        const uint32_t end = _filePos + static_cast<uint32_t>(_size);
+        const uint32_t alignedEnd = end - (end % kSectorBytes);
+        return alignedEnd > _filePos ? alignedEnd - _filePos : 0;
+    }
+
+    /** @brief The first n buffered bytes reached the file; shift the rest to the front */
+    void consume(size_t n) {
+        if (n > _size) {
+            n = _size;
+        }
+        memmove(_buf, _buf + n, _size - n);
+        _size -= n;
+        _filePos += static_cast<uint32_t>(n);
+    }
+
+    const uint8_t* data() const { return _buf; }
+    size_t size() const { return _size; }
+    bool empty() const { return _size == 0; }
+    bool full() const { return _size == kCapacity; }
+
+    /** @brief File offset of data()[0] */
+    uint32_t filePosition() const { return _filePos; }
+
+    static constexpr size_t capacity() { return kCapacity; }
+
+private:
+    uint8_t _buf[kCapacity];
+    size_t _size;
+    uint32_t _filePos;
+};
@@ -14,12 +14,14 @@ void initSensorData(SensorData* data) {
     
     memset(data, 0, sizeof(SensorData));
     
-    data->accel.x = 0.0f;
-    data->accel.y = 0.0f;
-    data->accel.z = 0.0f;
-    data->accel.magnitude = 0.0f;
+    data->accel.raw[0] = 0;
+    data->accel.raw[1] = 0;
+    data->accel.raw[2] = 0;
+    data->accel.range = 0;
+    data->accel.magnitudeSq = 0;
     data->accel.valid = false;
     data->accel.timestamp = 0;
+    data->accel.timestampUs = 0;
     
     /*
     data->gyro.x = 0.0f;
@@ -40,6 +42,11 @@ void initSensorData(SensorData* data) {
     data->baro.temperature = 0.0f;
     data->baro.valid = false;
     data->baro.timestamp = 0;
+
+    data->estimate.altitude = 0.0f;
+    data->estimate.velocity = 0.0f;
+    data->estimate.acceleration = 0.0f;
+    data->estimate.valid = false;
     
     data->systemTimestamp = 0;
     data->sequenceNumber = 0;
@@ -52,12 +59,19 @@ float calculateAccelMagnitude(float x, float y, float z) {
 void printSensorData(const SensorData& data) {
     Serial.print("SensorData [Seq: "); Serial.print(data.sequenceNumber);
     Serial.print("] Accel(V:"); Serial.print(data.accel.valid);
-    Serial.print(") X:"); Serial.print(data.accel.x, 3);
-    Serial.print(" Y:"); Serial.print(data.accel.y, 3);
-    Serial.print(" Z:"); Serial.print(data.accel.z, 3);
-    Serial.print(" Mag:"); Serial.print(data.accel.magnitude, 3);
+    const float x = rawAccelToG(data.accel.raw[0], data.accel.range);
+    const float y = rawAccelToG(data.accel.raw[1], data.accel.range);
+    const float z = rawAccelToG(data.accel.raw[2], data.accel.range);
+    Serial.print(") X:"); Serial.print(x, 3);
+    Serial.print(" Y:"); Serial.print(y, 3);
+    Serial.print(" Z:"); Serial.print(z, 3);
+    Serial.print(" Mag:"); Serial.print(calculateAccelMagnitude(x, y, z), 3);
     Serial.print(" | Baro(V:"); Serial.print(data.baro.valid);
     Serial.print(") P:"); Serial.print(data.baro.pressure, 2);
     Serial.print(" T:"); Serial.print(data.baro.temperature, 2);
-    Serial.print(" Alt:"); Serial.println(data.baro.altitude, 2);
+    Serial.print(" Alt:"); Serial.print(data.baro.altitude, 2);
+    Serial.print(" | Est(V:"); Serial.print(data.estimate.valid);
+    Serial.print(") Alt:"); Serial.print(data.estimate.altitude, 2);
+    Serial.print(" Vel:"); Serial.print(data.estimate.velocity, 2);
+    Serial.print(" Acc:"); Serial.println(data.estimate.acceleration, 2);
 }
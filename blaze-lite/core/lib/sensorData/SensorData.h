@@ -10,6 +10,8 @@
 #include <Arduino.h>
 #include <SparkFun_KX13X.h>
 
+#include "RawAccel.h"
+
 /**
  * @struct SensorData
  * @brief Aggregated sensor data from all sensors
@@ -17,12 +19,12 @@
 struct SensorData {
     // Accelerometer data (KX134)
     struct {
-        float x;        ///< X-axis acceleration (g)
-        float y;        ///< Y-axis acceleration (g)
-        float z;        ///< Z-axis acceleration (g)
-        float magnitude; ///< Acceleration magnitude (g)
+        int16_t raw[3]; ///< Raw X/Y/Z output (counts); see RawAccel.h for g conversions
+        uint8_t range;  ///< KX134 range code the raw counts were taken at
+        uint32_t magnitudeSq; ///< Squared magnitude (counts^2), for threshold checks
         bool valid;     ///< Data validity flag
         uint32_t timestamp; ///< Timestamp of reading (ms)
+        uint32_t timestampUs; ///< micros() at the KX134 data-ready edge
     } accel;
     
     // Barometric pressure data (BMP280/MS5611 - placeholder for future implementation)
@@ -33,6 +35,14 @@ struct SensorData {
         bool valid;         ///< Data validity flag
         uint32_t timestamp; ///< Timestamp of reading (ms)
     } baro;
+
+    // Baro/accelerometer fusion (AltitudeFilter), refreshed at the sample rate
+    struct {
+        float altitude;     ///< Altitude above the pad (m)
+        float velocity;     ///< Vertical velocity, up positive (m/s)
+        float acceleration; ///< Vertical acceleration, gravity removed (m/s^2)
+        bool valid;         ///< Set once a barometer sample has anchored the estimate
+    } estimate;
     
     // System metadata
     uint32_t systemTimestamp;  ///< System timestamp when data was collected (ms)
@@ -51,6 +61,7 @@ void initSensorData(SensorData* data);
  * @param y Y-axis acceleration
  * @param z Z-axis acceleration
  * @return Magnitude of acceleration
+ * @note Display only; the sample path uses rawAccelMagnitudeSq() on counts.
  */
 float calculateAccelMagnitude(float x, float y, float z);
 
@@ -0,0 +1,94 @@
+/**
+ * @file SessionIndex.h
+ * @brief Picks the next PREFIX###.ext session file name from one directory listing
+ *
+ * Feed every root directory entry to observe(); next() is one past the highest index seen,
+ * so a boot costs one directory scan instead of an existence probe per index. Matching is
+ * case-insensitive because FAT reports short names in upper case.
+ */
+
+#pragma once
+
+#include <ctype.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * @class SessionIndex
+ * @brief Tracks the highest PREFIX###.ext index among observed names
+ */
+class SessionIndex {
+public:
+    static constexpr int kMaxIndex = 999;
+
+    /**
+     * @param prefix Name prefix, e.g. "DATA"
+     * @param ext Extension including the dot, e.g. ".bin"
+     */
+    SessionIndex(const char* prefix, const char* ext) : _prefix(prefix), _ext(ext), _max(-1) {}
+
+    /** @brief Consider one directory entry name */
+    void observe(const char* name) {
+        const int index = parse(name);
+        if (index > _max) {
+            _max = index;
+        }
+    }
+
+    /** @brief Highest index seen, or -1 */
+    int highest() const { return _max; }
+
+    /** @brief Index for the new session, or -1 if PREFIX999 is already taken */
+    int next() const { return _max < kMaxIndex ? _max + 1 : -1; }
+
+    /**
+     * @brief Write the new session's file name
+     * @return false if the index range is exhausted or the buffer is too small
+     */
+    bool format(char* buffer, size_t bufferSize) const {
+        const int index = next();
+        if (index < 0) {
+            return false;
+        }
+        const int n = snprintf(buffer, bufferSize, "%s%03u%s", _prefix, static_cast<unsigned>(index), _ext);
+        return n > 0 && static_cast<size_t>(n) < bufferSize;
+    }
+
+    /** @brief Index encoded in name, or -1 if it is not PREFIX###.ext */
+    int parse(const char* name) const {
+        if (name == nullptr) {
+            return -1;
+        }
+        const size_t prefixLen = strlen(_prefix);
+        if (!matches(name, _prefix, prefixLen)) {
+            return -1;
+        }
+        const char* digits = name + prefixLen;
+        for (int i = 0; i < 3; ++i) {
+            if (!isdigit(static_cast<unsigned char>(digits[i]))) {
+                return -1;
+            }
+        }
+        const char* ext = digits + 3;
+        if (strlen(ext) != strlen(_ext) || !matches(ext, _ext, strlen(_ext))) {
+            return -1;
+        }
+        return (digits[0] - '0') * 100 + (digits[1] - '0') * 10 + (digits[2] - '0');
+    }
+
+private:
+    static bool matches(const char* s, const char* pattern, size_t len) {
+        for (size_t i = 0; i < len; ++i) {
+            if (s[i] == '\0' || toupper(static_cast<unsigned char>(s[i])) != toupper(static_cast<unsigned char>(pattern[i]))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    const char* _prefix;
+    const char* _ext;
+    int _max;
+};
@@ -6,19 +6,18 @@
 */
 #include "spiFlash.h"
 
-#include <SPI.h>
-
-#include <Adafruit_SPIFlash.h>
-#include <flash_devices.h>
-
 extern "C" {
 #include "lfs.h"
 }
 
 #include <algorithm>
+#include <cstddef>
 #include <cstdio>
 #include <cstring>
 
+#include "Crc32.h"
+#include "SessionIndex.h"
+
 // Set this to 0 in platformio.ini if you do not want a mount failure to erase/reformat flash:
 #ifndef SPI_FLASH_AUTO_FORMAT_ON_MOUNT_FAIL
 #define SPI_FLASH_AUTO_FORMAT_ON_MOUNT_FAIL 1
@@ -26,78 +25,18 @@ extern "C" {
 
 namespace {
 
-const uint8_t kFlashCsPin = PB8;
-
-// W25Q128 / GD25Q128 style SPI NOR flash geometry.
-static constexpr lfs_size_t kLfsReadSize = 16;
+// W25Q128 / GD25Q128 style SPI NOR flash geometry; the rest of the LittleFS config is the SpiFlashFsProfile.
 static constexpr lfs_size_t kLfsProgSize = 256;
 static constexpr lfs_size_t kLfsBlockSize = 4096;
-static constexpr lfs_size_t kLfsCacheSize = 256;
-static constexpr lfs_size_t kLfsLookaheadSize = 128;
-static constexpr int32_t kLfsBlockCycles = 500;
-
-// GD25Q128 (16 MiB): same ID pattern as GD25Q64 but capacity 0x18 — not in Adafruit's default table.
-static const SPIFlash_Device_t kGd25q128 = {
-    .total_size = (1UL << 24),
-    .start_up_time_us = 5000,
-    .manufacturer_id = 0xc8,
-    .memory_type = 0x40,
-    .capacity = 0x18,
-    .max_clock_speed_mhz = 104,
-    .quad_enable_bit_mask = 0x02,
-    .has_sector_protection = false,
-    .supports_fast_read = true,
-    .supports_qspi = true,
-    .supports_qspi_writes = true,
-    .write_status_register_split = true,
-    .single_status_byte = false,
-    .is_fram = false,
-};
-
-// Order: try exact parts used on Blaze / common alternates before library defaults.
-static const SPIFlash_Device_t kBlazeFlashCandidates[] = {
-    W25Q128JV_SQ,
-    W25Q128JV_PM,
-    MX25L12833F,
-    kGd25q128,
-};
+// LittleFS default attr_max; inline_max may not exceed it.
+static constexpr lfs_size_t kLfsAttrMax = 1022;
 
-void logRawJedec(uint8_t csPin) {
-    pinMode(csPin, OUTPUT);
-    digitalWrite(csPin, HIGH);
-    delayMicroseconds(50);
-    SPI.beginTransaction(SPISettings(250000, MSBFIRST, SPI_MODE0));
-    digitalWrite(csPin, LOW);
-    delayMicroseconds(2);
-    SPI.transfer(0x9F);
-    uint8_t m = SPI.transfer(0xFF);
-    uint8_t t = SPI.transfer(0xFF);
-    uint8_t c = SPI.transfer(0xFF);
-    digitalWrite(csPin, HIGH);
-    SPI.endTransaction();
-    Serial.print("SPI flash raw JEDEC (manuf, type, cap): 0x");
-    if (m < 16) {
-        Serial.print('0');
-    }
-    Serial.print(m, HEX);
-    Serial.print(" 0x");
-    if (t < 16) {
-        Serial.print('0');
-    }
-    Serial.print(t, HEX);
-    Serial.print(" 0x");
-    if (c < 16) {
-        Serial.print('0');
-    }
-    Serial.print(c, HEX);
-    Serial.println(" (if FF FF FF check wiring / CS pin / power)");
-}
-
-Adafruit_FlashTransport_SPI flashTransport(kFlashCsPin, SPI);
-Adafruit_SPIFlash flashChip(&flashTransport);
+// Set by startUp(); the LittleFS callbacks below only run while it is valid.
+FlashBlockDevice* flashDev = nullptr;
 
 lfs_t littlefs;
 lfs_config lfsConfig;
+EraseAhead<(1UL << 24) / kLfsBlockSize> eraseAhead;
 lfs_file_t dataFile;
 lfs_file_t logFile;
 
@@ -106,8 +45,135 @@ bool fsMounted = false;
 bool dataFileOpen = false;
 bool logFileOpen = false;
 
+// Sequential export reader (spiFlash::openReader).
+lfs_file_t readerFile;
+bool readerOpen = false;
+
 char dataFileName[16] = {0};
 char logFileName[16] = {0};
+uint16_t dataFileIndex = 0;
+
+// Raw flight log region: the SPI_FLASH_RAW_LOG_SECTORS sectors after the LittleFS volume.
+uint32_t rawSectors = 0;
+
+// Header at the start of every raw page. The run starts at page 0 of the region and
+// sequence counts up by one per page, so an erased or stale page ends the run.
+struct __attribute__((packed)) RawPageHeader {
+    uint32_t magic;     // kRawPageMagic
+    uint32_t sequence;  // page index within the run
+    uint16_t session;   // DATA### index the records belong to
+    uint16_t length;    // payload bytes following the header
+    uint8_t consumed;   // 0xFF until copied into LittleFS; programmed to 0 afterwards (page 0 only)
+    uint8_t reserved[3];
+    uint32_t crc;       // CRC-32 of the bytes before `consumed`, then the payload
+};
+
+static constexpr uint32_t kRawPageMagic = 0x4C574152;  // "RAWL"
+static constexpr size_t kRawHeaderBytes = sizeof(RawPageHeader);
+static constexpr size_t kRawPayloadBytes = kLfsProgSize - kRawHeaderBytes;
+static constexpr uint32_t kPagesPerSector = kLfsBlockSize / kLfsProgSize;
+
+// Page programs are issued without waiting for WIP to clear; the next flash command waits for
+// the program and reads the page back to verify it. LittleFS reads each data page back right
+// after programming it, so its programs are always waited on and that read is the only one: a
+// failed program fails LittleFS's own compare and the block is relocated. Only raw log pages,
+// which nothing reads back, leave the chip programming while sensor traffic uses the SPI bus.
+struct PendingProgram {
+    bool active;
+    bool lfs;               // issued by lfsProgCb (failures are reported through lfsSyncCb)
+    bool failed;            // a LittleFS page LittleFS did not read back mismatched since the last lfsSyncCb
+    uint32_t address;
+    uint32_t len;
+    uint8_t data[kLfsProgSize];
+};
+
+PendingProgram pendingProgram = {};
+uint32_t programsIssued = 0;
+uint32_t programWaits = 0;
+uint32_t programVerifyErrors = 0;
+
+// Retire the page program in flight. With wait == false, returns false if it is still running.
+// readBack: the caller reads the page next and sees a failure itself, so it is not verified here.
+bool finishProgram(bool wait, bool readBack = false) {
+    if (!pendingProgram.active) {
+        return true;
+    }
+    if (flashDev->busy()) {
+        if (!wait) {
+            return false;
+        }
+        ++programWaits;
+        flashDev->waitReady();
+    }
+    pendingProgram.active = false;
+    if (readBack) {
+        return true;
+    }
+
+    uint8_t check[kLfsProgSize];
+    if (!flashDev->read(pendingProgram.address, check, pendingProgram.len) ||
+        memcmp(check, pendingProgram.data, pendingProgram.len) != 0) {
+        pendingProgram.failed = pendingProgram.failed || pendingProgram.lfs;
+        ++programVerifyErrors;
+    }
+    return true;
+}
+
+bool flashBusy() {
+    if (!finishProgram(false)) {
+        return true;
+    }
+    return flashDev->busy();
+}
+
+void flashWaitIdle() {
+    finishProgram(true);
+    flashDev->waitReady();
+}
+
+bool flashRead(uint32_t address, uint8_t* buffer, uint32_t len) {
+    const bool readBack = pendingProgram.active && address < pendingProgram.address + pendingProgram.len &&
+                          pendingProgram.address < address + len;
+    finishProgram(true, readBack);
+    return flashDev->read(address, buffer, len);
+}
+
+// Program up to the end of each 256-byte page; only the last page is left running on return.
+bool flashProgram(uint32_t address, const uint8_t* data, uint32_t len, bool lfs = false) {
+    while (len > 0) {
+        const uint32_t room = kLfsProgSize - (address % kLfsProgSize);
+        const uint32_t n = len < room ? len : room;
+
+        finishProgram(true);
+        if (!flashDev->startProgram(address, data, n)) {
+            return false;
+        }
+        pendingProgram.active = true;
+        pendingProgram.lfs = lfs;
+        pendingProgram.address = address;
+        pendingProgram.len = n;
+        memcpy(pendingProgram.data, data, n);
+        ++programsIssued;
+#if !SPI_FLASH_ASYNC_PROGRAM
+        finishProgram(true);
+#endif
+        address += n;
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+bool flashEraseSector(uint32_t sector) {
+    finishProgram(true);
+    return flashDev->eraseSector(sector);
+}
+
+// Issue a sector erase and return without waiting for it to finish.
+bool flashStartErase(uint32_t address) {
+    flashWaitIdle();
+    return flashDev->startErase(address);
+}
 
 int lfsReadCb(const struct lfs_config* c,
               lfs_block_t block,
@@ -115,7 +181,7 @@ int lfsReadCb(const struct lfs_config* c,
               void* buffer,
               lfs_size_t size) {
     const uint32_t address = static_cast<uint32_t>(block * c->block_size + off);
-    return flashChip.readBuffer(address, static_cast<uint8_t*>(buffer), size) ? 0 : LFS_ERR_IO;
+    return flashRead(address, static_cast<uint8_t*>(buffer), size) ? 0 : LFS_ERR_IO;
 }
 
 int lfsProgCb(const struct lfs_config* c,
@@ -124,21 +190,30 @@ int lfsProgCb(const struct lfs_config* c,
               const void* buffer,
               lfs_size_t size) {
     const uint32_t address = static_cast<uint32_t>(block * c->block_size + off);
-    return flashChip.writeBuffer(address, static_cast<const uint8_t*>(buffer), size) ? 0 : LFS_ERR_IO;
+    eraseAhead.noteProgram(block);
+    return flashProgram(address, static_cast<const uint8_t*>(buffer), size, true) ? 0 : LFS_ERR_IO;
 }
 
 int lfsEraseCb(const struct lfs_config* /*c*/, lfs_block_t block) {
+    // Already erased in the background and untouched since: nothing to do.
+    if (eraseAhead.takeBlank(block)) {
+        return 0;
+    }
     // LittleFS block size is 4096, so the LittleFS block number maps directly to a 4 KiB flash sector.
-    return flashChip.eraseSector(block) ? 0 : LFS_ERR_IO;
+    return flashEraseSector(block) ? 0 : LFS_ERR_IO;
 }
 
 int lfsSyncCb(const struct lfs_config* /*c*/) {
-    // Adafruit_SPIFlash operations are blocking; wait here for compatibility with LittleFS sync.
-    flashChip.waitUntilReady();
+    // LittleFS syncs before committing metadata: the last page must be on the media and verified.
+    flashWaitIdle();
+    if (pendingProgram.failed) {
+        pendingProgram.failed = false;
+        return LFS_ERR_CORRUPT;
+    }
     return 0;
 }
 
-void configureLittleFs() {
+void configureLittleFs(const SpiFlashFsProfile& profile, uint32_t rawLogSectors) {
     memset(&lfsConfig, 0, sizeof(lfsConfig));
 
     lfsConfig.read = lfsReadCb;
@@ -146,46 +221,60 @@ void configureLittleFs() {
     lfsConfig.erase = lfsEraseCb;
     lfsConfig.sync = lfsSyncCb;
 
-    lfsConfig.read_size = kLfsReadSize;
+    lfsConfig.read_size = profile.readSize;
     lfsConfig.prog_size = kLfsProgSize;
     lfsConfig.block_size = kLfsBlockSize;
-    lfsConfig.block_count = flashChip.size() / kLfsBlockSize;
-    lfsConfig.cache_size = kLfsCacheSize;
-    lfsConfig.lookahead_size = kLfsLookaheadSize;
-    lfsConfig.block_cycles = kLfsBlockCycles;
+    const uint32_t sectors = flashDev->size() / kLfsBlockSize;
+    // Never let the raw region take more than half the chip.
+    rawSectors = rawLogSectors <= sectors / 2 ? rawLogSectors : 0;
+    lfsConfig.block_count = sectors - rawSectors;
+    lfsConfig.cache_size = profile.cacheSize;
+    lfsConfig.lookahead_size = profile.lookaheadSize;
+    lfsConfig.block_cycles = profile.blockCycles;
+    lfsConfig.metadata_max = profile.metadataMax;
+    lfsConfig.inline_max = profile.inlineMax;
+    lfsConfig.compact_thresh = profile.compactThresh;
 
     lfsConfigured = true;
 }
 
-bool fileExists(const char* path) {
-    lfs_info info;
-    return lfs_stat(&littlefs, path, &info) == 0;
-}
+bool readRawHead(RawPageHeader* header);
 
-bool makeDataFileName(char* buffer, size_t bufferSize) {
-    for (uint16_t fileIndex = 0; fileIndex < 1000; ++fileIndex) {
-        const int n = snprintf(buffer, bufferSize, "DATA%03u.txt", fileIndex);
-        if (n < 0 || static_cast<size_t>(n) >= bufferSize) {
-            return false;
-        }
-        if (!fileExists(buffer)) {
-            return true;
+// One pass over the root directory picks both session names (one past the highest index in use).
+bool makeSessionFileNames() {
+    SessionIndex data("DATA", ".bin");
+    SessionIndex log("LOG", ".txt");
+
+    lfs_dir_t dir;
+    if (lfs_dir_open(&littlefs, &dir, "/") < 0) {
+        return false;
+    }
+    lfs_info info;
+    int err;
+    while ((err = lfs_dir_read(&littlefs, &dir, &info)) > 0) {
+        if (info.type == LFS_TYPE_REG) {
+            data.observe(info.name);
+            log.observe(info.name);
         }
     }
-    return false;
-}
+    lfs_dir_close(&littlefs, &dir);
+    if (err < 0) {
+        return false;
+    }
+    // A raw run still waiting for recovery keeps its session index even if its DATA file is gone,
+    // so the new session never shares it and recoverRawLog() always has a target of its own.
+    RawPageHeader head;
+    if (readRawHead(&head) && head.consumed == 0xFF) {
+        char pending[16];
+        snprintf(pending, sizeof(pending), "DATA%03u.bin", head.session);
+        data.observe(pending);
+    }
 
-bool makeLogFileName(char* buffer, size_t bufferSize) {
-    for (uint16_t fileIndex = 0; fileIndex < 1000; ++fileIndex) {
-        const int n = snprintf(buffer, bufferSize, "LOG%03u.txt", fileIndex);
-        if (n < 0 || static_cast<size_t>(n) >= bufferSize) {
-            return false;
-        }
-        if (!fileExists(buffer)) {
-            return true;
-        }
+    if (!data.format(dataFileName, sizeof(dataFileName)) || !log.format(logFileName, sizeof(logFileName))) {
+        return false;
     }
-    return false;
+    dataFileIndex = static_cast<uint16_t>(data.next());
+    return true;
 }
 
 bool globMatch(const char* pattern, const char* str) {
@@ -237,6 +326,10 @@ void printRootFiles() {
 }
 
 void closeOpenFiles() {
+    if (readerOpen) {
+        lfs_file_close(&littlefs, &readerFile);
+        readerOpen = false;
+    }
     if (logFileOpen) {
         lfs_file_close(&littlefs, &logFile);
         logFileOpen = false;
@@ -247,20 +340,123 @@ void closeOpenFiles() {
     }
 }
 
+uint32_t rawSectorAddress(uint32_t sector) { return (lfsConfig.block_count + sector) * kLfsBlockSize; }
+
+uint32_t rawPageAddress(uint32_t page) {
+    return rawSectorAddress(page / kPagesPerSector) + (page % kPagesPerSector) * kLfsProgSize;
+}
+
+uint32_t rawPageCrc(const RawPageHeader& header, const uint8_t* payload) {
+    const uint32_t crc = crc32(&header, offsetof(RawPageHeader, consumed));
+    return crc32Update(crc, payload, header.length);
+}
+
+bool rawPageValid(const RawPageHeader& header, const uint8_t* payload, uint16_t session, uint32_t sequence) {
+    return header.magic == kRawPageMagic && header.session == session && header.sequence == sequence &&
+           header.length <= kRawPayloadBytes && header.crc == rawPageCrc(header, payload);
+}
+
+bool eraseAheadBusy(void* /*user*/) { return flashBusy(); }
+
+bool eraseAheadStart(void* /*user*/, uint32_t block) { return flashStartErase(block * kLfsBlockSize); }
+
+bool eraseAheadRead(void* /*user*/, uint32_t block, uint32_t off, uint8_t* buf, uint32_t len) {
+    return flashRead(block * kLfsBlockSize + off, buf, len);
+}
+
+// Read page 0 of the raw region; true if it starts a valid run.
+bool readRawHead(RawPageHeader* header) {
+    uint8_t page[kLfsProgSize];
+    if (rawSectors == 0 || !flashRead(rawPageAddress(0), page, sizeof(page))) {
+        return false;
+    }
+    memcpy(header, page, kRawHeaderBytes);
+    return rawPageValid(*header, page + kRawHeaderBytes, header->session, 0);
+}
+
+// Append the raw run of a session to an open LittleFS file. Returns pages copied or negative on error.
+int32_t copyRawLog(lfs_file_t* file, uint16_t session) {
+    uint8_t page[kLfsProgSize];
+    RawPageHeader header;
+    uint32_t p = 0;
+    for (; p < rawSectors * kPagesPerSector; ++p) {
+        if (!flashRead(rawPageAddress(p), page, sizeof(page))) {
+            return -1;
+        }
+        memcpy(&header, page, kRawHeaderBytes);
+        if (!rawPageValid(header, page + kRawHeaderBytes, session, p)) {
+            break;
+        }
+        const lfs_ssize_t w = lfs_file_write(&littlefs, file, page + kRawHeaderBytes, header.length);
+        if (w != static_cast<lfs_ssize_t>(header.length)) {
+            return -2;
+        }
+    }
+    return static_cast<int32_t>(p);
+}
+
+// NOR programming only clears bits, so the flag can be written in place without an erase.
+bool markRawLogConsumed() {
+    const uint8_t consumed = 0;
+    return flashProgram(rawPageAddress(0) + offsetof(RawPageHeader, consumed), &consumed, 1);
+}
+
+// A run left behind by a reset mid-flight is appended to the DATA file of its own session.
+void recoverRawLog() {
+    RawPageHeader head;
+    if (!readRawHead(&head) || head.consumed != 0xFF) {
+        return;
+    }
+
+    char name[16];
+    snprintf(name, sizeof(name), "DATA%03u.bin", head.session);
+    lfs_file_t file;
+    if (lfs_file_open(&littlefs, &file, name, LFS_O_WRONLY | LFS_O_CREAT | LFS_O_APPEND) < 0) {
+        Serial.println("Raw flight log recovery: could not open target file");
+        return;
+    }
+    const int32_t pages = copyRawLog(&file, head.session);
+    const bool closed = lfs_file_close(&littlefs, &file) == 0;
+    if (pages < 0 || !closed) {
+        Serial.println("Raw flight log recovery failed; region left untouched");
+        return;
+    }
+    markRawLogConsumed();
+    Serial.print("Recovered ");
+    Serial.print(pages);
+    Serial.print(" raw flight log pages into ");
+    Serial.println(name);
+}
+
 }  // namespace
 
-spiFlash::spiFlash(const size_t buffer_size, const size_t k_buffer_size)
+spiFlash::spiFlash(FlashBlockDevice& device, const size_t buffer_size, const size_t k_buffer_size)
     : buffer_size(buffer_size),
       k_buffer_size(k_buffer_size),
       buffer_offset(0),
-      k_buffer_offset(0) {
+      tick_stats{},
+      k_buffer_offset(0),
+      data_sync(SyncPolicyConfig{SPI_FLASH_SYNC_EVERY_BYTES, SPI_FLASH_SYNC_EVERY_MS, SPI_FLASH_SYNC_ON_PHASE != 0}),
+      log_sync(SyncPolicyConfig{SPI_FLASH_LOG_SYNC_EVERY_BYTES, SPI_FLASH_LOG_SYNC_EVERY_MS, SPI_FLASH_SYNC_ON_PHASE != 0}),
+      raw_page{},
+      raw_fill(0),
+      raw_next_page(0),
+      raw_erased_sectors(0),
+      raw_erase_busy(false),
+      raw_erasing(false),
+      raw_active(false),
+      raw_stats{},
+      raw_log_sectors(SPI_FLASH_RAW_LOG_SECTORS),
+      pre_erase_enabled(false),
+      fs_profile(SpiFlashFsProfile::defaults()),
+      device(device) {
     obuff = new char[buffer_size];
     kbuff = new char[k_buffer_size];
 }
 
 spiFlash::~spiFlash() {
-    flush();
-    kflush();
+    rawLogEnd();
+    sync();
     closeOpenFiles();
     if (fsMounted) {
         lfs_unmount(&littlefs);
@@ -271,19 +467,19 @@ spiFlash::~spiFlash() {
 }
 
 bool spiFlash::startUp() {
-    // Pass explicit candidates: W25Q128JV-PM/IM (EF 70 18) is omitted from Adafruit's built-in list,
-    // which only includes W25Q128JV-SQ (EF 40 18).
-    Serial.println("Before SPI flash initialization:");
-    if (!flashChip.begin(kBlazeFlashCandidates,
-                         sizeof(kBlazeFlashCandidates) / sizeof(kBlazeFlashCandidates[0]))) {
-        Serial.println("Error, failed to initialize flash chip!");
-        logRawJedec(kFlashCsPin);
+    const uint32_t startMs = millis();
+
+    flashDev = &device;
+    pendingProgram = PendingProgram{};
+    if (!flashDev->begin()) {
         return false;
     }
-    Serial.print("Flash chip JEDEC ID: 0x");
-    Serial.println(flashChip.getJEDECID(), HEX);
 
-    configureLittleFs();
+    if (!fs_profile.valid()) {
+        Serial.println("Invalid SPI flash LittleFS profile (check SPI_FLASH_LFS_* build flags)");
+        return false;
+    }
+    configureLittleFs(fs_profile, raw_log_sectors);
 
     if (!mountfs()) {
         Serial.println("Error, failed to mount LittleFS on SPI flash!");
@@ -313,14 +509,12 @@ bool spiFlash::startUp() {
         Serial.println("Mounted LittleFS filesystem.");
     }
 
-    if (!makeDataFileName(dataFileName, sizeof(dataFileName))) {
-        Serial.println("Failed to allocate SPI flash data file name");
-        return false;
-    }
-    if (!makeLogFileName(logFileName, sizeof(logFileName))) {
-        Serial.println("Failed to allocate SPI flash log file name");
+    const uint32_t scanStart = micros();
+    if (!makeSessionFileNames()) {
+        Serial.println("Failed to allocate SPI flash session file names");
         return false;
     }
+    const uint32_t scanUs = micros() - scanStart;
 
     closeOpenFiles();
 
@@ -342,7 +536,16 @@ bool spiFlash::startUp() {
     }
     logFileOpen = true;
 
-    delay(500);
+    recoverRawLog();
+
+    // Fill the allocator's lookahead window now so pre-erase has blocks to work on before the first write.
+    // lfs_fs_gc() also compacts metadata pairs when the profile allows it, which would cost every boot;
+    // then the window is left to the first allocation instead.
+    eraseAhead.begin(EraseAheadDevice{nullptr, eraseAheadBusy, eraseAheadStart, eraseAheadRead},
+                     lfsConfig.block_count, kLfsBlockSize, SPI_FLASH_PRE_ERASE_BLOCKS);
+    if (fs_profile.compactThresh >= kLfsBlockSize - kLfsProgSize) {
+        lfs_fs_gc(&littlefs);
+    }
 
     printRootFiles();
 
@@ -352,11 +555,15 @@ bool spiFlash::startUp() {
     Serial.print("SPI flash log file: ");
     Serial.println(logFileName);
 
+    Serial.print("SPI flash startup: ");
+    Serial.print(millis() - startMs);
+    Serial.print(" ms (session name scan ");
+    Serial.print(scanUs);
+    Serial.println(" us)");
+
     return true;
 }
 
-uint8_t spiFlash::getCS_PIN() { return kFlashCsPin; }
-
 ssize_t spiFlash::read(const size_t offset, const size_t bytes, char* buffer) {
     if (bytes == 0) {
         return 0;
@@ -381,17 +588,28 @@ ssize_t spiFlash::read(const size_t offset, const size_t bytes, char* buffer) {
 }
 
 int spiFlash::queue(size_t bytes, const char* data, char priority) {
+    LatencyHistogram::Scope timer(latency_hist.queue, micros);
     if (bytes == 0) {
         return 0;
     }
-    if (data == nullptr) {
+    if (data == nullptr || priority < P_MANDATORY || priority > P_OPTIONAL) {
         return -1;
     }
-    std::vector<char> copy(data, data + bytes);
-    queuedos.push(std::make_tuple(priority, std::move(copy)));
+    if (!queuedos.push(static_cast<uint8_t>(priority), data, bytes)) {
+        return -2;
+    }
     return 0;
 }
 
+uint32_t spiFlash::queueDropped() const { return queuedos.droppedCount(); }
+
+size_t spiFlash::queueHighWater(char priority) const {
+    if (priority < P_MANDATORY || priority > P_OPTIONAL) {
+        return 0;
+    }
+    return queuedos.highWater(static_cast<uint8_t>(priority));
+}
+
 int spiFlash::buffer(const size_t bytes, const char* data) {
     if (bytes == 0) {
         return 0;
@@ -440,6 +658,7 @@ ssize_t spiFlash::write(const size_t bytes, const char* data) {
     if (w < 0 || static_cast<size_t>(w) != bytes) {
         return -1;
     }
+    data_sync.noteWritten(bytes, millis());
     return static_cast<ssize_t>(w);
 }
 
@@ -458,10 +677,15 @@ ssize_t spiFlash::kwrite(const size_t bytes, const char* data) {
     if (w < 0 || static_cast<size_t>(w) != bytes) {
         return -1;
     }
+    log_sync.noteWritten(bytes, millis());
     return static_cast<ssize_t>(w);
 }
 
 int spiFlash::flush(void) {
+    LatencyHistogram::Scope timer(latency_hist.flush, micros);
+    if (raw_active) {
+        return rawProgramPage() < 0 ? -1 : 0;
+    }
     if (buffer_offset == 0) {
         return 0;
     }
@@ -470,13 +694,12 @@ int spiFlash::flush(void) {
         return -1;
     }
 
-    const int syncErr = lfs_file_sync(&littlefs, &dataFile);
-    if (syncErr < 0) {
-        return -2;
-    }
-
     memset(obuff, 0, buffer_size);
     buffer_offset = 0;
+
+    if (data_sync.due(millis()) && syncData() < 0) {
+        return -2;
+    }
     return 0;
 }
 
@@ -514,6 +737,7 @@ ssize_t spiFlash::kLog(const size_t bytes, const char* data) {
 }
 
 int spiFlash::kflush(void) {
+    LatencyHistogram::Scope timer(latency_hist.kflush, micros);
     if (k_buffer_offset == 0) {
         return 0;
     }
@@ -522,18 +746,135 @@ int spiFlash::kflush(void) {
         return -1;
     }
 
-    const int syncErr = lfs_file_sync(&littlefs, &logFile);
-    if (syncErr < 0) {
+    memset(kbuff, 0, k_buffer_size);
+    k_buffer_offset = 0;
+
+    if (log_sync.due(millis()) && syncLog() < 0) {
         return -2;
     }
+    return 0;
+}
 
-    memset(kbuff, 0, k_buffer_size);
-    k_buffer_offset = 0;
+int spiFlash::syncData() {
+    if (!fsMounted || !dataFileOpen) {
+        return -1;
+    }
+    if (lfs_file_sync(&littlefs, &dataFile) < 0) {
+        return -2;
+    }
+    data_sync.markSynced();
     return 0;
 }
 
+int spiFlash::syncLog() {
+    if (!fsMounted || !logFileOpen) {
+        return -1;
+    }
+    if (lfs_file_sync(&littlefs, &logFile) < 0) {
+        return -2;
+    }
+    log_sync.markSynced();
+    return 0;
+}
+
+int spiFlash::sync() {
+    int fe = flush();
+    if (fe < 0) {
+        return fe;
+    }
+    fe = kflush();
+    if (fe < 0) {
+        return fe;
+    }
+    if (data_sync.dirty() && syncData() < 0) {
+        return -2;
+    }
+    if (log_sync.dirty() && syncLog() < 0) {
+        return -2;
+    }
+    return 0;
+}
+
+int spiFlash::onPhaseChange(bool landed) {
+    // Commit RAM-buffered bytes too, so the file is complete up to the transition.
+    if (landed || data_sync.config().onPhaseChange || log_sync.config().onPhaseChange) {
+        int fe = flush();
+        if (fe < 0) {
+            return fe;
+        }
+        fe = kflush();
+        if (fe < 0) {
+            return fe;
+        }
+    }
+    if (data_sync.dueOnPhaseChange(landed) && syncData() < 0) {
+        return -2;
+    }
+    if (log_sync.dueOnPhaseChange(landed) && syncLog() < 0) {
+        return -2;
+    }
+    return 0;
+}
+
+int spiFlash::syncIfDue() {
+    const uint32_t now = millis();
+    if (data_sync.due(now) && syncData() < 0) {
+        return -2;
+    }
+    if (log_sync.due(now) && syncLog() < 0) {
+        return -2;
+    }
+    return 0;
+}
+
+bool SpiFlashFsProfile::valid() const {
+    const uint32_t kDisabled = 0xFFFFFFFFu;
+    const uint32_t metaBytes = metadataMax != 0 ? metadataMax : kLfsBlockSize;
+    return readSize != 0 && cacheSize != 0 && cacheSize % readSize == 0 && cacheSize % kLfsProgSize == 0 &&
+           kLfsBlockSize % cacheSize == 0 && lookaheadSize != 0 && blockCycles != 0 &&
+           (compactThresh == 0 || compactThresh == kDisabled ||
+            (compactThresh >= kLfsBlockSize / 2 && compactThresh <= kLfsBlockSize)) &&
+           (metadataMax == 0 || (metadataMax % readSize == 0 && metadataMax % kLfsProgSize == 0 &&
+                                 kLfsBlockSize % metadataMax == 0)) &&
+           (inlineMax == kDisabled ||
+            (inlineMax <= cacheSize && inlineMax <= kLfsAttrMax && inlineMax <= metaBytes / 8));
+}
+
+bool spiFlash::setFsProfile(const SpiFlashFsProfile& profile) {
+    if (fsMounted || !profile.valid()) {
+        return false;
+    }
+    fs_profile = profile;
+    lfsConfigured = false;
+    return true;
+}
+
+const SpiFlashFsProfile& spiFlash::fsProfile() const { return fs_profile; }
+
+bool spiFlash::setRawLogSectors(uint32_t sectors) {
+    if (fsMounted) {
+        return false;
+    }
+    raw_log_sectors = sectors;
+    return true;
+}
+
+void spiFlash::setSyncPolicy(const SyncPolicyConfig& data, const SyncPolicyConfig& log) {
+    data_sync.configure(data);
+    log_sync.configure(log);
+}
+
+uint32_t spiFlash::syncCount() const { return data_sync.syncCount() + log_sync.syncCount(); }
+
 ssize_t spiFlash::tick(void) {
-    if (queuedos.empty()) {
+    LatencyHistogram::Scope timer(latency_hist.tick, micros);
+    serviceFlash();
+
+    uint8_t cls = 0;
+    const char* payload = nullptr;
+    size_t payloadBytes = 0;
+
+    if (!queuedos.peek(&cls, &payload, &payloadBytes)) {
         return 0;
     }
 
@@ -541,15 +882,16 @@ ssize_t spiFlash::tick(void) {
 
     // Drain every P_MANDATORY entry currently in the queue (all priority 0),
     // then flush once so mandatory work hits the media together.
-    while (!queuedos.empty() && std::get<0>(queuedos.top()) == P_MANDATORY) {
-        std::tuple<char, std::vector<char>> item = queuedos.top();
-        queuedos.pop();
-        const std::vector<char>& payload = std::get<1>(item);
-        int e = buffer(payload.size(), payload.data());
+    while (cls == P_MANDATORY) {
+        int e = bufferRecord(payloadBytes, payload);
         if (e < 0) {
             return static_cast<ssize_t>(e);
         }
-        total += static_cast<ssize_t>(payload.size());
+        queuedos.pop(cls);
+        total += static_cast<ssize_t>(payloadBytes);
+        if (!queuedos.peek(&cls, &payload, &payloadBytes)) {
+            break;
+        }
     }
 
     if (total > 0) {
@@ -557,25 +899,323 @@ ssize_t spiFlash::tick(void) {
         if (fe < 0) {
             return static_cast<ssize_t>(fe);
         }
+        if (data_sync.dirty() && syncData() < 0) {
+            return -2;
+        }
         return total;
     }
 
     // Otherwise process a single highest-priority (non-mandatory top) item.
-    std::tuple<char, std::vector<char>> item = queuedos.top();
-    queuedos.pop();
-    const std::vector<char>& payload = std::get<1>(item);
-    int e = buffer(payload.size(), payload.data());
+    int e = bufferRecord(payloadBytes, payload);
     if (e < 0) {
         return static_cast<ssize_t>(e);
     }
-    return static_cast<ssize_t>(payload.size());
+    queuedos.pop(cls);
+    if (syncIfDue() < 0) {
+        return -2;
+    }
+    return static_cast<ssize_t>(payloadBytes);
+}
+
+ssize_t spiFlash::tick(uint32_t budgetUs) {
+    LatencyHistogram::Scope timer(latency_hist.tick, micros);
+    const uint32_t start = micros();
+    serviceFlash();
+
+    uint8_t cls = 0;
+    const char* payload = nullptr;
+    size_t payloadBytes = 0;
+    ssize_t total = 0;
+    uint32_t records = 0;
+    bool mandatory = false;
+
+    while (queuedos.peek(&cls, &payload, &payloadBytes)) {
+        // Mandatory entries are never deferred by the budget.
+        if (cls != P_MANDATORY && records > 0 && static_cast<uint32_t>(micros() - start) >= budgetUs) {
+            break;
+        }
+        int e = bufferRecord(payloadBytes, payload);
+        if (e < 0) {
+            return static_cast<ssize_t>(e);
+        }
+        queuedos.pop(cls);
+        total += static_cast<ssize_t>(payloadBytes);
+        ++records;
+
+        if (cls == P_MANDATORY) {
+            mandatory = true;
+            continue;
+        }
+        // A raw page was programmed, or a LittleFS page is ready.
+        if (e > 0 || buffer_offset >= kLfsProgSize) {
+            break;
+        }
+    }
+
+    if (mandatory) {
+        int fe = flush();
+        if (fe < 0) {
+            return static_cast<ssize_t>(fe);
+        }
+        if (data_sync.dirty() && syncData() < 0) {
+            return -2;
+        }
+    } else if (buffer_offset >= kLfsProgSize) {
+        int we = writeFullPages();
+        if (we < 0) {
+            return static_cast<ssize_t>(we);
+        }
+    }
+    // Runs even when the queue is empty so time-based syncs still happen.
+    if (syncIfDue() < 0) {
+        return -2;
+    }
+
+    const uint32_t elapsed = micros() - start;
+    tick_stats.bytes = static_cast<uint32_t>(total);
+    tick_stats.records = records;
+    tick_stats.elapsedUs = elapsed;
+    if (tick_stats.bytes > tick_stats.maxBytes) {
+        tick_stats.maxBytes = tick_stats.bytes;
+    }
+    if (elapsed > tick_stats.maxElapsedUs) {
+        tick_stats.maxElapsedUs = elapsed;
+    }
+    ++tick_stats.ticks;
+    tick_stats.programs = programsIssued;
+    tick_stats.programWaits = programWaits;
+    tick_stats.verifyErrors = programVerifyErrors;
+    return total;
+}
+
+const SpiFlashTickStats& spiFlash::tickStats() const { return tick_stats; }
+
+const SpiFlashLatency& spiFlash::latency() const { return latency_hist; }
+
+void spiFlash::resetLatency() {
+    latency_hist.queue.reset();
+    latency_hist.tick.reset();
+    latency_hist.flush.reset();
+    latency_hist.kflush.reset();
+}
+
+void spiFlash::resetTickStats() {
+    memset(&tick_stats, 0, sizeof(tick_stats));
+    programsIssued = 0;
+    programWaits = 0;
+    programVerifyErrors = 0;
+}
+
+int spiFlash::writeFullPages() {
+    const size_t pageBytes = buffer_offset - (buffer_offset % kLfsProgSize);
+    if (pageBytes == 0) {
+        return 0;
+    }
+    if (write(pageBytes, obuff) < 0) {
+        return -1;
+    }
+    memmove(obuff, obuff + pageBytes, buffer_offset - pageBytes);
+    buffer_offset -= pageBytes;
+    tick_stats.pagesWritten += static_cast<uint32_t>(pageBytes / kLfsProgSize);
+    return 0;
+}
+
+int spiFlash::bufferRecord(const size_t bytes, const char* data) {
+    return raw_active ? rawAppend(bytes, data) : buffer(bytes, data);
+}
+
+bool spiFlash::rawLogAvailable() const { return rawSectors > 0 && fsMounted; }
+
+int spiFlash::rawLogArm() {
+    if (!rawLogAvailable()) {
+        return -1;
+    }
+    if (raw_active) {
+        return 0;
+    }
+    // Never erase a run that has not reached LittleFS yet.
+    RawPageHeader head;
+    if (readRawHead(&head) && head.consumed == 0xFF) {
+        return -2;
+    }
+    if (raw_erase_busy) {
+        flashWaitIdle();
+        raw_erase_busy = false;
+    }
+    raw_erased_sectors = 0;
+    raw_erasing = true;
+    raw_stats.sectorsErased = 0;
+    raw_stats.blockingErases = 0;
+    return 0;
 }
 
-bool spiFlash::cmp_io_priority::operator()(const std::tuple<char, std::vector<char>>& l,
-                                           const std::tuple<char, std::vector<char>>& r) const {
-    return std::get<0>(l) > std::get<0>(r);
+int spiFlash::rawLogBegin() {
+    if (raw_active) {
+        return 0;
+    }
+    if (!raw_erasing) {
+        // Not armed (or arming refused): erase on demand, or stay on LittleFS if refused again.
+        const int e = rawLogArm();
+        if (e < 0) {
+            return e;
+        }
+    }
+    // Everything buffered before launch goes to LittleFS first so the data file stays in order.
+    if (flush() < 0) {
+        return -3;
+    }
+    raw_fill = 0;
+    raw_next_page = 0;
+    raw_stats.pagesWritten = 0;
+    raw_stats.droppedBytes = 0;
+    raw_active = true;
+    return 0;
 }
 
+int spiFlash::rawLogEnd() {
+    raw_erasing = false;
+    if (raw_erase_busy) {
+        flashWaitIdle();
+        raw_erase_busy = false;
+        ++raw_erased_sectors;
+        ++raw_stats.sectorsErased;
+    }
+    if (!raw_active) {
+        return 0;
+    }
+
+    const int pe = rawProgramPage();
+    raw_active = false;
+    if (pe < 0) {
+        return pe;
+    }
+    if (raw_next_page == 0) {
+        return 0;
+    }
+    if (!fsMounted || !dataFileOpen) {
+        return -1;
+    }
+
+    const int32_t pages = copyRawLog(&dataFile, dataFileIndex);
+    if (pages < 0) {
+        return -2;
+    }
+    data_sync.noteWritten(static_cast<size_t>(pages) * kRawPayloadBytes, millis());
+    if (syncData() < 0) {
+        return -2;
+    }
+    raw_stats.pagesConverted = static_cast<uint32_t>(pages);
+    return markRawLogConsumed() ? 0 : -3;
+}
+
+const SpiFlashRawLogStats& spiFlash::rawLogStats() const { return raw_stats; }
+
+int spiFlash::rawAppend(const size_t bytes, const char* data) {
+    if (bytes == 0) {
+        return 0;
+    }
+    if (data == nullptr) {
+        return -1;
+    }
+
+    int pages = 0;
+    size_t offset = 0;
+    while (offset < bytes) {
+        const size_t n = std::min(bytes - offset, kRawPayloadBytes - raw_fill);
+        memcpy(raw_page + kRawHeaderBytes + raw_fill, data + offset, n);
+        raw_fill += n;
+        offset += n;
+        if (raw_fill == kRawPayloadBytes) {
+            const int e = rawProgramPage();
+            if (e < 0) {
+                return e;
+            }
+            pages += e;
+        }
+    }
+    return pages;
+}
+
+int spiFlash::rawProgramPage() {
+    if (raw_fill == 0) {
+        return 0;
+    }
+    if (raw_next_page >= rawSectors * kPagesPerSector) {
+        raw_stats.droppedBytes += static_cast<uint32_t>(raw_fill);
+        raw_fill = 0;
+        return 0;
+    }
+    if (rawEnsureErased(raw_next_page / kPagesPerSector) < 0) {
+        return -1;
+    }
+
+    RawPageHeader header;
+    memset(&header, 0xFF, sizeof(header));
+    header.magic = kRawPageMagic;
+    header.sequence = raw_next_page;
+    header.session = dataFileIndex;
+    header.length = static_cast<uint16_t>(raw_fill);
+    header.crc = rawPageCrc(header, raw_page + kRawHeaderBytes);
+    memcpy(raw_page, &header, kRawHeaderBytes);
+
+    const uint32_t len = static_cast<uint32_t>(kRawHeaderBytes + raw_fill);
+    if (!flashProgram(rawPageAddress(raw_next_page), raw_page, len)) {
+        return -1;
+    }
+    ++raw_next_page;
+    ++raw_stats.pagesWritten;
+    raw_fill = 0;
+    return 1;
+}
+
+int spiFlash::rawEnsureErased(uint32_t sector) {
+    while (raw_erased_sectors <= sector) {
+        if (raw_erase_busy) {
+            flashWaitIdle();
+            raw_erase_busy = false;
+        } else if (!flashEraseSector(lfsConfig.block_count + raw_erased_sectors)) {
+            return -1;
+        }
+        ++raw_erased_sectors;
+        ++raw_stats.sectorsErased;
+        ++raw_stats.blockingErases;
+    }
+    return 0;
+}
+
+void spiFlash::rawLogService() {
+    if (!raw_erasing) {
+        return;
+    }
+    if (raw_erase_busy) {
+        if (flashBusy()) {
+            return;
+        }
+        raw_erase_busy = false;
+        ++raw_erased_sectors;
+        ++raw_stats.sectorsErased;
+    }
+    if (raw_erased_sectors >= rawSectors) {
+        raw_erasing = false;
+        return;
+    }
+    raw_erase_busy = flashStartErase(rawSectorAddress(raw_erased_sectors));
+}
+
+void spiFlash::serviceFlash() {
+    // Retire a finished page program here rather than in front of the next flash command.
+    finishProgram(false);
+    if (raw_erasing) {
+        rawLogService();
+    } else if (pre_erase_enabled && fsMounted) {
+        eraseAhead.step(&littlefs);
+    }
+}
+
+void spiFlash::setPreEraseEnabled(bool enabled) { pre_erase_enabled = enabled; }
+
+const EraseAheadStats& spiFlash::preEraseStats() const { return eraseAhead.stats(); }
+
 bool spiFlash::exportRootFiles(const SpiFlashExportCallbacks* callbacks) {
     return exportRootFilesMatching(callbacks, nullptr);
 }
@@ -589,12 +1229,8 @@ bool spiFlash::exportRootFilesMatching(const SpiFlashExportCallbacks* callbacks,
         return false;
     }
 
-    int fe = flush();
-    if (fe < 0) {
-        return false;
-    }
-    fe = kflush();
-    if (fe < 0) {
+    // Readers open their own handles, which only see synced data.
+    if (sync() < 0) {
         return false;
     }
 
@@ -664,6 +1300,61 @@ bool spiFlash::exportRootFilesMatching(const SpiFlashExportCallbacks* callbacks,
     return err >= 0;
 }
 
+int spiFlash::forEachRootFile(const char* pattern, bool (*fn)(void* user, const char* name, uint32_t size),
+                              void* user) {
+    if (fn == nullptr || !fsMounted) {
+        return -1;
+    }
+    // Readers open their own handles, which only see synced data.
+    if (sync() < 0) {
+        return -1;
+    }
+
+    lfs_dir_t root;
+    if (lfs_dir_open(&littlefs, &root, "/") < 0) {
+        return -1;
+    }
+    const bool filter = (pattern != nullptr && pattern[0] != '\0');
+    int visited = 0;
+    lfs_info info;
+    int err;
+    while ((err = lfs_dir_read(&littlefs, &root, &info)) > 0) {
+        if (info.type != LFS_TYPE_REG || (filter && !globMatch(pattern, info.name))) {
+            continue;
+        }
+        if (!fn(user, info.name, info.size)) {
+            err = -1;
+            break;
+        }
+        ++visited;
+    }
+    lfs_dir_close(&littlefs, &root);
+    return err < 0 ? -1 : visited;
+}
+
+bool spiFlash::openReader(const char* name) {
+    if (name == nullptr || !fsMounted || readerOpen) {
+        return false;
+    }
+    readerOpen = lfs_file_open(&littlefs, &readerFile, name, LFS_O_RDONLY) == 0;
+    return readerOpen;
+}
+
+ssize_t spiFlash::readReader(void* buf, size_t len) {
+    if (!readerOpen || buf == nullptr) {
+        return -1;
+    }
+    const lfs_ssize_t n = lfs_file_read(&littlefs, &readerFile, buf, static_cast<lfs_size_t>(len));
+    return n < 0 ? -1 : static_cast<ssize_t>(n);
+}
+
+void spiFlash::closeReader() {
+    if (readerOpen) {
+        lfs_file_close(&littlefs, &readerFile);
+        readerOpen = false;
+    }
+}
+
 bool spiFlash::removeFile(const char* path) {
     if (path == nullptr || path[0] == '\0' || !fsMounted) {
         return false;
@@ -692,12 +1383,7 @@ int spiFlash::removeFilesMatching(const char* pattern) {
         return -1;
     }
 
-    int fe = flush();
-    if (fe < 0) {
-        return -1;
-    }
-    fe = kflush();
-    if (fe < 0) {
+    if (sync() < 0) {
         return -1;
     }
 
@@ -738,8 +1424,11 @@ bool spiFlash::mountfs() {
     if (fsMounted) {
         return true;
     }
+    if (flashDev == nullptr) {
+        return false;
+    }
     if (!lfsConfigured) {
-        configureLittleFs();
+        configureLittleFs(fs_profile, raw_log_sectors);
     }
     const int err = lfs_mount(&littlefs, &lfsConfig);
     if (err < 0) {
@@ -757,8 +1446,7 @@ void spiFlash::unmountfs() {
         return;
     }
 
-    flush();
-    kflush();
+    sync();
     closeOpenFiles();
     lfs_unmount(&littlefs);
     fsMounted = false;
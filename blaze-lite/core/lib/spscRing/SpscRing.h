@@ -0,0 +1,82 @@
+/**
+ * @file SpscRing.h
+ * @brief Lock-free single-producer/single-consumer ring of fixed-size items
+ *
+ * One side (e.g. an ISR) only calls push(); the other (the main loop) only calls pop() or
+ * popBatch(). Head and tail are free-running 32-bit counters, each written by one side only,
+ * so neither side ever disables interrupts or takes a lock. Push never blocks: when the ring
+ * is full the new item is dropped and counted in overflows().
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+
+/**
+ * @class SpscRing
+ * @brief kCapacity items of T (power of two); T must be trivially copyable
+ */
+template <typename T, uint32_t kCapacity>
+class SpscRing {
+public:
+    static_assert(kCapacity >= 2 && (kCapacity & (kCapacity - 1)) == 0, "capacity must be a power of two");
+
+    SpscRing() : _head(0), _tail(0), _overflows(0) {}
+
+    /**
+     * @brief Producer side: copy item into the ring
+     * @return false if the ring was full (item dropped, overflow counted)
+     */
+    bool push(const T& item) {
+        const uint32_t tail = _tail.load(std::memory_order_relaxed);
+        if (tail - _head.load(std::memory_order_acquire) >= kCapacity) {
+            _overflows.store(_overflows.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return false;
+        }
+        _items[tail & kMask] = item;
+        _tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Consumer side: take the oldest item
+     * @return false if the ring is empty
+     */
+    bool pop(T* out) { return popBatch(out, 1) == 1; }
+
+    /**
+     * @brief Consumer side: take up to maxItems of the oldest items in order
+     * @return Number of items copied to out
+     */
+    size_t popBatch(T* out, size_t maxItems) {
+        const uint32_t head = _head.load(std::memory_order_relaxed);
+        uint32_t n = _tail.load(std::memory_order_acquire) - head;
+        if (n > maxItems) {
+            n = static_cast<uint32_t>(maxItems);
+        }
+        for (uint32_t i = 0; i < n; ++i) {
+            out[i] = _items[(head + i) & kMask];
+        }
+        _head.store(head + n, std::memory_order_release);
+        return n;
+    }
+
+    /** Items waiting (exact on the consumer side, a lower bound on the producer side). */
+    uint32_t size() const { return _tail.load(std::memory_order_acquire) - _head.load(std::memory_order_acquire); }
+    bool empty() const { return size() == 0; }
+    static constexpr uint32_t capacity() { return kCapacity; }
+
+    /** Items dropped by push() because the ring was full. Written by the producer only. */
+    uint32_t overflows() const { return _overflows.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr uint32_t kMask = kCapacity - 1;
+
+    T _items[kCapacity];
+    std::atomic<uint32_t> _head;       ///< next item to pop (consumer writes)
+    std::atomic<uint32_t> _tail;       ///< next free slot (producer writes)
+    std::atomic<uint32_t> _overflows;  ///< producer writes
+};
@@ -0,0 +1,90 @@
+/**
+ * @file SyncPolicy.h
+ * @brief Decides when an open LittleFS file should be committed with lfs_file_sync()
+ *
+ * Every sync commits file metadata and may compact a metadata pair, which costs milliseconds
+ * on SPI NOR. The policy batches syncs by byte count and elapsed time; the owner forces one
+ * on flight-phase changes (optional) and always on LANDED. After a power cut the file is
+ * recoverable up to the last sync, so the thresholds bound how much data can be lost.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @struct SyncPolicyConfig
+ * @brief Sync thresholds; a zero threshold is disabled
+ */
+struct SyncPolicyConfig {
+    uint32_t everyBytes;  ///< Sync once this many bytes were written since the last sync (1 = every write)
+    uint32_t everyMs;     ///< Sync once the oldest unsynced write is this old (ms)
+    bool onPhaseChange;   ///< Sync when the flight phase changes (LANDED always syncs)
+};
+
+/**
+ * @class SyncPolicy
+ * @brief Tracks unsynced bytes for one file and reports when a sync is due
+ */
+class SyncPolicy {
+public:
+    /** @brief Previous behaviour: sync after every write */
+    static SyncPolicyConfig everyWrite() { return SyncPolicyConfig{1, 0, true}; }
+
+    SyncPolicy() : _cfg(everyWrite()), _pendingBytes(0), _dirtySinceMs(0), _syncs(0) {}
+
+    explicit SyncPolicy(const SyncPolicyConfig& cfg) : _cfg(cfg), _pendingBytes(0), _dirtySinceMs(0), _syncs(0) {}
+
+    void configure(const SyncPolicyConfig& cfg) { _cfg = cfg; }
+
+    const SyncPolicyConfig& config() const { return _cfg; }
+
+    /**
+     * @brief Record bytes handed to lfs_file_write()
+     * @param bytes Bytes written
+     * @param nowMs Current time (ms)
+     */
+    void noteWritten(size_t bytes, uint32_t nowMs) {
+        if (bytes == 0) {
+            return;
+        }
+        if (_pendingBytes == 0) {
+            _dirtySinceMs = nowMs;
+        }
+        _pendingBytes += static_cast<uint32_t>(bytes);
+    }
+
+    /** @brief True if unsynced bytes exist and a byte or time threshold was reached */
+    bool due(uint32_t nowMs) const {
+        if (_pendingBytes == 0) {
+            return false;
+        }
+        if (_cfg.everyBytes != 0 && _pendingBytes >= _cfg.everyBytes) {
+            return true;
+        }
+        return _cfg.everyMs != 0 && static_cast<uint32_t>(nowMs - _dirtySinceMs) >= _cfg.everyMs;
+    }
+
+    /** @brief True if a phase change should commit this file */
+    bool dueOnPhaseChange(bool landed) const { return _pendingBytes != 0 && (landed || _cfg.onPhaseChange); }
+
+    /** @brief Call after a successful lfs_file_sync() */
+    void markSynced() {
+        _pendingBytes = 0;
+        ++_syncs;
+    }
+
+    bool dirty() const { return _pendingBytes != 0; }
+
+    uint32_t pendingBytes() const { return _pendingBytes; }
+
+    /** @brief Syncs performed since construction */
+    uint32_t syncCount() const { return _syncs; }
+
+private:
+    SyncPolicyConfig _cfg;
+    uint32_t _pendingBytes;
+    uint32_t _dirtySinceMs;
+    uint32_t _syncs;
+};
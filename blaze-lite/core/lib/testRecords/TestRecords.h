@@ -0,0 +1,35 @@
+/**
+ * @file TestRecords.h
+ * @brief Deterministic fixed-size log records shared by the host storage tests
+ *
+ * The records are 24 bytes, the size of a FlightRecord. That does not divide a 256-byte flash
+ * page or a 512-byte SD sector, so records straddle both. Each byte is derived from the
+ * record index (and, optionally, the session), so a read-back can be checked byte for byte
+ * without keeping a copy of what was written.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// Size of one test record in bytes.
+constexpr size_t kTestRecordBytes = 24;
+
+/// spiFlash::tick() budget per loop pass used by the tests, as in the main loop.
+constexpr uint32_t kTestTickBudgetUs = 1500;
+
+/**
+ * @brief Fill @p out with record @p index of session @p session
+ * @param out Buffer of kTestRecordBytes bytes
+ */
+inline void makeTestRecord(uint32_t session, uint32_t index, char* out) {
+    for (size_t i = 0; i < kTestRecordBytes; ++i) {
+        out[i] = static_cast<char>((session * 101u + index * 37u + i * 11u) & 0xFF);
+    }
+}
+
+/// Record @p index of session 0.
+inline void makeTestRecord(uint32_t index, char* out) {
+    makeTestRecord(0, index, out);
+}
@@ -16,18 +16,24 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
+#include <math.h>
 
 // Hardware libraries
 #include "KX134Accelerometer.h"
+#include "KX134Sampler.h"
 #include "Radio.h"
 #include "sdCard.h"
 #include "spiFlash.h"
+#include "AdafruitFlashDevice.h"
 #include "dataPacket.h"
+#include "FlightRecord.h"
 
 // System libraries
 #include "SensorData.h"
 #include "FlightState.h"
 #include "Baro.h"
+#include "AltitudeFilter.h"
+#include "SampleClock.h"
 
 // ============================================================================
 // Pin Definitions
@@ -64,18 +70,34 @@ Baro barometer(BARO_CS_PIN);
 
 // Sensors
 KX134Accelerometer accelerometer;
+KX134Sampler accelSampler(accelerometer);
+bool accelInterruptActive = false;  // false: samples are polled from loop()
+SampleClock accelClock;             // KX134 edge times extended past the 71.6 min micros() wrap
 
 // Communication
 Radio radio(RADIO_CS_PIN, RADIO_INT_PIN, RADIO_RST_PIN);
 
 // Storage
 sdCard card(SD_CS_PIN);
-spiFlash spiFlashMem;
+AdafruitFlashDevice spiFlashDevice(SPI_FLASH_CS_PIN);
+spiFlash spiFlashMem(spiFlashDevice);
 bool spiFlashReady = false;
 
 // Data structures
 SensorData sensorData;
 FlightStateMachine stateMachine;
+AltitudeFilter altitudeFilter;  // baro + axial accel -> altitude/velocity/acceleration
+
+// Barometer samples waiting for the accelerometer samples taken before them (applyPendingBaro()).
+// At the driver's default OSR (0.6 ms conversions, one temperature per 4 pressures) the MS5611
+// yields a sample every 0.75 ms, so 32 cover one KX134 burst (KX134_BURST_MS) plus loop latency.
+struct PendingBaro {
+    uint32_t timestampUs;
+    float altitude;
+};
+static constexpr size_t PENDING_BARO_MAX = 32;
+PendingBaro pendingBaro[PENDING_BARO_MAX];
+size_t pendingBaroCount = 0;
 
 // Data packet formatters for different sensor types
 DataPacket accelPacket(StartByte::NO_RESPONSE);      // High-G Accelerometer
@@ -87,6 +109,12 @@ static constexpr uint32_t RADIO_FREQUENCY = 433;  // 433 MHz
 static constexpr uint32_t SENSOR_READ_INTERVAL = 20;    // ms (50 Hz)
 static constexpr uint32_t RADIO_TX_INTERVAL = 100;      // ms (10 Hz)
 static constexpr uint32_t RADIO_RX_INTERVAL = 20;       // ms (20 Hz)
+static constexpr uint32_t SPI_FLASH_TICK_BUDGET_US = 1500;  // per-loop time for draining the flash queue
+static constexpr uint32_t BARO_MAX_HOLD_US = 100000;  // feed a held baro sample anyway if the KX134 stalls
+// The KX134 runs at the flight rate from ARMED on; on the pad only every Nth sample is logged,
+// so waiting ARMED costs storage at the ground rate (KX134 ODR codes double the rate per step).
+static_assert(KX134_FLIGHT_ODR >= KX134_GROUND_ODR, "flight ODR below ground ODR");
+static constexpr uint32_t ARMED_LOG_DIVIDER = 1u << (KX134_FLIGHT_ODR - KX134_GROUND_ODR);
 
 uint32_t lastSensorRead = 0;
 uint32_t lastRadioTx = 0;
@@ -98,6 +126,11 @@ uint32_t dataSequenceNumber = 0;
 // ============================================================================
 
 void readSensors();
+void pollBarometer();
+void applyPendingBaro(uint32_t untilUs);
+void kx134DataReadyIsr();
+void recordSensorSample(const AccelSample* sample);
+void publishAltitudeEstimate();
 void updateStateMachine();
 void handleRadio();
 bool formatAccelerometerPayload(uint8_t* payload);
@@ -106,11 +139,19 @@ bool formatStatusPayload(uint8_t* payload);
 void parseRadioCommand(const DecodedPacket& decoded);
 void writeLogEntry();
 void writeSystemLog(const char* format, ...);
+void notifyStoragePhaseChange(FlightPhase phase);
+void applySensorPhase(FlightPhase phase);
 void printReceivedPacket(const uint8_t* buffer, size_t length, const DecodedPacket* decoded);
 void handleSerialCommands();
 void processSerialLine(char* line);
 void serialDumpSpiFlashAll(const char* pattern);
 void serialDeleteSpiFlashFile(const char* filename);
+void serialPrintSpiFlashTickStats();
+void serialPrintSdWriteStats();
+void serialPrintAccelStats();
+void serialBenchAccelPath();
+void serialPrintStorageLatency();
+void logStorageLatency();
 // ============================================================================
 // Setup
 // ============================================================================
@@ -167,8 +208,10 @@ void setup() {
     delay(2000);
 
     // Initialize SD Card
+    const uint32_t storageStartMs = millis();
     Serial.println("Initializing SD card...");
     card.startUp();
+    const uint32_t sdDoneMs = millis();
 
     Serial.println("Initializing SPI flash...");
     spiFlashReady = spiFlashMem.startUp();
@@ -176,7 +219,13 @@ void setup() {
         Serial.println("SPI flash unavailable (logging to SD only)");
     } else {
         Serial.println("SPI flash initialized successfully");
+        spiFlashMem.setPreEraseEnabled(true);  // on the pad: UNARMED
     }
+    Serial.print("Storage init: SD ");
+    Serial.print(sdDoneMs - storageStartMs);
+    Serial.print(" ms, SPI flash ");
+    Serial.print(millis() - sdDoneMs);
+    Serial.println(" ms");
     
     // Initialize Radio
     Serial.println("Initializing radio...");
@@ -199,7 +248,11 @@ void setup() {
         delay(50);
         accelerometer.enableDataEngine(true);
         accelerometer.setRange(SFE_KX134_RANGE64G);
-        accelerometer.enable(true);
+        // Pad rate, one data-ready interrupt per sample; ARMED switches to buffered bursts.
+        if (!accelSampler.configure(KX134_GROUND_ODR, 0)) {
+            writeSystemLog("[%lu] ERROR: KX134 rate/interrupt setup failed\r\n", millis());
+            accelerometer.enable(true);
+        }
     }
 
     if (barometer.init() == true)
@@ -221,10 +274,13 @@ void setup() {
     initSensorData(&sensorData);
 
     stateMachine.setPhase(FlightPhase::UNARMED);
+
+    // Attach last: the ISR reads the KX134 over SPI, so the bus must no longer be in setup use.
+    accelInterruptActive = accelSampler.begin(KX134_INT1_PIN, kx134DataReadyIsr);
         
     Serial.println("=== System Ready ===");
     Serial.println("Waiting for ARM command...");
-    Serial.println("Serial: flash dump [pattern] | flash rm <pattern> | flash help");
+    Serial.println("Serial: flash dump [pattern] | flash rm <pattern> | flash export [folder] | flash help");
 }
 
 // ============================================================================
@@ -232,12 +288,15 @@ void setup() {
 // ============================================================================
 
 void loop() {
+    // Each SD, flash, radio or barometer transfer holds the bus (BusLock) only while it runs; a
+    // KX134 data-ready edge in the meantime queues its timestamp and readSensors() reads it.
     handleSerialCommands();
     updateStateMachine();       // Flight logic
-    readSensors();              // All sensor polling (includes logging)
+    readSensors();              // Drain accelerometer samples (includes logging)
     handleRadio();              // Uplink/downlink
     if (spiFlashReady) {
-        spiFlashMem.tick();
+        KX134Sampler::BusLock bus(accelSampler);
+        spiFlashMem.tick(SPI_FLASH_TICK_BUDGET_US);
     }
 }
 
@@ -245,35 +304,109 @@ void loop() {
 // Sensor Reading
 // ============================================================================
 
+void kx134DataReadyIsr() {
+    accelSampler.onDataReady();
+}
+
+void pollBarometer() {
+    KX134Sampler::BusLock bus(accelSampler);
+    // Starts/collects MS5611 conversions without waiting for them.
+    if (!barometer.isReady() || !barometer.tick()) {
+        return;
+    }
+    sensorData.baro.pressure = barometer.getPressure();
+    sensorData.baro.temperature = barometer.getTemperature();
+    sensorData.baro.altitude = barometer.getAltitudeAgl();
+    sensorData.baro.valid = true;
+    sensorData.baro.timestamp = millis();
+    // Stamped when the conversion finished. The KX134 may still hold samples taken before that,
+    // so the filter gets it once the accelerometer stream has caught up (applyPendingBaro()).
+    if (pendingBaroCount == PENDING_BARO_MAX) {
+        applyPendingBaro(pendingBaro[0].timestampUs);
+    }
+    pendingBaro[pendingBaroCount++] = PendingBaro{barometer.getSampleUs(), sensorData.baro.altitude};
+    if (!accelerometer.isReady()) {
+        applyPendingBaro(micros());
+    }
+}
+
+/**
+ * Feed the held barometer samples stamped at or before untilUs to the altitude filter, oldest
+ * first. Called with each accelerometer sample's time before that sample is applied, so the
+ * filter sees measurements in time order: predictTo() ignores anything older than the last one.
+ */
+void applyPendingBaro(uint32_t untilUs) {
+    size_t n = 0;
+    while (n < pendingBaroCount && static_cast<int32_t>(untilUs - pendingBaro[n].timestampUs) >= 0) {
+        altitudeFilter.updateAltitude(pendingBaro[n].timestampUs, pendingBaro[n].altitude);
+        ++n;
+    }
+    if (n == 0) {
+        return;
+    }
+    memmove(pendingBaro, pendingBaro + n, (pendingBaroCount - n) * sizeof(PendingBaro));
+    pendingBaroCount -= n;
+    publishAltitudeEstimate();
+}
+
 void readSensors() {
-    uint32_t currentTime = millis();
-    
-    // Throttle sensor reads to avoid overwhelming the system
-    if (currentTime - lastSensorRead < SENSOR_READ_INTERVAL) {
+    if (!accelerometer.isReady()) {
+        pollBarometer();
+        // No accelerometer samples to pace logging: keep barometer records at the old rate.
+        const uint32_t currentTime = millis();
+        if (currentTime - lastSensorRead >= SENSOR_READ_INTERVAL) {
+            lastSensorRead = currentTime;
+            recordSensorSample(nullptr);
+        }
         return;
     }
-    lastSensorRead = currentTime;
-    
+    if (accelInterruptActive) {
+        accelSampler.service();  // samples whose edges came while the bus was held
+    } else {
+        accelSampler.poll();
+    }
+
+    // One record per accelerometer sample, in order, however long loop() was blocked.
+    AccelSample batch[8];
+    size_t n;
+    while ((n = accelSampler.consume(batch, sizeof(batch) / sizeof(batch[0]))) > 0) {
+        for (size_t i = 0; i < n; ++i) {
+            recordSensorSample(&batch[i]);
+        }
+    }
+
+    pollBarometer();
+    applyPendingBaro(micros() - BARO_MAX_HOLD_US);
+}
+
+void recordSensorSample(const AccelSample* sample) {
+    const uint32_t currentTime = sample != nullptr ? static_cast<uint32_t>(accelClock.update(sample->timestampUs) / 1000)
+                                                   : millis();
+
     sensorData.systemTimestamp = currentTime;
     sensorData.sequenceNumber = dataSequenceNumber++;
     
-    // Read Accelerometer (KX134)
-    if (accelerometer.dataReady()) {
-        outputData accelData;
-        if (accelerometer.getAccelData(&accelData)) {
-            sensorData.accel.x = accelData.xData;
-            sensorData.accel.y = accelData.yData;
-            sensorData.accel.z = accelData.zData;
-            sensorData.accel.magnitude = calculateAccelMagnitude(
-                accelData.xData, accelData.yData, accelData.zData);
-            sensorData.accel.valid = true;
-            sensorData.accel.timestamp = currentTime;
-        } else {
-            sensorData.accel.valid = false;
-        }
+    // Accelerometer (KX134) raw counts as taken at the data-ready edge. Everything downstream
+    // works on counts (RawAccel.h); g is only computed for display.
+    if (sample != nullptr) {
+        sensorData.accel.raw[0] = sample->raw[0];
+        sensorData.accel.raw[1] = sample->raw[1];
+        sensorData.accel.raw[2] = sample->raw[2];
+        sensorData.accel.range = accelerometer.getRange();
+        sensorData.accel.magnitudeSq = rawAccelMagnitudeSq(sample->raw);
+        sensorData.accel.valid = true;
+        sensorData.accel.timestamp = currentTime;
+        sensorData.accel.timestampUs = sample->timestampUs;
+
+        // Axial specific force minus 1g is the vertical acceleration while the rocket points up.
+        const float axialG = KX134_AXIAL_SIGN * rawAccelToG(sample->raw[KX134_AXIAL_AXIS], sensorData.accel.range);
+        applyPendingBaro(sample->timestampUs);
+        altitudeFilter.updateAcceleration(sample->timestampUs, (axialG - 1.0f) * ALT_FILTER_G0);
     } else {
         sensorData.accel.valid = false;
+        altitudeFilter.predictTo(micros());
     }
+    publishAltitudeEstimate();
     
     // TODO: Read Gyroscope (LSM9DS1 or similar)
     // sensorData.gyro.valid = false;  // Placeholder
@@ -281,17 +414,8 @@ void readSensors() {
     // TODO: Read Magnetometer (LSM9DS1 or similar)
     // sensorData.mag.valid = false;  // Placeholder
     
-    // Read Barometer (MS5611)
-    if (barometer.isReady()) {
-        barometer.read();
-        sensorData.baro.pressure = barometer.getPressure();
-        sensorData.baro.temperature = barometer.getTemperature();
-        sensorData.baro.altitude = barometer.getAltitude();
-        sensorData.baro.valid = true;
-        sensorData.baro.timestamp = currentTime;
-    } else {
-        sensorData.baro.valid = false;
-    }
+    // Barometer fields hold the latest non-blocking MS5611 sample (pollBarometer()); its own
+    // timestamp says how fresh it is.
 
     //printSensorData(sensorData);
     
@@ -299,17 +423,35 @@ void readSensors() {
     writeLogEntry();
 }
 
+void publishAltitudeEstimate() {
+    sensorData.estimate.altitude = altitudeFilter.altitude();
+    sensorData.estimate.velocity = altitudeFilter.velocity();
+    sensorData.estimate.acceleration = altitudeFilter.acceleration();
+    sensorData.estimate.valid = sensorData.baro.valid;  // altitude is unanchored until the first baro sample
+}
+
 // ============================================================================
 // State Machine Update
 // ============================================================================
 
 void updateStateMachine() {
-    // Get current sensor data for state machine
-    float altitude = sensorData.baro.valid ? sensorData.baro.altitude : 0.0f;
-    float acceleration = sensorData.accel.valid ? sensorData.accel.magnitude : 0.0f;
+    // Filtered altitude/velocity once the barometer has anchored the estimate; before that the
+    // state machine differences whatever altitude it gets (NAN velocity).
+    const bool fused = sensorData.estimate.valid;
+    float altitude = fused ? sensorData.estimate.altitude : (sensorData.baro.valid ? sensorData.baro.altitude : 0.0f);
+    float velocity = fused ? sensorData.estimate.velocity : NAN;
+    float acceleration = fused ? sensorData.estimate.acceleration : NAN;
+    uint32_t accelMagnitudeSq = sensorData.accel.valid ? sensorData.accel.magnitudeSq : 0;
+    // Detection windows run on sample time: the data-ready edge of the newest KX134 sample.
+    const uint32_t sampleUs = sensorData.accel.valid ? sensorData.accel.timestampUs : micros();
     
     // Update state machine
-    bool stateChanged = stateMachine.update(altitude, acceleration);
+    const bool wasPredicted = stateMachine.getState().apogeePredicted;
+    bool stateChanged = stateMachine.update(sampleUs, altitude, accelMagnitudeSq, sensorData.accel.range, velocity,
+                                            acceleration);
+    if (!wasPredicted && stateMachine.getState().apogeePredicted) {
+        writeSystemLog("[%lu] EVENT: PREDICTED APOGEE (%.2f m)\r\n", millis(), stateMachine.getState().predictedApogee);
+    }
     
     // Handle state changes
     if (stateChanged) {
@@ -341,11 +483,14 @@ void updateStateMachine() {
                 break;
             case FlightPhase::LANDED:
                 writeSystemLog("[%lu] STATE: LANDED (time: %lu)\r\n", millis(), state.landedTime);
+                logStorageLatency();
                 break;
             case FlightPhase::ERROR:
                 writeSystemLog("[%lu] ERROR: %s\r\n", millis(), state.errorMessage);
                 break;
         }
+        notifyStoragePhaseChange(state.phase);
+        applySensorPhase(state.phase);
     }
     
     // Check for ARM command (could be from radio or button)
@@ -365,6 +510,7 @@ void handleRadio() {
         lastRadioRx = currentTime;
         
         // Check for incoming radio messages (uplink)
+        KX134Sampler::BusLock bus(accelSampler);
         if (radio.available()) {
             uint8_t rxBuffer[64];
             size_t received = radio.recv(rxBuffer, sizeof(rxBuffer));
@@ -404,6 +550,7 @@ void handleRadio() {
     // According to protocol: send sensor-specific packets
     if (state.radioFlag && (currentTime - lastRadioTx >= RADIO_TX_INTERVAL)) {
         lastRadioTx = currentTime;
+        KX134Sampler::BusLock bus(accelSampler);
         
         // Send High-G Accelerometer data (ID: "al")
         if (sensorData.accel.valid) {
@@ -460,47 +607,47 @@ void writeLogEntry() {
     if (!state.loggingEnabled) {
         return;
     }
+    // Launch detection still sees every sample; the log keeps the ground rate until LAUNCH.
+    if (state.phase == FlightPhase::ARMED && sensorData.accel.valid &&
+        sensorData.sequenceNumber % ARMED_LOG_DIVIDER != 0) {
+        return;
+    }
     
-    float accelX = sensorData.accel.valid ? sensorData.accel.x : 0.0f;
-    float accelY = sensorData.accel.valid ? sensorData.accel.y : 0.0f;
-    float accelZ = sensorData.accel.valid ? sensorData.accel.z : 0.0f;
-    float accelMag = sensorData.accel.valid ? sensorData.accel.magnitude : 0.0f;
-    float baroAlt = sensorData.baro.valid ? sensorData.baro.altitude : 0.0f;
-
-    char accelXStr[16];
-    char accelYStr[16];
-    char accelZStr[16];
-    char accelMagStr[16];
-    char baroAltStr[16];
-
-    dtostrf(accelX, 0, 3, accelXStr);
-    dtostrf(accelY, 0, 3, accelYStr);
-    dtostrf(accelZ, 0, 3, accelZStr);
-    dtostrf(accelMag, 0, 3, accelMagStr);
-    dtostrf(baroAlt, 0, 2, baroAltStr);
-
-    // Format data for logging
-    char logBuffer[256];
-    snprintf(logBuffer, sizeof(logBuffer),
-        "%lu,%u,%s,%s,%s,%s,%s,%u\r\n",
-        sensorData.systemTimestamp,
-        sensorData.sequenceNumber,
-        accelXStr,
-        accelYStr,
-        accelZStr,
-        accelMagStr,
-        baroAltStr,
-        static_cast<uint8_t>(state.phase)
-    );
-    
+    // Packed binary record (see FlightRecord.h); tools/flight_decode converts it back to CSV.
+    FlightRecord record;
+    record.flags = static_cast<uint8_t>((sensorData.accel.range << FLIGHT_RECORD_RANGE_SHIFT) & FLIGHT_RECORD_RANGE_MASK);
+    record.timestampMs = sensorData.systemTimestamp;
+    record.sequence = sensorData.sequenceNumber;
+    if (sensorData.accel.valid) {
+        record.flags |= FLIGHT_RECORD_ACCEL_VALID;
+        record.accelRaw[0] = sensorData.accel.raw[0];
+        record.accelRaw[1] = sensorData.accel.raw[1];
+        record.accelRaw[2] = sensorData.accel.raw[2];
+    } else {
+        record.accelRaw[0] = 0;
+        record.accelRaw[1] = 0;
+        record.accelRaw[2] = 0;
+    }
+    if (sensorData.baro.valid) {
+        record.flags |= FLIGHT_RECORD_BARO_VALID;
+        record.temperatureCentiC = static_cast<int16_t>(lroundf(sensorData.baro.temperature * 100.0f));
+        record.pressureDeciPa = static_cast<int32_t>(lroundf(sensorData.baro.pressure * 1000.0f));
+    } else {
+        record.temperatureCentiC = 0;
+        record.pressureDeciPa = 0;
+    }
+    flightRecordSeal(record, static_cast<uint8_t>(state.phase));
+    const char* recordBytes = reinterpret_cast<const char*>(&record);
+
     // Write to SD card
-    ssize_t written = card.writeData(strlen(logBuffer), logBuffer);
+    KX134Sampler::BusLock bus(accelSampler);
+    ssize_t written = card.writeData(sizeof(record), recordBytes);
     if (written < 0) {
         writeSystemLog("[%lu] ERROR: SD data write failed\r\n", millis());
     }
 
     if (spiFlashReady) {
-        if (spiFlashMem.queue(strlen(logBuffer), logBuffer, spiFlash::P_STD) < 0) {
+        if (spiFlashMem.queue(sizeof(record), recordBytes, spiFlash::P_STD) < 0) {
             Serial.println("SPI flash queue failed");
         }
     }
@@ -524,6 +671,7 @@ void writeSystemLog(const char* format, ...) {
     Serial.print(message);
     
     // Write to log file using writeLog method
+    KX134Sampler::BusLock bus(accelSampler);
     ssize_t written = card.writeLog(message, strlen(message));
     if (written < 0) {
         // If log write fails, at least try to print to Serial
@@ -539,6 +687,75 @@ void writeSystemLog(const char* format, ...) {
     }
 }
 
+/**
+ * Sensor settings per phase. The barometer averages the pad reference only while UNARMED/ARMED.
+ * KX134 at KX134_FLIGHT_ODR, drained from its on-chip buffer in bursts, from ARMED until
+ * LANDED; KX134_GROUND_ODR with one data-ready interrupt per sample otherwise. Switching at ARMED
+ * keeps the reconfiguration (sensor disabled, buffer cleared) off the launch transient;
+ * writeLogEntry() logs only every ARMED_LOG_DIVIDER-th sample until LAUNCH.
+ */
+void applySensorPhase(FlightPhase phase) {
+    barometer.setPadCalibration(phase == FlightPhase::UNARMED || phase == FlightPhase::ARMED);
+    // Axial acceleration is vertical only while the rocket points up; from apogee on the baro flies alone.
+    altitudeFilter.setAccelerationFused(phase != FlightPhase::APOGEE && phase != FlightPhase::DESCENT &&
+                                        phase != FlightPhase::LANDED);
+    if (!accelerometer.isReady()) {
+        return;
+    }
+    const bool flight = phase == FlightPhase::ARMED || phase == FlightPhase::LAUNCH || phase == FlightPhase::APOGEE ||
+                        phase == FlightPhase::DESCENT;
+    const uint8_t watermark = flight ? KX134Sampler::watermarkFor(KX134_FLIGHT_ODR, KX134_BURST_MS) : 0;
+    if (watermark == accelSampler.watermark()) {
+        return;
+    }
+    if (!accelSampler.configure(flight ? KX134_FLIGHT_ODR : KX134_GROUND_ODR, watermark)) {
+        writeSystemLog("[%lu] ERROR: KX134 rate change failed\r\n", millis());
+    }
+}
+
+/**
+ * Let the storage sinks commit buffered data at a flight-phase boundary.
+ * LANDED always forces everything to the media. When the raw flight log is enabled,
+ * ARMED starts pre-erasing it, LAUNCH switches data records to it and LANDED/DISARM
+ * copies it back into the LittleFS data file.
+ */
+void notifyStoragePhaseChange(FlightPhase phase) {
+    KX134Sampler::BusLock bus(accelSampler);
+    if (card.onPhaseChange(phase == FlightPhase::LANDED) < 0) {
+        Serial.println("SD flush failed");
+    }
+    if (!spiFlashReady) {
+        return;
+    }
+    // Background erases may hold the chip busy for tens of ms; keep them off the flight.
+    spiFlashMem.setPreEraseEnabled(phase == FlightPhase::UNARMED || phase == FlightPhase::ARMED ||
+                                   phase == FlightPhase::LANDED);
+    if (spiFlashMem.rawLogAvailable()) {
+        int err = 0;
+        switch (phase) {
+            case FlightPhase::ARMED:
+                err = spiFlashMem.rawLogArm();
+                break;
+            case FlightPhase::LAUNCH:
+                err = spiFlashMem.rawLogBegin();
+                break;
+            case FlightPhase::LANDED:
+            case FlightPhase::UNARMED:
+                err = spiFlashMem.rawLogEnd();
+                break;
+            default:
+                break;
+        }
+        if (err < 0) {
+            Serial.print("SPI flash raw log error ");
+            Serial.println(err);
+        }
+    }
+    if (spiFlashMem.onPhaseChange(phase == FlightPhase::LANDED) < 0) {
+        Serial.println("SPI flash sync failed");
+    }
+}
+
 /**
  * Print received packet details to Serial.
  * Includes raw bytes and decoded fields when available.
@@ -600,15 +817,12 @@ bool formatAccelerometerPayload(uint8_t* payload) {
         return false;
     }
 
-    float accelXVal = sensorData.accel.valid ? sensorData.accel.x : 0.0f;
-    float accelYVal = sensorData.accel.valid ? sensorData.accel.y : 0.0f;
-    float accelZVal = sensorData.accel.valid ? sensorData.accel.z : 0.0f;
-
-    // Convert accelerometer values to integers (multiply by 1000 for precision)
+    // Accelerometer counts to integer milli-g (no float on this path)
     // Then format as ASCII strings with leading zeros
-    int32_t accelX = (int32_t)(accelXVal * 1000.0f);
-    int32_t accelY = (int32_t)(accelYVal * 1000.0f);
-    int32_t accelZ = (int32_t)(accelZVal * 1000.0f);
+    const bool valid = sensorData.accel.valid;
+    int32_t accelX = valid ? rawAccelMilliG(sensorData.accel.raw[0], sensorData.accel.range) : 0;
+    int32_t accelY = valid ? rawAccelMilliG(sensorData.accel.raw[1], sensorData.accel.range) : 0;
+    int32_t accelZ = valid ? rawAccelMilliG(sensorData.accel.raw[2], sensorData.accel.range) : 0;
     
     // Format: X(5 digits) + Y(6 digits) + Z(6 digits) = 17 bytes
     // Using format: "XXXXXYYYYYYZZZZZZ"
@@ -710,9 +924,13 @@ void parseRadioCommand(const DecodedPacket& decoded) {
         if (decoded.payload[0] == '1' || decoded.payload[0] == 1) {
             writeSystemLog("[%lu] CMD: ARM command executed\r\n", millis());
             stateMachine.setPhase(FlightPhase::ARMED);
+            notifyStoragePhaseChange(FlightPhase::ARMED);
+            applySensorPhase(FlightPhase::ARMED);
         } else if (decoded.payload[0] == '0' || decoded.payload[0] == 0) {
             writeSystemLog("[%lu] CMD: DISARM command executed\r\n", millis());
             stateMachine.setPhase(FlightPhase::UNARMED);
+            notifyStoragePhaseChange(FlightPhase::UNARMED);
+            applySensorPhase(FlightPhase::UNARMED);
         }
         
     } else if (idA == 'p' && idB == 'r') {
@@ -819,6 +1037,31 @@ void processSerialLine(char* line) {
         return;
     }
 
+    if (strcmp(line, "stats") == 0) {
+        serialPrintStorageLatency();
+        return;
+    }
+    if (strcmp(line, "stats reset") == 0) {
+        card.resetLatency();
+        spiFlashMem.resetLatency();
+        Serial.println("Storage latency histograms cleared.");
+        return;
+    }
+
+    if (strcmp(line, "accel stats") == 0) {
+        serialPrintAccelStats();
+        return;
+    }
+    if (strcmp(line, "accel bench") == 0) {
+        serialBenchAccelPath();
+        return;
+    }
+
+    if (strcmp(line, "sd stats") == 0) {
+        serialPrintSdWriteStats();
+        return;
+    }
+
     if (strncmp(line, "flash ", 6) != 0) {
         return;
     }
@@ -827,11 +1070,24 @@ void processSerialLine(char* line) {
     while (*rest == ' ' || *rest == '\t') {
         ++rest;
     }
+    // Dump, export and delete talk to flash and SD card.
+    KX134Sampler::BusLock bus(accelSampler);
 
     if (strncmp(rest, "help", 4) == 0 && (rest[4] == '\0' || rest[4] == ' ' || rest[4] == '\t')) {
         Serial.println("SPI flash commands (root filenames only; * and ? wildcards):");
         Serial.println("  flash dump [pat] — dump files (omit pattern = all), e.g. flash dump DATA*");
-        Serial.println("  flash rm <pat>   — delete matching files, e.g. flash rm DATA*.txt");
+        Serial.println("  flash rm <pat>   — delete matching files, e.g. flash rm DATA*.bin");
+        Serial.println("  flash export [d] — copy all files to SD folder d (default flash), verify CRC32, resume");
+        Serial.println("  flash tick       — queue drain and pre-erase stats, then reset tick stats");
+        Serial.println("  sd stats         — worst SD writeData latency and flush counts, then reset");
+        Serial.println("  accel stats      — KX134 samples, bursts, deferred behind the SPI bus and lost");
+        Serial.println("  accel bench      — CPU cycles per sample, float g + sqrtf vs raw counts^2 path");
+        Serial.println("  stats [reset]    — latency histograms of every storage call (us, log2 buckets)");
+        return;
+    }
+
+    if (strncmp(rest, "tick", 4) == 0 && (rest[4] == '\0' || rest[4] == ' ' || rest[4] == '\t')) {
+        serialPrintSpiFlashTickStats();
         return;
     }
 
@@ -844,6 +1100,17 @@ void processSerialLine(char* line) {
         return;
     }
 
+    if (strncmp(rest, "export", 6) == 0 && (rest[6] == '\0' || rest[6] == ' ' || rest[6] == '\t')) {
+        const char* folder = rest + 6;
+        while (*folder == ' ' || *folder == '\t') {
+            ++folder;
+        }
+        if (!card.exportSpiFlashRootTo(spiFlashMem, folder[0] != '\0' ? folder : "flash")) {
+            Serial.println("SPI flash export incomplete; run it again to resume.");
+        }
+        return;
+    }
+
     if (strncmp(rest, "rm ", 3) == 0) {
         const char* name = rest + 3;
         while (*name == ' ' || *name == '\t') {
@@ -898,6 +1165,182 @@ void serialDumpSpiFlashAll(const char* pattern) {
     }
 }
 
+void serialPrintSpiFlashTickStats() {
+    if (!spiFlashReady) {
+        Serial.println("SPI flash not initialized.");
+        return;
+    }
+
+    const SpiFlashTickStats& st = spiFlashMem.tickStats();
+    Serial.print("SPI flash tick (budget ");
+    Serial.print(SPI_FLASH_TICK_BUDGET_US);
+    Serial.print(" us): ticks=");
+    Serial.print(st.ticks);
+    Serial.print(" last=");
+    Serial.print(st.bytes);
+    Serial.print(" B/");
+    Serial.print(st.records);
+    Serial.print(" rec/");
+    Serial.print(st.elapsedUs);
+    Serial.print(" us max=");
+    Serial.print(st.maxBytes);
+    Serial.print(" B/");
+    Serial.print(st.maxElapsedUs);
+    Serial.print(" us pages=");
+    Serial.print(st.pagesWritten);
+    Serial.print(" programs=");
+    Serial.print(st.programs);
+    Serial.print(" waits=");
+    Serial.print(st.programWaits);
+    Serial.print(" verifyErr=");
+    Serial.print(st.verifyErrors);
+    Serial.print(" dropped=");
+    Serial.println(spiFlashMem.queueDropped());
+    spiFlashMem.resetTickStats();
+
+    const EraseAheadStats& pre = spiFlashMem.preEraseStats();
+    Serial.print("SPI flash pre-erase: erased=");
+    Serial.print(pre.erased);
+    Serial.print(" foundBlank=");
+    Serial.print(pre.foundBlank);
+    Serial.print(" hits=");
+    Serial.print(pre.hits);
+    Serial.print(" misses=");
+    Serial.println(pre.misses);
+
+    if (spiFlashMem.rawLogAvailable()) {
+        const SpiFlashRawLogStats& raw = spiFlashMem.rawLogStats();
+        Serial.print("SPI flash raw log: pages=");
+        Serial.print(raw.pagesWritten);
+        Serial.print(" erased=");
+        Serial.print(raw.sectorsErased);
+        Serial.print(" blockingErases=");
+        Serial.print(raw.blockingErases);
+        Serial.print(" droppedBytes=");
+        Serial.print(raw.droppedBytes);
+        Serial.print(" converted=");
+        Serial.println(raw.pagesConverted);
+    }
+}
+
+/** Visit every storage latency histogram with its report name. */
+template <typename Fn>
+void forEachStorageLatency(Fn fn) {
+    fn("sd.writeData", card.latency().writeData);
+    fn("sd.writeLog", card.latency().writeLog);
+    if (spiFlashReady) {
+        const SpiFlashLatency& flash = spiFlashMem.latency();
+        fn("flash.queue", flash.queue);
+        fn("flash.tick", flash.tick);
+        fn("flash.flush", flash.flush);
+        fn("flash.kflush", flash.kflush);
+    }
+}
+
+void serialPrintStorageLatency() {
+    forEachStorageLatency([](const char* name, const LatencyHistogram& hist) {
+        char line[200];
+        hist.format(line, sizeof(line), name);
+        Serial.println(line);
+    });
+}
+
+/** Copy the histograms into the system log so a slow card shows up in the flight files. */
+void logStorageLatency() {
+    forEachStorageLatency([](const char* name, const LatencyHistogram& hist) {
+        char line[200];
+        hist.format(line, sizeof(line), name);
+        writeSystemLog("[%lu] LATENCY: %s\r\n", millis(), line);
+    });
+}
+
+void serialPrintSdWriteStats() {
+    const SdCardWriteStats& st = card.writeStats();
+    Serial.print("SD writeData: calls=");
+    Serial.print(st.calls);
+    Serial.print(" last=");
+    Serial.print(st.lastUs);
+    Serial.print(" us max=");
+    Serial.print(st.maxUs);
+    Serial.print(" us writes=");
+    Serial.print(st.sectorWrites);
+    Serial.print(" flushes=");
+    Serial.print(st.flushes);
+    Serial.print(" maxFlush=");
+    Serial.print(st.maxFlushUs);
+    Serial.println(" us");
+    card.resetWriteStats();
+}
+
+void serialPrintAccelStats() {
+    const KX134SamplerStats st = accelSampler.stats();
+    Serial.print(accelInterruptActive ? "KX134 (data-ready IRQ): samples=" : "KX134 (polled): samples=");
+    Serial.print(st.samples);
+    Serial.print(" deferred=");
+    Serial.print(st.deferred);
+    Serial.print(" lost=");
+    Serial.print(st.lost);
+    Serial.print(" readErrors=");
+    Serial.print(st.readErrors);
+    Serial.print(" ringOverflows=");
+    Serial.print(st.ringOverflows);
+    Serial.print(" bursts=");
+    Serial.print(st.bursts);
+    Serial.print(" maxBurst=");
+    Serial.println(st.maxBurst);
+}
+
+/**
+ * Cycles per sample for the old float path (scale to g, sqrtf, threshold, *1000 for telemetry)
+ * and the raw path (counts^2 against a squared threshold, integer milli-g), on synthetic samples.
+ */
+void serialBenchAccelPath() {
+#if defined(DWT) && defined(CoreDebug)
+    static constexpr size_t kSamples = 256;
+    static int16_t raw[kSamples][3];
+    uint32_t seed = 12345;
+    for (size_t i = 0; i < kSamples; ++i) {
+        for (int axis = 0; axis < 3; ++axis) {
+            seed = seed * 1664525u + 1013904223u;
+            raw[i][axis] = static_cast<int16_t>((seed >> 16) % 20000) - 10000;
+        }
+    }
+    const uint8_t range = SFE_KX134_RANGE64G;
+    const float scale = flightRecordAccelScale(range);
+    const uint32_t launchSq = rawAccelThresholdSq(2.0f, range);
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    volatile uint32_t sink = 0;
+
+    noInterrupts();
+    uint32_t start = DWT->CYCCNT;
+    for (size_t i = 0; i < kSamples; ++i) {
+        const float x = raw[i][0] * scale;
+        const float y = raw[i][1] * scale;
+        const float z = raw[i][2] * scale;
+        sink = sink + (calculateAccelMagnitude(x, y, z) > 2.0f) + static_cast<uint32_t>(static_cast<int32_t>(x * 1000.0f));
+    }
+    const uint32_t floatCycles = DWT->CYCCNT - start;
+    start = DWT->CYCCNT;
+    for (size_t i = 0; i < kSamples; ++i) {
+        sink = sink + (rawAccelMagnitudeSq(raw[i]) > launchSq) + static_cast<uint32_t>(rawAccelMilliG(raw[i][0], range));
+    }
+    const uint32_t rawCycles = DWT->CYCCNT - start;
+    interrupts();
+
+    Serial.print("accel bench (");
+    Serial.print(static_cast<unsigned>(kSamples));
+    Serial.print(" samples): float ");
+    Serial.print(static_cast<float>(floatCycles) / kSamples, 1);
+    Serial.print(" cycles/sample, raw ");
+    Serial.print(static_cast<float>(rawCycles) / kSamples, 1);
+    Serial.println(" cycles/sample");
+#else
+    Serial.println("accel bench: no DWT cycle counter on this build");
+#endif
+}
+
 void serialDeleteSpiFlashFile(const char* filename) {
     if (!spiFlashReady) {
         Serial.println("SPI flash not initialized.");
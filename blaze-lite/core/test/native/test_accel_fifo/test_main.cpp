@@ -0,0 +1,143 @@
+// Host-side tests for AccelFifo (KX134 buffer decoding and burst timestamp reconstruction).
+// Run with: pio test -e native -f native/test_accel_fifo
+
+#include <unity.h>
+
+#include <stdlib.h>
+
+#include <vector>
+
+#include "AccelFifo.h"
+
+namespace {
+
+// Simulated sensor: sample k is produced at startUs + k * truePeriodUs.
+struct Burst {
+    uint32_t readUs;
+    size_t first;
+    size_t count;
+};
+
+// Reads the buffer every ~readEveryUs (with jitter) and drains everything produced so far.
+std::vector<Burst> simulate(double truePeriodUs, uint32_t readEveryUs, uint32_t jitterUs, size_t samples,
+                            std::vector<double>* truth) {
+    const double startUs = 1000.0;
+    truth->clear();
+    for (size_t k = 0; k < samples; ++k) {
+        truth->push_back(startUs + k * truePeriodUs);
+    }
+    std::vector<Burst> bursts;
+    size_t next = 0;
+    double t = startUs;
+    srand(7);
+    while (next < samples) {
+        t += readEveryUs + (jitterUs > 0 ? rand() % jitterUs : 0);
+        size_t produced = next;
+        while (produced < samples && (*truth)[produced] <= t) {
+            ++produced;
+        }
+        if (produced == samples) {
+            break;  // the sensor stops here; a real buffer read never sees its last sample go stale
+        }
+        if (produced > next) {
+            bursts.push_back(Burst{static_cast<uint32_t>(t), next, produced - next});
+            next = produced;
+        }
+    }
+    return bursts;
+}
+
+double worstError(double truePeriodUs, uint32_t nominalPeriodUs, uint32_t readEveryUs, uint32_t jitterUs,
+                  bool* monotonic) {
+    std::vector<double> truth;
+    const std::vector<Burst> bursts = simulate(truePeriodUs, readEveryUs, jitterUs, 20000, &truth);
+    FifoSampleClock clock;
+    clock.reset(nominalPeriodUs);
+    double worst = 0;
+    uint32_t prev = 0;
+    *monotonic = true;
+    uint32_t stamps[KX134_BUFFER_MAX_SAMPLES];
+    for (const Burst& b : bursts) {
+        TEST_ASSERT_TRUE(b.count <= KX134_BUFFER_MAX_SAMPLES);
+        clock.stamp(b.readUs, b.count, stamps);
+        for (size_t i = 0; i < b.count; ++i) {
+            const double err = static_cast<double>(stamps[i]) - truth[b.first + i];
+            worst = err > worst ? err : (-err > worst ? -err : worst);
+            if (b.first + i > 0 && static_cast<int32_t>(stamps[i] - prev) <= 0) {
+                *monotonic = false;
+            }
+            prev = stamps[i];
+        }
+    }
+    return worst;
+}
+
+}  // namespace
+
+void setUp() {}
+void tearDown() {}
+
+void test_odr_periods() {
+    TEST_ASSERT_EQUAL_UINT32(20000, kx134OdrPeriodUs(6));
+    TEST_ASSERT_EQUAL_UINT32(2500, kx134OdrPeriodUs(9));
+    TEST_ASSERT_EQUAL_UINT32(625, kx134OdrPeriodUs(11));
+}
+
+void test_decode_little_endian_frame() {
+    const uint8_t frame[6] = {0x34, 0x12, 0xFF, 0xFF, 0x00, 0x80};
+    int16_t raw[3];
+    kx134DecodeBufferSample(frame, raw);
+    TEST_ASSERT_EQUAL_INT(0x1234, raw[0]);
+    TEST_ASSERT_EQUAL_INT(-1, raw[1]);
+    TEST_ASSERT_EQUAL_INT(-32768, raw[2]);
+}
+
+void test_burst_spacing_is_one_period() {
+    FifoSampleClock clock;
+    clock.reset(2500);
+    uint32_t stamps[8];
+    clock.stamp(100000, 8, stamps);
+    for (int i = 1; i < 8; ++i) {
+        TEST_ASSERT_EQUAL_UINT32(2500, stamps[i] - stamps[i - 1]);
+    }
+    TEST_ASSERT_TRUE(stamps[7] <= 100000 && stamps[7] > 100000 - 2500);
+    // Next burst continues the same timeline.
+    uint32_t more[8];
+    clock.stamp(120000, 8, more);
+    TEST_ASSERT_EQUAL_UINT32(2500, more[0] - stamps[7]);
+}
+
+void test_tracks_sensor_clock_within_one_period() {
+    bool monotonic = false;
+    // Error bound: one period for the newest sample of a burst, plus the nominal-vs-true drift
+    // accumulated back to the oldest one.
+    // 400 Hz nominal, sensor 1% slow and 1% fast, bursts every ~20 ms with 3 ms jitter.
+    TEST_ASSERT_TRUE(worstError(2525.0, 2500, 20000, 3000, &monotonic) <= 2500.0 + 10 * 25.0);
+    TEST_ASSERT_TRUE(monotonic);
+    TEST_ASSERT_TRUE(worstError(2475.0, 2500, 20000, 3000, &monotonic) <= 2500.0 + 10 * 25.0);
+    TEST_ASSERT_TRUE(monotonic);
+    // 1600 Hz with longer, irregular gaps between reads (up to 80 samples per burst).
+    TEST_ASSERT_TRUE(worstError(626.0, 625, 40000, 10000, &monotonic) <= 625.0 + 80 * 1.0);
+    TEST_ASSERT_TRUE(monotonic);
+}
+
+void test_timestamps_survive_micros_wrap() {
+    FifoSampleClock clock;
+    clock.reset(625);
+    uint32_t stamps[4];
+    clock.stamp(0xFFFFFF00u, 4, stamps);
+    uint32_t more[4];
+    clock.stamp(0xFFFFFF00u + 2500u, 4, more);  // wraps past zero
+    TEST_ASSERT_EQUAL_UINT32(625, more[0] - stamps[3]);
+    TEST_ASSERT_EQUAL_UINT32(625, more[3] - more[2]);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_odr_periods);
+    RUN_TEST(test_decode_little_endian_frame);
+    RUN_TEST(test_burst_spacing_is_one_period);
+    RUN_TEST(test_tracks_sensor_clock_within_one_period);
+    RUN_TEST(test_timestamps_survive_micros_wrap);
+    return UNITY_END();
+}
@@ -0,0 +1,324 @@
+// Host-side tests and benchmark for AltitudeFilter (baro/accelerometer Kalman fusion).
+// Run with: pio test -e native -f native/test_altitude_filter
+
+#include <unity.h>
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "AltitudeFilter.h"
+
+namespace {
+
+// One synthetic flight: 2.5 s boost at 80 m/s^2 net, ballistic coast through apogee until the
+// drogue holds 8 m/s down.
+// Truth is integrated at 1 kHz; accelerometer samples at 400 Hz, barometer at 100 Hz.
+struct Truth {
+    double t;
+    double h;
+    double v;
+    double a;
+};
+
+constexpr double kBoostS = 2.5;
+constexpr double kBoostAccel = 80.0;
+constexpr double kDescentRate = -8.0;
+constexpr double kEndS = 40.0;
+
+Truth truthAt(double t) {
+    const double vBurnout = kBoostAccel * kBoostS;
+    const double hBurnout = 0.5 * kBoostAccel * kBoostS * kBoostS;
+    const double tApogee = kBoostS + vBurnout / 9.80665;
+    const double hApogee = hBurnout + vBurnout * vBurnout / (2.0 * 9.80665);
+    if (t < 0.0) {
+        return Truth{t, 0.0, 0.0, 0.0};
+    }
+    if (t < kBoostS) {
+        return Truth{t, 0.5 * kBoostAccel * t * t, kBoostAccel * t, kBoostAccel};
+    }
+    if (t < tApogee) {
+        const double dt = t - kBoostS;
+        return Truth{t, hBurnout + vBurnout * dt - 0.5 * 9.80665 * dt * dt, vBurnout - 9.80665 * dt, -9.80665};
+    }
+    const double tDrogue = tApogee - kDescentRate / 9.80665;
+    if (t < tDrogue) {
+        const double dt = t - tApogee;
+        return Truth{t, hApogee - 0.5 * 9.80665 * dt * dt, -9.80665 * dt, -9.80665};
+    }
+    const double hDrogue = hApogee - kDescentRate * kDescentRate / (2.0 * 9.80665);
+    return Truth{t, hDrogue + kDescentRate * (t - tDrogue), kDescentRate, 0.0};
+}
+
+double trueApogeeTime() { return kBoostS + kBoostAccel * kBoostS / 9.80665; }
+
+struct FlightResult {
+    double altitudeRms;
+    double velocityRms;
+    double detectedApogeeS;     // first time the estimate crosses v < 0 after launch
+    int ascentNegatives;        // baro samples with v < 0 while truly climbing above 20 m/s
+    int differencedNegatives;   // the same count for naive baro differencing
+};
+
+struct SpikePlan {
+    double probability;  // per baro sample
+    double magnitudeM;
+};
+
+FlightResult flyOnce(uint32_t seed, double baroSigma, double accelSigma, const SpikePlan& spikes) {
+    std::mt19937 rng(seed);
+    std::normal_distribution<double> baroNoise(0.0, baroSigma);
+    std::normal_distribution<double> accelNoise(0.0, accelSigma);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+    AltitudeFilter filter;
+    filter.reset(0.0f);
+
+    const double t0 = -2.0;  // two seconds on the pad first
+    double sumH2 = 0.0;
+    double sumV2 = 0.0;
+    int n = 0;
+    FlightResult result{0.0, 0.0, -1.0, 0, 0};
+    double lastBaro = 0.0;
+    bool haveLastBaro = false;
+    for (int step = 0;; ++step) {
+        const double t = t0 + step * 0.0025;  // 400 Hz accelerometer tick
+        if (t > kEndS) {
+            break;
+        }
+        const uint32_t us = static_cast<uint32_t>((t - t0) * 1e6) + 1000u;
+        const Truth truth = truthAt(t);
+        filter.updateAcceleration(us, static_cast<float>(truth.a + accelNoise(rng)));
+        if (step % 4 == 0) {
+            double z = truth.h + baroNoise(rng);
+            if (t > 0.0 && uniform(rng) < spikes.probability) {
+                z += spikes.magnitudeM;
+            }
+            filter.updateAltitude(us, static_cast<float>(z));
+            if (haveLastBaro && truth.v > 20.0 && (z - lastBaro) / 0.01 < 0.0) {
+                ++result.differencedNegatives;
+            }
+            lastBaro = z;
+            haveLastBaro = true;
+            if (truth.v > 20.0 && filter.velocity() < 0.0f) {
+                ++result.ascentNegatives;
+            }
+        }
+        if (t > 1.0 && result.detectedApogeeS < 0.0 && filter.velocity() < 0.0f) {
+            result.detectedApogeeS = t;
+        }
+        const double eh = filter.altitude() - truth.h;
+        const double ev = filter.velocity() - truth.v;
+        sumH2 += eh * eh;
+        sumV2 += ev * ev;
+        ++n;
+    }
+    result.altitudeRms = sqrt(sumH2 / n);
+    result.velocityRms = sqrt(sumV2 / n);
+    return result;
+}
+
+// Descent seen by a real axial accelerometer: it measures specific force along the body, so
+// after apogee the rocket turns nose down and, hanging under the drogue, reads -1 g instead of
+// +1 g. Returns the velocity RMS from apogee to the end and the mean velocity over the last 5 s.
+struct DescentResult {
+    double velocityRms;
+    double finalVelocity;
+};
+
+DescentResult flyDescent(uint32_t seed, bool fuseAfterApogee) {
+    std::mt19937 rng(seed);
+    std::normal_distribution<double> baroNoise(0.0, 1.0);
+    std::normal_distribution<double> accelNoise(0.0, 0.5);
+
+    AltitudeFilter filter;
+    filter.reset(0.0f);
+
+    const double tApogee = trueApogeeTime();
+    double sumV2 = 0.0;
+    int n = 0;
+    double sumFinal = 0.0;
+    int nFinal = 0;
+    for (int step = 0;; ++step) {
+        const double t = step * 0.0025;
+        if (t > kEndS) {
+            break;
+        }
+        const uint32_t us = static_cast<uint32_t>(t * 1e6) + 1000u;
+        const Truth truth = truthAt(t);
+        // Body tilt from vertical: turns over in two seconds after apogee, then swings under the drogue.
+        double tilt = 0.0;
+        if (t > tApogee) {
+            tilt = t < tApogee + 2.0 ? M_PI * (t - tApogee) / 2.0 : M_PI + 0.4 * sin(2.0 * M_PI * 0.7 * t);
+        }
+        const double axialG = cos(tilt) * (truth.a + 9.80665) / ALT_FILTER_G0 + accelNoise(rng) / ALT_FILTER_G0;
+        if (!fuseAfterApogee) {
+            filter.setAccelerationFused(t < tApogee);
+        }
+        filter.updateAcceleration(us, static_cast<float>((axialG - 1.0) * ALT_FILTER_G0));
+        if (step % 4 == 0) {
+            filter.updateAltitude(us, static_cast<float>(truth.h + baroNoise(rng)));
+        }
+        if (t > tApogee) {
+            const double ev = filter.velocity() - truth.v;
+            sumV2 += ev * ev;
+            ++n;
+        }
+        if (t > kEndS - 5.0) {
+            sumFinal += filter.velocity();
+            ++nFinal;
+        }
+    }
+    return DescentResult{sqrt(sumV2 / n), sumFinal / nFinal};
+}
+
+}  // namespace
+
+void setUp() {}
+void tearDown() {}
+
+void test_linear_kalman_scalar_converges() {
+    // Constant scalar observed with unit noise: the estimate approaches the true value
+    // and the variance shrinks to about r / n.
+    LinearKalman<1> kf;
+    kf.reset(nullptr, 100.0f);
+    const LinearKalman<1>::Matrix f = {{1.0f}};
+    const LinearKalman<1>::Matrix q = {{0.0f}};
+    const LinearKalman<1>::Vector h = {1.0f};
+    std::mt19937 rng(7);
+    std::normal_distribution<float> noise(0.0f, 1.0f);
+    for (int i = 0; i < 400; ++i) {
+        kf.predict(f, q);
+        TEST_ASSERT_TRUE(kf.update(h, 1.0f, 5.0f + noise(rng)));
+    }
+    TEST_ASSERT_TRUE(fabsf(kf.state(0) - 5.0f) < 0.2f);
+    TEST_ASSERT_TRUE(fabsf(kf.covariance(0, 0) - 1.0f / 400.0f) < 0.0005f);
+}
+
+void test_tracks_noisy_flights() {
+    // Five synthetic flights with realistic sensor noise: RMS errors stay small over the
+    // whole profile and the velocity sign never flips during a fast climb.
+    for (uint32_t seed = 1; seed <= 5; ++seed) {
+        const FlightResult r = flyOnce(seed, 1.0, 0.5, SpikePlan{0.0, 0.0});
+        printf("seed %u: altitude RMS %.2f m, velocity RMS %.2f m/s, apogee at %.2f s (true %.2f s), "
+               "ascent sign flips filter %d / differencing %d\n",
+               static_cast<unsigned>(seed), r.altitudeRms, r.velocityRms, r.detectedApogeeS, trueApogeeTime(),
+               r.ascentNegatives, r.differencedNegatives);
+        TEST_ASSERT_TRUE(r.altitudeRms < 1.0);
+        TEST_ASSERT_TRUE(r.velocityRms < 1.0);
+        TEST_ASSERT_EQUAL_INT(0, r.ascentNegatives);
+        TEST_ASSERT_TRUE(r.differencedNegatives > 0);
+        TEST_ASSERT_TRUE(fabs(r.detectedApogeeS - trueApogeeTime()) < 0.5);
+    }
+}
+
+void test_heavy_vibration_and_baro_spikes() {
+    // Boost vibration (3 m/s^2 accel noise), noisier baro and 2% of samples hit by +60 m
+    // transonic spikes: the gate drops the spikes and apogee timing holds.
+    for (uint32_t seed = 11; seed <= 13; ++seed) {
+        const FlightResult r = flyOnce(seed, 2.0, 3.0, SpikePlan{0.02, 60.0});
+        printf("seed %u (spiky): altitude RMS %.2f m, velocity RMS %.2f m/s, apogee at %.2f s\n",
+               static_cast<unsigned>(seed), r.altitudeRms, r.velocityRms, r.detectedApogeeS);
+        TEST_ASSERT_TRUE(r.altitudeRms < 2.0);
+        TEST_ASSERT_TRUE(r.velocityRms < 2.0);
+        TEST_ASSERT_EQUAL_INT(0, r.ascentNegatives);
+        TEST_ASSERT_TRUE(fabs(r.detectedApogeeS - trueApogeeTime()) < 1.0);
+    }
+}
+
+void test_descent_ignores_tumbling_accelerometer() {
+    // Nose down under the drogue the axial accelerometer reads about -2 g net while the rocket
+    // falls at a steady 8 m/s. With fusion off from apogee the barometer holds the descent rate;
+    // left on, the wrong acceleration pulls the estimate away.
+    for (uint32_t seed = 21; seed <= 23; ++seed) {
+        const DescentResult off = flyDescent(seed, false);
+        const DescentResult on = flyDescent(seed, true);
+        printf("seed %u descent: velocity RMS %.2f m/s (fused throughout %.2f m/s), last 5 s mean %.2f m/s\n",
+               static_cast<unsigned>(seed), off.velocityRms, on.velocityRms, off.finalVelocity);
+        TEST_ASSERT_TRUE(off.velocityRms < 2.0);
+        TEST_ASSERT_TRUE(fabs(off.finalVelocity - kDescentRate) < 1.0);
+        TEST_ASSERT_TRUE(on.velocityRms > 2.0 * off.velocityRms);
+    }
+}
+
+void test_single_spike_is_rejected() {
+    AltitudeFilter filter;
+    filter.reset(100.0f);
+    uint32_t us = 0;
+    for (int i = 0; i < 400; ++i) {
+        us += 10000;
+        filter.updateAcceleration(us, 0.0f);
+        filter.updateAltitude(us, 100.0f);
+    }
+    us += 10000;
+    TEST_ASSERT_FALSE(filter.updateAltitude(us, 250.0f));
+    TEST_ASSERT_EQUAL_UINT32(1, filter.baroRejects());
+    TEST_ASSERT_TRUE(fabsf(filter.altitude() - 100.0f) < 0.5f);
+    TEST_ASSERT_TRUE(fabsf(filter.velocity()) < 0.5f);
+}
+
+void test_gate_gives_way_to_a_real_step() {
+    // A persistent 40 m offset is not a spike: after the reject limit the filter re-acquires it
+    // instead of rejecting every later sample.
+    AltitudeFilter filter;
+    uint32_t us = 0;
+    for (int i = 0; i < 400; ++i) {
+        us += 10000;
+        filter.updateAcceleration(us, 0.0f);
+        filter.updateAltitude(us, 0.0f);
+    }
+    for (int i = 0; i < 500; ++i) {
+        us += 10000;
+        filter.updateAcceleration(us, 0.0f);
+        filter.updateAltitude(us, 40.0f);
+    }
+    TEST_ASSERT_TRUE(fabsf(filter.altitude() - 40.0f) < 1.0f);
+    TEST_ASSERT_TRUE(fabsf(filter.velocity()) < 0.5f);
+    TEST_ASSERT_TRUE(filter.baroRejects() <= 2u * ALT_FILTER_BARO_GATE_MAX_REJECTS);
+}
+
+void test_out_of_order_timestamp_is_ignored() {
+    AltitudeFilter filter;
+    filter.updateAcceleration(1000, 10.0f);
+    filter.updateAcceleration(11000, 10.0f);
+    const float h = filter.altitude();
+    filter.predictTo(5000);
+    TEST_ASSERT_EQUAL_FLOAT(h, filter.altitude());
+}
+
+void bench_filter_step() {
+    using Clock = std::chrono::steady_clock;
+    AltitudeFilter filter;
+    constexpr int kSteps = 2000000;
+    uint32_t us = 0;
+    volatile float sink = 0.0f;
+    const auto t0 = Clock::now();
+    for (int i = 0; i < kSteps; ++i) {
+        us += 2500;
+        filter.updateAcceleration(us, static_cast<float>(i & 7));
+        if ((i & 3) == 0) {
+            filter.updateAltitude(us, static_cast<float>(i & 15));
+        }
+    }
+    sink = sink + filter.altitude();
+    const auto t1 = Clock::now();
+    printf("predict + accel update (+ baro every 4th): %.1f ns per accelerometer sample\n",
+           std::chrono::duration<double, std::nano>(t1 - t0).count() / kSteps);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_linear_kalman_scalar_converges);
+    RUN_TEST(test_tracks_noisy_flights);
+    RUN_TEST(test_heavy_vibration_and_baro_spikes);
+    RUN_TEST(test_descent_ignores_tumbling_accelerometer);
+    RUN_TEST(test_single_spike_is_rejected);
+    RUN_TEST(test_gate_gives_way_to_a_real_step);
+    RUN_TEST(test_out_of_order_timestamp_is_ignored);
+    RUN_TEST(bench_filter_step);
+    return UNITY_END();
+}
@@ -0,0 +1,163 @@
+// Host-side tests and benchmark for ApogeePredictor (drag-aware ballistic coast model).
+// Run with: pio test -e native -f native/test_apogee_predictor
+
+#include <unity.h>
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <chrono>
+
+#include "ApogeePredictor.h"
+
+namespace {
+
+constexpr double kG = 9.80665;
+constexpr double kDrag = 0.0015;   // k (1/m): ~300 m/s burnout coasts to ~1.2 km
+constexpr uint32_t kPeriodUs = 2500;  // 400 Hz
+
+// Coast under gravity and quadratic drag integrated at 40 kHz; one entry per 400 Hz sample.
+struct Coast {
+    double h;
+    double v;
+    double a;
+    double t;
+
+    void step() {
+        for (int i = 0; i < 100; ++i) {
+            const double dt = 1.0 / 40000.0;
+            const double acc = -kG - kDrag * v * fabs(v);
+            v += acc * dt;
+            h += v * dt;
+        }
+        a = -kG - kDrag * v * fabs(v);
+        t += 1.0 / 400.0;
+    }
+};
+
+// Fly the coast from (h0, v0) until v <= 0; returns apogee height and time.
+void coastToApogeeNumerically(double h0, double v0, double* apogeeM, double* apogeeS) {
+    Coast c{h0, v0, 0.0, 0.0};
+    while (c.v > 0.0) {
+        c.step();
+    }
+    *apogeeM = c.h;
+    *apogeeS = c.t;
+}
+
+}  // namespace
+
+void setUp() {}
+void tearDown() {}
+
+void test_closed_form_matches_integration() {
+    double apogeeM;
+    double apogeeS;
+    coastToApogeeNumerically(0.0, 250.0, &apogeeM, &apogeeS);
+    float rise;
+    const float t = ApogeePredictor::coastToApogee(250.0f, static_cast<float>(kDrag), &rise);
+    TEST_ASSERT_TRUE(fabs(t - apogeeS) < 0.005);
+    TEST_ASSERT_TRUE(fabs(rise - apogeeM) < 0.5);
+
+    // Drag-free limit and already descending.
+    TEST_ASSERT_TRUE(fabsf(ApogeePredictor::coastToApogee(98.0665f, 0.0f, &rise) - 10.0f) < 1e-4f);
+    TEST_ASSERT_TRUE(fabsf(rise - 490.3325f) < 0.01f);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, ApogeePredictor::coastToApogee(-3.0f, static_cast<float>(kDrag), &rise));
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, rise);
+}
+
+void test_no_prediction_before_coast() {
+    ApogeePredictor p;
+    TEST_ASSERT_FALSE(p.update(0, 0.0f, 0.0f, NAN));
+    for (uint32_t i = 1; i < 400; ++i) {  // boost: 60 m/s^2 up
+        TEST_ASSERT_FALSE(p.update(i * kPeriodUs, 0.0f, 60.0f * i / 400.0f, 60.0f));
+    }
+    TEST_ASSERT_FALSE(p.coasting());
+    TEST_ASSERT_TRUE(p.update(400 * kPeriodUs, 30.0f, 60.0f, -20.0f));
+    TEST_ASSERT_TRUE(p.coasting());
+}
+
+void test_drag_fit_converges_to_apogee() {
+    ApogeePredictor p;
+    Coast c{300.0, 280.0, -kG - kDrag * 280.0 * 280.0, 0.0};
+    double apogeeM;
+    double apogeeS;
+    coastToApogeeNumerically(c.h, c.v, &apogeeM, &apogeeS);
+    uint32_t us = 10000000;
+    TEST_ASSERT_TRUE(p.update(us, static_cast<float>(c.h), static_cast<float>(c.v), static_cast<float>(c.a)));
+    for (int i = 0; i < 400; ++i) {  // 1 s of coast
+        c.step();
+        us += kPeriodUs;
+        p.update(us, static_cast<float>(c.h), static_cast<float>(c.v), static_cast<float>(c.a));
+    }
+    printf("k %.5f (true %.5f), apogee %.1f m in %.3f s (true %.1f m in %.3f s)\n", p.dragPerMass(), kDrag,
+           p.apogeeAltitudeM(), p.timeToApogeeS(), apogeeM, apogeeS - c.t);
+    TEST_ASSERT_TRUE(fabs(p.dragPerMass() - kDrag) < 0.01 * kDrag);
+    TEST_ASSERT_TRUE(fabs(p.apogeeAltitudeM() - apogeeM) < 1.0);
+    TEST_ASSERT_TRUE(fabs(p.timeToApogeeS() - (apogeeS - c.t)) < 0.02);
+}
+
+void test_baro_transient_barely_moves_prediction() {
+    // The fused velocity swings -300 m/s for 300 ms (transonic pressure on the baro); the
+    // accelerometer-driven acceleration does not.
+    ApogeePredictor clean;
+    ApogeePredictor spiked;
+    Coast c{300.0, 280.0, -kG - kDrag * 280.0 * 280.0, 0.0};
+    uint32_t us = 0;
+    for (int i = 0; i < 800; ++i) {
+        const bool spike = i >= 200 && i < 320;
+        const float v = static_cast<float>(c.v);
+        clean.update(us, static_cast<float>(c.h), v, static_cast<float>(c.a));
+        spiked.update(us, static_cast<float>(c.h), spike ? v - 300.0f : v, static_cast<float>(c.a));
+        if (spike) {
+            TEST_ASSERT_TRUE(spiked.timeToApogeeS() > clean.timeToApogeeS() - 0.5f);
+        }
+        c.step();
+        us += kPeriodUs;
+    }
+    TEST_ASSERT_TRUE(fabsf(spiked.timeToApogeeS() - clean.timeToApogeeS()) < 0.05f);
+}
+
+void test_velocity_tracked_from_launch() {
+    // Coast starting while the fused velocity is wrong: the velocity carried from launch wins.
+    ApogeePredictor p;
+    uint32_t us = 0;
+    float v = 0.0f;
+    for (int i = 0; i < 400; ++i) {  // 1 s boost at 100 m/s^2
+        p.update(us, 0.0f, v, 100.0f);
+        v += 100.0f / 400.0f;
+        us += kPeriodUs;
+    }
+    TEST_ASSERT_TRUE(p.update(us, 50.0f, -40.0f, -20.0f));  // filter velocity corrupted at burnout
+    TEST_ASSERT_TRUE(fabsf(p.velocity() - 100.0f) < 0.5f);
+}
+
+void bench_update_cost() {
+    using Clock = std::chrono::steady_clock;
+    constexpr int kUpdates = 1000000;
+    ApogeePredictor p;
+    float v = 300.0f;
+    float sink = 0.0f;
+    const auto t0 = Clock::now();
+    for (int i = 0; i < kUpdates; ++i) {
+        const float a = -9.80665f - 0.0015f * v * v;
+        p.update(static_cast<uint32_t>(i) * kPeriodUs, 1000.0f, v, a);
+        sink += p.timeToApogeeS();
+        v = v > 1.0f ? v + a * 0.0025f : 300.0f;
+    }
+    const double s = std::chrono::duration<double>(Clock::now() - t0).count();
+    printf("%d updates: %.1f ns per update (sink %.1f)\n", kUpdates, 1e9 * s / kUpdates, sink);
+    TEST_ASSERT_TRUE(sink > 0.0f);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_closed_form_matches_integration);
+    RUN_TEST(test_no_prediction_before_coast);
+    RUN_TEST(test_drag_fit_converges_to_apogee);
+    RUN_TEST(test_baro_transient_barely_moves_prediction);
+    RUN_TEST(test_velocity_tracked_from_launch);
+    RUN_TEST(bench_update_cost);
+    return UNITY_END();
+}
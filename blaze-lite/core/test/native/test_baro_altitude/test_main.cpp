@@ -0,0 +1,114 @@
+// Host-side tests and benchmark for BaroAltitude (table-based, pad-referenced altitude).
+// Run with: pio test -e native -f native/test_baro_altitude
+
+#include <unity.h>
+
+#include <math.h>
+#include <stdio.h>
+
+#include <chrono>
+#include <vector>
+
+#include "BaroAltitude.h"
+
+namespace {
+
+double exactAltitude(double pressureHpa) { return 44307.694 * (1.0 - pow(pressureHpa / 1013.25, 0.190284)); }
+
+// Pressure for a standard-atmosphere altitude (inverse of exactAltitude).
+double pressureAt(double altitudeM) { return 1013.25 * pow(1.0 - altitudeM / 44307.694, 1.0 / 0.190284); }
+
+}  // namespace
+
+void setUp() {}
+void tearDown() {}
+
+void test_table_matches_exact_formula() {
+    static BaroAltitudeTable table;
+    double worst = 0.0;
+    for (double p = 160.0; p <= 1090.0; p += 0.37) {
+        const double err = fabs(table.altitude(static_cast<float>(p)) - exactAltitude(static_cast<float>(p)));
+        worst = err > worst ? err : worst;
+    }
+    printf("table vs exact, 160-1090 hPa: worst %.4f m\n", worst);
+    TEST_ASSERT_TRUE(worst < 0.02);
+}
+
+void test_agl_accurate_over_10km_from_high_pad() {
+    // Pad at 1500 m MSL, flight to 10 km above it: every AGL within 0.1 m of the exact difference.
+    static PadAltitude pad;
+    const double padMsl = 1500.0;
+    for (int i = 0; i < BARO_PAD_SAMPLES; ++i) {
+        pad.addPadSample(static_cast<float>(pressureAt(padMsl)));
+    }
+    TEST_ASSERT_TRUE(pad.hasReference());
+    double worst = 0.0;
+    for (double agl = 0.0; agl <= 10000.0; agl += 3.1) {
+        const float p = static_cast<float>(pressureAt(padMsl + agl));
+        const double exact = exactAltitude(p) - exactAltitude(pressureAt(padMsl));
+        const double err = fabs(pad.agl(p) - exact);
+        worst = err > worst ? err : worst;
+    }
+    printf("AGL 0-10 km from a 1500 m pad: worst %.4f m\n", worst);
+    TEST_ASSERT_TRUE(worst < 0.1);
+}
+
+void test_pad_reference_is_block_average() {
+    static PadAltitude pad;
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, pad.agl(900.0f));
+    pad.addPadSample(900.0f);  // first sample is the provisional reference
+    TEST_ASSERT_EQUAL_FLOAT(900.0f, pad.referenceHpa());
+    for (int i = 1; i < BARO_PAD_SAMPLES; ++i) {
+        pad.addPadSample(i % 2 ? 901.0f : 899.0f);
+    }
+    // 900 + 32 * 901 + 31 * 899 over 64 samples
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 900.015625f, pad.referenceHpa());
+    TEST_ASSERT_FLOAT_WITHIN(0.05f, 0.0f, pad.agl(pad.referenceHpa()));
+}
+
+void test_out_of_table_falls_back() {
+    static BaroAltitudeTable table;
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, static_cast<float>(exactAltitude(100.0)), table.altitude(100.0f));
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, static_cast<float>(exactAltitude(1150.0)), table.altitude(1150.0f));
+}
+
+void bench_table_vs_powf() {
+    using Clock = std::chrono::steady_clock;
+    static BaroAltitudeTable table;
+    std::vector<float> pressures;
+    for (int i = 0; i < 4096; ++i) {
+        pressures.push_back(300.0f + (i * 37 % 7000) * 0.1f);
+    }
+    constexpr int kRounds = 500;
+    volatile float sink = 0.0f;
+    const auto t0 = Clock::now();
+    for (int r = 0; r < kRounds; ++r) {
+        float acc = 0.0f;
+        for (float p : pressures) {
+            acc += baroStdAltitude(p);
+        }
+        sink = sink + acc;
+    }
+    const auto t1 = Clock::now();
+    for (int r = 0; r < kRounds; ++r) {
+        float acc = 0.0f;
+        for (float p : pressures) {
+            acc += table.altitude(p);
+        }
+        sink = sink + acc;
+    }
+    const auto t2 = Clock::now();
+    const double n = static_cast<double>(pressures.size()) * kRounds;
+    printf("powf standard atmosphere: %.2f ns per altitude\n", std::chrono::duration<double, std::nano>(t1 - t0).count() / n);
+    printf("Hermite table:            %.2f ns per altitude\n", std::chrono::duration<double, std::nano>(t2 - t1).count() / n);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_table_matches_exact_formula);
+    RUN_TEST(test_agl_accurate_over_10km_from_high_pad);
+    RUN_TEST(test_pad_reference_is_block_average);
+    RUN_TEST(test_out_of_table_falls_back);
+    RUN_TEST(bench_table_vs_powf);
+    return UNITY_END();
+}
@@ -0,0 +1,37 @@
+// Host-side tests for the shared CRC-32 helper.
+// Run with: pio test -e native -f native/test_crc32
+
+#include <unity.h>
+
+#include <string.h>
+
+#include "Crc32.h"
+
+void setUp() {}
+void tearDown() {}
+
+void test_check_value() {
+    const char* s = "123456789";
+    TEST_ASSERT_EQUAL_UINT32(0xCBF43926u, crc32(s, strlen(s)));
+    TEST_ASSERT_EQUAL_UINT32(0u, crc32(s, 0));
+}
+
+void test_incremental_matches_one_shot() {
+    uint8_t buf[1000];
+    for (size_t i = 0; i < sizeof(buf); ++i) {
+        buf[i] = static_cast<uint8_t>(i * 31 + 7);
+    }
+    uint32_t crc = 0;
+    for (size_t off = 0; off < sizeof(buf); off += 97) {
+        const size_t n = (sizeof(buf) - off < 97) ? sizeof(buf) - off : 97;
+        crc = crc32Update(crc, buf + off, n);
+    }
+    TEST_ASSERT_EQUAL_UINT32(crc32(buf, sizeof(buf)), crc);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_check_value);
+    RUN_TEST(test_incremental_matches_one_shot);
+    return UNITY_END();
+}
@@ -0,0 +1,257 @@
+// Host-side tests for EraseAhead (background pre-erase driven by the LittleFS lookahead window).
+// LittleFS runs on the emulated W25Q128 (EmulatedNorFlash), whose erases take datasheet time on the
+// host clock; the loop between writes is modelled as idle steps of kStepUs each.
+// Run with: pio test -e native -f native/test_erase_ahead -v
+
+#include <unity.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include <vector>
+
+extern "C" {
+#include "lfs.h"
+}
+
+#include "EmulatedNorFlash.h"
+#include "EraseAhead.h"
+#include "HostClock.h"
+
+namespace {
+
+constexpr lfs_size_t kBlockSize = 4096;
+constexpr lfs_size_t kBlockCount = 256;
+constexpr lfs_size_t kProgSize = 256;
+constexpr uint32_t kStepUs = 1000;  // loop time between engine steps
+constexpr uint32_t kDepth = 16;
+
+// LittleFS on an EmulatedNorFlash, with the erase/program hooks spiFlash gives EraseAhead.
+struct Fixture {
+    EmulatedNorFlash nor{kBlockSize * kBlockCount};
+    EraseAhead<kBlockCount>* ahead = nullptr;
+    uint32_t syncErases = 0;
+    uint32_t backgroundErases = 0;
+    std::vector<bool> inUse;  // blocks LittleFS reported in use at the last traversal
+};
+
+bool devBusy(void* user) { return static_cast<Fixture*>(user)->nor.busy(); }
+
+bool devStartErase(void* user, uint32_t block) {
+    auto* fx = static_cast<Fixture*>(user);
+    ++fx->backgroundErases;
+    return fx->nor.startErase(block * kBlockSize);
+}
+
+bool devRead(void* user, uint32_t block, uint32_t off, uint8_t* buf, uint32_t len) {
+    return static_cast<Fixture*>(user)->nor.read(block * kBlockSize + off, buf, len);
+}
+
+int norRead(const lfs_config* c, lfs_block_t block, lfs_off_t off, void* buffer, lfs_size_t size) {
+    auto* fx = static_cast<Fixture*>(c->context);
+    return fx->nor.read(block * kBlockSize + off, static_cast<uint8_t*>(buffer), size) ? 0 : LFS_ERR_IO;
+}
+
+int norProg(const lfs_config* c, lfs_block_t block, lfs_off_t off, const void* buffer, lfs_size_t size) {
+    auto* fx = static_cast<Fixture*>(c->context);
+    if (fx->ahead != nullptr) {
+        fx->ahead->noteProgram(block);
+    }
+    const uint8_t* src = static_cast<const uint8_t*>(buffer);
+    for (lfs_size_t done = 0; done < size; done += kProgSize) {
+        if (!fx->nor.startProgram(block * kBlockSize + off + done, src + done, kProgSize)) {
+            return LFS_ERR_IO;
+        }
+    }
+    fx->nor.waitReady();
+    return 0;
+}
+
+int norErase(const lfs_config* c, lfs_block_t block) {
+    auto* fx = static_cast<Fixture*>(c->context);
+    if (fx->ahead != nullptr && fx->ahead->takeBlank(block)) {
+        return 0;
+    }
+    ++fx->syncErases;
+    return fx->nor.eraseSector(block) ? 0 : LFS_ERR_IO;
+}
+
+int norSync(const lfs_config* c) {
+    static_cast<Fixture*>(c->context)->nor.waitReady();
+    return 0;
+}
+
+lfs_config makeConfig(Fixture* fx) {
+    lfs_config cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.context = fx;
+    cfg.read = norRead;
+    cfg.prog = norProg;
+    cfg.erase = norErase;
+    cfg.sync = norSync;
+    cfg.read_size = 16;
+    cfg.prog_size = kProgSize;
+    cfg.block_size = kBlockSize;
+    cfg.block_count = kBlockCount;
+    cfg.cache_size = 256;
+    cfg.lookahead_size = 16;
+    cfg.block_cycles = 500;
+    return cfg;
+}
+
+void attach(Fixture* fx, EraseAhead<kBlockCount>* ahead, uint32_t depth) {
+    ahead->begin(EraseAheadDevice{fx, devBusy, devStartErase, devRead}, kBlockCount, kBlockSize, depth);
+    fx->ahead = ahead;
+}
+
+void idle(EraseAhead<kBlockCount>* ahead, lfs_t* lfs, uint32_t steps) {
+    for (uint32_t s = 0; s < steps; ++s) {
+        ahead->step(lfs);
+        hostClockAdvanceUs(kStepUs);
+    }
+}
+
+int markInUse(void* p, lfs_block_t block) {
+    static_cast<Fixture*>(p)->inUse[block] = true;
+    return 0;
+}
+
+void fillPattern(uint8_t* buf, size_t len, uint32_t seed) {
+    for (size_t i = 0; i < len; ++i) {
+        buf[i] = static_cast<uint8_t>(seed * 131u + i * 7u);
+    }
+}
+
+// Write `pages` program pages to DATA.bin with `idleSteps` engine steps between pages;
+// returns synchronous erases issued while writing.
+uint32_t runSession(Fixture* fx, lfs_t* lfs, EraseAhead<kBlockCount>* ahead, uint32_t pages, uint32_t idleSteps) {
+    lfs_file_t file;
+    TEST_ASSERT_EQUAL(0, lfs_file_open(lfs, &file, "DATA.bin", LFS_O_RDWR | LFS_O_CREAT | LFS_O_APPEND));
+    const uint32_t before = fx->syncErases;
+    uint8_t page[kProgSize];
+    for (uint32_t p = 0; p < pages; ++p) {
+        if (ahead != nullptr) {
+            idle(ahead, lfs, idleSteps);
+        }
+        fillPattern(page, sizeof(page), p);
+        TEST_ASSERT_EQUAL(kProgSize, lfs_file_write(lfs, &file, page, sizeof(page)));
+        if (p % 64 == 63) {
+            TEST_ASSERT_EQUAL(0, lfs_file_sync(lfs, &file));
+        }
+    }
+    TEST_ASSERT_EQUAL(0, lfs_file_close(lfs, &file));
+    return fx->syncErases - before;
+}
+
+void verifyData(lfs_t* lfs, uint32_t pages) {
+    lfs_file_t file;
+    TEST_ASSERT_EQUAL(0, lfs_file_open(lfs, &file, "DATA.bin", LFS_O_RDONLY));
+    uint8_t expect[kProgSize];
+    uint8_t got[kProgSize];
+    for (uint32_t p = 0; p < pages; ++p) {
+        fillPattern(expect, sizeof(expect), p);
+        TEST_ASSERT_EQUAL(kProgSize, lfs_file_read(lfs, &file, got, sizeof(got)));
+        TEST_ASSERT_EQUAL_MEMORY(expect, got, sizeof(got));
+    }
+    TEST_ASSERT_EQUAL(0, lfs_file_close(lfs, &file));
+}
+
+}  // namespace
+
+void setUp() { hostClockReset(); }
+void tearDown() {}
+
+void test_pre_erase_removes_sync_erases_and_keeps_data() {
+    const uint32_t kPages = 40 * kBlockSize / kProgSize;  // 40 blocks of data
+
+    // Baseline: no engine. Start from a dirty chip so every allocated block needs an erase.
+    static Fixture plain;
+    memset(plain.nor.image().data(), 0x00, plain.nor.image().size());
+    lfs_config plainCfg = makeConfig(&plain);
+    lfs_t plainFs;
+    TEST_ASSERT_EQUAL(0, lfs_format(&plainFs, &plainCfg));
+    TEST_ASSERT_EQUAL(0, lfs_mount(&plainFs, &plainCfg));
+    const uint32_t baseline = runSession(&plain, &plainFs, nullptr, kPages, 0);
+    TEST_ASSERT_EQUAL(0, lfs_unmount(&plainFs));
+
+    static Fixture fx;
+    memset(fx.nor.image().data(), 0x00, fx.nor.image().size());
+    static EraseAhead<kBlockCount> ahead;
+    lfs_config cfg = makeConfig(&fx);
+    lfs_t lfs;
+    TEST_ASSERT_EQUAL(0, lfs_format(&lfs, &cfg));
+    TEST_ASSERT_EQUAL(0, lfs_mount(&lfs, &cfg));
+    attach(&fx, &ahead, kDepth);
+    TEST_ASSERT_EQUAL(0, lfs_fs_gc(&lfs));  // populate the lookahead window
+
+    // Idle time before launch (2 s): let the engine get ahead of the allocator.
+    idle(&ahead, &lfs, 2000);
+    TEST_ASSERT_EQUAL_UINT32(kDepth, ahead.blankCount());
+
+    // In flight: a few idle steps between 256-byte writes (about one per sensor sample).
+    const uint32_t withEngine = runSession(&fx, &lfs, &ahead, kPages, 8);
+    printf("sync erases for %u pages: %u without pre-erase, %u with (hits %u, background %u)\n",
+           static_cast<unsigned>(kPages), static_cast<unsigned>(baseline), static_cast<unsigned>(withEngine),
+           static_cast<unsigned>(ahead.stats().hits), static_cast<unsigned>(fx.backgroundErases));
+    TEST_ASSERT_TRUE(ahead.stats().hits >= 30);
+    TEST_ASSERT_TRUE(withEngine * 4 < baseline);
+    TEST_ASSERT_EQUAL_UINT32(0, static_cast<uint32_t>(fx.nor.stats().norViolations));
+
+    // The engine must never have erased a block LittleFS still uses.
+    ahead.settle();
+    TEST_ASSERT_EQUAL(0, lfs_unmount(&lfs));
+    fx.ahead = nullptr;
+    TEST_ASSERT_EQUAL(0, lfs_mount(&lfs, &cfg));
+    verifyData(&lfs, kPages);
+    TEST_ASSERT_EQUAL(0, lfs_unmount(&lfs));
+}
+
+void test_blank_bits_only_cover_free_blocks() {
+    static Fixture fx;
+    static EraseAhead<kBlockCount> ahead;
+    lfs_config cfg = makeConfig(&fx);
+    lfs_t lfs;
+    TEST_ASSERT_EQUAL(0, lfs_format(&lfs, &cfg));
+    TEST_ASSERT_EQUAL(0, lfs_mount(&lfs, &cfg));
+    attach(&fx, &ahead, kDepth);
+
+    runSession(&fx, &lfs, &ahead, 200, 4);
+    TEST_ASSERT_EQUAL(0, lfs_fs_gc(&lfs));
+    idle(&ahead, &lfs, 2000);
+
+    // A fresh chip is already blank: verification alone should find the blocks, without erasing.
+    TEST_ASSERT_TRUE(ahead.stats().foundBlank > 0);
+
+    fx.inUse.assign(kBlockCount, false);
+    TEST_ASSERT_EQUAL(0, lfs_fs_traverse(&lfs, markInUse, &fx));
+    for (uint32_t b = 0; b < kBlockCount; ++b) {
+        if (ahead.isBlank(b)) {
+            TEST_ASSERT_FALSE(fx.inUse[b]);
+        }
+    }
+    TEST_ASSERT_EQUAL(0, lfs_unmount(&lfs));
+}
+
+void test_disabled_with_zero_depth() {
+    static Fixture fx;
+    static EraseAhead<kBlockCount> ahead;
+    lfs_config cfg = makeConfig(&fx);
+    lfs_t lfs;
+    TEST_ASSERT_EQUAL(0, lfs_format(&lfs, &cfg));
+    TEST_ASSERT_EQUAL(0, lfs_mount(&lfs, &cfg));
+    attach(&fx, &ahead, 0);
+    TEST_ASSERT_EQUAL(0, lfs_fs_gc(&lfs));
+    for (int i = 0; i < 100; ++i) {
+        TEST_ASSERT_FALSE(ahead.step(&lfs));
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, ahead.blankCount());
+    TEST_ASSERT_EQUAL(0, lfs_unmount(&lfs));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_pre_erase_removes_sync_erases_and_keeps_data);
+    RUN_TEST(test_blank_bits_only_cover_free_blocks);
+    RUN_TEST(test_disabled_with_zero_depth);
+    return UNITY_END();
+}
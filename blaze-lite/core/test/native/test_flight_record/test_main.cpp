@@ -0,0 +1,77 @@
+// Host-side tests for the binary flight record and its CSV conversion.
+// Run with: pio test -e native -f native/test_flight_record
+
+#include <unity.h>
+
+#include <stddef.h>
+#include <string.h>
+
+#include "FlightRecord.h"
+
+void setUp() {}
+void tearDown() {}
+
+void test_layout_is_fixed() {
+    TEST_ASSERT_EQUAL(24, sizeof(FlightRecord));
+    TEST_ASSERT_EQUAL(4, offsetof(FlightRecord, timestampMs));
+    TEST_ASSERT_EQUAL(12, offsetof(FlightRecord, accelRaw));
+    TEST_ASSERT_EQUAL(20, offsetof(FlightRecord, pressureDeciPa));
+}
+
+void test_csv_matches_legacy_columns() {
+    FlightRecord rec = {};
+    rec.flags = FLIGHT_RECORD_ACCEL_VALID | FLIGHT_RECORD_BARO_VALID | (3 << FLIGHT_RECORD_RANGE_SHIFT);
+    rec.timestampMs = 123456;
+    rec.sequence = 42;
+    rec.accelRaw[0] = 0;
+    rec.accelRaw[1] = 0;
+    rec.accelRaw[2] = 1997;            // 3.900 g at +-64 g (512 counts per g)
+    rec.pressureDeciPa = 1013250;      // 1013.25 hPa -> 0 m
+    flightRecordSeal(rec, 2);
+    TEST_ASSERT_TRUE(flightRecordIsValid(rec));
+    TEST_ASSERT_EQUAL(2, flightRecordPhase(rec));
+
+    char line[128];
+    const int n = flightRecordToCsv(rec, line, sizeof(line));
+    TEST_ASSERT_GREATER_THAN(0, n);
+    TEST_ASSERT_EQUAL_STRING("123456,42,0.000,0.000,3.900,3.900,0.00,2\r\n", line);
+}
+
+void test_invalid_fields_are_zeroed() {
+    FlightRecord rec = {};
+    rec.accelRaw[0] = 1234;
+    rec.pressureDeciPa = 900000;
+    flightRecordSeal(rec, 0);
+
+    char line[128];
+    flightRecordToCsv(rec, line, sizeof(line));
+    TEST_ASSERT_EQUAL_STRING("0,0,0.000,0.000,0.000,0.000,0.00,0\r\n", line);
+
+    rec.versionPhase = static_cast<uint8_t>((FLIGHT_RECORD_VERSION + 1) << 4);
+    rec.crc = flightRecordCrc(rec);
+    TEST_ASSERT_FALSE(flightRecordIsValid(rec));
+}
+
+void test_crc_rejects_corruption() {
+    FlightRecord rec = {};
+    rec.timestampMs = 5000;
+    rec.pressureDeciPa = 1000000;
+    flightRecordSeal(rec, 4);
+    TEST_ASSERT_TRUE(flightRecordIsValid(rec));
+
+    uint8_t* bytes = reinterpret_cast<uint8_t*>(&rec);
+    for (size_t i = 0; i < sizeof(rec); ++i) {
+        bytes[i] ^= 0x10;
+        TEST_ASSERT_FALSE(flightRecordIsValid(rec));
+        bytes[i] ^= 0x10;
+    }
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_layout_is_fixed);
+    RUN_TEST(test_csv_matches_legacy_columns);
+    RUN_TEST(test_invalid_fields_are_zeroed);
+    RUN_TEST(test_crc_rejects_corruption);
+    return UNITY_END();
+}
@@ -0,0 +1,149 @@
+// Host-side tests for FlightReplay (log parsing, replay pipeline and event scoring).
+// Run with: pio test -e native -f native/test_flight_replay
+
+#include <unity.h>
+
+#include <math.h>
+#include <stdio.h>
+
+#include <random>
+
+#include "FlightReplay.h"
+
+namespace {
+
+// 1-D flight sampled at 400 Hz: 2 s pad, 2.5 s boost at 80 m/s^2, coast through apogee until
+// the drogue holds 8 m/s down.
+// Barometer (1 m noise) refreshes every 4th sample like the MS5611 sequencer.
+constexpr double kApogeeS = 2.5 + 200.0 / 9.80665;
+constexpr double kDrogueS = kApogeeS + 8.0 / 9.80665;
+
+void flightSample(int i, std::mt19937& rng, ReplaySample* s) {
+    std::normal_distribution<double> baroNoise(0.0, 1.0);
+    const double t = i / 400.0 - 2.0;
+    double h;
+    double a;
+    if (t < 0.0) {
+        h = 0.0;
+        a = 0.0;
+    } else if (t < 2.5) {
+        h = 40.0 * t * t;
+        a = 80.0;
+    } else if (t < kDrogueS) {
+        const double d = t - 2.5;
+        h = 250.0 + 200.0 * d - 0.5 * 9.80665 * d * d;
+        a = -9.80665;
+    } else {
+        const double d = kDrogueS - 2.5;
+        h = 250.0 + 200.0 * d - 0.5 * 9.80665 * d * d - 8.0 * (t - kDrogueS);
+        a = 0.0;
+    }
+    // The accelerometer reads specific force: 0 g in free fall, 1 g on the pad and under the drogue.
+    const double axialG = (a + 9.80665) / 9.80665;
+    s->timestampUs = static_cast<uint32_t>(i) * 2500u;
+    s->accelRaw[0] = 0;
+    s->accelRaw[1] = 0;
+    s->accelRaw[2] = rawAccelFromG(static_cast<float>(axialG), 3);
+    s->accelRange = 3;
+    s->accelValid = true;
+    s->baroFresh = i % 4 == 0;
+    if (s->baroFresh) {
+        s->pressureHpa = baroStdPressure(static_cast<float>(300.0 + h + baroNoise(rng)));  // pad 300 m above datum
+    }
+}
+
+}  // namespace
+
+void setUp() {}
+void tearDown() {}
+
+void test_parse_data_csv_line() {
+    DataCsvRow row;
+    TEST_ASSERT_TRUE(parseDataCsvLine("12345,67,0.010,-0.020,9.875,9.875,1234.56,2\r\n", &row));
+    TEST_ASSERT_EQUAL_UINT32(12345, row.timestampMs);
+    TEST_ASSERT_EQUAL_UINT32(67, row.sequence);
+    TEST_ASSERT_TRUE(fabsf(row.accelG[2] - 9.875f) < 1e-4f);
+    TEST_ASSERT_TRUE(fabsf(row.altitudeM - 1234.56f) < 1e-3f);
+    TEST_ASSERT_EQUAL_UINT8(2, row.phase);
+
+    TEST_ASSERT_FALSE(parseDataCsvLine("timestamp,seq,ax,ay,az,mag,alt,phase\r\n", &row));
+    TEST_ASSERT_FALSE(parseDataCsvLine("1,2,3,4,5,6,7\r\n", &row));
+    TEST_ASSERT_FALSE(parseDataCsvLine("1,2,3,4,5,6,7,9\r\n", &row));
+    TEST_ASSERT_FALSE(parseDataCsvLine("1,2,3,4,5,6,7,2,junk\r\n", &row));
+    TEST_ASSERT_FALSE(parseDataCsvLine("", &row));
+}
+
+void test_phase_names_round_trip() {
+    for (int i = 0; i < FLIGHT_PHASE_COUNT; ++i) {
+        FlightPhase phase;
+        TEST_ASSERT_TRUE(flightPhaseFromName(flightPhaseName(static_cast<FlightPhase>(i)), &phase));
+        TEST_ASSERT_EQUAL_INT(i, static_cast<int>(phase));
+    }
+    FlightPhase phase;
+    TEST_ASSERT_FALSE(flightPhaseFromName("APOGE", &phase));
+    TEST_ASSERT_FALSE(flightPhaseFromName("apogee", &phase));
+}
+
+void test_raw_from_g_saturates() {
+    TEST_ASSERT_EQUAL_INT16(512, rawAccelFromG(1.0f, 3));
+    TEST_ASSERT_EQUAL_INT16(32767, rawAccelFromG(80.0f, 3));
+    TEST_ASSERT_EQUAL_INT16(-32768, rawAccelFromG(-80.0f, 3));
+    TEST_ASSERT_EQUAL_INT16(-4096, rawAccelFromG(-1.0f, 0));
+}
+
+void test_scoring() {
+    FlightEvents reference;
+    FlightEvents detected;
+    reference.clear();
+    detected.clear();
+    reference.mark(FlightPhase::LAUNCH, 10000000);
+    reference.mark(FlightPhase::APOGEE, 30000000);
+    reference.mark(FlightPhase::LANDED, 90000000);
+    detected.mark(FlightPhase::LAUNCH, 10050000);   // 50 ms late
+    detected.mark(FlightPhase::APOGEE, 29200000);   // 800 ms early: within tolerance
+    detected.mark(FlightPhase::DESCENT, 29300000);  // not in the reference
+    FlightEventScore scores[FLIGHT_PHASE_COUNT];
+    TEST_ASSERT_EQUAL_INT(2, scoreFlightEvents(reference, detected, 1000, scores));
+    TEST_ASSERT_EQUAL_INT32(50, scores[static_cast<int>(FlightPhase::LAUNCH)].latencyMs);
+    TEST_ASSERT_EQUAL_INT32(-800, scores[static_cast<int>(FlightPhase::APOGEE)].latencyMs);
+    TEST_ASSERT_FALSE(scores[static_cast<int>(FlightPhase::APOGEE)].falsePositive);
+    TEST_ASSERT_TRUE(scores[static_cast<int>(FlightPhase::DESCENT)].falsePositive);
+    TEST_ASSERT_TRUE(scores[static_cast<int>(FlightPhase::LANDED)].missed);
+
+    // Tighter tolerance: the early apogee now counts against the detector as well.
+    TEST_ASSERT_EQUAL_INT(3, scoreFlightEvents(reference, detected, 500, scores));
+}
+
+void test_replay_detects_synthetic_flight() {
+    std::mt19937 rng(5);
+    FlightReplayer replay;
+    ReplaySample s{};
+    replay.arm(0);
+    for (int i = 0; i < 400 * 40; ++i) {
+        flightSample(i, rng, &s);
+        replay.feed(s);
+    }
+    const FlightEvents& ev = replay.events();
+    TEST_ASSERT_TRUE(ev.seen[static_cast<int>(FlightPhase::LAUNCH)]);
+    TEST_ASSERT_TRUE(ev.seen[static_cast<int>(FlightPhase::APOGEE)]);
+    TEST_ASSERT_TRUE(ev.seen[static_cast<int>(FlightPhase::DESCENT)]);
+    const double launchS = ev.timeUs[static_cast<int>(FlightPhase::LAUNCH)] / 1e6 - 2.0;
+    const double apogeeS = ev.timeUs[static_cast<int>(FlightPhase::APOGEE)] / 1e6 - 2.0;
+    printf("launch detected %+.3f s after ignition, apogee %+.3f s after true apogee\n", launchS, apogeeS - kApogeeS);
+    TEST_ASSERT_TRUE(launchS >= 0.1 && launchS < 0.15);
+    // APOGEE_DETECTION_TIME (500 ms) of velocity below -0.5 m/s, which free fall reaches 0.05 s
+    // past apogee.
+    TEST_ASSERT_TRUE(apogeeS - kApogeeS > 0.5 && apogeeS - kApogeeS < 0.7);
+    // Pad reference removed: the filter tracks height above the pad, not the 300 m datum.
+    TEST_ASSERT_TRUE(fabsf(replay.state().maxAltitude - 2289.5f) < 3.0f);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_parse_data_csv_line);
+    RUN_TEST(test_phase_names_round_trip);
+    RUN_TEST(test_raw_from_g_saturates);
+    RUN_TEST(test_scoring);
+    RUN_TEST(test_replay_detects_synthetic_flight);
+    return UNITY_END();
+}
@@ -0,0 +1,109 @@
+// Host-side tests for FlightSim (1-DOF Monte Carlo flights through the detection pipeline).
+// Run with: pio test -e native -f native/test_flight_sim
+
+#include <unity.h>
+
+#include <math.h>
+#include <stdio.h>
+
+#include "FlightSim.h"
+
+void setUp() {}
+void tearDown() {}
+
+void test_thrust_curve() {
+    const ThrustCurve c = ThrustCurve::defaultMotor();
+    TEST_ASSERT_TRUE(fabsf(c.burnTimeS() - 1.6f) < 1e-6f);
+    TEST_ASSERT_TRUE(fabsf(c.at(0.025f) - 160.0f) < 0.01f);   // ramp to the first point
+    TEST_ASSERT_TRUE(fabsf(c.at(0.70f) - 230.0f) < 0.01f);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, c.at(-0.1f));
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, c.at(2.0f));
+    TEST_ASSERT_TRUE(fabsf(c.impulseNs() - 330.5f) < 0.1f);
+
+    ThrustCurve bad;
+    TEST_ASSERT_TRUE(bad.add(0.1f, 10.0f));
+    TEST_ASSERT_FALSE(bad.add(0.1f, 20.0f));
+}
+
+void test_seed_is_reproducible() {
+    const SimConfig cfg;
+    const FlightDetectorConfig det = FlightStateMachine::defaultDetectorConfig();
+    const SimFlightResult a = simulateFlight(cfg, det, 42);
+    const SimFlightResult b = simulateFlight(cfg, det, 42);
+    const SimFlightResult c = simulateFlight(cfg, det, 43);
+    TEST_ASSERT_EQUAL_FLOAT(a.trueApogeeM, b.trueApogeeM);
+    TEST_ASSERT_EQUAL_FLOAT(a.apogeeDetectS, b.apogeeDetectS);
+    TEST_ASSERT_EQUAL_UINT32(a.samples, b.samples);
+    TEST_ASSERT_TRUE(a.trueApogeeM != c.trueApogeeM);
+}
+
+void test_nominal_flight_is_detected() {
+    const SimConfig cfg;
+    const SimFlightResult r = simulateFlight(cfg, FlightStateMachine::defaultDetectorConfig(), 7);
+    printf("apogee %.0f m at %.2f s (Mach %.2f); detected launch +%.3f s, apogee %+.3f s, landed %+.2f s\n",
+           r.trueApogeeM, r.trueApogeeS, r.maxMach, r.launchDetectS - r.ignitionS, r.apogeeDetectS - r.trueApogeeS,
+           r.landedDetectS - r.landingS);
+    TEST_ASSERT_TRUE(r.trueApogeeM > 400.0f && r.trueApogeeM < 1000.0f);
+    TEST_ASSERT_TRUE(r.launchDetected && r.apogeeDetected && r.landedDetected);
+    TEST_ASSERT_FALSE(r.earlyApogee);
+    TEST_ASSERT_TRUE(r.launchDetectS - r.ignitionS >= 0.1f && r.launchDetectS - r.ignitionS < 0.2f);
+    // -0.5 m/s is reached ~0.05 s after apogee, then the 500 ms window.
+    TEST_ASSERT_TRUE(r.apogeeDetectS - r.trueApogeeS > 0.5f && r.apogeeDetectS - r.trueApogeeS < 0.7f);
+    TEST_ASSERT_TRUE(r.landingS > 0.0f && r.landedDetectS > r.landingS - 2.0f);
+}
+
+void test_shorter_apogee_window_loses_less_altitude() {
+    const SimConfig cfg;
+    FlightDetectorConfig fast = FlightStateMachine::defaultDetectorConfig();
+    fast.apogeeDetectionMs = 100;
+    const SimFlightResult slow = simulateFlight(cfg, FlightStateMachine::defaultDetectorConfig(), 11);
+    const SimFlightResult quick = simulateFlight(cfg, fast, 11);
+    TEST_ASSERT_EQUAL_FLOAT(slow.trueApogeeS, quick.trueApogeeS);  // same flight up to apogee
+    TEST_ASSERT_TRUE(quick.apogeeDetectS < slow.apogeeDetectS - 0.3f);
+    TEST_ASSERT_TRUE(quick.altitudeLostM < slow.altitudeLostM);
+}
+
+void test_deploy_on_predicted_apogee() {
+    const SimConfig cfg;
+    FlightDetectorConfig predict = FlightStateMachine::defaultDetectorConfig();
+    predict.apogeeOnPrediction = true;
+    const SimFlightResult r = simulateFlight(cfg, predict, 7);
+    const SimFlightResult window = simulateFlight(cfg, FlightStateMachine::defaultDetectorConfig(), 7);
+    printf("predicted apogee event %+.3f s, lost %.1f mm (velocity window %.2f m)\n", r.predictedEventS - r.trueApogeeS,
+           r.altitudeLostM * 1000.0f, window.altitudeLostM);
+    TEST_ASSERT_TRUE(r.apogeePredicted && r.apogeeDetected);
+    TEST_ASSERT_EQUAL_FLOAT(r.predictedEventS, r.apogeeDetectS);
+    TEST_ASSERT_TRUE(fabsf(r.apogeeDetectS - r.trueApogeeS) < 0.05f);
+    // Within 50 ms of apogee, climbing or falling, the vehicle is within g t^2 / 2 = 12 mm of it.
+    TEST_ASSERT_TRUE(fabsf(r.altitudeLostM) < 0.012f);
+    TEST_ASSERT_TRUE(window.altitudeLostM > 1.0f);
+}
+
+void test_saturation_and_transonic_flight() {
+    // Three times the motor: supersonic, boost above 64 g clips at the range limit, and the
+    // transonic pressure excursion has to be survived by the filter's gate.
+    SimConfig cfg;
+    for (int i = 0; i < cfg.motor.count; ++i) {
+        cfg.motor.thrustN[i] *= 3.0f;
+    }
+    cfg.propellantKg *= 3.0f;
+    cfg.dryMassKg = 0.3f;
+    cfg.transonicSpikePa = 0.0f;
+    const SimFlightResult r = simulateFlight(cfg, FlightStateMachine::defaultDetectorConfig(), 3);
+    printf("hot flight: apogee %.0f m, Mach %.2f, apogee detect %+.3f s\n", r.trueApogeeM, r.maxMach,
+           r.apogeeDetectS - r.trueApogeeS);
+    TEST_ASSERT_TRUE(r.maxMach > 1.0f);
+    TEST_ASSERT_TRUE(r.launchDetected && r.apogeeDetected);
+    TEST_ASSERT_FALSE(r.earlyApogee);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_thrust_curve);
+    RUN_TEST(test_seed_is_reproducible);
+    RUN_TEST(test_nominal_flight_is_detected);
+    RUN_TEST(test_shorter_apogee_window_loses_less_altitude);
+    RUN_TEST(test_deploy_on_predicted_apogee);
+    RUN_TEST(test_saturation_and_transonic_flight);
+    return UNITY_END();
+}
@@ -0,0 +1,385 @@
+// Host-side tests for FlightStateMachine driven by sample timestamps (no wall clock).
+// Run with: pio test -e native -f native/test_flight_state
+
+#include <unity.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include <chrono>
+
+#include "FlightState.h"
+#include "HostClock.h"
+#include "RawAccel.h"
+
+namespace {
+
+constexpr uint8_t kRange = 3;  // 64 g
+constexpr uint32_t kPeriodUs = 2500;  // 400 Hz
+
+// Squared magnitude of an acceleration of g along one axis, in counts at kRange.
+uint32_t magSq(float g) {
+    const int16_t raw[3] = {0, 0, static_cast<int16_t>(g * rawAccelCountsPerG(kRange))};
+    return rawAccelMagnitudeSq(raw);
+}
+
+// Feed samples until the phase changes or maxSamples pass; returns the sample time of the change.
+struct Feed {
+    FlightStateMachine& fsm;
+    uint32_t us;
+
+    bool run(int maxSamples, float altitude, float g, float velocity, uint32_t* changedAtUs) {
+        for (int i = 0; i < maxSamples; ++i) {
+            us += kPeriodUs;
+            if (fsm.update(us, altitude, magSq(g), kRange, velocity)) {
+                *changedAtUs = us;
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+// Samples that satisfy one transition guard (and, where possible, no other).
+struct Stimulus {
+    const char* guard;
+    float altitude;
+    float g;
+    float velocity;
+    float acceleration;  // m/s^2 for the apogee predictor; NAN: none
+};
+
+const Stimulus kStimuli[] = {
+    {"launch accel", 0.0f, 8.0f, 0.0f, NAN},
+    {"predicted apogee", 800.0f, 0.0f, 0.0f, -9.80665f},  // coasting, at the top: time to apogee 0
+    {"descending", 800.0f, 0.0f, -2.0f, NAN},
+    {"falling", 600.0f, 0.0f, -8.0f, NAN},
+    {"at rest", 1.0f, 1.0f, 0.0f, NAN},
+};
+constexpr int kStimulusCount = sizeof(kStimuli) / sizeof(kStimuli[0]);
+
+const Stimulus* stimulusFor(const char* guard) {
+    for (const Stimulus& s : kStimuli) {
+        if (strcmp(s.guard, guard) == 0) {
+            return &s;
+        }
+    }
+    return nullptr;
+}
+
+// Hold a stimulus for up to durationUs from phase; returns the sample time of the first change.
+bool hold(FlightStateMachine& fsm, const Stimulus& s, uint32_t startUs, uint32_t durationUs, uint32_t* changedAtUs) {
+    for (uint32_t us = startUs; us - startUs <= durationUs; us += kPeriodUs) {
+        if (fsm.update(us, s.altitude, magSq(s.g), kRange, s.velocity, s.acceleration)) {
+            *changedAtUs = us;
+            return true;
+        }
+    }
+    return false;
+}
+
+FlightDetectorConfig predictingConfig() {
+    FlightDetectorConfig config = FlightStateMachine::defaultDetectorConfig();
+    config.apogeeOnPrediction = true;
+    return config;
+}
+
+}  // namespace
+
+void setUp() { hostClockReset(); }
+void tearDown() {}
+
+void test_launch_window_runs_on_sample_time() {
+    FlightStateMachine fsm;
+    fsm.init();
+    fsm.setPhase(FlightPhase::ARMED);
+    Feed feed{fsm, 0};  // sample time starting at 0 is fine: no sentinel values
+    uint32_t changedAt = 0;
+    TEST_ASSERT_FALSE(feed.run(200, 0.0f, 1.0f, 0.0f, &changedAt));
+    const uint32_t boostStart = feed.us + kPeriodUs;
+    TEST_ASSERT_TRUE(feed.run(1000, 0.0f, 8.0f, 0.0f, &changedAt));
+    TEST_ASSERT_EQUAL(FlightPhase::LAUNCH, fsm.getPhase());
+    TEST_ASSERT_EQUAL_UINT32(boostStart + 100000, changedAt);
+    TEST_ASSERT_EQUAL_UINT32(changedAt / 1000, fsm.getState().launchTime);
+    // Nothing touched the (virtual) wall clock.
+    TEST_ASSERT_EQUAL_UINT32(0, static_cast<uint32_t>(hostClockUs()));
+}
+
+void test_dropout_restarts_launch_window() {
+    FlightStateMachine fsm;
+    fsm.init();
+    fsm.setPhase(FlightPhase::ARMED);
+    Feed feed{fsm, 1000000};
+    uint32_t changedAt = 0;
+    TEST_ASSERT_FALSE(feed.run(30, 0.0f, 8.0f, 0.0f, &changedAt));  // 75 ms high
+    TEST_ASSERT_FALSE(feed.run(1, 0.0f, 1.0f, 0.0f, &changedAt));   // one quiet sample
+    const uint32_t restart = feed.us + kPeriodUs;
+    TEST_ASSERT_TRUE(feed.run(1000, 0.0f, 8.0f, 0.0f, &changedAt));
+    TEST_ASSERT_EQUAL_UINT32(restart + 100000, changedAt);
+}
+
+void test_apogee_and_landing_windows() {
+    FlightStateMachine fsm;
+    fsm.init();
+    fsm.setPhase(FlightPhase::LAUNCH);
+    Feed feed{fsm, 5000000};
+    uint32_t changedAt = 0;
+    TEST_ASSERT_FALSE(feed.run(400, 500.0f, 0.0f, 20.0f, &changedAt));
+    const uint32_t falling = feed.us + kPeriodUs;
+    TEST_ASSERT_TRUE(feed.run(1000, 500.0f, 0.0f, -2.0f, &changedAt));
+    TEST_ASSERT_EQUAL(FlightPhase::APOGEE, fsm.getPhase());
+    TEST_ASSERT_EQUAL_UINT32(falling + 500000, changedAt);
+
+    TEST_ASSERT_TRUE(feed.run(10, 490.0f, 0.0f, -8.0f, &changedAt));
+    TEST_ASSERT_EQUAL(FlightPhase::DESCENT, fsm.getPhase());
+
+    TEST_ASSERT_FALSE(feed.run(2000, 100.0f, 1.0f, -8.0f, &changedAt));  // still high up
+    const uint32_t down = feed.us + kPeriodUs;
+    TEST_ASSERT_TRUE(feed.run(2000, 1.0f, 1.0f, 0.0f, &changedAt));
+    TEST_ASSERT_EQUAL(FlightPhase::LANDED, fsm.getPhase());
+    TEST_ASSERT_EQUAL_UINT32(down + 2000000, changedAt);
+}
+
+void test_windows_survive_micros_wrap() {
+    FlightStateMachine fsm;
+    fsm.init();
+    fsm.setPhase(FlightPhase::ARMED);
+    Feed feed{fsm, 0xFFFFFFFFu - 50000u};  // wraps 50 ms into the boost
+    uint32_t changedAt = 0;
+    const uint32_t boostStart = feed.us + kPeriodUs;
+    TEST_ASSERT_TRUE(feed.run(1000, 0.0f, 8.0f, 0.0f, &changedAt));
+    TEST_ASSERT_EQUAL_UINT32(boostStart + 100000u, changedAt);
+}
+
+void test_times_keep_counting_across_micros_wrap() {
+    // Launch detected 50 ms after micros() wraps: the ms fields carry on from before the wrap
+    // instead of restarting near 0, so launch, apogee and landing stay in order.
+    FlightStateMachine fsm;
+    fsm.init();
+    fsm.setPhase(FlightPhase::ARMED);
+    Feed feed{fsm, 0xFFFFFFFFu - 50000u};
+    const uint64_t boostStartUs = static_cast<uint64_t>(feed.us) + kPeriodUs;
+    uint32_t changedAt = 0;
+    TEST_ASSERT_TRUE(feed.run(1000, 0.0f, 8.0f, 0.0f, &changedAt));
+    TEST_ASSERT_TRUE(changedAt < feed.us + kPeriodUs);  // wrapped
+    const FlightState& state = fsm.getState();
+    const uint64_t launchUs = boostStartUs + 100000u;
+    TEST_ASSERT_EQUAL_UINT32(static_cast<uint32_t>(launchUs / 1000), state.launchTime);
+    TEST_ASSERT_EQUAL_UINT32(state.launchTime, state.timestamp);
+
+    TEST_ASSERT_TRUE(feed.run(1000, 500.0f, 0.0f, -2.0f, &changedAt));
+    TEST_ASSERT_EQUAL(FlightPhase::APOGEE, fsm.getPhase());
+    TEST_ASSERT_EQUAL_UINT32(static_cast<uint32_t>((launchUs + kPeriodUs + 500000u) / 1000), state.apogeeTime);
+    TEST_ASSERT_TRUE(feed.run(10, 490.0f, 0.0f, -8.0f, &changedAt));
+    TEST_ASSERT_TRUE(feed.run(2000, 1.0f, 1.0f, 0.0f, &changedAt));
+    TEST_ASSERT_EQUAL(FlightPhase::LANDED, fsm.getPhase());
+    TEST_ASSERT_TRUE(state.landedTime > state.apogeeTime + 2000);
+
+    const uint32_t landedTime = state.landedTime;
+    fsm.setPhase(FlightPhase::UNARMED);
+    TEST_ASSERT_EQUAL_UINT32(landedTime, state.timestamp);
+    fsm.reset();
+    TEST_ASSERT_EQUAL_UINT32(landedTime, state.timestamp);
+}
+
+void test_velocity_differenced_from_sample_time() {
+    FlightStateMachine fsm;
+    fsm.init();
+    fsm.update(1000000, 10.0f, magSq(1.0f), kRange);
+    fsm.update(1010000, 10.5f, magSq(1.0f), kRange);  // +0.5 m in 10 ms
+    TEST_ASSERT_TRUE(fabsf(fsm.getState().velocity - 50.0f) < 0.01f);
+}
+
+// Drag-free coast from 100 m/s at LAUNCH: apogee 10.197 s later. Returns the sample time at
+// which the phase changed (0 if it did not within 12 s) and leaves fsm at that sample.
+uint32_t coastThroughApogee(FlightStateMachine& fsm, uint32_t startUs) {
+    constexpr float kG = 9.80665f;
+    fsm.setPhase(FlightPhase::LAUNCH);
+    for (uint32_t i = 0; i <= 12 * 400; ++i) {
+        const float t = i * kPeriodUs * 1e-6f;
+        const float v = 100.0f - kG * t;
+        const float h = 100.0f * t - 0.5f * kG * t * t;
+        const uint32_t us = startUs + i * kPeriodUs;
+        if (fsm.update(us, h, magSq(0.0f), kRange, v, -kG)) {
+            return us;
+        }
+    }
+    return 0;
+}
+
+void test_predicted_apogee_event() {
+    const uint32_t start = 20000000;
+    const uint32_t apogeeUs = start + 10197162;
+    FlightStateMachine fsm;
+    fsm.init();
+    const uint32_t detectedAt = coastThroughApogee(fsm, start);
+    const FlightState& state = fsm.getState();
+    // Reported only: APOGEE still comes from the velocity window, 0.5 m/s + 500 ms after apogee.
+    TEST_ASSERT_EQUAL(FlightPhase::APOGEE, fsm.getPhase());
+    TEST_ASSERT_TRUE(detectedAt > apogeeUs + 500000 && detectedAt < apogeeUs + 560000);
+    TEST_ASSERT_TRUE(state.apogeePredicted);
+    // 50 ms lead, 50 ms window: the event lands on the predicted apogee.
+    TEST_ASSERT_TRUE(state.apogeePredictedTime + 5 >= apogeeUs / 1000 && state.apogeePredictedTime <= apogeeUs / 1000 + 5);
+    TEST_ASSERT_TRUE(fabsf(state.predictedApogee - 509.858f) < 0.5f);
+
+    FlightDetectorConfig config = FlightStateMachine::defaultDetectorConfig();
+    config.apogeeOnPrediction = true;
+    config.apogeeLeadMs = 1000;  // e.g. to cover a slow deployment
+    fsm.setDetectorConfig(config);
+    fsm.init();
+    const uint32_t predictedAt = coastThroughApogee(fsm, start);
+    TEST_ASSERT_EQUAL(FlightPhase::APOGEE, fsm.getPhase());
+    TEST_ASSERT_TRUE(predictedAt + 950000 - 5000 <= apogeeUs && predictedAt + 950000 + 5000 >= apogeeUs);
+    TEST_ASSERT_EQUAL_UINT32(predictedAt / 1000, state.apogeeTime);
+    TEST_ASSERT_EQUAL_UINT32(predictedAt / 1000, state.apogeePredictedTime);
+}
+
+void test_no_prediction_without_acceleration() {
+    FlightStateMachine fsm;
+    fsm.init();
+    fsm.setPhase(FlightPhase::LAUNCH);
+    Feed feed{fsm, 0};
+    uint32_t changedAt = 0;
+    TEST_ASSERT_FALSE(feed.run(400, 500.0f, 0.0f, 20.0f, &changedAt));
+    TEST_ASSERT_TRUE(feed.run(1000, 500.0f, 0.0f, -2.0f, &changedAt));
+    TEST_ASSERT_FALSE(fsm.getState().apogeePredictionValid);
+    TEST_ASSERT_FALSE(fsm.getState().apogeePredicted);
+}
+
+void test_transition_table_rows() {
+    using T = FlightStateMachine::Transitions;
+    TEST_ASSERT_EQUAL_UINT32(5, T::kRows);
+    const struct {
+        FlightPhase from;
+        FlightPhase to;
+        bool debounced;
+        const char* guard;
+    } expected[] = {
+        {FlightPhase::ARMED, FlightPhase::LAUNCH, true, "launch accel"},
+        {FlightPhase::LAUNCH, FlightPhase::APOGEE, false, "predicted apogee"},
+        {FlightPhase::LAUNCH, FlightPhase::APOGEE, true, "descending"},
+        {FlightPhase::APOGEE, FlightPhase::DESCENT, false, "falling"},
+        {FlightPhase::DESCENT, FlightPhase::LANDED, true, "at rest"},
+    };
+    for (size_t i = 0; i < T::kRows; ++i) {
+        TEST_ASSERT_EQUAL(expected[i].from, T::kInfo[i].from);
+        TEST_ASSERT_EQUAL(expected[i].to, T::kInfo[i].to);
+        TEST_ASSERT_EQUAL(expected[i].debounced, T::kInfo[i].debounced);
+        TEST_ASSERT_EQUAL_STRING(expected[i].guard, T::kInfo[i].guard);
+        TEST_ASSERT_NOT_NULL(stimulusFor(T::kInfo[i].guard));
+    }
+}
+
+void test_every_transition_fires_after_its_window() {
+    using T = FlightStateMachine::Transitions;
+    for (size_t i = 0; i < T::kRows; ++i) {
+        const TransitionInfo<FlightPhase>& row = T::kInfo[i];
+        FlightStateMachine fsm;
+        fsm.setDetectorConfig(predictingConfig());
+        fsm.init();
+        fsm.setPhase(row.from);
+        const FlightDetectorConfig& c = fsm.detectorConfig();
+        uint32_t windowMs = 0;
+        if (row.to == FlightPhase::LAUNCH) {
+            windowMs = c.launchDetectionMs;
+        } else if (strcmp(row.guard, "predicted apogee") == 0) {
+            windowMs = c.apogeePredictMs;  // the event's own window, not the row's
+        } else if (row.to == FlightPhase::APOGEE) {
+            windowMs = c.apogeeDetectionMs;
+        } else if (row.to == FlightPhase::LANDED) {
+            windowMs = c.landedDetectionMs;
+        }
+        const uint32_t start = 7000000;
+        uint32_t changedAt = 0;
+        TEST_ASSERT_TRUE_MESSAGE(hold(fsm, *stimulusFor(row.guard), start, windowMs * 1000 + 10000, &changedAt),
+                                 row.guard);
+        TEST_ASSERT_EQUAL_MESSAGE(row.to, fsm.getPhase(), row.guard);
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE(start + windowMs * 1000, changedAt, row.guard);
+    }
+}
+
+void test_phases_only_take_listed_transitions() {
+    // Every phase x every stimulus: the phase stays or moves along one of its own rows. UNARMED has
+    // none: launch-level acceleration while disarmed is not a launch.
+    using T = FlightStateMachine::Transitions;
+    for (int p = 0; p < 7; ++p) {
+        const FlightPhase phase = static_cast<FlightPhase>(p);
+        for (int k = 0; k < kStimulusCount; ++k) {
+            FlightStateMachine fsm;
+            fsm.setDetectorConfig(predictingConfig());
+            fsm.init();
+            fsm.setPhase(phase);
+            uint32_t changedAt = 0;
+            const bool changed = hold(fsm, kStimuli[k], 1000000, 3000000, &changedAt);
+            bool allowed = !changed;
+            for (size_t i = 0; i < T::kRows; ++i) {
+                allowed = allowed || (T::kInfo[i].from == phase && T::kInfo[i].to == fsm.getPhase());
+            }
+            TEST_ASSERT_TRUE_MESSAGE(allowed, kStimuli[k].guard);
+            if (phase == FlightPhase::UNARMED || phase == FlightPhase::LANDED || phase == FlightPhase::ERROR) {
+                TEST_ASSERT_FALSE(changed);
+            }
+        }
+    }
+}
+
+void test_set_phase_restarts_windows() {
+    FlightStateMachine fsm;
+    fsm.init();
+    fsm.setPhase(FlightPhase::ARMED);
+    uint32_t changedAt = 0;
+    const Stimulus& launch = *stimulusFor("launch accel");
+    TEST_ASSERT_FALSE(hold(fsm, launch, 0, 80000, &changedAt));  // 80 ms of boost, then disarm/re-arm
+    fsm.setPhase(FlightPhase::UNARMED);
+    fsm.setPhase(FlightPhase::ARMED);
+    TEST_ASSERT_TRUE(hold(fsm, launch, 100000, 200000, &changedAt));
+    TEST_ASSERT_EQUAL_UINT32(200000, changedAt);
+}
+
+void bench_flights_per_second() {
+    // A 60 s flight at 400 Hz, start to landing, as fast as the host runs it.
+    using Clock = std::chrono::steady_clock;
+    constexpr int kFlights = 50;
+    constexpr int kSamples = 60 * 400;
+    const uint32_t launchSq = magSq(8.0f);
+    const uint32_t coastSq = magSq(0.2f);
+    const uint32_t restSq = magSq(1.0f);
+    int landed = 0;
+    const auto t0 = Clock::now();
+    for (int f = 0; f < kFlights; ++f) {
+        FlightStateMachine fsm;
+        fsm.init();
+        fsm.setPhase(FlightPhase::ARMED);
+        for (int i = 0; i < kSamples; ++i) {
+            const float t = i / 400.0f;
+            const float v = t < 2.0f ? 80.0f * t : (t < 18.0f ? 160.0f - 10.0f * (t - 2.0f) : -8.0f);
+            const float h = t < 40.0f ? 1000.0f : 1.0f;
+            const uint32_t sq = t < 2.0f ? launchSq : (t < 40.0f ? coastSq : restSq);
+            const float a = t < 2.0f ? 80.0f : (t < 18.0f ? -10.0f : 0.0f);
+            fsm.update(static_cast<uint32_t>(i) * kPeriodUs, h, sq, kRange, v, a);
+        }
+        landed += fsm.getPhase() == FlightPhase::LANDED;
+    }
+    const double s = std::chrono::duration<double>(Clock::now() - t0).count();
+    printf("%d flights of %d samples: %.2f ms per flight (%.0fx real time)\n", kFlights, kSamples,
+           1e3 * s / kFlights, 60.0 * kFlights / s);
+    TEST_ASSERT_EQUAL_INT(kFlights, landed);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_launch_window_runs_on_sample_time);
+    RUN_TEST(test_dropout_restarts_launch_window);
+    RUN_TEST(test_apogee_and_landing_windows);
+    RUN_TEST(test_windows_survive_micros_wrap);
+    RUN_TEST(test_times_keep_counting_across_micros_wrap);
+    RUN_TEST(test_velocity_differenced_from_sample_time);
+    RUN_TEST(test_predicted_apogee_event);
+    RUN_TEST(test_no_prediction_without_acceleration);
+    RUN_TEST(test_transition_table_rows);
+    RUN_TEST(test_every_transition_fires_after_its_window);
+    RUN_TEST(test_phases_only_take_listed_transitions);
+    RUN_TEST(test_set_phase_restarts_windows);
+    RUN_TEST(bench_flights_per_second);
+    return UNITY_END();
+}
@@ -0,0 +1,178 @@
+// Host-side tests and micro-benchmark for IoPriorityQueue (the spiFlash write queue).
+// Run with: pio test -e native -f native/test_io_queue
+
+#include <unity.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <queue>
+#include <tuple>
+#include <vector>
+
+#include "IoQueue.h"
+
+namespace {
+
+using Queue = IoPriorityQueue<6, 256>;
+
+bool popInto(Queue& q, uint8_t* cls, char* out, size_t* bytes) {
+    const char* p = nullptr;
+    if (!q.peek(cls, &p, bytes)) {
+        return false;
+    }
+    memcpy(out, p, *bytes);
+    q.pop(*cls);
+    return true;
+}
+
+}  // namespace
+
+void setUp() {}
+void tearDown() {}
+
+void test_fifo_within_class() {
+    static Queue q;
+    q.clear();
+    TEST_ASSERT_TRUE(q.push(3, "aa", 2));
+    TEST_ASSERT_TRUE(q.push(3, "bbb", 3));
+
+    uint8_t cls = 0;
+    char out[8] = {0};
+    size_t n = 0;
+    TEST_ASSERT_TRUE(popInto(q, &cls, out, &n));
+    TEST_ASSERT_EQUAL(3, cls);
+    TEST_ASSERT_EQUAL(2, n);
+    TEST_ASSERT_EQUAL_MEMORY("aa", out, 2);
+    TEST_ASSERT_TRUE(popInto(q, &cls, out, &n));
+    TEST_ASSERT_EQUAL(3, n);
+    TEST_ASSERT_EQUAL_MEMORY("bbb", out, 3);
+    TEST_ASSERT_TRUE(q.empty());
+}
+
+void test_priority_order() {
+    static Queue q;
+    q.clear();
+    TEST_ASSERT_TRUE(q.push(5, "opt", 3));
+    TEST_ASSERT_TRUE(q.push(3, "std", 3));
+    TEST_ASSERT_TRUE(q.push(0, "man", 3));
+
+    uint8_t cls = 0;
+    char out[8] = {0};
+    size_t n = 0;
+    TEST_ASSERT_TRUE(popInto(q, &cls, out, &n));
+    TEST_ASSERT_EQUAL(0, cls);
+    TEST_ASSERT_TRUE(popInto(q, &cls, out, &n));
+    TEST_ASSERT_EQUAL(3, cls);
+    TEST_ASSERT_TRUE(popInto(q, &cls, out, &n));
+    TEST_ASSERT_EQUAL(5, cls);
+    TEST_ASSERT_FALSE(popInto(q, &cls, out, &n));
+}
+
+void test_full_ring_reports_backpressure() {
+    static Queue q;
+    q.clear();
+    char rec[50];
+    memset(rec, 'x', sizeof(rec));
+
+    int accepted = 0;
+    while (q.push(3, rec, sizeof(rec))) {
+        ++accepted;
+    }
+    // 256-byte ring holds four 52-byte records (50 payload + 2 length).
+    TEST_ASSERT_EQUAL(4, accepted);
+    TEST_ASSERT_EQUAL(1, q.droppedCount());
+    // Other classes are unaffected by a full ring.
+    TEST_ASSERT_TRUE(q.push(2, rec, sizeof(rec)));
+    // Oversized and invalid-class records are rejected.
+    char big[Queue::kMaxRecordBytes + 1] = {0};
+    TEST_ASSERT_FALSE(q.push(1, big, sizeof(big)));
+    TEST_ASSERT_FALSE(q.push(6, rec, 1));
+}
+
+void test_wraparound_keeps_records_contiguous() {
+    static Queue q;
+    q.clear();
+    char rec[70];
+    char out[80];
+    uint8_t cls = 0;
+    size_t n = 0;
+
+    // Push/pop variable sizes many times so records straddle the end of the ring.
+    uint32_t pushed = 0;
+    uint32_t popped = 0;
+    for (int round = 0; round < 2000; ++round) {
+        const size_t len = 1 + (round * 7) % sizeof(rec);
+        memset(rec, static_cast<char>(pushed & 0x7F), len);
+        if (q.push(4, rec, len)) {
+            ++pushed;
+        }
+        if (round % 3 != 0 && popInto(q, &cls, out, &n)) {
+            TEST_ASSERT_EQUAL(static_cast<char>(popped & 0x7F), out[0]);
+            TEST_ASSERT_EQUAL(static_cast<char>(popped & 0x7F), out[n - 1]);
+            ++popped;
+        }
+    }
+    while (popInto(q, &cls, out, &n)) {
+        TEST_ASSERT_EQUAL(static_cast<char>(popped & 0x7F), out[0]);
+        ++popped;
+    }
+    TEST_ASSERT_EQUAL(pushed, popped);
+    TEST_ASSERT_EQUAL(0, q.usedBytes(4));
+    TEST_ASSERT_LESS_OR_EQUAL(256, q.highWater(4));
+}
+
+void bench_enqueue_dequeue() {
+    using Clock = std::chrono::steady_clock;
+    constexpr int kIterations = 1000000;
+    const char line[] = "123456,789,0.123,-0.456,9.810,9.830,1234.56,3\r\n";
+    const size_t len = sizeof(line) - 1;
+
+    static IoPriorityQueue<6, 2048> ring;
+    size_t sink = 0;
+    auto t0 = Clock::now();
+    for (int i = 0; i < kIterations; ++i) {
+        ring.push(static_cast<uint8_t>(3 + (i & 1)), line, len);
+        uint8_t cls;
+        const char* p;
+        size_t n;
+        if (ring.peek(&cls, &p, &n)) {
+            sink += static_cast<unsigned char>(p[n - 1]);
+            ring.pop(cls);
+        }
+    }
+    auto t1 = Clock::now();
+
+    // Baseline: the previous std::priority_queue<tuple<char, vector<char>>> implementation.
+    struct Cmp {
+        bool operator()(const std::tuple<char, std::vector<char>>& l,
+                        const std::tuple<char, std::vector<char>>& r) const {
+            return std::get<0>(l) > std::get<0>(r);
+        }
+    };
+    std::priority_queue<std::tuple<char, std::vector<char>>, std::vector<std::tuple<char, std::vector<char>>>, Cmp> pq;
+    auto t2 = Clock::now();
+    for (int i = 0; i < kIterations; ++i) {
+        pq.push(std::make_tuple(static_cast<char>(3 + (i & 1)), std::vector<char>(line, line + len)));
+        std::tuple<char, std::vector<char>> item = pq.top();
+        pq.pop();
+        sink += static_cast<unsigned char>(std::get<1>(item).back());
+    }
+    auto t3 = Clock::now();
+
+    const double ringNs = std::chrono::duration<double, std::nano>(t1 - t0).count() / kIterations;
+    const double pqNs = std::chrono::duration<double, std::nano>(t3 - t2).count() / kIterations;
+    printf("IoPriorityQueue: %.1f ns per enqueue+dequeue (%zu-byte record)\n", ringNs, len);
+    printf("std::priority_queue baseline: %.1f ns per enqueue+dequeue\n", pqNs);
+    TEST_ASSERT_GREATER_THAN(0u, sink);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_fifo_within_class);
+    RUN_TEST(test_priority_order);
+    RUN_TEST(test_full_ring_reports_backpressure);
+    RUN_TEST(test_wraparound_keeps_records_contiguous);
+    RUN_TEST(bench_enqueue_dequeue);
+    return UNITY_END();
+}
@@ -0,0 +1,78 @@
+// Host-side tests for LatencyHistogram (log2 storage latency buckets).
+// Run with: pio test -e native -f native/test_latency_histogram
+
+#include <unity.h>
+
+#include <string.h>
+
+#include "LatencyHistogram.h"
+
+namespace {
+uint32_t fakeNowUs = 0;
+uint32_t fakeNow() { return fakeNowUs; }
+}  // namespace
+
+void setUp() { fakeNowUs = 0; }
+void tearDown() {}
+
+void test_bucket_boundaries() {
+    TEST_ASSERT_EQUAL_UINT8(0, LatencyHistogram::bucketFor(0));
+    TEST_ASSERT_EQUAL_UINT8(0, LatencyHistogram::bucketFor(1));
+    TEST_ASSERT_EQUAL_UINT8(1, LatencyHistogram::bucketFor(2));
+    TEST_ASSERT_EQUAL_UINT8(1, LatencyHistogram::bucketFor(3));
+    TEST_ASSERT_EQUAL_UINT8(10, LatencyHistogram::bucketFor(1024));
+    TEST_ASSERT_EQUAL_UINT8(10, LatencyHistogram::bucketFor(2047));
+    TEST_ASSERT_EQUAL_UINT8(LatencyHistogram::kBuckets - 1, LatencyHistogram::bucketFor(0xFFFFFFFFu));
+}
+
+void test_count_mean_max_and_percentiles() {
+    LatencyHistogram h;
+    for (int i = 0; i < 99; ++i) {
+        h.record(100);  // bucket [64, 128)
+    }
+    h.record(40000);  // one slow SD write
+    TEST_ASSERT_EQUAL_UINT32(100, h.count());
+    TEST_ASSERT_EQUAL_UINT32(40000, h.maxUs());
+    TEST_ASSERT_EQUAL_UINT32((99 * 100 + 40000) / 100, h.meanUs());
+    TEST_ASSERT_EQUAL_UINT32(127, h.percentileUs(50));
+    TEST_ASSERT_EQUAL_UINT32(127, h.percentileUs(99));
+    TEST_ASSERT_EQUAL_UINT32(40000, h.percentileUs(100));
+
+    h.reset();
+    TEST_ASSERT_EQUAL_UINT32(0, h.count());
+    TEST_ASSERT_EQUAL_UINT32(0, h.percentileUs(99));
+}
+
+void test_scope_records_block_duration() {
+    LatencyHistogram h;
+    {
+        LatencyHistogram::Scope t(h, fakeNow);
+        fakeNowUs += 300;
+    }
+    TEST_ASSERT_EQUAL_UINT32(1, h.count());
+    TEST_ASSERT_EQUAL_UINT32(300, h.maxUs());
+    TEST_ASSERT_EQUAL_UINT32(1, h.bucket(8));
+}
+
+void test_format_lists_non_empty_buckets() {
+    LatencyHistogram h;
+    h.record(5);
+    h.record(300);
+    char line[160];
+    h.format(line, sizeof(line), "sd.writeData");
+    TEST_ASSERT_NOT_NULL(strstr(line, "sd.writeData n=2"));
+    TEST_ASSERT_NOT_NULL(strstr(line, " 4:1 256:1"));
+
+    char tiny[16];
+    TEST_ASSERT_TRUE(h.format(tiny, sizeof(tiny), "sd.writeData") > 0);
+    TEST_ASSERT_EQUAL_UINT32(sizeof(tiny) - 1, strlen(tiny));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_bucket_boundaries);
+    RUN_TEST(test_count_mean_max_and_percentiles);
+    RUN_TEST(test_scope_records_block_duration);
+    RUN_TEST(test_format_lists_non_empty_buckets);
+    return UNITY_END();
+}
@@ -0,0 +1,88 @@
+// Host-side tests for Ms5611Sequencer (non-blocking MS5611 D1/D2 conversion schedule).
+// Run with: pio test -e native -f native/test_ms5611_sequencer
+
+#include <unity.h>
+
+#include "Ms5611Sequencer.h"
+
+void setUp() {}
+void tearDown() {}
+
+void test_conversion_times() {
+    TEST_ASSERT_EQUAL_UINT32(600, ms5611ConversionUs(8));
+    TEST_ASSERT_EQUAL_UINT32(9100, ms5611ConversionUs(12));
+}
+
+void test_temperature_first_then_alternate() {
+    Ms5611Sequencer seq;
+    seq.configure(1000, 1);
+
+    Ms5611Sequencer::Step s = seq.tick(0);
+    TEST_ASSERT_EQUAL(Ms5611Sequencer::NONE, s.read);
+    TEST_ASSERT_EQUAL(Ms5611Sequencer::D2, s.start);
+
+    s = seq.tick(999);  // still converting: nothing to do
+    TEST_ASSERT_EQUAL(Ms5611Sequencer::NONE, s.read);
+    TEST_ASSERT_EQUAL(Ms5611Sequencer::NONE, s.start);
+
+    s = seq.tick(1000);
+    TEST_ASSERT_EQUAL(Ms5611Sequencer::D2, s.read);
+    TEST_ASSERT_EQUAL(Ms5611Sequencer::D1, s.start);
+    TEST_ASSERT_FALSE(s.sampleReady);
+
+    s = seq.tick(2500);
+    TEST_ASSERT_EQUAL(Ms5611Sequencer::D1, s.read);
+    TEST_ASSERT_TRUE(s.sampleReady);
+    TEST_ASSERT_EQUAL(Ms5611Sequencer::D2, s.start);
+    TEST_ASSERT_EQUAL_UINT32(2000, s.readyUs);  // started at 1000, read 500 us late
+}
+
+void test_temperature_reused_for_several_pressures() {
+    Ms5611Sequencer seq;
+    seq.configure(600, 4);
+    uint32_t now = 0;
+    int temperatures = 0;
+    int samples = 0;
+    for (int i = 0; i < 101; ++i) {
+        const Ms5611Sequencer::Step s = seq.tick(now);
+        temperatures += s.read == Ms5611Sequencer::D2;
+        samples += s.sampleReady;
+        now += 600;
+    }
+    // 100 conversions read: 1 temperature then (4 pressure + 1 temperature) repeating.
+    TEST_ASSERT_EQUAL(20, temperatures);
+    TEST_ASSERT_EQUAL(80, samples);
+}
+
+void test_late_ticks_never_wait_and_survive_wrap() {
+    Ms5611Sequencer seq;
+    seq.configure(2300, 1);
+    uint32_t now = 0xFFFFF000u;
+    seq.tick(now);
+    now += 50000;  // loop was blocked far longer than the conversion; wraps past zero
+    const Ms5611Sequencer::Step s = seq.tick(now);
+    TEST_ASSERT_EQUAL(Ms5611Sequencer::D2, s.read);
+    TEST_ASSERT_EQUAL(Ms5611Sequencer::D1, s.start);
+    TEST_ASSERT_EQUAL_UINT32(0xFFFFF000u + 2300u, s.readyUs);
+}
+
+void test_restart_requires_fresh_temperature() {
+    Ms5611Sequencer seq;
+    seq.configure(600, 8);
+    seq.tick(0);
+    seq.tick(600);  // D2 read, D1 started
+    seq.restart();
+    const Ms5611Sequencer::Step s = seq.tick(1200);
+    TEST_ASSERT_EQUAL(Ms5611Sequencer::NONE, s.read);
+    TEST_ASSERT_EQUAL(Ms5611Sequencer::D2, s.start);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_conversion_times);
+    RUN_TEST(test_temperature_first_then_alternate);
+    RUN_TEST(test_temperature_reused_for_several_pressures);
+    RUN_TEST(test_late_ticks_never_wait_and_survive_wrap);
+    RUN_TEST(test_restart_requires_fresh_temperature);
+    return UNITY_END();
+}
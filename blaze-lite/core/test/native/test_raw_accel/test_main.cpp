@@ -0,0 +1,144 @@
+// Host-side tests and micro-benchmark for RawAccel (integer KX134 magnitude/threshold math).
+// Run with: pio test -e native -f native/test_raw_accel
+
+#include <unity.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+#include <vector>
+
+#include "FlightRecord.h"
+#include "RawAccel.h"
+
+namespace {
+
+// The float path this replaces: counts -> g with flightRecordAccelScale(), sqrtf, compare, and
+// *1000 for telemetry.
+struct FloatResult {
+    bool launch;
+    int32_t milliG;
+};
+
+FloatResult floatPath(const int16_t raw[3], uint8_t range, float launchG) {
+    const float scale = flightRecordAccelScale(range);
+    const float x = raw[0] * scale;
+    const float y = raw[1] * scale;
+    const float z = raw[2] * scale;
+    const float magnitude = sqrtf(x * x + y * y + z * z);
+    return FloatResult{magnitude > launchG, static_cast<int32_t>(x * 1000.0f)};
+}
+
+}  // namespace
+
+void setUp() {}
+void tearDown() {}
+
+void test_counts_per_g() {
+    TEST_ASSERT_EQUAL_INT32(4096, rawAccelCountsPerG(0));
+    TEST_ASSERT_EQUAL_INT32(512, rawAccelCountsPerG(3));
+}
+
+void test_magnitude_sq_covers_full_scale() {
+    const int16_t extreme[3] = {-32768, -32768, -32768};
+    TEST_ASSERT_EQUAL_UINT32(3u * 32768u * 32768u, rawAccelMagnitudeSq(extreme));
+    const int16_t oneG[3] = {0, 0, 512};
+    TEST_ASSERT_EQUAL_UINT32(512u * 512u, rawAccelMagnitudeSq(oneG));
+}
+
+void test_threshold_sq() {
+    TEST_ASSERT_EQUAL_UINT32(1024u * 1024u, rawAccelThresholdSq(2.0f, 3));
+    TEST_ASSERT_EQUAL_UINT32(0u, rawAccelThresholdSq(0.0f, 0));
+    TEST_ASSERT_EQUAL_UINT32(0xFFFFFFFFu, rawAccelThresholdSq(20.0f, 0));  // beyond 8g full scale
+    constexpr uint32_t kCompileTime = rawAccelThresholdSq(1.5f, 2);
+    TEST_ASSERT_EQUAL_UINT32(1536u * 1536u, kCompileTime);
+}
+
+void test_milli_g_matches_float_path() {
+    for (int32_t v = -32768; v <= 32767; v += 7) {
+        for (uint8_t range = 0; range < 4; ++range) {
+            const int32_t exact = rawAccelMilliG(static_cast<int16_t>(v), range);
+            const double ref = static_cast<double>(v) * 1000.0 / rawAccelCountsPerG(range);
+            TEST_ASSERT_TRUE(fabs(exact - ref) < 1.0);
+        }
+    }
+}
+
+void test_threshold_decisions_match_float_path() {
+    // Same launch decision as |a| > 2 g in float, except where rounding the threshold to whole
+    // counts^2 or float rounding lands a sample right at 2 g on the other side.
+    srand(11);
+    const float launchG = 2.0f;
+    uint32_t mismatches = 0;
+    for (int i = 0; i < 200000; ++i) {
+        const uint8_t range = static_cast<uint8_t>(rand() & 3);
+        int16_t raw[3];
+        for (int axis = 0; axis < 3; ++axis) {
+            raw[axis] = static_cast<int16_t>((rand() % 6000) - 3000);
+        }
+        const bool fixed = rawAccelMagnitudeSq(raw) > rawAccelThresholdSq(launchG, range);
+        if (fixed != floatPath(raw, range, launchG).launch) {
+            const double g = sqrt(static_cast<double>(rawAccelMagnitudeSq(raw))) / rawAccelCountsPerG(range);
+            TEST_ASSERT_TRUE(fabs(g - launchG) < launchG * 0.002);
+            ++mismatches;
+        }
+    }
+    TEST_ASSERT_TRUE(mismatches < 200);
+}
+
+void bench_per_sample() {
+    using Clock = std::chrono::steady_clock;
+    constexpr size_t kSamples = 4096;
+    constexpr int kRounds = 500;
+    std::vector<int16_t> raw(kSamples * 3);
+    srand(3);
+    for (int16_t& v : raw) {
+        v = static_cast<int16_t>((rand() % 20000) - 10000);
+    }
+    const uint8_t range = 3;
+    const uint32_t launchSq = rawAccelThresholdSq(2.0f, range);
+
+    volatile uint32_t sink = 0;
+    const auto t0 = Clock::now();
+    for (int r = 0; r < kRounds; ++r) {
+        uint32_t launches = 0;
+        int32_t milli = 0;
+        for (size_t i = 0; i < kSamples; ++i) {
+            const FloatResult res = floatPath(&raw[i * 3], range, 2.0f);
+            launches += res.launch;
+            milli += res.milliG;
+        }
+        sink = sink + launches + static_cast<uint32_t>(milli);
+    }
+    const auto t1 = Clock::now();
+    for (int r = 0; r < kRounds; ++r) {
+        uint32_t launches = 0;
+        int32_t milli = 0;
+        for (size_t i = 0; i < kSamples; ++i) {
+            launches += rawAccelMagnitudeSq(&raw[i * 3]) > launchSq;
+            milli += rawAccelMilliG(raw[i * 3], range);
+        }
+        sink = sink + launches + static_cast<uint32_t>(milli);
+    }
+    const auto t2 = Clock::now();
+
+    const double n = static_cast<double>(kSamples) * kRounds;
+    printf("float path (scale, sqrtf, compare, *1000): %.2f ns per sample\n",
+           std::chrono::duration<double, std::nano>(t1 - t0).count() / n);
+    printf("raw path (counts^2 compare, milli-g):      %.2f ns per sample\n",
+           std::chrono::duration<double, std::nano>(t2 - t1).count() / n);
+    printf("on target: serial command \"accel bench\" reports Cortex-M4 cycles per sample\n");
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_counts_per_g);
+    RUN_TEST(test_magnitude_sq_covers_full_scale);
+    RUN_TEST(test_threshold_sq);
+    RUN_TEST(test_milli_g_matches_float_path);
+    RUN_TEST(test_threshold_decisions_match_float_path);
+    RUN_TEST(bench_per_sample);
+    return UNITY_END();
+}
@@ -0,0 +1,51 @@
+// Host-side tests for SampleClock (64-bit sample time from wrapping micros() timestamps).
+// Run with: pio test -e native -f native/test_sample_clock
+
+#include <unity.h>
+
+#include "SampleClock.h"
+
+void setUp() {}
+void tearDown() {}
+
+void test_starts_at_first_timestamp() {
+    SampleClock clock;
+    TEST_ASSERT_FALSE(clock.started());
+    TEST_ASSERT_TRUE(clock.update(123456789u) == 123456789ULL);
+    TEST_ASSERT_TRUE(clock.started());
+    TEST_ASSERT_EQUAL_UINT32(123456u, clock.ms());
+    TEST_ASSERT_TRUE(clock.update(123458789u) == 123458789ULL);
+}
+
+void test_counts_through_micros_wrap() {
+    SampleClock clock;
+    // 2 ms period across three wraps of the 32-bit microsecond counter (about 3.6 hours).
+    uint32_t micros = 0xFFFF0000u;
+    clock.update(micros);
+    const uint64_t start = clock.us();
+    const uint32_t kSteps = 3u * 2147484u + 10u;  // 2^32 us / 2000 us per step, three times over
+    for (uint32_t i = 0; i < kSteps; ++i) {
+        micros += 2000u;
+        clock.update(micros);
+    }
+    TEST_ASSERT_TRUE(clock.us() == start + static_cast<uint64_t>(kSteps) * 2000u);
+    TEST_ASSERT_EQUAL_UINT32(static_cast<uint32_t>(clock.us() / 1000), clock.ms());
+    TEST_ASSERT_TRUE(clock.ms() > 3u * 4294967u);  // ms keeps growing past 71.6 minutes
+}
+
+void test_reset_restarts_timeline() {
+    SampleClock clock;
+    clock.update(5000000u);
+    clock.update(6000000u);
+    clock.reset();
+    TEST_ASSERT_FALSE(clock.started());
+    TEST_ASSERT_TRUE(clock.update(1000u) == 1000ULL);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_starts_at_first_timestamp);
+    RUN_TEST(test_counts_through_micros_wrap);
+    RUN_TEST(test_reset_restarts_timeline);
+    return UNITY_END();
+}
@@ -0,0 +1,143 @@
+// Host-side tests for sdCard::exportSpiFlashRootTo: spiFlash on the emulated W25Q128
+// (EmulatedNorFlash) copied onto the emulated SD card (EmulatedSdCard behind the SdFat stand-in).
+// Run with: pio test -e native -f native/test_sd_export
+
+#include <unity.h>
+
+#include <string>
+
+#include "EmulatedNorFlash.h"
+#include "EmulatedSdCard.h"
+#include "HostClock.h"
+#include "TestRecords.h"
+#include "sdCard.h"
+#include "spiFlash.h"
+
+namespace {
+
+constexpr uint32_t kSessions = 3;
+constexpr const char* kFolder = "EXPORT";
+
+// One spiFlash session per call: DATA000.bin, DATA001.bin, ... of different lengths.
+void recordSessions(EmulatedNorFlash& nor) {
+    for (uint32_t s = 0; s < kSessions; ++s) {
+        spiFlash flash(nor);
+        TEST_ASSERT_TRUE(flash.startUp());
+        char rec[kTestRecordBytes];
+        for (uint32_t i = 0; i < 500 + 300 * s; ++i) {
+            makeTestRecord(s, i, rec);
+            TEST_ASSERT_EQUAL(0, flash.queue(kTestRecordBytes, rec, spiFlash::P_STD));
+            flash.tick(kTestTickBudgetUs);
+        }
+        TEST_ASSERT_EQUAL(0, flash.sync());
+    }
+}
+
+bool exportedIntact(uint32_t session) {
+    char path[32];
+    snprintf(path, sizeof(path), "%s/DATA%03u.bin", kFolder, static_cast<unsigned>(session));
+    const auto it = EmulatedSdCard::instance().files.find(path);
+    if (it == EmulatedSdCard::instance().files.end()) {
+        return false;
+    }
+    const std::vector<uint8_t>& data = it->second.data;
+    if (data.size() != (500 + 300 * session) * kTestRecordBytes) {
+        return false;
+    }
+    char rec[kTestRecordBytes];
+    for (size_t off = 0; off < data.size(); ++off) {
+        if (off % kTestRecordBytes == 0) {
+            makeTestRecord(session, static_cast<uint32_t>(off / kTestRecordBytes), rec);
+        }
+        if (data[off] != static_cast<uint8_t>(rec[off % kTestRecordBytes])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+void setUp() {
+    hostClockReset();
+    hostSerialSetEnabled(false);
+    EmulatedSdCard::instance().reset();
+}
+
+void tearDown() {}
+
+void test_export_copies_every_session() {
+    EmulatedNorFlash nor(2u << 20);
+    recordSessions(nor);
+    spiFlash flash(nor);
+    TEST_ASSERT_TRUE(flash.startUp());
+    sdCard card(10);
+    card.startUp();
+
+    SdExportReport report;
+    TEST_ASSERT_TRUE(card.exportSpiFlashRootTo(flash, kFolder, "DATA*", &report));
+    // The session spiFlash just opened (DATA003.bin, empty) is copied as well.
+    TEST_ASSERT_EQUAL_UINT32(kSessions + 1, report.files);
+    TEST_ASSERT_EQUAL_UINT32(0, report.failed);
+    for (uint32_t s = 0; s < kSessions; ++s) {
+        TEST_ASSERT_TRUE(exportedIntact(s));
+    }
+
+    // Run again: nothing left to copy.
+    TEST_ASSERT_TRUE(card.exportSpiFlashRootTo(flash, kFolder, "DATA*", &report));
+    TEST_ASSERT_EQUAL_UINT32(0, report.files);
+    TEST_ASSERT_EQUAL_UINT32(kSessions + 1, report.skipped);
+}
+
+void test_failing_file_does_not_stop_the_export() {
+    EmulatedNorFlash nor(2u << 20);
+    recordSessions(nor);
+    spiFlash flash(nor);
+    TEST_ASSERT_TRUE(flash.startUp());
+    sdCard card(10);
+    card.startUp();
+
+    // Bad sectors under the second file: its copy does not read back as written.
+    EmulatedSdCard::instance().setCorruptWrites("EXPORT/DATA001.bin");
+    SdExportReport report;
+    TEST_ASSERT_FALSE(card.exportSpiFlashRootTo(flash, kFolder, "DATA*", &report));
+    TEST_ASSERT_EQUAL_UINT32(1, report.failed);
+    TEST_ASSERT_EQUAL_UINT32(kSessions, report.files);
+    TEST_ASSERT_TRUE(exportedIntact(0));
+    TEST_ASSERT_TRUE(exportedIntact(2));
+
+    // Resume once the card behaves: only the failed file is copied again.
+    EmulatedSdCard::instance().setCorruptWrites("");
+    TEST_ASSERT_TRUE(card.exportSpiFlashRootTo(flash, kFolder, "DATA*", &report));
+    TEST_ASSERT_EQUAL_UINT32(1, report.files);
+    TEST_ASSERT_EQUAL_UINT32(kSessions, report.skipped);
+    TEST_ASSERT_EQUAL_UINT32(0, report.failed);
+    TEST_ASSERT_TRUE(exportedIntact(1));
+}
+
+void test_card_write_failure_stops_the_export() {
+    EmulatedNorFlash nor(2u << 20);
+    recordSessions(nor);
+    spiFlash flash(nor);
+    TEST_ASSERT_TRUE(flash.startUp());
+    sdCard card(10);
+    card.startUp();
+
+    // Card full: the first file is refused and the rest are not attempted.
+    TEST_ASSERT_TRUE(EmulatedSdCard::instance().dirs.insert(kFolder).second);
+    EmulatedSdCard::instance().setFailWrites(true);
+    SdExportReport report;
+    TEST_ASSERT_FALSE(card.exportSpiFlashRootTo(flash, kFolder, "DATA*", &report));
+    TEST_ASSERT_EQUAL_UINT32(1, report.failed);
+    TEST_ASSERT_EQUAL_UINT32(0, report.files);
+    TEST_ASSERT_EQUAL_UINT32(0, report.skipped);
+    EmulatedSdCard::instance().setFailWrites(false);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_export_copies_every_session);
+    RUN_TEST(test_failing_file_does_not_stop_the_export);
+    RUN_TEST(test_card_write_failure_stops_the_export);
+    return UNITY_END();
+}
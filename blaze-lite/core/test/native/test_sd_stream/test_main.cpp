@@ -0,0 +1,101 @@
+// Host-side tests for streaming the SD data file into its preallocated extent: the file must
+// end at the written length after LANDED, and at the last flushed record after a reset.
+// Run with: pio test -e native -f native/test_sd_stream
+
+#include <unity.h>
+
+#include <string>
+#include <vector>
+
+#include "EmulatedSdCard.h"
+#include "HostClock.h"
+#include "TestRecords.h"
+#include "sdCard.h"
+
+namespace {
+
+void writeRecords(sdCard& card, uint32_t first, uint32_t count) {
+    char rec[kTestRecordBytes];
+    for (uint32_t i = first; i < first + count; ++i) {
+        makeTestRecord(i, rec);
+        TEST_ASSERT_EQUAL(static_cast<int>(kTestRecordBytes), static_cast<int>(card.writeData(kTestRecordBytes, rec)));
+    }
+}
+
+// The session data file as it is on the card right now (what a PC sees after a reset).
+const std::vector<uint8_t>& dataFileOnCard() {
+    for (const auto& kv : EmulatedSdCard::instance().files) {
+        if (kv.first.compare(0, 4, "DATA") == 0) {
+            return kv.second.data;
+        }
+    }
+    TEST_FAIL_MESSAGE("no data file on the card");
+    static const std::vector<uint8_t> none;
+    return none;
+}
+
+void assertRecords(const uint8_t* data, size_t bytes, uint32_t count) {
+    TEST_ASSERT_EQUAL_UINT32(count * kTestRecordBytes, bytes);
+    char rec[kTestRecordBytes];
+    for (uint32_t i = 0; i < count; ++i) {
+        makeTestRecord(i, rec);
+        TEST_ASSERT_EQUAL_MEMORY(rec, data + i * kTestRecordBytes, kTestRecordBytes);
+    }
+}
+
+}  // namespace
+
+void setUp() {
+    hostClockReset();
+    hostSerialSetEnabled(false);
+    EmulatedSdCard::instance().reset();
+}
+
+void tearDown() {}
+
+void test_landed_file_ends_at_written_length() {
+    sdCard card(10);
+    card.startUp();
+    TEST_ASSERT_TRUE(card.isStreaming());
+
+    const uint32_t records = 5000;  // 117 KiB, ends mid-sector
+    writeRecords(card, 0, records);
+    TEST_ASSERT_EQUAL(0, card.onPhaseChange(true));
+    TEST_ASSERT_FALSE(card.isStreaming());
+    TEST_ASSERT_TRUE(card.writeStats().streamedSectors > 0);
+
+    std::vector<char> readBack(records * kTestRecordBytes + 512);
+    const ssize_t n = card.readData(readBack.size(), readBack.data());
+    assertRecords(reinterpret_cast<const uint8_t*>(readBack.data()), static_cast<size_t>(n), records);
+    const std::vector<uint8_t>& onCard = dataFileOnCard();
+    assertRecords(onCard.data(), onCard.size(), records);
+
+    // After LANDED, records are appended behind the streamed ones.
+    writeRecords(card, records, 100);
+    TEST_ASSERT_EQUAL(0, card.flush());
+    assertRecords(onCard.data(), onCard.size(), records + 100);
+}
+
+void test_reset_mid_flight_keeps_flushed_records() {
+    sdCard card(10);
+    card.startUp();
+    TEST_ASSERT_TRUE(card.isStreaming());
+
+    writeRecords(card, 0, 1000);
+    TEST_ASSERT_EQUAL(0, card.flush());
+    const std::vector<uint8_t>& onCard = dataFileOnCard();
+    assertRecords(onCard.data(), onCard.size(), 1000);
+
+    // The partial last sector is rewritten in place as more records arrive.
+    writeRecords(card, 1000, 7);
+    TEST_ASSERT_EQUAL(0, card.flush());
+    assertRecords(onCard.data(), onCard.size(), 1007);
+    TEST_ASSERT_TRUE(card.isStreaming());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_landed_file_ends_at_written_length);
+    RUN_TEST(test_reset_mid_flight_keeps_flushed_records);
+    return UNITY_END();
+}
@@ -0,0 +1,69 @@
+// Host-side tests for SectorBuffer (sector-aligned SD write coalescing).
+// Run with: pio test -e native -f native/test_sector_buffer
+
+#include <unity.h>
+
+#include <vector>
+
+#include "SectorBuffer.h"
+
+void setUp() {}
+void tearDown() {}
+
+void test_small_appends_wait_for_a_whole_sector() {
+    SectorBuffer<1024> buf;
+    uint8_t rec[50] = {};
+    for (int i = 0; i < 10; ++i) {
+        TEST_ASSERT_EQUAL_UINT32(50, buf.append(rec, sizeof(rec)));
+        TEST_ASSERT_EQUAL_UINT32(0, buf.alignedBytes());
+    }
+    buf.append(rec, sizeof(rec));  // 550 bytes
+    TEST_ASSERT_EQUAL_UINT32(512, buf.alignedBytes());
+    buf.consume(512);
+    TEST_ASSERT_EQUAL_UINT32(38, buf.size());
+    TEST_ASSERT_EQUAL_UINT32(512, buf.filePosition());
+}
+
+void test_partial_flush_realigns_on_next_sector() {
+    SectorBuffer<1024> buf;
+    uint8_t rec[100] = {};
+    buf.append(rec, sizeof(rec));
+    buf.consume(buf.size());  // forced flush of a partial sector
+    TEST_ASSERT_EQUAL_UINT32(100, buf.filePosition());
+
+    for (int i = 0; i < 4; ++i) {
+        buf.append(rec, sizeof(rec));
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, buf.alignedBytes());
+    buf.append(rec, sizeof(rec));  // file offset 600 reached
+    TEST_ASSERT_EQUAL_UINT32(412, buf.alignedBytes());
+}
+
+void test_append_stops_when_full() {
+    SectorBuffer<512> buf;
+    std::vector<uint8_t> big(700, 0xAB);
+    TEST_ASSERT_EQUAL_UINT32(512, buf.append(big.data(), big.size()));
+    TEST_ASSERT_TRUE(buf.full());
+    TEST_ASSERT_EQUAL_UINT32(0, buf.append(big.data(), 1));
+}
+
+void test_consume_keeps_tail_bytes_in_order() {
+    SectorBuffer<1024> buf;
+    uint8_t bytes[600];
+    for (size_t i = 0; i < sizeof(bytes); ++i) {
+        bytes[i] = static_cast<uint8_t>(i);
+    }
+    buf.append(bytes, sizeof(bytes));
+    buf.consume(buf.alignedBytes());
+    TEST_ASSERT_EQUAL_UINT32(88, buf.size());
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(bytes + 512, buf.data(), 88);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_small_appends_wait_for_a_whole_sector);
+    RUN_TEST(test_partial_flush_realigns_on_next_sector);
+    RUN_TEST(test_append_stops_when_full);
+    RUN_TEST(test_consume_keeps_tail_bytes_in_order);
+    return UNITY_END();
+}
@@ -0,0 +1,49 @@
+// Host-side tests for SessionIndex (session file naming from one directory scan).
+// Run with: pio test -e native -f native/test_session_index
+
+#include <unity.h>
+
+#include "SessionIndex.h"
+
+void setUp() {}
+void tearDown() {}
+
+void test_empty_directory_starts_at_zero() {
+    SessionIndex data("DATA", ".bin");
+    char name[16];
+    TEST_ASSERT_TRUE(data.format(name, sizeof(name)));
+    TEST_ASSERT_EQUAL_STRING("DATA000.bin", name);
+}
+
+void test_next_is_one_past_highest() {
+    SessionIndex data("DATA", ".bin");
+    SessionIndex log("LOG", ".txt");
+    const char* entries[] = {"DATA000.bin", "LOG003.txt", "DATA007.BIN", "notes.txt", "DATA012.csv",
+                             "DATA01.bin", "DATA0123.bin", "log010.TXT", "DATAX00.bin"};
+    for (const char* e : entries) {
+        data.observe(e);
+        log.observe(e);
+    }
+    TEST_ASSERT_EQUAL_INT(8, data.next());
+    TEST_ASSERT_EQUAL_INT(11, log.next());
+
+    char name[16];
+    TEST_ASSERT_TRUE(log.format(name, sizeof(name)));
+    TEST_ASSERT_EQUAL_STRING("LOG011.txt", name);
+}
+
+void test_exhausted_range() {
+    SessionIndex data("DATA", ".bin");
+    data.observe("DATA999.bin");
+    char name[16];
+    TEST_ASSERT_EQUAL_INT(-1, data.next());
+    TEST_ASSERT_FALSE(data.format(name, sizeof(name)));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_empty_directory_starts_at_zero);
+    RUN_TEST(test_next_is_one_past_highest);
+    RUN_TEST(test_exhausted_range);
+    return UNITY_END();
+}
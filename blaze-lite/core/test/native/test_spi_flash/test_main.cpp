@@ -0,0 +1,380 @@
+// Host-side tests for spiFlash on the emulated W25Q128 (EmulatedNorFlash + HostClock).
+// Run with: pio test -e native -f native/test_spi_flash
+
+#include <unity.h>
+
+#include <string.h>
+
+#include <vector>
+
+#include "EmulatedNorFlash.h"
+#include "HostClock.h"
+#include "TestRecords.h"
+#include "spiFlash.h"
+
+namespace {
+
+constexpr uint32_t kSamplePeriodUs = 20000;  // 50 Hz
+
+bool matchesStream(const std::vector<char>& bytes) {
+    char rec[kTestRecordBytes];
+    for (size_t off = 0; off < bytes.size(); ++off) {
+        if (off % kTestRecordBytes == 0) {
+            makeTestRecord(static_cast<uint32_t>(off / kTestRecordBytes), rec);
+        }
+        if (bytes[off] != rec[off % kTestRecordBytes]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+constexpr uint32_t kRawSectors = 8;
+
+// Arm the raw log, let the background erase finish while "on the pad", launch, and stream
+// records into the raw region. Returns the record bytes consumed by tick().
+uint32_t flyRaw(spiFlash& flash, uint32_t records) {
+    TEST_ASSERT_EQUAL(0, flash.rawLogArm());
+    for (int i = 0; i < 200 && flash.rawLogStats().sectorsErased < kRawSectors; ++i) {
+        flash.tick(kTestTickBudgetUs);
+        hostClockAdvanceUs(kSamplePeriodUs);
+    }
+    TEST_ASSERT_EQUAL_UINT32(kRawSectors, flash.rawLogStats().sectorsErased);
+    TEST_ASSERT_EQUAL(0, flash.rawLogBegin());
+
+    uint32_t consumed = 0;
+    char rec[kTestRecordBytes];
+    for (uint32_t i = 0; i < records; ++i) {
+        makeTestRecord(i, rec);
+        TEST_ASSERT_EQUAL(0, flash.queue(kTestRecordBytes, rec, spiFlash::P_STD));
+        const ssize_t n = flash.tick(kTestTickBudgetUs);
+        TEST_ASSERT_TRUE(n >= 0);
+        consumed += static_cast<uint32_t>(n);
+        hostClockAdvanceUs(kSamplePeriodUs);
+    }
+    ssize_t n;
+    while ((n = flash.tick(kTestTickBudgetUs)) > 0) {
+        consumed += static_cast<uint32_t>(n);
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, flash.rawLogStats().blockingErases);
+    return consumed;
+}
+
+}  // namespace
+
+void setUp() {
+    hostClockReset();
+    hostSerialSetEnabled(false);
+}
+
+void tearDown() {}
+
+void test_stream_round_trip() {
+    EmulatedNorFlash nor(2u << 20);
+    spiFlash flash(nor);
+    TEST_ASSERT_TRUE(flash.startUp());
+
+    const uint32_t kRecords = 3000;
+    char rec[kTestRecordBytes];
+    for (uint32_t i = 0; i < kRecords; ++i) {
+        makeTestRecord(i, rec);
+        TEST_ASSERT_EQUAL(0, flash.queue(kTestRecordBytes, rec, spiFlash::P_STD));
+        TEST_ASSERT_TRUE(flash.tick(kTestTickBudgetUs) >= 0);
+        hostClockAdvanceUs(kSamplePeriodUs);
+    }
+    while (flash.tick(kTestTickBudgetUs) > 0) {
+    }
+    TEST_ASSERT_EQUAL(0, flash.sync());
+
+    std::vector<char> back(kRecords * kTestRecordBytes);
+    TEST_ASSERT_EQUAL(static_cast<ssize_t>(back.size()), flash.read(0, back.size(), back.data()));
+    TEST_ASSERT_TRUE(matchesStream(back));
+    TEST_ASSERT_EQUAL_UINT32(0, static_cast<uint32_t>(nor.stats().norViolations));
+}
+
+void test_page_programs_overlap_sample_period() {
+    EmulatedNorFlash nor(2u << 20);
+    spiFlash flash(nor);
+    TEST_ASSERT_TRUE(flash.setRawLogSectors(kRawSectors));
+    TEST_ASSERT_TRUE(flash.startUp());
+    const SyncPolicyConfig never = {0, 0, false};
+    flash.setSyncPolicy(never, never);
+
+    // On LittleFS every data page is read back straight away, which waits for its program.
+    char rec[kTestRecordBytes];
+    flash.resetTickStats();
+    for (uint32_t i = 0; i < 500; ++i) {
+        makeTestRecord(i, rec);
+        flash.queue(kTestRecordBytes, rec, spiFlash::P_STD);
+        flash.tick(kTestTickBudgetUs);
+        hostClockAdvanceUs(kSamplePeriodUs);
+    }
+    TEST_ASSERT_TRUE(flash.tickStats().pagesWritten > 20);
+    TEST_ASSERT_TRUE(flash.tickStats().programWaits >= flash.tickStats().pagesWritten);
+
+    // Raw log pages are not read back: programs finish during the sample period, so almost
+    // nothing waits for one.
+    flyRaw(flash, 20);
+    flash.resetTickStats();
+    for (uint32_t i = 0; i < 2000; ++i) {
+        makeTestRecord(i, rec);
+        flash.queue(kTestRecordBytes, rec, spiFlash::P_STD);
+        flash.tick(kTestTickBudgetUs);
+        hostClockAdvanceUs(kSamplePeriodUs);
+    }
+    const SpiFlashTickStats& st = flash.tickStats();
+    TEST_ASSERT_TRUE(st.programs > 100);
+    TEST_ASSERT_TRUE(st.programWaits * 10 < st.programs);
+    TEST_ASSERT_EQUAL_UINT32(0, st.verifyErrors);
+    TEST_ASSERT_EQUAL(0, flash.rawLogEnd());
+}
+
+void test_failed_programs_relocated_by_littlefs() {
+    EmulatedNorFlash nor(2u << 20);
+    spiFlash flash(nor);
+    TEST_ASSERT_TRUE(flash.startUp());
+    // Worn-out sectors across the volume (the superblock pair stays good): their programs
+    // complete without changing the cells.
+    for (uint32_t sector = 3; sector < 512; sector += 3) {
+        nor.setBadSector(sector);
+    }
+
+    const uint32_t kRecords = 3000;
+    char rec[kTestRecordBytes];
+    for (uint32_t i = 0; i < kRecords; ++i) {
+        makeTestRecord(i, rec);
+        TEST_ASSERT_EQUAL(0, flash.queue(kTestRecordBytes, rec, spiFlash::P_STD));
+        TEST_ASSERT_TRUE(flash.tick(kTestTickBudgetUs) >= 0);
+        hostClockAdvanceUs(kSamplePeriodUs);
+    }
+    while (flash.tick(kTestTickBudgetUs) > 0) {
+    }
+    // Each failure surfaced on the page's own read-back, so no later commit reports it.
+    TEST_ASSERT_EQUAL(0, flash.sync());
+    TEST_ASSERT_TRUE(nor.stats().failedPrograms > 0);
+
+    std::vector<char> back(kRecords * kTestRecordBytes);
+    TEST_ASSERT_EQUAL(static_cast<ssize_t>(back.size()), flash.read(0, back.size(), back.data()));
+    TEST_ASSERT_TRUE(matchesStream(back));
+}
+
+void test_power_cut_keeps_synced_prefix() {
+    EmulatedNorFlash nor(2u << 20, NorTimings(), 7);
+    uint32_t syncedLowerBound = 0;
+    {
+        spiFlash flash(nor);
+        TEST_ASSERT_TRUE(flash.startUp());
+        nor.cutPowerAtUs(hostClockUs() + 61234567ULL);
+
+        char rec[kTestRecordBytes];
+        uint32_t consumed = 0;
+        for (uint32_t i = 0; nor.powered(); ++i) {
+            makeTestRecord(i, rec);
+            flash.queue(kTestRecordBytes, rec, spiFlash::P_STD);
+            const uint32_t syncsBefore = flash.syncCount();
+            const ssize_t n = flash.tick(kTestTickBudgetUs);
+            if (n > 0) {
+                consumed += static_cast<uint32_t>(n);
+            }
+            if (nor.powered() && flash.syncCount() != syncsBefore && consumed > 256) {
+                syncedLowerBound = consumed - 256;  // at most one partial page stays in RAM
+            }
+            hostClockAdvanceUs(kSamplePeriodUs);
+        }
+    }
+    TEST_ASSERT_TRUE(syncedLowerBound > 0);
+
+    nor.powerOn();
+    spiFlash flash(nor);
+    TEST_ASSERT_TRUE(flash.startUp());
+
+    // The interrupted session is intact up to its last sync; the new one got the next index.
+    std::vector<char> back;
+    struct Collect {
+        std::vector<char>* out;
+        bool active;
+    } collect{&back, false};
+    SpiFlashExportCallbacks cb = {};
+    cb.user = &collect;
+    cb.onBeginFile = [](void* user, const char* name) {
+        static_cast<Collect*>(user)->active = strcmp(name, "DATA000.bin") == 0;
+        return true;
+    };
+    cb.onWrite = [](void* user, const uint8_t* data, size_t len) {
+        auto* c = static_cast<Collect*>(user);
+        if (c->active) {
+            c->out->insert(c->out->end(), data, data + len);
+        }
+        return true;
+    };
+    cb.onEndFile = [](void* /*user*/) { return true; };
+    TEST_ASSERT_TRUE(flash.exportRootFilesMatching(&cb, "DATA*"));
+    TEST_ASSERT_TRUE(back.size() >= syncedLowerBound);
+    TEST_ASSERT_TRUE(matchesStream(back));
+    TEST_ASSERT_FALSE(flash.canRemovePath("DATA001.bin"));
+}
+
+void test_fs_profile_validation() {
+    EmulatedNorFlash nor(2u << 20);
+    spiFlash flash(nor);
+
+    SpiFlashFsProfile bad = SpiFlashFsProfile::defaults();
+    bad.cacheSize = 384;  // not a factor of the 4 KiB block
+    TEST_ASSERT_FALSE(bad.valid());
+    TEST_ASSERT_FALSE(flash.setFsProfile(bad));
+
+    SpiFlashFsProfile profile = SpiFlashFsProfile::defaults();
+    profile.cacheSize = 512;
+    profile.metadataMax = 1024;
+    TEST_ASSERT_TRUE(flash.setFsProfile(profile));
+    TEST_ASSERT_TRUE(flash.startUp());
+    TEST_ASSERT_EQUAL_UINT32(512, flash.fsProfile().cacheSize);
+    TEST_ASSERT_EQUAL_UINT32(512 * 4 + profile.lookaheadSize, flash.fsProfile().ramBytes(2));
+
+    // Mounted: the profile can no longer change.
+    TEST_ASSERT_FALSE(flash.setFsProfile(SpiFlashFsProfile::defaults()));
+}
+
+struct ReaderVisit {
+    spiFlash* flash;
+    uint32_t files;
+    std::vector<char> bytes;
+};
+
+bool readWholeFile(void* user, const char* name, uint32_t size) {
+    auto* visit = static_cast<ReaderVisit*>(user);
+    ++visit->files;
+    if (!visit->flash->openReader(name)) {
+        return false;
+    }
+    char chunk[4096];
+    ssize_t n;
+    while ((n = visit->flash->readReader(chunk, sizeof(chunk))) > 0) {
+        visit->bytes.insert(visit->bytes.end(), chunk, chunk + n);
+    }
+    visit->flash->closeReader();
+    return n == 0 && visit->bytes.size() == size;
+}
+
+void test_reader_pulls_files_in_chunks() {
+    EmulatedNorFlash nor(2u << 20);
+    spiFlash flash(nor);
+    TEST_ASSERT_TRUE(flash.startUp());
+
+    const uint32_t kRecords = 800;
+    char rec[kTestRecordBytes];
+    for (uint32_t i = 0; i < kRecords; ++i) {
+        makeTestRecord(i, rec);
+        TEST_ASSERT_EQUAL(0, flash.queue(kTestRecordBytes, rec, spiFlash::P_STD));
+        flash.tick(kTestTickBudgetUs);
+    }
+
+    // forEachRootFile syncs the queue first, so every record is visible to the reader.
+    ReaderVisit visit = {&flash, 0, {}};
+    TEST_ASSERT_EQUAL(1, flash.forEachRootFile("DATA*", readWholeFile, &visit));
+    TEST_ASSERT_EQUAL_UINT32(1, visit.files);
+    TEST_ASSERT_EQUAL_UINT32(kRecords * kTestRecordBytes, static_cast<uint32_t>(visit.bytes.size()));
+    TEST_ASSERT_TRUE(matchesStream(visit.bytes));
+
+    TEST_ASSERT_FALSE(flash.openReader("MISSING.bin"));
+    TEST_ASSERT_EQUAL(-1, static_cast<int>(flash.readReader(rec, sizeof(rec))));
+}
+
+namespace {
+
+// Power fails mid-flight on a fresh chip: the raw run of session 0 is never converted.
+uint32_t cutRawFlight(EmulatedNorFlash& nor, uint32_t records) {
+    spiFlash flash(nor);
+    TEST_ASSERT_TRUE(flash.setRawLogSectors(kRawSectors));
+    TEST_ASSERT_TRUE(flash.startUp());
+    const uint32_t consumed = flyRaw(flash, records);
+    TEST_ASSERT_TRUE(flash.rawLogStats().pagesWritten > 0);
+    nor.cutPowerAtUs(hostClockUs());
+    return consumed;
+}
+
+std::vector<char> readFile(spiFlash& flash, const char* name) {
+    ReaderVisit visit = {&flash, 0, {}};
+    TEST_ASSERT_EQUAL(1, flash.forEachRootFile(name, readWholeFile, &visit));
+    return visit.bytes;
+}
+
+}  // namespace
+
+void test_raw_log_copied_into_data_file() {
+    EmulatedNorFlash nor(2u << 20);
+    spiFlash flash(nor);
+    TEST_ASSERT_TRUE(flash.setRawLogSectors(kRawSectors));
+    TEST_ASSERT_TRUE(flash.startUp());
+    TEST_ASSERT_TRUE(flash.rawLogAvailable());
+    TEST_ASSERT_FALSE(flash.setRawLogSectors(0));  // mounted
+
+    const uint32_t consumed = flyRaw(flash, 1000);
+    TEST_ASSERT_EQUAL(0, flash.rawLogEnd());
+    const SpiFlashRawLogStats& raw = flash.rawLogStats();
+    TEST_ASSERT_TRUE(raw.pagesWritten > 0);
+    TEST_ASSERT_EQUAL_UINT32(raw.pagesWritten, raw.pagesConverted);
+    TEST_ASSERT_EQUAL_UINT32(0, raw.droppedBytes);
+
+    std::vector<char> back(consumed);
+    TEST_ASSERT_EQUAL(static_cast<ssize_t>(consumed), flash.read(0, back.size(), back.data()));
+    TEST_ASSERT_TRUE(matchesStream(back));
+
+    // The run is consumed, so the region can be armed for the next flight.
+    TEST_ASSERT_EQUAL(0, flash.rawLogArm());
+}
+
+void test_raw_log_recovered_after_power_cut() {
+    EmulatedNorFlash nor(2u << 20);
+    const uint32_t consumed = cutRawFlight(nor, 600);
+    nor.powerOn();
+
+    spiFlash flash(nor);
+    TEST_ASSERT_TRUE(flash.setRawLogSectors(kRawSectors));
+    TEST_ASSERT_TRUE(flash.startUp());
+    // Only the partial page still in RAM is lost.
+    const std::vector<char> back = readFile(flash, "DATA000.bin");
+    TEST_ASSERT_TRUE(back.size() <= consumed && back.size() + 256 > consumed);
+    TEST_ASSERT_TRUE(matchesStream(back));
+
+    // Recovery marked the run consumed: the next flight arms, flies and converts normally.
+    const uint32_t next = flyRaw(flash, 300);
+    TEST_ASSERT_EQUAL(0, flash.rawLogEnd());
+    TEST_ASSERT_EQUAL(static_cast<ssize_t>(next), static_cast<ssize_t>(readFile(flash, "DATA001.bin").size()));
+    TEST_ASSERT_EQUAL(static_cast<ssize_t>(back.size()), static_cast<ssize_t>(readFile(flash, "DATA000.bin").size()));
+}
+
+void test_raw_log_keeps_session_index_of_missing_file() {
+    // A run whose DATA file no longer exists (here: the raw region moved onto a blank chip) would
+    // otherwise share its index with the new session, be skipped by recovery and block arming.
+    EmulatedNorFlash flown(2u << 20);
+    const uint32_t consumed = cutRawFlight(flown, 400);
+
+    EmulatedNorFlash nor(2u << 20);
+    const size_t rawBytes = kRawSectors * 4096u;
+    memcpy(nor.image().data() + nor.image().size() - rawBytes, flown.image().data() + flown.image().size() - rawBytes,
+           rawBytes);
+
+    spiFlash flash(nor);
+    TEST_ASSERT_TRUE(flash.setRawLogSectors(kRawSectors));
+    TEST_ASSERT_TRUE(flash.startUp());
+    const std::vector<char> back = readFile(flash, "DATA000.bin");
+    TEST_ASSERT_TRUE(back.size() <= consumed && back.size() + 256 > consumed);
+    TEST_ASSERT_TRUE(matchesStream(back));
+    TEST_ASSERT_FALSE(flash.canRemovePath("DATA001.bin"));  // the new session
+    TEST_ASSERT_EQUAL(0, flash.rawLogArm());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_stream_round_trip);
+    RUN_TEST(test_page_programs_overlap_sample_period);
+    RUN_TEST(test_failed_programs_relocated_by_littlefs);
+    RUN_TEST(test_power_cut_keeps_synced_prefix);
+    RUN_TEST(test_fs_profile_validation);
+    RUN_TEST(test_reader_pulls_files_in_chunks);
+    RUN_TEST(test_raw_log_copied_into_data_file);
+    RUN_TEST(test_raw_log_recovered_after_power_cut);
+    RUN_TEST(test_raw_log_keeps_session_index_of_missing_file);
+    return UNITY_END();
+}
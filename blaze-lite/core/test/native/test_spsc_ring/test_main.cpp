@@ -0,0 +1,120 @@
+// Host-side tests for SpscRing (ISR -> main loop sample ring), including a two-thread stress run.
+// Run with: pio test -e native -f native/test_spsc_ring
+
+#include <unity.h>
+
+#include <atomic>
+#include <thread>
+
+#include "SpscRing.h"
+
+namespace {
+
+struct Sample {
+    uint32_t seq;
+    uint32_t check;
+};
+
+uint32_t checkFor(uint32_t seq) { return seq * 2654435761u; }
+
+}  // namespace
+
+void setUp() {}
+void tearDown() {}
+
+void test_push_pop_in_order() {
+    SpscRing<Sample, 8> ring;
+    TEST_ASSERT_TRUE(ring.empty());
+    for (uint32_t i = 0; i < 5; ++i) {
+        TEST_ASSERT_TRUE(ring.push(Sample{i, checkFor(i)}));
+    }
+    TEST_ASSERT_EQUAL_UINT32(5, ring.size());
+
+    Sample out[8];
+    TEST_ASSERT_EQUAL_UINT32(3, ring.popBatch(out, 3));
+    TEST_ASSERT_EQUAL_UINT32(0, out[0].seq);
+    TEST_ASSERT_EQUAL_UINT32(2, out[2].seq);
+    TEST_ASSERT_TRUE(ring.pop(&out[0]));
+    TEST_ASSERT_EQUAL_UINT32(3, out[0].seq);
+    TEST_ASSERT_EQUAL_UINT32(1, ring.size());
+}
+
+void test_full_ring_drops_newest_and_counts_overflow() {
+    SpscRing<Sample, 4> ring;
+    for (uint32_t i = 0; i < 6; ++i) {
+        ring.push(Sample{i, checkFor(i)});
+    }
+    TEST_ASSERT_EQUAL_UINT32(4, ring.size());
+    TEST_ASSERT_EQUAL_UINT32(2, ring.overflows());
+
+    Sample out[4];
+    TEST_ASSERT_EQUAL_UINT32(4, ring.popBatch(out, 4));
+    TEST_ASSERT_EQUAL_UINT32(3, out[3].seq);  // 4 and 5 were dropped, not the oldest
+    TEST_ASSERT_TRUE(ring.push(Sample{6, checkFor(6)}));
+    TEST_ASSERT_TRUE(ring.pop(&out[0]));
+    TEST_ASSERT_EQUAL_UINT32(6, out[0].seq);
+}
+
+void test_counters_wrap() {
+    SpscRing<Sample, 4> ring;
+    Sample out;
+    // Enough traffic to run head/tail through many laps of the index mask.
+    for (uint32_t i = 0; i < 100000; ++i) {
+        TEST_ASSERT_TRUE(ring.push(Sample{i, checkFor(i)}));
+        TEST_ASSERT_TRUE(ring.pop(&out));
+        TEST_ASSERT_EQUAL_UINT32(i, out.seq);
+    }
+    TEST_ASSERT_TRUE(ring.empty());
+}
+
+void test_concurrent_producer_consumer() {
+    static SpscRing<Sample, 64> ring;
+    const uint32_t kItems = 2000000;
+    std::atomic<bool> done(false);
+    uint32_t pushed = 0;
+
+    std::thread producer([&] {
+        for (uint32_t i = 0; i < kItems; ++i) {
+            if (ring.push(Sample{i, checkFor(i)})) {
+                ++pushed;
+            }
+        }
+        done.store(true, std::memory_order_release);
+    });
+
+    // Every item the consumer sees must be intact and strictly newer than the previous one;
+    // gaps are allowed only where the producer counted an overflow.
+    uint32_t received = 0;
+    uint32_t torn = 0;
+    uint32_t reordered = 0;
+    int64_t last = -1;
+    Sample batch[16];
+    while (true) {
+        const bool finished = done.load(std::memory_order_acquire);
+        const size_t n = ring.popBatch(batch, 16);
+        for (size_t i = 0; i < n; ++i) {
+            torn += batch[i].check != checkFor(batch[i].seq);
+            reordered += static_cast<int64_t>(batch[i].seq) <= last;
+            last = batch[i].seq;
+        }
+        received += static_cast<uint32_t>(n);
+        if (finished && n == 0) {
+            break;
+        }
+    }
+    producer.join();
+
+    TEST_ASSERT_EQUAL_UINT32(0, torn);
+    TEST_ASSERT_EQUAL_UINT32(0, reordered);
+    TEST_ASSERT_EQUAL_UINT32(pushed, received);
+    TEST_ASSERT_EQUAL_UINT32(kItems, received + ring.overflows());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_push_pop_in_order);
+    RUN_TEST(test_full_ring_drops_newest_and_counts_overflow);
+    RUN_TEST(test_counters_wrap);
+    RUN_TEST(test_concurrent_producer_consumer);
+    return UNITY_END();
+}
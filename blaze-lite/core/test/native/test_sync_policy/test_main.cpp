@@ -0,0 +1,194 @@
+// Host-side benchmark for the SPI flash sync policy (spiFlash on the emulated W25Q128).
+// Replays a 10-minute logging session through queue()/tick(), kLog()/kflush() and onPhaseChange(),
+// and reports sync count and write amplification per policy.
+// Run with: pio test -e native -f native/test_sync_policy -v
+
+#include <unity.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include <vector>
+
+#include "EmulatedNorFlash.h"
+#include "HostClock.h"
+#include "SyncPolicy.h"
+#include "TestRecords.h"
+#include "spiFlash.h"
+
+namespace {
+
+constexpr uint32_t kChipBytes = 2u << 20;
+constexpr uint32_t kSamplePeriodMs = 20;  // 50 Hz
+constexpr uint32_t kLogPeriodMs = 2000;
+constexpr uint32_t kSessionMs = 600000;
+
+struct SessionResult {
+    uint32_t syncs;
+    uint64_t payloadBytes;
+    uint64_t progBytes;
+    uint64_t erases;
+    double busyMs;
+    uint32_t dataBytes;            // data records consumed by tick() before LANDED
+    std::vector<uint8_t> snapshot; // flash image just before the LANDED phase change
+};
+
+// 50 Hz x 24-byte records queued and ticked as in the main loop, a ~40-byte log line every 2 s
+// through kLog()/kflush(), and onPhaseChange() at fixed times. LANDED forces a final sync of both files.
+void runSession(const SyncPolicyConfig& policy, SessionResult* out) {
+    hostClockReset();
+    EmulatedNorFlash nor(kChipBytes);
+    spiFlash flash(nor);
+    TEST_ASSERT_TRUE(flash.startUp());
+    flash.setSyncPolicy(policy, policy);
+    nor.resetStats();
+
+    const uint32_t phaseChangeMs[] = {30000, 32000, 75000, 80000};  // ARMED..DESCENT
+    size_t nextPhase = 0;
+    const char logLine[] = "[123456] RX: ID=sm, Seq=12, TS=123456\r\n";
+    char rec[kTestRecordBytes];
+    uint64_t payload = 0;
+    uint32_t consumed = 0;
+
+    for (uint32_t i = 0; i * kSamplePeriodMs < kSessionMs; ++i) {
+        const uint32_t nowMs = i * kSamplePeriodMs;
+        makeTestRecord(i, rec);
+        TEST_ASSERT_EQUAL(0, flash.queue(kTestRecordBytes, rec, spiFlash::P_STD));
+        payload += kTestRecordBytes;
+        const ssize_t n = flash.tick(kTestTickBudgetUs);
+        TEST_ASSERT_TRUE(n >= 0);
+        consumed += static_cast<uint32_t>(n);
+
+        if (nowMs % kLogPeriodMs == 0) {
+            TEST_ASSERT_EQUAL(0, static_cast<int>(flash.kLog(sizeof(logLine) - 1, logLine)));
+            TEST_ASSERT_EQUAL(0, flash.kflush());
+            payload += sizeof(logLine) - 1;
+        }
+        if (nextPhase < sizeof(phaseChangeMs) / sizeof(phaseChangeMs[0]) && nowMs == phaseChangeMs[nextPhase]) {
+            ++nextPhase;
+            TEST_ASSERT_EQUAL(0, flash.onPhaseChange(false));
+        }
+        hostClockAdvanceUs(static_cast<uint64_t>(kSamplePeriodMs) * 1000u);
+    }
+    while (flash.tick(kTestTickBudgetUs) > 0) {
+    }
+
+    // Simulated power cut: keep the image as it was before LANDED committed anything.
+    nor.waitReady();
+    out->snapshot = nor.image();
+    out->dataBytes = consumed;
+
+    TEST_ASSERT_EQUAL(0, flash.onPhaseChange(true));
+
+    const NorStats& st = nor.stats();
+    out->syncs = flash.syncCount();
+    out->payloadBytes = payload;
+    out->progBytes = st.programBytes;
+    out->erases = st.erases;
+    out->busyMs = static_cast<double>(st.busyUs) / 1000.0;
+    TEST_ASSERT_EQUAL_UINT32(0, static_cast<uint32_t>(st.norViolations));
+}
+
+void report(const char* name, const SessionResult& r) {
+    printf("%-28s syncs=%6u  write-amp=%5.2f  erases=%4u  flash busy=%8.1f ms\n", name, r.syncs,
+           static_cast<double>(r.progBytes) / static_cast<double>(r.payloadBytes),
+           static_cast<unsigned>(r.erases), r.busyMs);
+}
+
+struct DataVisit {
+    spiFlash* flash;
+    std::vector<char> bytes;
+};
+
+bool readDataFile(void* user, const char* name, uint32_t /*size*/) {
+    auto* visit = static_cast<DataVisit*>(user);
+    if (strcmp(name, "DATA000.bin") != 0) {
+        return true;
+    }
+    if (!visit->flash->openReader(name)) {
+        return false;
+    }
+    char chunk[1024];
+    ssize_t n;
+    while ((n = visit->flash->readReader(chunk, sizeof(chunk))) > 0) {
+        visit->bytes.insert(visit->bytes.end(), chunk, chunk + n);
+    }
+    visit->flash->closeReader();
+    return n == 0;
+}
+
+SessionResult everyWrite;
+SessionResult defaults;
+SessionResult relaxed;
+SessionResult phaseOnly;
+
+}  // namespace
+
+void setUp() { hostSerialSetEnabled(false); }
+void tearDown() {}
+
+void test_policy_decisions() {
+    SyncPolicy p(SyncPolicyConfig{100, 500, false});
+    TEST_ASSERT_FALSE(p.due(0));
+    p.noteWritten(60, 1000);
+    TEST_ASSERT_FALSE(p.due(1200));
+    TEST_ASSERT_TRUE(p.due(1500));          // oldest unsynced byte is 500 ms old
+    p.noteWritten(60, 1300);
+    TEST_ASSERT_TRUE(p.due(1300));          // 120 >= 100 bytes
+    TEST_ASSERT_FALSE(p.dueOnPhaseChange(false));
+    TEST_ASSERT_TRUE(p.dueOnPhaseChange(true));
+    p.markSynced();
+    TEST_ASSERT_FALSE(p.dirty());
+    TEST_ASSERT_FALSE(p.dueOnPhaseChange(true));
+    TEST_ASSERT_EQUAL(1, p.syncCount());
+}
+
+void bench_policies() {
+    runSession(SyncPolicy::everyWrite(), &everyWrite);
+    runSession(SyncPolicyConfig{4096, 1000, true}, &defaults);
+    runSession(SyncPolicyConfig{16384, 5000, true}, &relaxed);
+    runSession(SyncPolicyConfig{0, 0, true}, &phaseOnly);
+
+    report("every write (previous)", everyWrite);
+    report("4 KiB / 1 s / phase (default)", defaults);
+    report("16 KiB / 5 s / phase", relaxed);
+    report("phase + LANDED only", phaseOnly);
+
+    TEST_ASSERT_LESS_THAN(everyWrite.syncs, defaults.syncs);
+    TEST_ASSERT_LESS_THAN(everyWrite.progBytes, defaults.progBytes);
+    TEST_ASSERT_LESS_OR_EQUAL(defaults.syncs, relaxed.syncs);
+    TEST_ASSERT_LESS_OR_EQUAL(relaxed.syncs, phaseOnly.syncs);
+}
+
+void test_recoverable_up_to_last_sync() {
+    // Mount the pre-LANDED snapshot of the default run: the data file must hold every record
+    // written up to its last sync, which the 1 s time threshold keeps within ~1 s of the end.
+    hostClockReset();
+    EmulatedNorFlash nor(kChipBytes);
+    nor.image() = defaults.snapshot;
+    spiFlash flash(nor);
+    TEST_ASSERT_TRUE(flash.startUp());
+
+    DataVisit visit = {&flash, {}};
+    TEST_ASSERT_TRUE(flash.forEachRootFile("DATA*", readDataFile, &visit) >= 1);
+    const uint32_t slackBytes = 2 * (1000 / kSamplePeriodMs) * kTestRecordBytes;
+    TEST_ASSERT_GREATER_THAN(0u, defaults.dataBytes);
+    TEST_ASSERT_TRUE(visit.bytes.size() + slackBytes >= defaults.dataBytes);
+    TEST_ASSERT_TRUE(visit.bytes.size() <= defaults.dataBytes);
+
+    char rec[kTestRecordBytes];
+    for (size_t off = 0; off < visit.bytes.size(); ++off) {
+        if (off % kTestRecordBytes == 0) {
+            makeTestRecord(static_cast<uint32_t>(off / kTestRecordBytes), rec);
+        }
+        TEST_ASSERT_EQUAL(rec[off % kTestRecordBytes], visit.bytes[off]);
+    }
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_policy_decisions);
+    RUN_TEST(bench_policies);
+    RUN_TEST(test_recoverable_up_to_last_sync);
+    return UNITY_END();
+}
@@ -0,0 +1,477 @@
+/**
+ * @file flash_bench.cpp
+ * @brief Host tool: replay a flight-length record stream through spiFlash on an emulated W25Q128
+ *
+ * Build and run:
+ *   pio run -e flash_bench -t exec
+ *   .pio/build/flash_bench/program --worst --flight 300
+ *
+ * Options:
+ *   --rate <Hz>        sample rate (default 50)
+ *   --pad-rate <Hz>    records logged per second while ARMED (default 50, as in writeLogEntry())
+ *   --budget <us>      tick(budgetUs) budget per loop (default 1500)
+ *   --pad <s>          time ARMED on the pad before launch (default 60)
+ *   --flight <s>       launch to landing (default 180)
+ *   --landed <s>       time logged after landing (default 30)
+ *   --worst            every program/erase takes its datasheet maximum
+ *   --jitter <0..1>    spread program/erase times between typical and maximum
+ *   --image <path>     start from (and save back to) a chip image instead of a blank chip
+ *   --cut <s>          cut power at this flight time and report what survived
+ *
+ * LittleFS profile (defaults from the SPI_FLASH_LFS_* macros, see SpiFlashFsProfile):
+ *   --read <n> --cache <n> --lookahead <n> --block-cycles <n>
+ *   --metadata-max <n> --inline-max <n> --compact-thresh <n>   (-1 disables the last two)
+ *   --sweep            try a grid of profiles, each on a fresh chip, and print one CSV row per
+ *                      profile: LittleFS RAM, remount time of the written volume, sustained
+ *                      append throughput, worst tick, cost of ticks that synced, erases
+ *
+ * Each loop queues one FlightRecord per sample at P_STD exactly like writeLogEntry(), logs a
+ * status line every 2 s, and calls tick(budgetUs); phase changes go through the same calls as
+ * notifyStoragePhaseChange(). Samples keep arriving while a tick runs: the next loop queues all
+ * of them at once, as readSensors() does after draining the KX134 buffer, and samples older than
+ * the buffer holds are lost. Time is virtual (HostClock), so the run is deterministic and
+ * latencies include the emulated SPI transfers and tPP / tSE waits.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "AccelFifo.h"
+#include "EmulatedNorFlash.h"
+#include "FlightRecord.h"
+#include "FlightState.h"
+#include "HostClock.h"
+#include "spiFlash.h"
+
+namespace {
+
+struct BenchOptions {
+    uint32_t rateHz = 50;
+    uint32_t padRateHz = 50;
+    uint32_t budgetUs = 1500;
+    uint32_t padS = 60;
+    uint32_t flightS = 180;
+    uint32_t landedS = 30;
+    bool worst = false;
+    float jitter = 0.0f;
+    const char* image = nullptr;
+    int32_t cutS = -1;
+};
+
+void usage(const char* argv0) {
+    fprintf(stderr,
+            "usage: %s [--rate Hz] [--pad-rate Hz] [--budget us] [--pad s] [--flight s] [--landed s] [--worst]\n"
+            "          [--jitter 0..1] [--image path] [--cut s] [--sweep]\n"
+            "          [--read n] [--cache n] [--lookahead n] [--block-cycles n]\n"
+            "          [--metadata-max n] [--inline-max n] [--compact-thresh n]\n",
+            argv0);
+}
+
+// Same storage calls as notifyStoragePhaseChange() in main.cpp.
+void enterPhase(spiFlash& flash, FlightPhase phase) {
+    flash.setPreEraseEnabled(phase == FlightPhase::UNARMED || phase == FlightPhase::ARMED ||
+                             phase == FlightPhase::LANDED);
+    if (flash.rawLogAvailable()) {
+        if (phase == FlightPhase::ARMED) {
+            flash.rawLogArm();
+        } else if (phase == FlightPhase::LAUNCH) {
+            flash.rawLogBegin();
+        } else if (phase == FlightPhase::LANDED || phase == FlightPhase::UNARMED) {
+            flash.rawLogEnd();
+        }
+    }
+    flash.onPhaseChange(phase == FlightPhase::LANDED);
+}
+
+// Rough flight profile: boost for 3 s, apogee at 40% of the flight, then descent.
+FlightPhase phaseAt(uint32_t ms, const BenchOptions& opt) {
+    const uint32_t launchMs = opt.padS * 1000;
+    const uint32_t flightMs = opt.flightS * 1000;
+    if (ms < launchMs) {
+        return FlightPhase::ARMED;
+    }
+    if (ms < launchMs + 3000) {
+        return FlightPhase::LAUNCH;
+    }
+    if (ms < launchMs + flightMs * 2 / 5) {
+        return FlightPhase::APOGEE;
+    }
+    if (ms < launchMs + flightMs) {
+        return FlightPhase::DESCENT;
+    }
+    return FlightPhase::LANDED;
+}
+
+void makeRecord(FlightRecord& rec, uint32_t sequence, uint32_t ms, FlightPhase phase) {
+    rec.flags = FLIGHT_RECORD_ACCEL_VALID | FLIGHT_RECORD_BARO_VALID | (3 << FLIGHT_RECORD_RANGE_SHIFT);
+    rec.timestampMs = ms;
+    rec.sequence = sequence;
+    rec.accelRaw[0] = static_cast<int16_t>((sequence * 7) & 0x3FF);
+    rec.accelRaw[1] = static_cast<int16_t>((sequence * 13) & 0x3FF);
+    rec.accelRaw[2] = static_cast<int16_t>(512 + (sequence & 0xFF));
+    rec.temperatureCentiC = 2150;
+    rec.pressureDeciPa = 1013250 - static_cast<int32_t>(sequence % 50000);
+    flightRecordSeal(rec, static_cast<uint8_t>(phase));
+}
+
+void printWear(const EmulatedNorFlash& nor) {
+    const std::vector<uint32_t>& erases = nor.sectorErases();
+    uint32_t minE = 0xFFFFFFFFu;
+    uint32_t maxE = 0;
+    uint64_t total = 0;
+    uint32_t touched = 0;
+    for (uint32_t e : erases) {
+        minE = std::min(minE, e);
+        maxE = std::max(maxE, e);
+        total += e;
+        touched += e > 0 ? 1 : 0;
+    }
+    printf("wear: sectors %zu, erased at least once %u, min %u, max %u, mean %.3f\n", erases.size(),
+           touched, minE, maxE, erases.empty() ? 0.0 : static_cast<double>(total) / erases.size());
+
+    // Histogram of erase counts for the sectors that were erased at all.
+    if (maxE == 0) {
+        return;
+    }
+    const uint32_t kBins = 8;
+    const uint32_t width = (maxE + kBins - 1) / kBins;
+    uint32_t bins[kBins] = {};
+    for (uint32_t e : erases) {
+        if (e > 0) {
+            ++bins[std::min((e - 1) / width, kBins - 1)];
+        }
+    }
+    for (uint32_t i = 0; i < kBins && i * width + 1 <= maxE; ++i) {
+        printf("  %5u-%-5u %u\n", i * width + 1, (i + 1) * width, bins[i]);
+    }
+}
+
+// Everything measured over one replayed flight.
+struct FlightResult {
+    uint64_t mountUs;
+    double seconds;
+    uint64_t bytesQueued;
+    uint32_t records;
+    uint32_t rejected;
+    uint32_t lost;              // samples that overflowed the KX134 buffer during a long tick
+    uint32_t tickErrors;
+    uint32_t worstTickUs;
+    uint32_t worstTickMs;
+    uint64_t tickUsTotal;
+    uint32_t syncTicks;         // ticks that ended in at least one lfs_file_sync
+    uint64_t syncTickUsTotal;
+    uint32_t worstSyncTickUs;
+    uint32_t syncs;
+    bool cut;
+    NorStats nor;
+    SpiFlashTickStats ticks;
+    EraseAheadStats preErase;
+};
+
+// Runs the whole flight; returns false if the filesystem could not be mounted.
+bool runFlight(EmulatedNorFlash& nor, const BenchOptions& opt, const SpiFlashFsProfile& profile, FlightResult& r) {
+    memset(&r, 0, sizeof(r));
+    spiFlash flash(nor);
+    if (!flash.setFsProfile(profile)) {
+        fprintf(stderr, "invalid LittleFS profile\n");
+        return false;
+    }
+    const uint64_t mountStart = hostClockUs();
+    if (!flash.startUp()) {
+        fprintf(stderr, "spiFlash startUp failed\n");
+        return false;
+    }
+    r.mountUs = hostClockUs() - mountStart;
+    nor.resetStats();
+    flash.resetTickStats();
+
+    const uint32_t periodUs = 1000000 / opt.rateHz;
+    const uint32_t totalMs = (opt.padS + opt.flightS + opt.landedS) * 1000;
+    const uint64_t t0 = hostClockUs();
+    if (opt.cutS >= 0) {
+        nor.cutPowerAtUs(t0 + static_cast<uint64_t>(opt.cutS) * 1000000ULL);
+    }
+
+    const uint32_t padDivider = opt.rateHz > opt.padRateHz ? opt.rateHz / opt.padRateHz : 1;
+    FlightPhase phase = FlightPhase::UNARMED;
+    uint32_t sequence = 0;
+    uint32_t nextLogMs = 0;
+    uint64_t nextSampleUs = t0;
+    bool done = false;
+
+    while (!done && nor.powered()) {
+        hostClockAdvanceTo(nextSampleUs);
+        const uint64_t now = hostClockUs();
+        const uint64_t pending = (now - nextSampleUs) / periodUs + 1;
+        if (pending > KX134_BUFFER_MAX_SAMPLES) {
+            const uint32_t lost = static_cast<uint32_t>(pending - KX134_BUFFER_MAX_SAMPLES);
+            r.lost += lost;
+            sequence += lost;
+            nextSampleUs += static_cast<uint64_t>(lost) * periodUs;
+        }
+
+        for (; nextSampleUs <= now; nextSampleUs += periodUs) {
+            const uint32_t ms = static_cast<uint32_t>((nextSampleUs - t0) / 1000);
+            if (ms >= totalMs) {
+                done = true;
+                break;
+            }
+
+            const FlightPhase at = phaseAt(ms, opt);
+            if (at != phase) {
+                phase = at;
+                enterPhase(flash, phase);
+            }
+
+            const uint32_t seq = sequence++;
+            if (phase == FlightPhase::ARMED && seq % padDivider != 0) {
+                continue;
+            }
+            FlightRecord rec;
+            makeRecord(rec, seq, ms, phase);
+            if (flash.queue(sizeof(rec), reinterpret_cast<const char*>(&rec), spiFlash::P_STD) < 0) {
+                ++r.rejected;
+            } else {
+                ++r.records;
+                r.bytesQueued += sizeof(rec);
+            }
+
+            if (ms >= nextLogMs) {
+                char line[64];
+                const int n = snprintf(line, sizeof(line), "[%lu] STATUS: phase %u seq %lu\r\n",
+                                       static_cast<unsigned long>(ms), static_cast<unsigned>(phase),
+                                       static_cast<unsigned long>(sequence));
+                flash.kLog(static_cast<size_t>(n), line);
+                flash.kflush();
+                nextLogMs = ms + 2000;
+            }
+        }
+        if (done) {
+            break;
+        }
+
+        const uint32_t syncsBefore = flash.syncCount();
+        const uint64_t tickStart = hostClockUs();
+        if (flash.tick(opt.budgetUs) < 0) {
+            ++r.tickErrors;
+        }
+        const uint32_t tickUs = static_cast<uint32_t>(hostClockUs() - tickStart);
+        r.tickUsTotal += tickUs;
+        if (tickUs > r.worstTickUs) {
+            r.worstTickUs = tickUs;
+            r.worstTickMs = static_cast<uint32_t>((tickStart - t0) / 1000);
+        }
+        if (flash.syncCount() != syncsBefore) {
+            ++r.syncTicks;
+            r.syncTickUsTotal += tickUs;
+            r.worstSyncTickUs = tickUs > r.worstSyncTickUs ? tickUs : r.worstSyncTickUs;
+        }
+    }
+
+    r.cut = !nor.powered();
+    if (!r.cut) {
+        enterPhase(flash, FlightPhase::LANDED);
+        flash.sync();
+    }
+    r.seconds = static_cast<double>(hostClockUs() - t0) / 1e6;
+    r.syncs = flash.syncCount();
+    r.nor = nor.stats();
+    r.ticks = flash.tickStats();
+    r.preErase = flash.preEraseStats();
+    return true;
+}
+
+void printFlight(const BenchOptions& opt, const FlightResult& r) {
+    printf("flash_bench: %u Hz, budget %u us, %s timings, jitter %.2f\n", opt.rateHz, opt.budgetUs,
+           opt.worst ? "worst-case" : "typical", opt.jitter);
+    printf("mount: %.1f ms\n", r.mountUs / 1000.0);
+    printf("records: %u queued, %u rejected (queue full), %u samples lost to KX134 buffer overrun, %u tick errors\n",
+           r.records, r.rejected, r.lost, r.tickErrors);
+    printf("throughput: %.0f B/s payload over %.1f s; %.1f KiB programmed (%.2fx write amplification)\n",
+           r.bytesQueued / r.seconds, r.seconds, r.nor.programBytes / 1024.0,
+           r.bytesQueued ? static_cast<double>(r.nor.programBytes) / r.bytesQueued : 0.0);
+    printf("tick: worst %u us at t=%.2f s, mean %.1f us over %u ticks\n", r.worstTickUs, r.worstTickMs / 1000.0,
+           r.ticks.ticks ? static_cast<double>(r.tickUsTotal) / r.ticks.ticks : 0.0, r.ticks.ticks);
+    printf("sync: %u syncs, ticks that synced: mean %.1f us, worst %u us\n", r.syncs,
+           r.syncTicks ? static_cast<double>(r.syncTickUsTotal) / r.syncTicks : 0.0, r.worstSyncTickUs);
+    printf("flash: %llu programs, %llu erases, %llu status polls, %.1f ms blocked waiting, %llu NOR violations\n",
+           static_cast<unsigned long long>(r.nor.programs), static_cast<unsigned long long>(r.nor.erases),
+           static_cast<unsigned long long>(r.nor.statusPolls), r.nor.waitUs / 1000.0,
+           static_cast<unsigned long long>(r.nor.norViolations));
+    printf("async programs: %u issued, %u waited on, %u overlapped other work, %u verify errors\n", r.ticks.programs,
+           r.ticks.programWaits, r.ticks.programs - r.ticks.programWaits, r.ticks.verifyErrors);
+    printf("pre-erase: %u erased, %u found blank, %u hits, %u misses\n", r.preErase.erased, r.preErase.foundBlank,
+           r.preErase.hits, r.preErase.misses);
+}
+
+// Remount a volume that already holds a flight, then append back to back (no sample period) to
+// measure sustained throughput. Returns bytes per second, or a negative value on error.
+double measureAppend(EmulatedNorFlash& nor, const SpiFlashFsProfile& profile, uint32_t budgetUs, uint64_t& mountUs) {
+    spiFlash flash(nor);
+    flash.setFsProfile(profile);
+    const uint64_t mountStart = hostClockUs();
+    if (!flash.startUp()) {
+        return -1.0;
+    }
+    mountUs = hostClockUs() - mountStart;
+
+    const uint32_t kBytes = 512 * 1024;
+    FlightRecord rec;
+    const uint64_t t0 = hostClockUs();
+    for (uint32_t done = 0, seq = 0; done < kBytes; done += sizeof(rec), ++seq) {
+        makeRecord(rec, seq, seq * 20, FlightPhase::LAUNCH);
+        while (flash.queue(sizeof(rec), reinterpret_cast<const char*>(&rec), spiFlash::P_STD) == -2) {
+            if (flash.tick(budgetUs) < 0) {
+                return -1.0;
+            }
+        }
+    }
+    while (flash.tick(budgetUs) > 0) {
+    }
+    if (flash.sync() < 0) {
+        return -1.0;
+    }
+    return kBytes / (static_cast<double>(hostClockUs() - t0) / 1e6);
+}
+
+// One sweep row per profile: fresh chip, replayed flight, remount of the written volume, append burst.
+int runSweep(const BenchOptions& opt, const NorTimings& timings) {
+    static const uint32_t kReadSizes[] = {16, 256};
+    static const uint32_t kCacheSizes[] = {256, 512, 1024};
+    static const uint32_t kLookaheadSizes[] = {16, 128, 256};
+    static const int32_t kBlockCycles[] = {500, -1};
+    static const uint32_t kMetadataMax[] = {0, 1024};
+    static const uint32_t kInlineMax[] = {0, 0xFFFFFFFFu};
+    static const uint32_t kCompactThresh[] = {0, 0xFFFFFFFFu};
+
+    printf("read,cache,lookahead,block_cycles,metadata_max,inline_max,compact_thresh,ram_bytes,"
+           "mount_ms,append_kib_s,worst_tick_us,mean_sync_tick_us,worst_sync_tick_us,erases,program_kib\n");
+    for (uint32_t readSize : kReadSizes) {
+        for (uint32_t cacheSize : kCacheSizes) {
+            for (uint32_t lookahead : kLookaheadSizes) {
+                for (int32_t cycles : kBlockCycles) {
+                    for (uint32_t metadataMax : kMetadataMax) {
+                        for (uint32_t inlineMax : kInlineMax) {
+                            for (uint32_t compact : kCompactThresh) {
+                                const SpiFlashFsProfile profile{readSize,    cacheSize, lookahead, cycles,
+                                                                metadataMax, inlineMax, compact};
+                                if (!profile.valid()) {
+                                    continue;
+                                }
+                                hostClockReset();
+                                EmulatedNorFlash nor(EmulatedNorFlash::kW25Q128Size, timings);
+                                FlightResult r;
+                                if (!runFlight(nor, opt, profile, r)) {
+                                    return 1;
+                                }
+                                uint64_t mountUs = 0;
+                                const double append = measureAppend(nor, profile, opt.budgetUs, mountUs);
+                                printf("%u,%u,%u,%d,%u,%d,%d,%u,%.1f,%.1f,%u,%.1f,%u,%llu,%.1f\n", readSize, cacheSize,
+                                       lookahead, cycles, metadataMax, static_cast<int32_t>(inlineMax),
+                                       static_cast<int32_t>(compact), profile.ramBytes(2), mountUs / 1000.0,
+                                       append / 1024.0, r.worstTickUs,
+                                       r.syncTicks ? static_cast<double>(r.syncTickUsTotal) / r.syncTicks : 0.0,
+                                       r.worstSyncTickUs, static_cast<unsigned long long>(r.nor.erases),
+                                       r.nor.programBytes / 1024.0);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    BenchOptions opt;
+    SpiFlashFsProfile profile = SpiFlashFsProfile::defaults();
+    bool sweep = false;
+    for (int i = 1; i < argc; ++i) {
+        const bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--rate") == 0 && hasValue) {
+            opt.rateHz = static_cast<uint32_t>(atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--pad-rate") == 0 && hasValue) {
+            opt.padRateHz = static_cast<uint32_t>(atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--budget") == 0 && hasValue) {
+            opt.budgetUs = static_cast<uint32_t>(atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--pad") == 0 && hasValue) {
+            opt.padS = static_cast<uint32_t>(atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--flight") == 0 && hasValue) {
+            opt.flightS = static_cast<uint32_t>(atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--landed") == 0 && hasValue) {
+            opt.landedS = static_cast<uint32_t>(atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--worst") == 0) {
+            opt.worst = true;
+        } else if (strcmp(argv[i], "--jitter") == 0 && hasValue) {
+            opt.jitter = static_cast<float>(atof(argv[++i]));
+        } else if (strcmp(argv[i], "--image") == 0 && hasValue) {
+            opt.image = argv[++i];
+        } else if (strcmp(argv[i], "--cut") == 0 && hasValue) {
+            opt.cutS = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--read") == 0 && hasValue) {
+            profile.readSize = static_cast<uint32_t>(atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--cache") == 0 && hasValue) {
+            profile.cacheSize = static_cast<uint32_t>(atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--lookahead") == 0 && hasValue) {
+            profile.lookaheadSize = static_cast<uint32_t>(atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--block-cycles") == 0 && hasValue) {
+            profile.blockCycles = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--metadata-max") == 0 && hasValue) {
+            profile.metadataMax = static_cast<uint32_t>(atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--inline-max") == 0 && hasValue) {
+            profile.inlineMax = static_cast<uint32_t>(atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--compact-thresh") == 0 && hasValue) {
+            profile.compactThresh = static_cast<uint32_t>(atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--sweep") == 0) {
+            sweep = true;
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (opt.rateHz == 0 || opt.rateHz > 1000 || opt.padRateHz == 0 || opt.jitter < 0.0f || opt.jitter > 1.0f || !profile.valid() ||
+        (sweep && (opt.image != nullptr || opt.cutS >= 0))) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    NorTimings timings = opt.worst ? NorTimings::worstCase() : NorTimings();
+    timings.jitter = opt.jitter;
+    hostSerialSetEnabled(false);
+    if (sweep) {
+        return runSweep(opt, timings);
+    }
+
+    EmulatedNorFlash nor(EmulatedNorFlash::kW25Q128Size, timings);
+    if (opt.image != nullptr && !nor.open(opt.image)) {
+        fprintf(stderr, "cannot open image %s\n", opt.image);
+        return 1;
+    }
+
+    FlightResult result;
+    if (!runFlight(nor, opt, profile, result)) {
+        return 1;
+    }
+    printFlight(opt, result);
+    printf("LittleFS RAM: %u bytes (read %u, cache %u, lookahead %u, 2 open files)\n", profile.ramBytes(2),
+           profile.readSize, profile.cacheSize, profile.lookaheadSize);
+    printWear(nor);
+    if (!nor.powered()) {
+        printf("power cut at t=%d s; remounting\n", opt.cutS);
+        nor.powerOn();
+        spiFlash after(nor);
+        printf("remount after cut: %s\n", after.startUp() ? "ok" : "FAILED");
+    }
+    if (opt.image != nullptr && !nor.save()) {
+        fprintf(stderr, "cannot save image %s\n", opt.image);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,99 @@
+/**
+ * @file flight_decode.cpp
+ * @brief Host tool: convert binary DATA###.bin flight logs to the legacy CSV columns
+ *
+ * Build and run:
+ *   pio run -e flight_decode
+ *   .pio/build/flight_decode/program DATA003.bin DATA003.txt
+ *
+ * Options:
+ *   --sea-level <hPa>  reference pressure for the altitude column (default 1013.25)
+ *
+ * Output columns: timestamp, sequence, ax, ay, az, |a|, altitude, phase — the format the
+ * firmware wrote before the binary record was introduced. Bytes that do not start a valid
+ * record (torn writes, power loss) are skipped and counted on stderr.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "FlightRecord.h"
+
+namespace {
+
+void usage(const char* argv0) {
+    fprintf(stderr, "usage: %s [--sea-level hPa] <DATA###.bin> [out.csv]\n", argv0);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    float seaLevelHpa = 1013.25f;
+    const char* inPath = nullptr;
+    const char* outPath = nullptr;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--sea-level") == 0 && i + 1 < argc) {
+            seaLevelHpa = static_cast<float>(atof(argv[++i]));
+        } else if (inPath == nullptr) {
+            inPath = argv[i];
+        } else if (outPath == nullptr) {
+            outPath = argv[i];
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (inPath == nullptr || seaLevelHpa <= 0.0f) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    FILE* in = fopen(inPath, "rb");
+    if (in == nullptr) {
+        perror(inPath);
+        return 1;
+    }
+    FILE* out = stdout;
+    if (outPath != nullptr) {
+        out = fopen(outPath, "wb");
+        if (out == nullptr) {
+            perror(outPath);
+            fclose(in);
+            return 1;
+        }
+    }
+
+    // Slide a record-sized window over the file so a corrupt byte costs one byte, not the log.
+    uint8_t window[sizeof(FlightRecord)];
+    size_t have = fread(window, 1, sizeof(window), in);
+    unsigned long records = 0;
+    unsigned long skipped = 0;
+    char line[128];
+
+    while (have == sizeof(window)) {
+        FlightRecord rec;
+        memcpy(&rec, window, sizeof(rec));
+        if (flightRecordIsValid(rec)) {
+            const int n = flightRecordToCsv(rec, line, sizeof(line), seaLevelHpa);
+            if (n > 0) {
+                fwrite(line, 1, static_cast<size_t>(n), out);
+            }
+            ++records;
+            have = fread(window, 1, sizeof(window), in);
+            continue;
+        }
+        memmove(window, window + 1, sizeof(window) - 1);
+        ++skipped;
+        have = sizeof(window) - 1 + fread(window + sizeof(window) - 1, 1, 1, in);
+    }
+    skipped += have;
+
+    fclose(in);
+    if (out != stdout) {
+        fclose(out);
+    }
+    fprintf(stderr, "%lu records decoded, %lu bytes skipped\n", records, skipped);
+    return 0;
+}
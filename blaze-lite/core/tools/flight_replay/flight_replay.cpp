@@ -0,0 +1,355 @@
+/**
+ * @file flight_replay.cpp
+ * @brief Host tool: replay recorded flights through AltitudeFilter + FlightStateMachine
+ *
+ * Build and run:
+ *   pio run -e flight_replay
+ *   .pio/build/flight_replay/program logs/DATA*.txt --max-latency 300
+ *
+ * Options:
+ *   --truth <file>      ground truth for the single input (default: <input>.truth if present,
+ *                       else the logged phase column)
+ *   --early <ms>        detection this much before the reference is not a false positive
+ *                       (default 1000; the logged phase column is itself late)
+ *   --max-latency <ms>  also fail if any detection is later than this
+ *   --no-filter         raw altitude and differenced velocity (firmware before AltitudeFilter)
+ *   --range <0..3>      KX134 range code used to turn CSV g back into counts (default 3, 64 g)
+ *   --axis <0..2>       body axis (default KX134_AXIAL_AXIS, Z)
+ *   --sign <1|-1>       body axis sign (default 1)
+ *   --sea-level <hPa>   reference pressure the DATA###.txt altitudes were computed with (default 1013.25)
+ *
+ * Inputs are DATA###.txt (legacy CSV: timestamp, sequence, ax, ay, az, |a|, altitude, phase) or
+ * DATA###.bin (FlightRecord). Ground-truth files hold one "<PHASE> <ms>" pair per line, e.g.
+ * "APOGEE 23140"; '#' starts a comment, and a phase not listed did not happen. The replay arms where the log first shows ARMED (or at
+ * its first sample) and runs on the logged timestamps, so a flight takes milliseconds.
+ *
+ * Prints detection latency per phase and per file, and where the coast model predicted apogee,
+ * then a summary. Exit status is 1 if any
+ * file has a false positive, a missed event or (with --max-latency) a late detection, so the
+ * tool can gate changes to the detectors.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <vector>
+
+#include "FlightRecord.h"
+#include "FlightReplay.h"
+
+namespace {
+
+struct ReplayOptions {
+    const char* truthPath = nullptr;
+    uint32_t earlyMs = 1000;
+    int32_t maxLatencyMs = -1;
+    bool useFilter = true;
+    uint8_t range = 3;
+    uint8_t axis = 2;
+    int8_t sign = 1;
+    float seaLevelHpa = 1013.25f;
+};
+
+struct LoggedRow {
+    uint32_t timestampMs;
+    int16_t accelRaw[3];
+    uint8_t accelRange;
+    bool accelValid;
+    float pressureHpa;
+    bool baroValid;
+    uint8_t phase;
+};
+
+void usage(const char* argv0) {
+    fprintf(stderr,
+            "usage: %s [--truth file] [--early ms] [--max-latency ms] [--no-filter]\n"
+            "          [--range 0..3] [--axis 0..2] [--sign 1|-1] [--sea-level hPa] <DATA###.txt|.bin>...\n",
+            argv0);
+}
+
+bool endsWith(const char* s, const char* suffix) {
+    const size_t n = strlen(s);
+    const size_t m = strlen(suffix);
+    return n >= m && strcmp(s + n - m, suffix) == 0;
+}
+
+bool loadCsv(const char* path, const ReplayOptions& opt, std::vector<LoggedRow>* rows) {
+    FILE* in = fopen(path, "rb");
+    if (in == nullptr) {
+        perror(path);
+        return false;
+    }
+    char line[256];
+    DataCsvRow row;
+    while (fgets(line, sizeof(line), in) != nullptr) {
+        if (!parseDataCsvLine(line, &row)) {
+            continue;
+        }
+        LoggedRow r;
+        r.timestampMs = row.timestampMs;
+        for (int i = 0; i < 3; ++i) {
+            r.accelRaw[i] = rawAccelFromG(row.accelG[i], opt.range);
+        }
+        r.accelRange = opt.range;
+        r.accelValid = row.magnitudeG != 0.0f;  // the firmware logged zeros without a sample
+        r.baroValid = row.altitudeM != 0.0f;
+        r.pressureHpa = r.baroValid ? baroStdPressure(row.altitudeM, opt.seaLevelHpa) : 0.0f;
+        r.phase = row.phase;
+        rows->push_back(r);
+    }
+    fclose(in);
+    return true;
+}
+
+bool loadBin(const char* path, std::vector<LoggedRow>* rows) {
+    FILE* in = fopen(path, "rb");
+    if (in == nullptr) {
+        perror(path);
+        return false;
+    }
+    // Same resynchronising window as flight_decode.
+    uint8_t window[sizeof(FlightRecord)];
+    size_t have = fread(window, 1, sizeof(window), in);
+    while (have == sizeof(window)) {
+        FlightRecord rec;
+        memcpy(&rec, window, sizeof(rec));
+        if (!flightRecordIsValid(rec)) {
+            memmove(window, window + 1, sizeof(window) - 1);
+            have = sizeof(window) - 1 + fread(window + sizeof(window) - 1, 1, 1, in);
+            continue;
+        }
+        LoggedRow r;
+        r.timestampMs = rec.timestampMs;
+        memcpy(r.accelRaw, rec.accelRaw, sizeof(r.accelRaw));
+        r.accelRange = (rec.flags & FLIGHT_RECORD_RANGE_MASK) >> FLIGHT_RECORD_RANGE_SHIFT;
+        r.accelValid = (rec.flags & FLIGHT_RECORD_ACCEL_VALID) != 0;
+        r.baroValid = (rec.flags & FLIGHT_RECORD_BARO_VALID) != 0;
+        r.pressureHpa = r.baroValid ? rec.pressureDeciPa / 1000.0f : 0.0f;
+        r.phase = flightRecordPhase(rec);
+        rows->push_back(r);
+        have = fread(window, 1, sizeof(window), in);
+    }
+    fclose(in);
+    return true;
+}
+
+bool loadTruth(const char* path, FlightEvents* truth) {
+    FILE* in = fopen(path, "rb");
+    if (in == nullptr) {
+        perror(path);
+        return false;
+    }
+    truth->clear();
+    char line[128];
+    int lineNo = 0;
+    bool ok = true;
+    while (fgets(line, sizeof(line), in) != nullptr) {
+        ++lineNo;
+        char* hash = strchr(line, '#');
+        if (hash != nullptr) {
+            *hash = '\0';
+        }
+        char name[16];
+        unsigned long ms = 0;
+        const int n = sscanf(line, "%15s %lu", name, &ms);
+        if (n <= 0) {
+            continue;
+        }
+        FlightPhase phase;
+        if (n != 2 || !flightPhaseFromName(name, &phase)) {
+            fprintf(stderr, "%s:%d: expected \"<PHASE> <ms>\"\n", path, lineNo);
+            ok = false;
+            continue;
+        }
+        truth->mark(phase, static_cast<uint32_t>(ms * 1000u));
+    }
+    fclose(in);
+    return ok;
+}
+
+// Reference from the logged phase column; a jump over phases marks the skipped ones too.
+void truthFromPhaseColumn(const std::vector<LoggedRow>& rows, FlightEvents* truth) {
+    truth->clear();
+    uint8_t last = 0;
+    for (const LoggedRow& r : rows) {
+        if (r.phase > last && r.phase <= static_cast<uint8_t>(FlightPhase::LANDED)) {
+            for (uint8_t p = last + 1; p <= r.phase; ++p) {
+                truth->mark(static_cast<FlightPhase>(p), r.timestampMs * 1000u);
+            }
+            last = r.phase;
+        }
+    }
+}
+
+struct PhaseSummary {
+    int detected = 0;
+    int64_t latencySumMs = 0;
+    int32_t worstLatencyMs = 0;
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    ReplayOptions opt;
+    std::vector<const char*> inputs;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--truth") == 0 && i + 1 < argc) {
+            opt.truthPath = argv[++i];
+        } else if (strcmp(argv[i], "--early") == 0 && i + 1 < argc) {
+            opt.earlyMs = static_cast<uint32_t>(atol(argv[++i]));
+        } else if (strcmp(argv[i], "--max-latency") == 0 && i + 1 < argc) {
+            opt.maxLatencyMs = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--no-filter") == 0) {
+            opt.useFilter = false;
+        } else if (strcmp(argv[i], "--range") == 0 && i + 1 < argc) {
+            opt.range = static_cast<uint8_t>(atoi(argv[++i]) & 0x03);
+        } else if (strcmp(argv[i], "--axis") == 0 && i + 1 < argc) {
+            opt.axis = static_cast<uint8_t>(atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--sign") == 0 && i + 1 < argc) {
+            opt.sign = atoi(argv[++i]) < 0 ? -1 : 1;
+        } else if (strcmp(argv[i], "--sea-level") == 0 && i + 1 < argc) {
+            opt.seaLevelHpa = static_cast<float>(atof(argv[++i]));
+        } else if (argv[i][0] == '-' && argv[i][1] == '-') {
+            usage(argv[0]);
+            return 2;
+        } else {
+            inputs.push_back(argv[i]);
+        }
+    }
+    if (inputs.empty() || opt.axis > 2 || opt.seaLevelHpa <= 0.0f || (opt.truthPath != nullptr && inputs.size() != 1)) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    using Clock = std::chrono::steady_clock;
+    PhaseSummary summary[FLIGHT_PHASE_COUNT];
+    int failedFiles = 0;
+    double totalReplayS = 0.0;
+    double totalFlightS = 0.0;
+    std::vector<LoggedRow> rows;
+
+    for (const char* path : inputs) {
+        rows.clear();
+        const bool loaded = endsWith(path, ".bin") ? loadBin(path, &rows) : loadCsv(path, opt, &rows);
+        if (!loaded || rows.empty()) {
+            fprintf(stderr, "%s: no samples\n", path);
+            ++failedFiles;
+            continue;
+        }
+
+        FlightEvents truth;
+        const char* truthSource = "phase column";
+        char sidecar[512];
+        snprintf(sidecar, sizeof(sidecar), "%s.truth", path);
+        const char* truthPath = opt.truthPath;
+        if (truthPath == nullptr) {
+            FILE* probe = fopen(sidecar, "rb");
+            if (probe != nullptr) {
+                fclose(probe);
+                truthPath = sidecar;
+            }
+        }
+        if (truthPath != nullptr) {
+            if (!loadTruth(truthPath, &truth)) {
+                ++failedFiles;
+                continue;
+            }
+            truthSource = truthPath;
+        } else {
+            truthFromPhaseColumn(rows, &truth);
+        }
+
+        // Replay: arm where the log shows ARMED (or at its first sample), then one feed per row.
+        const auto t0 = Clock::now();
+        FlightReplayer replay(opt.useFilter, opt.axis, opt.sign);
+        size_t armAt = 0;
+        while (armAt < rows.size() && rows[armAt].phase < static_cast<uint8_t>(FlightPhase::ARMED)) {
+            ++armAt;
+        }
+        if (armAt == rows.size()) {
+            armAt = 0;
+        }
+        float lastPressure = NAN;
+        for (size_t i = 0; i < rows.size(); ++i) {
+            const LoggedRow& r = rows[i];
+            ReplaySample s;
+            s.timestampUs = r.timestampMs * 1000u;
+            memcpy(s.accelRaw, r.accelRaw, sizeof(s.accelRaw));
+            s.accelRange = r.accelRange;
+            s.accelValid = r.accelValid;
+            s.pressureHpa = r.pressureHpa;
+            // The log repeats the latest baro value on every accelerometer record.
+            s.baroFresh = r.baroValid && r.pressureHpa != lastPressure;
+            if (r.baroValid) {
+                lastPressure = r.pressureHpa;
+            }
+            if (i == armAt) {
+                replay.arm(s.timestampUs);
+            }
+            replay.feed(s);
+        }
+        const double replayS = std::chrono::duration<double>(Clock::now() - t0).count();
+        const double flightS = (rows.back().timestampMs - rows.front().timestampMs) / 1000.0;
+        totalReplayS += replayS;
+        totalFlightS += flightS;
+
+        FlightEventScore scores[FLIGHT_PHASE_COUNT];
+        int failures = scoreFlightEvents(truth, replay.events(), opt.earlyMs, scores);
+        printf("%s: %zu samples, %.1f s replayed in %.2f ms, reference: %s\n", path, rows.size(), flightS,
+               replayS * 1e3, truthSource);
+        for (int p = static_cast<int>(FlightPhase::LAUNCH); p <= static_cast<int>(FlightPhase::LANDED); ++p) {
+            const FlightEventScore& sc = scores[p];
+            const char* name = flightPhaseName(static_cast<FlightPhase>(p));
+            char ref[24] = "-";
+            char det[24] = "-";
+            if (sc.expected) {
+                snprintf(ref, sizeof(ref), "%lu ms", static_cast<unsigned long>(truth.timeUs[p] / 1000));
+            }
+            if (sc.detected) {
+                snprintf(det, sizeof(det), "%lu ms", static_cast<unsigned long>(replay.events().timeUs[p] / 1000));
+            }
+            const bool late = sc.expected && sc.detected && opt.maxLatencyMs >= 0 && sc.latencyMs > opt.maxLatencyMs;
+            failures += late ? 1 : 0;
+            printf("  %-8s ref %-12s detected %-12s", name, ref, det);
+            if (sc.expected && sc.detected) {
+                printf(" latency %+ld ms", static_cast<long>(sc.latencyMs));
+                PhaseSummary& ps = summary[p];
+                ++ps.detected;
+                ps.latencySumMs += sc.latencyMs;
+                if (ps.detected == 1 || sc.latencyMs > ps.worstLatencyMs) {
+                    ps.worstLatencyMs = sc.latencyMs;
+                }
+            }
+            printf("%s%s%s\n", sc.falsePositive ? "  FALSE POSITIVE" : "", sc.missed ? "  MISSED" : "",
+                   late ? "  LATE" : "");
+        }
+        const FlightState& state = replay.state();
+        if (state.apogeePredicted) {
+            const int p = static_cast<int>(FlightPhase::APOGEE);
+            printf("  predicted apogee %.1f m at %lu ms", state.predictedApogee,
+                   static_cast<unsigned long>(state.apogeePredictedTime));
+            if (truth.seen[p]) {
+                printf(" (%+ld ms vs ref)", static_cast<long>(state.apogeePredictedTime) -
+                                                static_cast<long>(truth.timeUs[p] / 1000));
+            }
+            printf("\n");
+        }
+        if (failures > 0) {
+            ++failedFiles;
+        }
+    }
+
+    printf("\n%zu file(s), %d failed; %.1f s of flight in %.2f ms (%.0fx real time)\n", inputs.size(), failedFiles,
+           totalFlightS, totalReplayS * 1e3, totalReplayS > 0.0 ? totalFlightS / totalReplayS : 0.0);
+    for (int p = static_cast<int>(FlightPhase::LAUNCH); p <= static_cast<int>(FlightPhase::LANDED); ++p) {
+        const PhaseSummary& ps = summary[p];
+        if (ps.detected > 0) {
+            printf("  %-8s mean latency %+.0f ms, worst %+ld ms over %d flight(s)\n",
+                   flightPhaseName(static_cast<FlightPhase>(p)), static_cast<double>(ps.latencySumMs) / ps.detected,
+                   static_cast<long>(ps.worstLatencyMs), ps.detected);
+        }
+    }
+    return failedFiles > 0 ? 1 : 0;
+}
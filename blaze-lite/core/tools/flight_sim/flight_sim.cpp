@@ -0,0 +1,351 @@
+/**
+ * @file flight_sim.cpp
+ * @brief Host tool: Monte Carlo flights through the detection pipeline, in parallel on all cores
+ *
+ * Build and run:
+ *   pio run -e flight_sim
+ *   .pio/build/flight_sim/program --flights 2000 --params apogeeMs=500 --params apogeeMs=200
+ *
+ * Detector parameter sets (repeat --params to compare; default: the flight defaults). Each is a
+ * comma-separated list of key=value overriding the defaults:
+ *   launchG launchMs apogeeV apogeeMs descentV landedG landedAlt landedMs
+ *   leadMs predictMs predict   (predicted apogee: lead, window, 1 = deploy on it)
+ *
+ * Run:
+ *   --flights <n>        flights per parameter set (default 1000)
+ *   --seed <n>           first seed; flight i uses seed + i in every set (default 1)
+ *   --threads <n>        worker threads (default: all cores)
+ *   --csv <file>         one row per flight
+ *
+ * Vehicle and environment (SimConfig; 1-sigma dispersions are built in):
+ *   --thrust <file>      thrust curve, "time thrust" pairs per line (RASP .eng bodies work;
+ *                        lines that are not two numbers are skipped)
+ *   --motor-scale <k>    scale thrust and propellant (e.g. 3 for a transonic flight)
+ *   --mass <kg> --propellant <kg> --cda <m^2> --chute-cda <m^2> --deploy-delay <s>
+ *   --pad-alt <m> --gust <m/s> --accel-noise <g> --vibration <g> --baro-noise <Pa> --spike <Pa>
+ *
+ * Prints, per parameter set, the distribution of apogee-detection error (detected minus true
+ * apogee), altitude lost between true apogee and parachute deploy (an early deploy is charged the
+ * height still to climb), and time to detect launch
+ * and landing, plus missed and early (still climbing) detections. The apogee predictor is
+ * scored by its event time and by what it predicted one second into the coast.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "FlightSim.h"
+
+namespace {
+
+struct ParamSet {
+    char label[128];
+    FlightDetectorConfig detector;
+};
+
+void usage(const char* argv0) {
+    fprintf(stderr,
+            "usage: %s [--flights n] [--seed n] [--threads n] [--csv file] [--params k=v,...]...\n"
+            "          [--thrust file] [--motor-scale k] [--mass kg] [--propellant kg] [--cda m2]\n"
+            "          [--chute-cda m2] [--deploy-delay s] [--pad-alt m] [--gust m/s]\n"
+            "          [--accel-noise g] [--vibration g] [--baro-noise Pa] [--spike Pa]\n",
+            argv0);
+}
+
+bool parseParams(const char* text, ParamSet* set) {
+    set->detector = FlightStateMachine::defaultDetectorConfig();
+    snprintf(set->label, sizeof(set->label), "%s", text);
+    char buf[256];
+    snprintf(buf, sizeof(buf), "%s", text);
+    for (char* item = strtok(buf, ","); item != nullptr; item = strtok(nullptr, ",")) {
+        char* eq = strchr(item, '=');
+        if (eq == nullptr) {
+            return false;
+        }
+        *eq = '\0';
+        const double value = atof(eq + 1);
+        FlightDetectorConfig& d = set->detector;
+        if (strcmp(item, "launchG") == 0) {
+            d.launchAccelG = static_cast<float>(value);
+        } else if (strcmp(item, "launchMs") == 0) {
+            d.launchDetectionMs = static_cast<uint32_t>(value);
+        } else if (strcmp(item, "apogeeV") == 0) {
+            d.apogeeVelocity = static_cast<float>(value);
+        } else if (strcmp(item, "apogeeMs") == 0) {
+            d.apogeeDetectionMs = static_cast<uint32_t>(value);
+        } else if (strcmp(item, "descentV") == 0) {
+            d.descentVelocity = static_cast<float>(value);
+        } else if (strcmp(item, "landedG") == 0) {
+            d.landedAccelG = static_cast<float>(value);
+        } else if (strcmp(item, "landedAlt") == 0) {
+            d.landedAltitudeM = static_cast<float>(value);
+        } else if (strcmp(item, "landedMs") == 0) {
+            d.landedDetectionMs = static_cast<uint32_t>(value);
+        } else if (strcmp(item, "leadMs") == 0) {
+            d.apogeeLeadMs = static_cast<uint32_t>(value);
+        } else if (strcmp(item, "predictMs") == 0) {
+            d.apogeePredictMs = static_cast<uint32_t>(value);
+        } else if (strcmp(item, "predict") == 0) {
+            d.apogeeOnPrediction = value != 0.0;
+        } else {
+            fprintf(stderr, "unknown parameter \"%s\"\n", item);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool loadThrust(const char* path, ThrustCurve* curve) {
+    FILE* in = fopen(path, "rb");
+    if (in == nullptr) {
+        perror(path);
+        return false;
+    }
+    ThrustCurve c;
+    char line[256];
+    while (fgets(line, sizeof(line), in) != nullptr) {
+        float t;
+        float n;
+        if (line[0] == ';' || sscanf(line, " %f%*[ ,\t]%f", &t, &n) != 2) {
+            continue;
+        }
+        if (!c.add(t, n)) {
+            fprintf(stderr, "%s: thrust points must increase in time (max %d)\n", path, ThrustCurve::kMaxPoints);
+            fclose(in);
+            return false;
+        }
+    }
+    fclose(in);
+    if (c.count == 0) {
+        fprintf(stderr, "%s: no thrust points\n", path);
+        return false;
+    }
+    *curve = c;
+    return true;
+}
+
+struct Distribution {
+    std::vector<float> values;
+
+    void add(float v) { values.push_back(v); }
+
+    void print(const char* name) {
+        if (values.empty()) {
+            printf("  %-34s -\n", name);
+            return;
+        }
+        std::sort(values.begin(), values.end());
+        double sum = 0.0;
+        for (float v : values) {
+            sum += v;
+        }
+        const double mean = sum / values.size();
+        double var = 0.0;
+        for (float v : values) {
+            var += (v - mean) * (v - mean);
+        }
+        auto pct = [this](double p) { return values[static_cast<size_t>(p * (values.size() - 1) + 0.5)]; };
+        printf("  %-34s mean %+8.3f  sd %7.3f  p5 %+8.3f  p50 %+8.3f  p95 %+8.3f  max %+8.3f\n", name, mean,
+               sqrt(var / values.size()), pct(0.05), pct(0.5), pct(0.95), values.back());
+    }
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    SimConfig cfg;
+    std::vector<ParamSet> sets;
+    uint32_t flights = 1000;
+    uint32_t seed = 1;
+    unsigned threads = std::thread::hardware_concurrency();
+    const char* csvPath = nullptr;
+    double motorScale = 1.0;
+
+    for (int i = 1; i < argc; ++i) {
+        const bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--params") == 0 && hasValue) {
+            ParamSet set;
+            if (!parseParams(argv[++i], &set)) {
+                usage(argv[0]);
+                return 2;
+            }
+            sets.push_back(set);
+        } else if (strcmp(argv[i], "--flights") == 0 && hasValue) {
+            flights = static_cast<uint32_t>(atol(argv[++i]));
+        } else if (strcmp(argv[i], "--seed") == 0 && hasValue) {
+            seed = static_cast<uint32_t>(atol(argv[++i]));
+        } else if (strcmp(argv[i], "--threads") == 0 && hasValue) {
+            threads = static_cast<unsigned>(atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--csv") == 0 && hasValue) {
+            csvPath = argv[++i];
+        } else if (strcmp(argv[i], "--thrust") == 0 && hasValue) {
+            if (!loadThrust(argv[++i], &cfg.motor)) {
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--motor-scale") == 0 && hasValue) {
+            motorScale = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--mass") == 0 && hasValue) {
+            cfg.dryMassKg = static_cast<float>(atof(argv[++i]));
+        } else if (strcmp(argv[i], "--propellant") == 0 && hasValue) {
+            cfg.propellantKg = static_cast<float>(atof(argv[++i]));
+        } else if (strcmp(argv[i], "--cda") == 0 && hasValue) {
+            cfg.cdA = static_cast<float>(atof(argv[++i]));
+        } else if (strcmp(argv[i], "--chute-cda") == 0 && hasValue) {
+            cfg.parachuteCdA = static_cast<float>(atof(argv[++i]));
+        } else if (strcmp(argv[i], "--deploy-delay") == 0 && hasValue) {
+            cfg.deployDelayS = static_cast<float>(atof(argv[++i]));
+        } else if (strcmp(argv[i], "--pad-alt") == 0 && hasValue) {
+            cfg.padAltitudeM = static_cast<float>(atof(argv[++i]));
+        } else if (strcmp(argv[i], "--gust") == 0 && hasValue) {
+            cfg.gustSigmaMs = static_cast<float>(atof(argv[++i]));
+        } else if (strcmp(argv[i], "--accel-noise") == 0 && hasValue) {
+            cfg.accelNoiseG = static_cast<float>(atof(argv[++i]));
+        } else if (strcmp(argv[i], "--vibration") == 0 && hasValue) {
+            cfg.boostVibrationG = static_cast<float>(atof(argv[++i]));
+        } else if (strcmp(argv[i], "--baro-noise") == 0 && hasValue) {
+            cfg.baroNoisePa = static_cast<float>(atof(argv[++i]));
+        } else if (strcmp(argv[i], "--spike") == 0 && hasValue) {
+            cfg.transonicSpikePa = static_cast<float>(atof(argv[++i]));
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (flights == 0 || motorScale <= 0.0 || cfg.gustTauS <= 0.0f) {
+        usage(argv[0]);
+        return 2;
+    }
+    if (sets.empty()) {
+        ParamSet set;
+        parseParams("", &set);
+        snprintf(set.label, sizeof(set.label), "defaults");
+        sets.push_back(set);
+    }
+    for (int i = 0; i < cfg.motor.count; ++i) {
+        cfg.motor.thrustN[i] *= static_cast<float>(motorScale);
+    }
+    cfg.propellantKg *= static_cast<float>(motorScale);
+    if (threads == 0) {
+        threads = 1;
+    }
+
+    // Every (set, flight) pair is one job; workers pull the next index until all are done.
+    const size_t jobs = sets.size() * flights;
+    std::vector<SimFlightResult> results(jobs);
+    std::atomic<size_t> next(0);
+    const auto t0 = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (unsigned w = 0; w < threads; ++w) {
+        workers.emplace_back([&]() {
+            for (size_t job = next.fetch_add(1); job < jobs; job = next.fetch_add(1)) {
+                const size_t set = job / flights;
+                const uint32_t flight = static_cast<uint32_t>(job % flights);
+                results[job] = simulateFlight(cfg, sets[set].detector, seed + flight);
+            }
+        });
+    }
+    for (std::thread& t : workers) {
+        t.join();
+    }
+    const double wallS = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    uint64_t samples = 0;
+    for (const SimFlightResult& r : results) {
+        samples += r.samples;
+    }
+    printf("%zu flights (%u per set) on %u threads in %.2f s: %.0f flights/s, %.1f M samples/s\n", jobs, flights,
+           threads, wallS, jobs / wallS, samples / wallS / 1e6);
+
+    FILE* csv = nullptr;
+    if (csvPath != nullptr) {
+        csv = fopen(csvPath, "wb");
+        if (csv == nullptr) {
+            perror(csvPath);
+            return 1;
+        }
+        fprintf(csv, "set,seed,true_apogee_s,true_apogee_m,max_mach,launch_detect_s,apogee_detect_s,early_apogee,"
+                     "deploy_s,altitude_lost_m,landing_s,landed_detect_s,predicted_event_s,coast_start_s,"
+                     "coast_predicted_apogee_m,coast_predicted_apogee_s,baro_rejects\n");
+    }
+
+    for (size_t s = 0; s < sets.size(); ++s) {
+        const FlightDetectorConfig& d = sets[s].detector;
+        printf("\nset %zu (%s): launchG=%.2f launchMs=%lu apogeeV=%.2f apogeeMs=%lu descentV=%.2f landedG=%.2f "
+               "landedAlt=%.1f landedMs=%lu leadMs=%lu predictMs=%lu predict=%d\n",
+               s + 1, sets[s].label, d.launchAccelG, static_cast<unsigned long>(d.launchDetectionMs), d.apogeeVelocity,
+               static_cast<unsigned long>(d.apogeeDetectionMs), d.descentVelocity, d.landedAccelG, d.landedAltitudeM,
+               static_cast<unsigned long>(d.landedDetectionMs), static_cast<unsigned long>(d.apogeeLeadMs),
+               static_cast<unsigned long>(d.apogeePredictMs), d.apogeeOnPrediction ? 1 : 0);
+        Distribution apogeeError;
+        Distribution altitudeLost;
+        Distribution launchDelay;
+        Distribution landedDelay;
+        Distribution apogeeM;
+        Distribution mach;
+        Distribution predictedEvent;
+        Distribution coastApogeeError;
+        Distribution coastTimeError;
+        uint32_t launchMissed = 0;
+        uint32_t apogeeMissed = 0;
+        uint32_t early = 0;
+        uint32_t landedMissed = 0;
+        for (uint32_t f = 0; f < flights; ++f) {
+            const SimFlightResult& r = results[s * flights + f];
+            apogeeM.add(r.trueApogeeM);
+            mach.add(r.maxMach);
+            launchMissed += r.launchDetected ? 0 : 1;
+            apogeeMissed += r.apogeeDetected ? 0 : 1;
+            early += r.earlyApogee ? 1 : 0;
+            landedMissed += r.landedDetected || r.landingS < 0.0f ? 0 : 1;
+            if (r.launchDetected) {
+                launchDelay.add(r.launchDetectS - r.ignitionS);
+            }
+            if (r.apogeeDetected) {
+                apogeeError.add(r.apogeeDetectS - r.trueApogeeS);
+            }
+            if (r.deployS >= 0.0f) {
+                altitudeLost.add(r.altitudeLostM);
+            }
+            if (r.landedDetected && r.landingS >= 0.0f) {
+                landedDelay.add(r.landedDetectS - r.landingS);
+            }
+            if (r.apogeePredicted) {
+                predictedEvent.add(r.predictedEventS - r.trueApogeeS);
+            }
+            if (r.coastStartS >= 0.0f) {
+                coastApogeeError.add(r.coastPredictedApogeeM - r.trueApogeeM);
+                coastTimeError.add(r.coastPredictedApogeeS - r.trueApogeeS);
+            }
+            if (csv != nullptr) {
+                fprintf(csv, "%zu,%lu,%.3f,%.1f,%.3f,%.3f,%.3f,%d,%.3f,%.2f,%.3f,%.3f,%.3f,%.3f,%.1f,%.3f,%lu\n", s + 1,
+                        static_cast<unsigned long>(seed + f), r.trueApogeeS, r.trueApogeeM, r.maxMach,
+                        r.launchDetectS, r.apogeeDetectS, r.earlyApogee ? 1 : 0, r.deployS, r.altitudeLostM,
+                        r.landingS, r.landedDetectS, r.predictedEventS, r.coastStartS, r.coastPredictedApogeeM,
+                        r.coastPredictedApogeeS, static_cast<unsigned long>(r.baroRejects));
+            }
+        }
+        printf("  missed: launch %lu, apogee %lu, landed %lu; apogee while climbing %lu\n",
+               static_cast<unsigned long>(launchMissed), static_cast<unsigned long>(apogeeMissed),
+               static_cast<unsigned long>(landedMissed), static_cast<unsigned long>(early));
+        apogeeM.print("true apogee (m)");
+        mach.print("max Mach");
+        apogeeError.print("apogee detect - true apogee (s)");
+        altitudeLost.print("altitude lost at deploy (m)");
+        launchDelay.print("launch detect - ignition (s)");
+        landedDelay.print("landed detect - touchdown (s)");
+        predictedEvent.print("predicted event - true apogee (s)");
+        coastApogeeError.print("predicted apogee err, 1 s coast (m)");
+        coastTimeError.print("predicted time err, 1 s coast (s)");
+    }
+    if (csv != nullptr) {
+        fclose(csv);
+    }
+    return 0;
+}